@@ -700,6 +700,13 @@ int main(int argc, char **argv, char **envp) {
 		}
 		r_list_free (evals);
 #endif
+		if (!has_project && r_config_get_i (r.config, "anal.cache")) {
+			if (r_core_anal_cache_load (&r, NULL)) {
+				if (!quiet)
+					eprintf ("NOTE: Loaded analysis cache.\n");
+				do_analysis = 0;
+			}
+		}
 		// no flagspace selected by default the beginning
 		r.flags->space_idx = -1;
 		/* load <file>.r2 */
@@ -19,6 +19,7 @@ static ut32 count = 0;
 static int showcount = 0;
 static int useva = R_TRUE;
 static int delta = 0;
+static int chunks = 0;
 static int showbare = R_FALSE;
 static int json_started = 0;
 static int diffmode = 0; 
@@ -93,7 +94,7 @@ static RCore* opencore(const char *f) {
 }
 
 static int show_help(int v) {
-	printf ("Usage: radiff2 [-abcCdjrspOv] [-g sym] [-t %%] [file] [file]\n");
+	printf ("Usage: radiff2 [-abcCdjkrspOv] [-g sym] [-t %%] [file] [file]\n");
 	if (v) printf (
 		"  -a [arch]  specify architecture plugin to use (x86, arm, ..)\n"
 		"  -b [bits]  specify register size for arch (16 (thumb), 32, 64, ..)\n"
@@ -103,6 +104,7 @@ static int show_help(int v) {
 		"  -d         use delta diffing\n"
 		"  -g [sym|off1,off2]   graph diff of given symbol, or between two offsets\n"
 		"  -j         output in json format\n"
+		"  -k         chunked diff, fast on big files with moved or inserted data\n"
 		"  -n         print bare addresses only (diff.bare=1)\n"
 		"  -O         code diffing with opcode bytes only\n"
 		"  -p         use physical addressing (io.va=0)\n"
@@ -171,7 +173,7 @@ int main(int argc, char **argv) {
 	int gdiff_mode = 0;
 	double sim;
 
-	while ((o = getopt (argc, argv, "a:b:Cnpg:Ojrhcdsvxt:")) != -1) {
+	while ((o = getopt (argc, argv, "a:b:Cnpg:Ojkrhcdsvxt:")) != -1) {
 		switch (o) {
 		case 'a':
 			arch = optarg;
@@ -209,6 +211,9 @@ int main(int argc, char **argv) {
 		case 'd':
 			delta = 1;
 			break;
+		case 'k':
+			chunks = 1;
+			break;
 		case 'h':
 			return show_help (1);
 		case 's':
@@ -325,7 +330,9 @@ int main(int argc, char **argv) {
 			printf("\"changes\":[");
 		}
 		r_diff_set_callback (d, &cb, 0);//(void *)(size_t)diffmode);
-		r_diff_buffers (d, bufa, sza, bufb, szb);
+		if (chunks)
+			r_diff_buffers_chunks (d, bufa, sza, bufb, szb);
+		else r_diff_buffers (d, bufa, sza, bufb, szb);
 		if (diffmode == 'j')
 			printf("]\n");
 		r_diff_free (d);
@@ -14,6 +14,8 @@ static ut64 to = 0LL;
 static int incremental = 1;
 static int iterations = 0;
 static int quiet = 0;
+static int treemode = 0;
+static int nthreads = 0;
 static RHashSeed s = {0}, *_s = NULL;
 
 static void do_hash_seed(const char *seed) {
@@ -85,13 +87,7 @@ static void do_hash_print(RHash *ctx, int hash, int dlen, int rad, int ule) {
 	}
 }
 
-static int do_hash_internal(RHash *ctx, int hash, const ut8 *buf, int len, int rad, int print, int le) {
-	int dlen;
-	if (len<1)
-		return 0;
-	dlen = r_hash_calculate (ctx, hash, buf, len);
-	if (!dlen) return 0;
-	if (!print) return 1;
+static void do_hash_output(RHash *ctx, int hash, int dlen, const ut8 *buf, int len, int rad, int le) {
 	if (hash == R_HASH_ENTROPY) {
 		double e = r_hash_entropy (buf, len);
 		if (rad) {
@@ -107,15 +103,160 @@ static int do_hash_internal(RHash *ctx, int hash, const ut8 *buf, int len, int r
 			r_hash_do_spice (ctx, hash, iterations, _s);
 		do_hash_print (ctx, hash, dlen, rad, le);
 	}
+}
+
+static int do_hash_internal(RHash *ctx, int hash, const ut8 *buf, int len, int rad, int print, int le) {
+	int dlen;
+	if (len<1)
+		return 0;
+	dlen = r_hash_calculate (ctx, hash, buf, len);
+	if (!dlen) return 0;
+	if (print)
+		do_hash_output (ctx, hash, dlen, buf, len, rad, le);
 	return 1;
 }
 
+/* double buffered reads: the next window is read by a thread
+ * while the current one is being hashed */
+typedef struct {
+	RIO *io;
+	RThread *th;
+	ut8 *buf[2];
+	int size, cur;
+	ut64 addr;
+	int len;
+} HashReader;
+
+static int reader_thread(RThread *th) {
+	HashReader *r = th->user;
+	r_io_pread (r->io, r->addr, r->buf[r->cur], r->len);
+	return R_FALSE;
+}
+
+static int reader_start(HashReader *r, ut64 addr, int len) {
+	r->cur = !r->cur;
+	if (!r->buf[r->cur] && !(r->buf[r->cur] = malloc (r->size + 1)))
+		return R_FALSE;
+	r->addr = addr;
+	r->len = len;
+	r->th = r_th_new (reader_thread, r, 0);
+	if (!r->th)
+		r_io_pread (r->io, addr, r->buf[r->cur], len);
+	return R_TRUE;
+}
+
+static ut8 *reader_wait(HashReader *r) {
+	if (r->th) {
+		r_th_free (r->th);
+		r->th = NULL;
+	}
+	return r->buf[r->cur];
+}
+
+static void reader_fini(HashReader *r) {
+	reader_wait (r);
+	free (r->buf[0]);
+	free (r->buf[1]);
+}
+
+#define HASH_WINDOW 0x2000000
+#define TREE_BSIZE 0x100000
+
+/* per-block digests of [from, to), or the merkle root of them when
+ * leaves is not NULL. blocks of each window are hashed in parallel */
+static int do_hash_blocks(RIO *io, RHash *ctx, int hashbit, int bsize, int rad, int ule, ut8 **leaves, int *nleaves) {
+	int k, n, dlen = r_hash_size (hashbit);
+	ut64 j, f = from, t = to, wsize = R_MAX (1, HASH_WINDOW / bsize) * (ut64)bsize;
+	HashReader r = { io };
+	ut8 *buf, *out;
+
+	if (!dlen || f >= t)
+		return R_FALSE;
+	r.size = (int)R_MIN (wsize, t - f);
+	out = malloc ((r.size / bsize + 1) * dlen);
+	if (!out || !reader_start (&r, f, r.size)) {
+		free (out);
+		return R_FALSE;
+	}
+	for (j=f; j<t; j+=wsize) {
+		int len = (int)R_MIN (wsize, t-j);
+		buf = reader_wait (&r);
+		if (j+wsize < t)
+			reader_start (&r, j+wsize, (int)R_MIN (wsize, t-j-wsize));
+		n = r_hash_calculate_blocks (hashbit, buf, len, bsize, out, nthreads);
+		if (leaves) {
+			ut8 *p = realloc (*leaves, (*nleaves + n) * dlen);
+			if (!p) break;
+			*leaves = p;
+			memcpy (p + *nleaves * dlen, out, n * dlen);
+			*nleaves += n;
+			continue;
+		}
+		for (k=0; k<n; k++) {
+			from = j + (ut64)k * bsize;
+			to = R_MIN (from + bsize, t);
+			memcpy (ctx->digest, out + k * dlen, dlen);
+			do_hash_output (ctx, hashbit, dlen, buf + k * bsize,
+				(int)(to - from), rad, ule);
+		}
+	}
+	from = f;
+	to = t;
+	reader_fini (&r);
+	free (out);
+	return R_TRUE;
+}
+
+typedef struct {
+	RHash **ctx;
+	int *bits;
+	int first, n, step;
+	const ut8 *buf;
+	int len;
+} HashAlgoWorker;
+
+static void hash_algos(HashAlgoWorker *w) {
+	int k;
+	for (k=w->first; k<w->n; k+=w->step)
+		r_hash_calculate (w->ctx[k], w->bits[k], w->buf, w->len);
+}
+
+static int hash_algos_thread(RThread *th) {
+	hash_algos (th->user);
+	return R_FALSE;
+}
+
+/* feed the same buffer to independent algorithms, one thread each */
+static void do_hash_update(RHash **ctx, int *bits, int n, const ut8 *buf, int len) {
+	HashAlgoWorker w[32];
+	RThread *th[32];
+	int k, nth = R_MIN (r_hash_threads (nthreads), n);
+
+	if (len<1)
+		return;
+	for (k=0; k<nth; k++) {
+		w[k].ctx = ctx;
+		w[k].bits = bits;
+		w[k].first = k;
+		w[k].n = n;
+		w[k].step = nth;
+		w[k].buf = buf;
+		w[k].len = len;
+		th[k] = k? r_th_new (hash_algos_thread, &w[k], 0): NULL;
+	}
+	hash_algos (&w[0]);
+	for (k=1; k<nth; k++) {
+		if (th[k])
+			r_th_free (th[k]);
+		else hash_algos (&w[k]);
+	}
+}
+
 
 static int do_hash(const char *file, const char *algo, RIO *io, int bsize, int rad, int ule) {
 	ut64 j, fsize, algobit = r_hash_name_to_bits (algo);
 	RHash *ctx;
-	ut8 *buf;
-	int i, first = 1;
+	int i, k, first = 1;
 	if (algobit == R_HASH_NONE) {
 		eprintf ("rahash2: Invalid hashing algorithm specified\n");
 		return 1;
@@ -126,6 +267,7 @@ static int do_hash(const char *file, const char *algo, RIO *io, int bsize, int r
 		return 1;
 	}
 	if (bsize<0) bsize = fsize / -bsize;
+	if (treemode && bsize == 0) bsize = TREE_BSIZE;
 	if (bsize == 0 || bsize > fsize) bsize = fsize;
 	if (to == 0LL) to = fsize;
 	if (from>to) {
@@ -136,19 +278,83 @@ static int do_hash(const char *file, const char *algo, RIO *io, int bsize, int r
 		eprintf ("rahash2: Unknown file size\n");
 		return 1;
 	}
-	buf = malloc (bsize+1);
-	if (!buf)
-		return 1;
 	ctx = r_hash_new (R_TRUE, algobit);
+	if (!ctx)
+		return 1;
 
 	if (rad == 'j')
 		printf ("[");
-	if (incremental) {
+	if (treemode) {
+		if (s.buf)
+			eprintf ("Warning: Seed ignored on tree hashing.\n");
 		for (i=1; i<0x800000; i<<=1) {
+			ut8 *leaves = NULL;
+			int nleaves = 0, dlen = r_hash_size (i);
+			if (!(algobit & i) || !dlen || !*r_hash_name (i))
+				continue;
+			if (!do_hash_blocks (io, ctx, i, bsize, rad, ule, &leaves, &nleaves)
+					|| !r_hash_calculate_root (i, leaves, nleaves, nthreads)) {
+				free (leaves);
+				continue;
+			}
+			memcpy (ctx->digest, leaves, dlen);
+			free (leaves);
+			if (iterations>0)
+				r_hash_do_spice (ctx, i, iterations, _s);
+			if (rad == 'j') {
+				if (first) {
+					first = 0;
+				} else {
+					printf (",");
+				}
+			}
+			if (!quiet && rad != 'j')
+				printf ("%s: ", file);
+			do_hash_print (ctx, i, dlen, rad, ule);
+		}
+	} else if (incremental) {
+		HashReader r = { io };
+		RHash *ctxs[32];
+		int bits[32], n = 0;
+		for (i=1; i<0x800000 && n<32; i<<=1) {
 			if (algobit & i) {
-				int hashbit = i & algobit;
-				int dlen = r_hash_size (hashbit);
-				r_hash_do_begin (ctx, i);
+				bits[n] = i;
+				ctxs[n] = r_hash_new (R_TRUE, i);
+				if (!ctxs[n])
+					break;
+				r_hash_do_begin (ctxs[n], i);
+				if (s.buf && s.prefix) {
+					do_hash_internal (ctxs[n],
+						i, s.buf, s.len, rad, 0, ule);
+				}
+				n++;
+			}
+		}
+		/* the whole range goes through the same digest, so read it in
+		 * fixed windows whatever -b says, the next one while hashing */
+		r.size = (int)R_MIN (HASH_WINDOW, to-from);
+		if (reader_start (&r, from, r.size)) {
+			for (j=from; j<to; j+=HASH_WINDOW) {
+				int len = (int)R_MIN (HASH_WINDOW, to-j);
+				const ut8 *buf = reader_wait (&r);
+				if (j+HASH_WINDOW<to) {
+					reader_start (&r, j+HASH_WINDOW,
+						(int)R_MIN (HASH_WINDOW, to-j-HASH_WINDOW));
+				}
+				do_hash_update (ctxs, bits, n, buf, len);
+			}
+		}
+		reader_fini (&r);
+		for (k=0; k<n; k++) {
+			i = bits[k];
+			if (s.buf && !s.prefix) {
+				do_hash_internal (ctxs[k], i, s.buf,
+					s.len, rad, 0, ule);
+			}
+			r_hash_do_end (ctxs[k], i);
+			if (iterations>0)
+				r_hash_do_spice (ctxs[k], i, iterations, _s);
+			if (*r_hash_name (i)) {
 				if (rad == 'j') {
 					if (first) {
 						first = 0;
@@ -156,29 +362,11 @@ static int do_hash(const char *file, const char *algo, RIO *io, int bsize, int r
 						printf (",");
 					}
 				}
-				if (s.buf && s.prefix) {
-					do_hash_internal (ctx,
-						hashbit, s.buf, s.len, rad, 0, ule);
-				}
-				for (j=from; j<to; j+=bsize) {
-					int len = ((j+bsize)>to)? (to-j): bsize;
-					r_io_pread (io, j, buf, len);
-					do_hash_internal (ctx, hashbit, buf,
-						len, rad, 0, ule);
-				}
-				if (s.buf && !s.prefix) {
-					do_hash_internal (ctx, hashbit, s.buf,
-						s.len, rad, 0, ule);
-				}
-				r_hash_do_end (ctx, i);
-				if (iterations>0)
-					r_hash_do_spice (ctx, i, iterations, _s);
-				if (!*r_hash_name (i))
-					continue;
 				if (!quiet && rad != 'j')
 					printf ("%s: ", file);
-				do_hash_print (ctx, i, dlen, rad, ule);
+				do_hash_print (ctxs[k], i, r_hash_size (i), rad, ule);
 			}
+			r_hash_free (ctxs[k]);
 		}
 		if (_s)
 			free (_s->buf);
@@ -187,41 +375,25 @@ static int do_hash(const char *file, const char *algo, RIO *io, int bsize, int r
 		if (s.buf)
 			eprintf ("Warning: Seed ignored on per-block hashing.\n");
 		for (i=1; i<0x800000; i<<=1) {
-			ut64 f, t, ofrom, oto;
-			if (algobit & i) {
-				int hashbit = i & algobit;
-				ofrom = from;
-				oto = to;
-				f = from;
-				t = to;
-				for (j=f; j<t; j+=bsize) {
-					int nsize = (j+bsize<fsize)? bsize: (fsize-j);
-					r_io_pread (io, j, buf, bsize);
-					from = j;
-					to = j+bsize;
-					if (to>fsize)
-						to = fsize;
-					do_hash_internal (ctx, hashbit, buf, nsize, rad, 1, ule);
-				}
-				from = ofrom;
-				to = oto;
-			}
+			if (algobit & i)
+				do_hash_blocks (io, ctx, i, bsize, rad, ule, NULL, NULL);
 		}
 	}
 	if (rad == 'j')
 		printf ("]\n");
 	r_hash_free (ctx);
-	free (buf);
 	return 0;
 }
 
 static int do_help(int line) {
-	printf ("Usage: rahash2 [-rBhLkv] [-b sz] [-a algo] [-s str] [-f from] [-t to] [file] ...\n");
+	printf ("Usage: rahash2 [-rBThLkv] [-b sz] [-p n] [-a algo] [-s str] [-f from] [-t to] [file] ...\n");
 	if (line) return 0;
 	printf (
 	" -a algo     comma separated list of algorithms (default is 'sha256')\n"
 	" -b bsize    specify the size of the block (instead of full file)\n"
 	" -B          show per-block hash\n"
+	" -T          show the merkle tree hash of -b blocks (1M by default)\n"
+	" -p threads  number of hashing threads (0 = one per cpu)\n"
 	" -e          swap endian (use little endian)\n"
 	" -d / -D     encode/decode base64 string (-s) or file to stdout\n"
 	" -f from     start hashing at given address\n"
@@ -269,7 +441,7 @@ int main(int argc, char **argv) {
 	RHash *ctx;
 	RIO *io;
 
-	while ((c = getopt (argc, argv, "jdDrvea:i:S:s:x:b:nBhf:t:kLq")) != -1) {
+	while ((c = getopt (argc, argv, "jdDrvea:i:S:s:x:b:nBThf:t:kLqp:")) != -1) {
 		switch (c) {
 		case 'q': quiet = 1; break;
 		case 'i': iterations = atoi (optarg);
@@ -289,6 +461,8 @@ int main(int argc, char **argv) {
 		case 'k': rad = 2; break;
 		case 'a': algo = optarg; break;
 		case 'B': incremental = 0; break;
+		case 'T': treemode = 1; break;
+		case 'p': nthreads = atoi (optarg); break;
 		case 'b': bsize = (int)r_num_math (NULL, optarg); break;
 		case 'f': from = r_num_math (NULL, optarg); break;
 		case 't': to = 1+r_num_math (NULL, optarg); break;
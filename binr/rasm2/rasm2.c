@@ -62,7 +62,7 @@ static void rasm2_list(RAsm *a, const char *arch) {
 }
 
 static int rasm_show_help(int v) {
-	printf ("Usage: rasm2 [-CdDehLBvw] [-a arch] [-b bits] [-o addr] [-s syntax]\n"
+	printf ("Usage: rasm2 [-CdDehLBSvw] [-a arch] [-b bits] [-o addr] [-s syntax]\n"
 		"             [-f file] [-F fil:ter] [-i skip] [-l len] 'code'|hex|-\n");
 	if (v)
 	printf (" -a [arch]    Set architecture to assemble/disassemble (see -L)\n"
@@ -82,6 +82,7 @@ static int rasm_show_help(int v) {
 		" -o [offset]  Set start address for code (default 0)\n"
 		" -O [file]    Output file name (rasm2 -Bf a.asm -O a)\n"
 		" -s [syntax]  Select syntax (intel, att)\n"
+		" -S           Stream raw bytes of -f file or stdin to the disassembler (-d, -D)\n"
 		" -B           Binary input/output (-l is mandatory for binary input)\n"
 		" -v           Show version information\n"
 		" -w           What's this instruction for? describe opcode\n"
@@ -148,6 +149,66 @@ beach:
 	return ret;
 }
 
+#define STREAM_CHUNK (1024*1024)
+#define STREAM_TAIL 32
+#define STREAM_OPS 8192
+
+/* -S: raw bytes read in chunks and swept by one thread per cpu,
+ * nothing is allocated per instruction */
+static ut64 rasm_disasm_stream(int fd, ut64 offset, ut64 skip, ut64 len, int hex) {
+	RAsmBatch b = {0};
+	char hexstr[R_ASM_BUFSIZE];
+	ut64 total = 0, left = len? len: UT64_MAX;
+	int i, n, avail = 0, eof = 0, done;
+	ut8 *data = malloc (STREAM_CHUNK);
+
+	b.maxops = STREAM_OPS;
+	b.textsize = STREAM_OPS * 32;
+	b.ops = malloc (b.maxops * sizeof (RAsmOpRec));
+	b.text = malloc (b.textsize);
+	if (!data || !b.ops || !b.text)
+		goto beach;
+	for (; skip > 0; skip -= n)
+		if ((n = read (fd, data, R_MIN (skip, STREAM_CHUNK))) < 1)
+			break;
+	r_asm_set_pc (a, offset);
+	for (;;) {
+		while (!eof && avail < STREAM_CHUNK && left > 0) {
+			n = read (fd, data + avail, R_MIN (STREAM_CHUNK - avail, left));
+			if (n < 1) eof = 1;
+			else {
+				avail += n;
+				left -= n;
+			}
+		}
+		if (!left) eof = 1;
+		b.nops = b.textlen = 0;
+		b.minlen = eof? 0: STREAM_TAIL;
+		done = r_asm_sweep (a, &b, data, avail, 0);
+		if (done < 0)
+			break;
+		for (i = 0; i < b.nops; i++) {
+			RAsmOpRec *op = &b.ops[i];
+			if (hex) {
+				n = R_MIN (op->size, (sizeof (hexstr) / 2) - 1);
+				r_hex_bin2str (data + (op->addr - offset - total), n, hexstr);
+				printf ("0x%08"PFMT64x"  %2d %24s  %s\n", op->addr, op->size,
+					hexstr, op->type == R_ASM_OPREC_INVALID? "invalid": b.text + op->text);
+			} else printf ("%s\n", b.text + op->text);
+		}
+		total += done;
+		avail -= done;
+		memmove (data, data + done, avail);
+		if (eof && (!avail || !done))
+			break;
+	}
+beach:
+	free (data);
+	free (b.ops);
+	free (b.text);
+	return total;
+}
+
 static void print_buf(char *str) {
 	int i;
 	if (coutput) {
@@ -204,7 +265,7 @@ int main(int argc, char *argv[]) {
 	char buf[R_ASM_BUFSIZE];
 	char *arch = NULL, *file = NULL, *filters = NULL, *kernel = NULL, *cpu = NULL;
 	ut64 offset = 0;
-	int fd =-1, dis = 0, ascii = 0, bin = 0, ret = 0, bits = 32, c, whatsop = 0;
+	int fd =-1, dis = 0, ascii = 0, bin = 0, ret = 0, bits = 32, c, whatsop = 0, stream = 0;
 	ut64 len = 0, idx = 0, skip = 0;
 
 	if (argc<2)
@@ -227,7 +288,7 @@ int main(int argc, char *argv[]) {
 
 	r_asm_use (a, R_SYS_ARCH);
 	r_asm_set_big_endian (a, R_FALSE);
-	while ((c = getopt (argc, argv, "i:k:DCc:eva:b:s:do:Bl:hLf:F:wO:")) != -1) {
+	while ((c = getopt (argc, argv, "i:k:DCc:eva:b:s:Sdo:Bl:hLf:F:wO:")) != -1) {
 		switch (c) {
 		case 'k':
 			kernel = optarg;
@@ -261,6 +322,9 @@ int main(int argc, char *argv[]) {
 		case 'd':
 			dis = 1;
 			break;
+		case 'S':
+			stream = 1;
+			break;
 		case 'o':
 			offset = r_num_math (NULL, optarg);
 			break;
@@ -344,6 +408,17 @@ int main(int argc, char *argv[]) {
 		}
 	}
 
+	if (stream) {
+		int in = (!file || !strcmp (file, "-"))? 0: open (file, O_RDONLY);
+		if (in == -1) {
+			eprintf ("rasm2: Cannot open file %s\n", file);
+			ret = 1;
+			goto beach;
+		}
+		ret = !rasm_disasm_stream (in, offset, skip, len, dis == 2);
+		if (in) close (in);
+		goto beach;
+	}
 	if (file) {
 		char *content;
 		int length = 0;
@@ -97,6 +97,7 @@ R_API RAnal *r_anal_new() {
 	//anal->sdb_locals = sdb_ns (anal->sdb, "locals", 1);
 	anal->sdb_types = sdb_ns (anal->sdb, "types", 1);
 	anal->printf = (PrintfCallback) printf;
+	anal->lock = r_th_rwlock_new ();
 	r_anal_pin_init (anal);
 	r_anal_type_init (anal);
 	r_anal_xrefs_init (anal);
@@ -141,15 +142,18 @@ R_API RAnal *r_anal_free(RAnal *a) {
 	if (!a) return NULL;
 	/* TODO: Free anals here */
 	R_FREE (a->cpu);
+	r_anal_opcache_set (a, 0);
 	r_list_free (a->plugins);
 	a->fcns->free = r_anal_fcn_free;
 	r_list_free (a->fcns);
 	// might provoke double frees since this is used in r_anal_fcn_insert()
 	//r_listrange_free (a->fcnstore);
+	r_meta_free (a);
 	r_space_fini (&a->meta_spaces);
 	r_anal_pin_fini (a);
 	r_list_free (a->refs);
 	r_list_free (a->types);
+	free (a->dirty);
 	r_reg_free (a->reg);
 	r_anal_op_free (a->queued);
 	a->sdb = NULL;
@@ -159,12 +163,29 @@ R_API RAnal *r_anal_free(RAnal *a) {
 		r_anal_esil_free (a->esil);
 		a->esil = NULL;
 	}
+	r_th_rwlock_free (a->lock);
 	// r_io_free(anal->iob.io); // need r_core (but recursive problem to fix)
 	memset (a, 0, sizeof (RAnal));
 	free (a);
 	return NULL;
 }
 
+/* see RAnal.lock, the write side is not reentrant */
+R_API void r_anal_lock_read(RAnal *anal) {
+	if (anal->lock)
+		r_th_rwlock_read (anal->lock);
+}
+
+R_API void r_anal_lock_write(RAnal *anal) {
+	if (anal->lock)
+		r_th_rwlock_write (anal->lock);
+}
+
+R_API void r_anal_unlock(RAnal *anal) {
+	if (anal->lock)
+		r_th_rwlock_unlock (anal->lock);
+}
+
 R_API void r_anal_set_user_ptr(RAnal *anal, void *user) {
 	anal->user = user;
 }
@@ -346,6 +367,7 @@ R_API int r_anal_op_is_eob (RAnalOp *op) {
 R_API int r_anal_purge (RAnal *anal) {
 	sdb_reset (anal->sdb_fcns);
 	sdb_reset (anal->sdb_meta);
+	r_meta_free (anal);
 	sdb_reset (anal->sdb_hints);
 	sdb_reset (anal->sdb_xrefs);
 	sdb_reset (anal->sdb_types);
@@ -359,5 +381,6 @@ R_API int r_anal_purge (RAnal *anal) {
 	anal->refs = r_anal_ref_list_new ();
 	r_list_free (anal->types);
 	anal->types = r_anal_type_list_new ();
+	anal->ndirty = 0;
 	return 0;
 }
@@ -3,6 +3,7 @@
 #include <r_anal.h>
 #include <r_util.h>
 #include <r_diff.h>
+#include <r_th.h>
 
 R_API RAnalDiff *r_anal_diff_new() {
 	RAnalDiff *diff = R_NEW (RAnalDiff);
@@ -38,6 +39,16 @@ R_API void r_anal_diff_setup_i(RAnal *anal, int doops, int thbb, int thfcn) {
 	anal->diff_thfcn = (thfcn>=0)? ((double)thfcn)/100: R_ANAL_THRESHOLDFCN;
 }
 
+/* similarity of two fingerprints, only exact when it is above th */
+static double fingerprint_similarity(const ut8 *a, ut32 la, const ut8 *b, ut32 lb, double th) {
+	double t = 0;
+	ut32 maxdist = UT32_MAX;
+	if (th > 0 && th <= 1)
+		maxdist = (ut32)((1 - th) * R_MAX (la, lb)) + 1;
+	r_diff_buffers_distance_max (NULL, a, la, b, lb, maxdist, NULL, &t);
+	return t;
+}
+
 // Fingerprint function basic block
 R_API int r_anal_diff_fingerprint_bb(RAnal *anal, RAnalBlock *bb) {
 	RAnalOp *op;
@@ -99,12 +110,13 @@ R_API int r_anal_diff_fingerprint_fcn(RAnal *anal, RAnalFunction *fcn) {
 R_API int r_anal_diff_bb(RAnal *anal, RAnalFunction *fcn, RAnalFunction *fcn2) {
 	RAnalBlock *bb, *bb2, *mbb, *mbb2;
 	RListIter *iter, *iter2;
-	double t, ot;
+	double t = 0, ot, th;
 
 	if (!anal) return R_FALSE;
 	if (anal->cur && anal->cur->diff_bb)
 		return (anal->cur->diff_bb (anal, fcn, fcn2));
 
+	th = R_MIN (anal->diff_thbb, anal->diff_thfcn);
 	fcn->diff->type = fcn2->diff->type = R_ANAL_DIFF_TYPE_MATCH;
 	r_list_foreach (fcn->bbs, iter, bb) {
 		if (bb->diff && bb->diff->type != R_ANAL_DIFF_TYPE_NULL)
@@ -113,8 +125,8 @@ R_API int r_anal_diff_bb(RAnal *anal, RAnalFunction *fcn, RAnalFunction *fcn2) {
 		mbb = mbb2 = NULL;
 		r_list_foreach (fcn2->bbs, iter2, bb2) {
 			if (bb2->diff && bb2->diff->type == R_ANAL_DIFF_TYPE_NULL) {
-				r_diff_buffers_distance (NULL, bb->fingerprint, bb->size,
-						bb2->fingerprint, bb2->size, NULL, &t);
+				t = fingerprint_similarity (bb->fingerprint, bb->size,
+						bb2->fingerprint, bb2->size, th);
 #if 0
 				eprintf ("BB: %llx - %llx => %lli - %lli => %f\n", bb->addr, bb2->addr,
 						bb->size, bb->size, t);
@@ -142,11 +154,230 @@ R_API int r_anal_diff_bb(RAnal *anal, RAnalFunction *fcn, RAnalFunction *fcn2) {
 	return R_TRUE;
 }
 
+/* Functions are matched in passes: same name, same fingerprint, and then by
+ * edit distance against a few candidates picked from an index of cheap
+ * features (basic blocks, size, cyclomatic complexity and calls) */
+
+#define DIFF_CANDIDATES 32
+#define DIFF_MAX_THREADS 16
+
+typedef struct {
+	RAnalFunction *fcn;
+	int idx; /* position in fcns2, ties go to the first like in a list walk */
+	int bbs, cc, calls;
+} RAnalDiffFcn;
+
+typedef struct {
+	int bbs, from, to;
+} RAnalDiffGroup;
+
+typedef struct {
+	RAnalDiffFcn f;
+	RAnalDiffFcn *cand[DIFF_CANDIDATES];
+	int score[DIFF_CANDIDATES];
+	double t[DIFF_CANDIDATES];
+	int n;
+} RAnalDiffMatch;
+
+typedef struct {
+	RAnalDiffMatch *m;
+	double th;
+	int from, to;
+} RAnalDiffWorker;
+
+static ut32 fingerprint_hash(const ut8 *buf, ut32 len) {
+	ut32 h = 0x811c9dc5;
+	while (len--)
+		h = (h ^ *buf++) * 0x01000193;
+	return h;
+}
+
+static void bucket_add(RHashTable *ht, RList *buckets, ut32 hash, void *data) {
+	RList *l = r_hashtable_lookup (ht, hash);
+	if (!l) {
+		l = r_list_new ();
+		r_list_append (buckets, l);
+		r_hashtable_insert (ht, hash, l);
+	}
+	r_list_append (l, data);
+}
+
+static int fcn_diffable(RAnalFunction *fcn) {
+	return (fcn->type == R_ANAL_FCN_TYPE_FCN || fcn->type == R_ANAL_FCN_TYPE_SYM) &&
+		fcn->diff->type == R_ANAL_DIFF_TYPE_NULL;
+}
+
+static void fcn_match(RAnal *anal, RAnalFunction *fcn, RAnalFunction *fcn2, double t) {
+	/* Set flag in matched functions */
+	fcn->diff->type = fcn2->diff->type = (t==1)?
+		R_ANAL_DIFF_TYPE_MATCH: R_ANAL_DIFF_TYPE_UNMATCH;
+	fcn->diff->dist = fcn2->diff->dist = t;
+	R_FREE (fcn->fingerprint);
+	R_FREE (fcn2->fingerprint);
+	fcn->diff->addr = fcn2->addr;
+	fcn2->diff->addr = fcn->addr;
+	R_FREE (fcn->diff->name);
+	if (fcn2->name)
+		fcn->diff->name = strdup (fcn2->name);
+	R_FREE (fcn2->diff->name);
+	if (fcn->name)
+		fcn2->diff->name = strdup (fcn->name);
+	r_anal_diff_bb (anal, fcn, fcn2);
+}
+
+static void fcn_features(RAnalDiffFcn *f, RAnalFunction *fcn, int idx) {
+	RListIter *iter;
+	RAnalRef *ref;
+	f->fcn = fcn;
+	f->idx = idx;
+	f->bbs = r_list_length (fcn->bbs);
+	f->cc = r_anal_fcn_cc (fcn);
+	f->calls = 0;
+	r_list_foreach (fcn->refs, iter, ref) {
+		if (ref->type == R_ANAL_REF_TYPE_CALL)
+			f->calls++;
+	}
+}
+
+static int fcn_cmp(const void *a, const void *b) {
+	const RAnalDiffFcn *fa = a, *fb = b;
+	if (fa->bbs != fb->bbs)
+		return fa->bbs - fb->bbs;
+	if (fa->fcn->size != fb->fcn->size)
+		return (fa->fcn->size < fb->fcn->size)? -1: 1;
+	return fa->idx - fb->idx;
+}
+
+/* keep the closest candidates, sorted by score */
+static void cand_add(RAnalDiffMatch *m, RAnalDiffFcn *f, int score) {
+	int i = m->n;
+	if (i == DIFF_CANDIDATES) {
+		if (score >= m->score[i - 1])
+			return;
+		i--;
+	} else m->n++;
+	for (; i > 0 && m->score[i - 1] > score; i--) {
+		m->cand[i] = m->cand[i - 1];
+		m->score[i] = m->score[i - 1];
+	}
+	m->cand[i] = f;
+	m->score[i] = score;
+}
+
+/* fcns2[from..to) have the same basic block count and are sorted by size */
+static void cand_group(RAnalDiffMatch *m, RAnalDiffFcn *fcns2, int from, int to, double th) {
+	ut32 size = m->f.fcn->size, maxsize, minsize;
+	int lo = from, hi = to, mid, i, score;
+
+	/* skip the ones that are too small to pass the threshold */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (fcns2[mid].fcn->size < (ut32)(size * th))
+			lo = mid + 1;
+		else hi = mid;
+	}
+	for (i = lo; i < to; i++) {
+		RAnalDiffFcn *f = &fcns2[i];
+		maxsize = R_MAX (size, f->fcn->size);
+		minsize = R_MIN (size, f->fcn->size);
+		if (maxsize * th > minsize) {
+			if (f->fcn->size > size)
+				break;
+			continue;
+		}
+		score = abs (m->f.bbs - f->bbs) + abs (m->f.cc - f->cc) +
+			abs (m->f.calls - f->calls) +
+			(int)((ut64)(maxsize - minsize) * 64 / maxsize);
+		cand_add (m, f, score);
+	}
+}
+
+/* walk the groups outwards from the same basic block count, the score is
+ * never below the block count difference so we can stop early */
+static void cand_find(RAnalDiffMatch *m, RAnalDiffFcn *fcns2,
+		RAnalDiffGroup *groups, int ngroups, double th) {
+	RAnalDiffGroup *g;
+	int l, r, mid;
+
+	l = 0;
+	r = ngroups;
+	while (l < r) {
+		mid = l + (r - l) / 2;
+		if (groups[mid].bbs < m->f.bbs)
+			l = mid + 1;
+		else r = mid;
+	}
+	l = r - 1;
+	while (l >= 0 || r < ngroups) {
+		if (r >= ngroups || (l >= 0 && m->f.bbs - groups[l].bbs <= groups[r].bbs - m->f.bbs))
+			g = &groups[l--];
+		else g = &groups[r++];
+		if (m->n == DIFF_CANDIDATES && abs (g->bbs - m->f.bbs) >= m->score[m->n - 1])
+			break;
+		cand_group (m, fcns2, g->from, g->to, th);
+	}
+}
+
+static void match_range(RAnalDiffWorker *w) {
+	RAnalFunction *fcn, *fcn2;
+	int i, j;
+	for (i = w->from; i < w->to; i++) {
+		RAnalDiffMatch *m = &w->m[i];
+		fcn = m->f.fcn;
+		for (j = 0; j < m->n; j++) {
+			fcn2 = m->cand[j]->fcn;
+			m->t[j] = fingerprint_similarity (fcn->fingerprint, fcn->size,
+				fcn2->fingerprint, fcn2->size, w->th);
+		}
+	}
+}
+
+static int match_thread(RThread *th) {
+	match_range (th->user);
+	return R_FALSE;
+}
+
+static int diff_threads() {
+	return R_MIN (r_sys_cpus (), DIFF_MAX_THREADS);
+}
+
+/* compute the similarity of every candidate pair */
+static void match_all(RAnalDiffMatch *ms, int n, double th) {
+	RAnalDiffWorker workers[DIFF_MAX_THREADS];
+	RThread *threads[DIFF_MAX_THREADS];
+	int i, nth = diff_threads ();
+
+	if (nth > n / 16) nth = n / 16;
+	if (nth < 2) {
+		RAnalDiffWorker w = { ms, th, 0, n };
+		match_range (&w);
+		return;
+	}
+	for (i = 0; i < nth; i++) {
+		workers[i].m = ms;
+		workers[i].th = th;
+		workers[i].from = (n * i) / nth;
+		workers[i].to = (n * (i + 1)) / nth;
+		threads[i] = r_th_new (match_thread, &workers[i], 0);
+		if (!threads[i])
+			match_range (&workers[i]);
+	}
+	for (i = 0; i < nth; i++) {
+		if (threads[i])
+			r_th_free (threads[i]);
+	}
+}
+
 R_API int r_anal_diff_fcn(RAnal *anal, RList *fcns, RList *fcns2) {
-	RAnalFunction *fcn, *fcn2, *mfcn, *mfcn2;
+	RAnalFunction *fcn, *fcn2;
+	RAnalDiffFcn *idx = NULL, *best;
+	RAnalDiffGroup *groups = NULL;
+	RAnalDiffMatch *ms = NULL;
 	RListIter *iter, *iter2;
-	ut64 maxsize, minsize;
-	double t, ot;
+	RHashTable *ht;
+	RList *buckets, *l;
+	int i, j, n, n2, ngroups;
+	double t, ot, th;
 
 	if (!anal)
 		return R_FALSE;
@@ -154,101 +385,114 @@ R_API int r_anal_diff_fcn(RAnal *anal, RList *fcns, RList *fcns2) {
 	if (anal->cur && anal->cur->diff_fcn)
 		return (anal->cur->diff_fcn (anal, fcns, fcns2));
 
+	th = anal->diff_thfcn;
 	/* Compare functions with the same name */
-	if (fcns)
+	ht = r_hashtable_new ();
+	buckets = r_list_newf ((RListFree)r_list_free);
+	r_list_foreach (fcns2, iter2, fcn2) {
+		if (fcn2->type == R_ANAL_FCN_TYPE_SYM && fcn2->name)
+			bucket_add (ht, buckets, r_str_hash (fcn2->name), fcn2);
+	}
 	r_list_foreach (fcns, iter, fcn) {
 		if (fcn->type != R_ANAL_FCN_TYPE_SYM || fcn->name == NULL)
 			continue;
-		r_list_foreach (fcns2, iter2, fcn2) {
-			if (fcn2->type != R_ANAL_FCN_TYPE_SYM || fcn2->name == NULL ||
-				strcmp (fcn->name, fcn2->name))
+		l = r_hashtable_lookup (ht, r_str_hash (fcn->name));
+		r_list_foreach (l, iter2, fcn2) {
+			if (strcmp (fcn->name, fcn2->name))
 				continue;
-			r_diff_buffers_distance (NULL, fcn->fingerprint, fcn->size,
-					fcn2->fingerprint, fcn2->size, NULL, &t);
-#if 0
-			eprintf ("FCN NAME (NAME): %s - %s => %lli - %lli => %f\n", fcn->name, fcn2->name,
-					fcn->size, fcn2->size, t);
-#endif
-			/* Set flag in matched functions */
-			fcn->diff->type = fcn2->diff->type = (t==1)?
-				R_ANAL_DIFF_TYPE_MATCH: R_ANAL_DIFF_TYPE_UNMATCH;
-			fcn->diff->dist = fcn2->diff->dist = t;
-			R_FREE (fcn->fingerprint);
-			R_FREE (fcn2->fingerprint);
-			fcn->diff->addr = fcn2->addr;
-			fcn2->diff->addr = fcn->addr;
-			R_FREE (fcn->diff->name);
-			if (fcn2->name)
-				fcn->diff->name = strdup (fcn2->name);
-			R_FREE (fcn2->diff->name);
-			if (fcn->name)
-				fcn2->diff->name = strdup (fcn->name);
-			r_anal_diff_bb (anal, fcn, fcn2);
+			t = fingerprint_similarity (fcn->fingerprint, fcn->size,
+					fcn2->fingerprint, fcn2->size, 0);
+			fcn_match (anal, fcn, fcn2, t);
 			break;
 		}
 	}
-	/* Compare remaining functions */
+	r_hashtable_free (ht);
+	r_list_purge (buckets);
+
+	/* Same code, same function */
+	ht = r_hashtable_new ();
+	r_list_foreach (fcns2, iter2, fcn2) {
+		if (fcn_diffable (fcn2) && fcn2->fingerprint && fcn2->size > 0)
+			bucket_add (ht, buckets, fingerprint_hash (fcn2->fingerprint,
+				fcn2->size), fcn2);
+	}
+	r_list_foreach (fcns, iter, fcn) {
+		if (!fcn_diffable (fcn) || !fcn->fingerprint || fcn->size < 1)
+			continue;
+		l = r_hashtable_lookup (ht, fingerprint_hash (fcn->fingerprint, fcn->size));
+		r_list_foreach (l, iter2, fcn2) {
+			if (fcn2->diff->type == R_ANAL_DIFF_TYPE_NULL && fcn2->size == fcn->size &&
+					!memcmp (fcn->fingerprint, fcn2->fingerprint, fcn->size)) {
+				fcn_match (anal, fcn, fcn2, 1);
+				break;
+			}
+		}
+	}
+	r_hashtable_free (ht);
+	r_list_free (buckets);
+
+	/* Compare remaining functions against the closest candidates */
+	n = r_list_length (fcns);
+	n2 = r_list_length (fcns2);
+	idx = malloc (sizeof (RAnalDiffFcn) * (n2 + 1));
+	groups = malloc (sizeof (RAnalDiffGroup) * (n2 + 1));
+	ms = malloc (sizeof (RAnalDiffMatch) * (n + 1));
+	if (!idx || !groups || !ms) {
+		free (idx);
+		free (groups);
+		free (ms);
+		return R_FALSE;
+	}
+	i = j = 0;
+	r_list_foreach (fcns2, iter2, fcn2) {
+		if (fcn_diffable (fcn2) && fcn2->fingerprint && fcn2->size > 0)
+			fcn_features (&idx[j++], fcn2, i);
+		i++;
+	}
+	n2 = j;
+	qsort (idx, n2, sizeof (RAnalDiffFcn), fcn_cmp);
+	for (ngroups = i = 0; i < n2; i++) {
+		if (!ngroups || groups[ngroups - 1].bbs != idx[i].bbs) {
+			groups[ngroups].bbs = idx[i].bbs;
+			groups[ngroups].from = i;
+			ngroups++;
+		}
+		groups[ngroups - 1].to = i + 1;
+	}
+	i = 0;
 	r_list_foreach (fcns, iter, fcn) {
-		if ((fcn->type != R_ANAL_FCN_TYPE_FCN && fcn->type != R_ANAL_FCN_TYPE_SYM) ||
-			fcn->diff->type != R_ANAL_DIFF_TYPE_NULL)
+		if (!fcn_diffable (fcn) || !fcn->fingerprint || fcn->size < 1)
+			continue;
+		fcn_features (&ms[i].f, fcn, i);
+		ms[i].n = 0;
+		cand_find (&ms[i], idx, groups, ngroups, th);
+		i++;
+	}
+	n = i;
+	match_all (ms, n, th);
+	for (i = 0; i < n; i++) {
+		fcn = ms[i].f.fcn;
+		if (fcn->diff->type != R_ANAL_DIFF_TYPE_NULL)
 			continue;
 		ot = 0;
-		mfcn = mfcn2 = NULL;
-		r_list_foreach (fcns2, iter2, fcn2) {
-			if (fcn->size > fcn2->size) {
-				maxsize = fcn->size;
-				minsize = fcn2->size;
-			} else {
-				maxsize = fcn2->size;
-				minsize = fcn->size;
-			}
-			if ((fcn2->type != R_ANAL_FCN_TYPE_FCN && fcn2->type != R_ANAL_FCN_TYPE_SYM) ||
-				fcn2->diff->type != R_ANAL_DIFF_TYPE_NULL || (maxsize * anal->diff_thfcn > minsize))
+		best = NULL;
+		for (j = 0; j < ms[i].n; j++) {
+			RAnalDiffFcn *c = ms[i].cand[j];
+			if (c->fcn->diff->type != R_ANAL_DIFF_TYPE_NULL)
 				continue;
-			r_diff_buffers_distance (NULL, fcn->fingerprint, fcn->size,
-					fcn2->fingerprint, fcn2->size, NULL, &t);
-			fcn->diff->dist = fcn2->diff->dist = t;
-#if 0
-			int i;
-			eprintf ("FP0 ");
-			for (i=0;i<fcn->size;i++)
-				eprintf ("%02x", fcn->fingerprint[i]);
-			eprintf ("\n");
-
-			eprintf ("FP1 ");
-			for (i=0;i<fcn2->size;i++)
-				eprintf ("%02x", fcn2->fingerprint[i]);
-			eprintf ("\n");
-			eprintf ("FCN: %s - %s => %lli - %lli => %f\n", fcn->name, fcn2->name,
-					fcn->size, fcn2->size, t);
-#endif
-			if (t > anal->diff_thfcn && t > ot) {
+			t = ms[i].t[j];
+			fcn->diff->dist = R_MAX (fcn->diff->dist, t);
+			if (t > th && (t > ot || (t == ot && c->idx < best->idx))) {
 				ot = t;
-				mfcn = fcn;
-				mfcn2 = fcn2;
-				if (t == 1) break;
+				best = c;
 			}
 		}
-		if (mfcn && mfcn2) {
-#if 0
-			eprintf ("Match => %s - %s\n", mfcn->name, mfcn2->name);
-#endif
-			/* Set flag in matched functions */
-			mfcn->diff->type = mfcn2->diff->type = (ot==1)?
-				R_ANAL_DIFF_TYPE_MATCH: R_ANAL_DIFF_TYPE_UNMATCH;
-			R_FREE (mfcn->fingerprint);
-			R_FREE (mfcn2->fingerprint);
-			mfcn->diff->addr = mfcn2->addr;
-			mfcn2->diff->addr = mfcn->addr;
-			R_FREE (mfcn->diff->name);
-			if (mfcn2->name)
-				mfcn->diff->name = strdup (mfcn2->name);
-			R_FREE (mfcn2->diff->name);
-			if (mfcn->name)
-				mfcn2->diff->name = strdup (mfcn->name);
-			r_anal_diff_bb (anal, mfcn, mfcn2);
-		}
+		if (best)
+			fcn_match (anal, fcn, best->fcn, ot);
 	}
+	free (idx);
+	free (groups);
+	free (ms);
 	return R_TRUE;
 }
 
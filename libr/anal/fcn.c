@@ -13,6 +13,7 @@
 
 // 64KB max size
 #define MAX_FCN_SIZE 262140
+#define MAX_DIRTY_RANGES 4096
 
 #define DB a->sdb_fcns
 #define EXISTS(x,y...) snprintf (key, sizeof(key)-1,x,##y),sdb_exists(DB,key)
@@ -879,6 +880,300 @@ R_API int r_anal_fcn_split_bb(RAnal *anal, RAnalFunction *fcn, RAnalBlock *bb, u
 	return R_ANAL_RET_NEW;
 }
 
+/* incremental update of the blocks touched by writes */
+
+/* writes only record the range. The blocks it overlaps are looked up
+ * once by r_anal_fcn_update_dirty(), so io writes do not walk the
+ * functions. Returns the number of pending ranges */
+R_API int r_anal_fcn_bb_dirty(RAnal *anal, ut64 addr, int len) {
+	RAnalRange *r;
+	ut64 end = addr + len;
+	int i;
+	if (!anal || len < 1)
+		return 0;
+	if (end < addr)
+		end = UT64_MAX;
+	/* sequential writes grow the last range */
+	r = anal->ndirty? &anal->dirty[anal->ndirty - 1]: NULL;
+	if (r && addr <= r->to && end >= r->from) {
+		r->from = R_MIN (r->from, addr);
+		r->to = R_MAX (r->to, end);
+		return anal->ndirty;
+	}
+	if (anal->ndirty >= MAX_DIRTY_RANGES) {
+		/* too many scattered writes, mark everything in between */
+		for (i = 0; i < anal->ndirty; i++) {
+			addr = R_MIN (anal->dirty[i].from, addr);
+			end = R_MAX (anal->dirty[i].to, end);
+		}
+		anal->ndirty = 0;
+	}
+	if (!(anal->ndirty % 64)) {
+		r = realloc (anal->dirty, (anal->ndirty + 64) * sizeof (RAnalRange));
+		if (!r) return anal->ndirty;
+		anal->dirty = r;
+	}
+	r = &anal->dirty[anal->ndirty++];
+	r->from = addr;
+	r->to = end;
+	return anal->ndirty;
+}
+
+static int rangecmp(const void *a, const void *b) {
+	const RAnalRange *ra = a, *rb = b;
+	return (ra->from > rb->from) - (ra->from < rb->from);
+}
+
+/* sorts the pending dirty ranges and merges the overlapping ones */
+static void dirty_sort(RAnal *anal) {
+	RAnalRange *rs = anal->dirty;
+	int i, n = 0;
+	qsort (rs, anal->ndirty, sizeof (RAnalRange), rangecmp);
+	for (i = 0; i < anal->ndirty; i++) {
+		if (n && rs[i].from <= rs[n - 1].to)
+			rs[n - 1].to = R_MAX (rs[n - 1].to, rs[i].to);
+		else rs[n++] = rs[i];
+	}
+	anal->ndirty = n;
+}
+
+static int dirty_hit(RAnal *anal, RAnalBlock *bb) {
+	ut64 end = bb->addr + bb->size;
+	int lo = 0, hi = anal->ndirty;
+	/* the last range starting before the end of the block */
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (anal->dirty[mid].from < end)
+			lo = mid + 1;
+		else hi = mid;
+	}
+	return lo > 0 && anal->dirty[lo - 1].to > bb->addr;
+}
+
+static RAnalBlock *bbat(RAnalFunction *fcn, ut64 addr) {
+	RListIter *iter;
+	RAnalBlock *bb;
+	r_list_foreach (fcn->bbs, iter, bb) {
+		if (bb->addr == addr)
+			return bb;
+	}
+	return NULL;
+}
+
+static int bbpreds(RAnalFunction *fcn, RAnalBlock *bb) {
+	RListIter *iter;
+	RAnalBlock *bbi;
+	int n = 0;
+	r_list_foreach (fcn->bbs, iter, bbi) {
+		if (bbi != bb && (bbi->jump == bb->addr || bbi->fail == bb->addr))
+			n++;
+	}
+	return n;
+}
+
+/* drop the refs done from [from, to) both per function and in the xrefs db */
+static void bbrefs_del(RAnal *anal, RAnalFunction *fcn, ut64 from, ut64 to) {
+	RListIter *iter, *iter2, *tmp, *tmp2;
+	RAnalFunction *callee;
+	RAnalRef *ref, *xref;
+	r_list_foreach_safe (fcn->refs, iter, tmp, ref) {
+		if (ref->at < from || ref->at >= to)
+			continue;
+		r_anal_xrefs_deln (anal, ref->type, ref->at, ref->addr);
+		if (ref->type == R_ANAL_REF_TYPE_CALL) {
+			callee = r_anal_get_fcn_at (anal, ref->addr, 0);
+			if (callee) {
+				r_list_foreach_safe (callee->xrefs, iter2, tmp2, xref) {
+					if (xref->at == ref->at && xref->addr == ref->addr)
+						r_list_delete (callee->xrefs, iter2);
+				}
+			}
+		}
+		r_list_delete (fcn->refs, iter);
+	}
+}
+
+static void bbref_add(RAnal *anal, RAnalFunction *fcn, ut64 at, ut64 addr, int type) {
+	RAnalFunction *callee;
+	RAnalRef *ref;
+	if (!r_anal_fcn_xref_add (anal, fcn, at, addr, type))
+		return;
+	if (type == R_ANAL_REF_TYPE_CALL) {
+		callee = r_anal_get_fcn_at (anal, addr, 0);
+		if (callee && (ref = r_anal_ref_new ())) {
+			ref->at = at;
+			ref->addr = addr;
+			ref->type = type;
+			r_list_append (callee->xrefs, ref);
+		}
+	}
+}
+
+/* a new edge into the function may need a new block or split an old one */
+static void bbtarget(RAnal *anal, RAnalFunction *fcn, ut64 addr, RList *todo) {
+	RAnalBlock *bb;
+	if (addr == UT64_MAX)
+		return;
+	bb = bbget (fcn, addr);
+	if (bb) {
+		if (bb->addr != addr)
+			r_anal_fcn_split_bb (anal, fcn, bb, addr);
+		return;
+	}
+	if (addr < fcn->addr || addr >= fcn->addr + fcn->size)
+		return;
+	if (r_anal_get_fcn_at (anal, addr, 0))
+		return;
+	bb = appendBasicBlock (anal, fcn, addr);
+	if (bb) {
+		bb->dirty = R_TRUE;
+		r_list_append (todo, bb);
+	}
+}
+
+/* re-decode a single block, returns the previous end address */
+static ut64 bbupdate(RAnal *anal, RAnalFunction *fcn, RAnalBlock *bb) {
+	ut8 buf[MAXBBSIZE];
+	ut64 oend = bb->addr + bb->size;
+	int oplen, idx = 0, ninstr = 0, delay = 0, end = 0;
+	RAnalBlock *next;
+	RAnalOp op;
+
+	bbrefs_del (anal, fcn, bb->addr, oend);
+	anal->iob.read_at (anal->iob.io, bb->addr, buf, sizeof (buf));
+	bb->jump = bb->fail = UT64_MAX;
+	bb->conditional = R_FALSE;
+	bb->type &= R_ANAL_BB_TYPE_HEAD;
+	memset (&op, 0, sizeof (op));
+	while (idx < sizeof (buf) && !end) {
+		if (idx > 0 && !delay && (next = bbat (fcn, bb->addr + idx))) {
+			/* fall into the next block */
+			bb->jump = next->addr;
+			break;
+		}
+		r_anal_op_fini (&op);
+		oplen = r_anal_op (anal, &op, bb->addr + idx, buf + idx, sizeof (buf) - idx);
+		if (oplen < 1)
+			break;
+		idx += oplen;
+		ninstr++;
+		if (op.ptr && op.ptr != UT64_MAX && op.ptr != UT32_MAX)
+			bbref_add (anal, fcn, op.addr, op.ptr, R_ANAL_REF_TYPE_DATA);
+		if (delay > 0) {
+			end = !--delay;
+			continue;
+		}
+		switch (op.type) {
+		case R_ANAL_OP_TYPE_JMP:
+			bbref_add (anal, fcn, op.addr, op.jump, R_ANAL_REF_TYPE_CODE);
+			bb->jump = op.jump;
+			end = 1;
+			break;
+		case R_ANAL_OP_TYPE_CJMP:
+			bbref_add (anal, fcn, op.addr, op.jump, R_ANAL_REF_TYPE_CODE);
+			bb->jump = op.jump;
+			bb->fail = op.fail;
+			bb->conditional = R_TRUE;
+			end = 1;
+			break;
+		case R_ANAL_OP_TYPE_CALL:
+		case R_ANAL_OP_TYPE_CCALL:
+			bbref_add (anal, fcn, op.addr, op.jump, R_ANAL_REF_TYPE_CALL);
+			break;
+		case R_ANAL_OP_TYPE_RET:
+			bb->type |= R_ANAL_BB_TYPE_LAST;
+			/* fallthru */
+		case R_ANAL_OP_TYPE_UJMP:
+		case R_ANAL_OP_TYPE_TRAP:
+		case R_ANAL_OP_TYPE_ILL:
+			end = 1;
+			break;
+		}
+		if (end && op.delay > 0) {
+			/* keep the delay slots in the block */
+			delay = op.delay;
+			end = 0;
+		}
+	}
+	r_anal_op_fini (&op);
+	if (!(bb->type & R_ANAL_BB_TYPE_LAST))
+		bb->type |= R_ANAL_BB_TYPE_BODY;
+	fcn->ninstr += ninstr - bb->ninstr;
+	bb->ninstr = ninstr;
+	bb->size = idx;
+	bb->dirty = R_FALSE;
+	return oend;
+}
+
+/* Re-decode the blocks marked by r_anal_fcn_bb_dirty(). Blocks are split
+ * when a new branch appears, merged with their successor when a branch
+ * disappears and the refs done from them are recomputed, without touching
+ * the rest of the function. Returns the number of re-decoded blocks */
+R_API int r_anal_fcn_update_dirty(RAnal *anal) {
+	RListIter *iter, *iter2;
+	RAnalFunction *fcn;
+	RAnalBlock *bb, *next;
+	RList *todo;
+	ut64 oend, nend, fend;
+	int n = 0;
+
+	if (!anal || !(todo = r_list_new ()))
+		return 0;
+	dirty_sort (anal);
+	r_list_foreach (anal->fcns, iter, fcn) {
+		r_list_foreach (fcn->bbs, iter2, bb) {
+			if (!bb->dirty && anal->ndirty && bb->size > 0)
+				bb->dirty = dirty_hit (anal, bb);
+			if (bb->dirty)
+				r_list_append (todo, bb);
+		}
+		while ((bb = r_list_pop (todo))) {
+			oend = bbupdate (anal, fcn, bb);
+			nend = bb->addr + bb->size;
+			n++;
+			if (nend < oend) {
+				/* the tail is reachable only if something lands there */
+				RAnalBlock *bbi;
+				RListIter *it;
+				if (bb->fail >= nend && bb->fail < oend)
+					bbtarget (anal, fcn, bb->fail, todo);
+				r_list_foreach (fcn->bbs, it, bbi) {
+					if (bbi->jump >= nend && bbi->jump < oend)
+						bbtarget (anal, fcn, bbi->jump, todo);
+					if (bbi->fail >= nend && bbi->fail < oend)
+						bbtarget (anal, fcn, bbi->fail, todo);
+				}
+			}
+			if (bb->jump == nend && bb->fail == UT64_MAX && !bb->conditional
+					&& (next = bbat (fcn, nend)) && !next->dirty
+					&& bbpreds (fcn, next) == 1) {
+				/* the terminator is gone, absorb the next block */
+				bb->size += next->size;
+				bb->ninstr += next->ninstr;
+				bb->jump = next->jump;
+				bb->fail = next->fail;
+				bb->conditional = next->conditional;
+				bb->type = (bb->type & R_ANAL_BB_TYPE_HEAD) |
+					(next->type & ~R_ANAL_BB_TYPE_HEAD);
+				r_list_delete_data (fcn->bbs, next);
+				continue;
+			}
+			bbtarget (anal, fcn, bb->jump, todo);
+			bbtarget (anal, fcn, bb->fail, todo);
+		}
+		fend = fcn->addr;
+		r_list_foreach (fcn->bbs, iter2, bb) {
+			if (bb->addr + bb->size > fend)
+				fend = bb->addr + bb->size;
+		}
+		if (fend - fcn->addr > fcn->size)
+			fcn->size = fend - fcn->addr;
+	}
+	r_list_free (todo);
+	anal->ndirty = 0;
+	return n;
+}
+
 // TODO: rename fcn_bb_overlap()
 R_API int r_anal_fcn_bb_overlaps(RAnalFunction *fcn, RAnalBlock *bb) {
 	RAnalBlock *bbi;
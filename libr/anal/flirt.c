@@ -101,6 +101,7 @@ Referenced functions:
 #include <r_lib.h>
 #include <r_cmd.h>
 #include <r_sign.h>
+#include <r_th.h>
 #include <signal.h>
 
 #define DEBUG 0
@@ -314,6 +315,7 @@ typedef struct RFlirtNode {
 	ut64 variant_mask; // this is the mask that will define variant bytes in ut8 *pattern_bytes
 	ut8 *pattern_bytes; // holds the pattern bytes of the signature
 	ut8 *variant_bool_array; // bool array, if true, byte in pattern_bytes is a variant byte
+	RList **child_index; // children that can match each possible first byte
 } RFlirtNode;
 
 static ut8 version; // version of the sig file being parsed
@@ -321,7 +323,7 @@ static ut8 version; // version of the sig file being parsed
 
 // This is from flair tools flair/crc16.cpp
 #define POLY 0x8408
-unsigned short crc16 (const unsigned char *data_p, size_t length) {
+static unsigned short crc16 (const unsigned char *data_p, size_t length) {
 	unsigned char i;
 	unsigned int data;
 
@@ -442,6 +444,13 @@ static void node_free (RFlirtNode *node) {
 		r_list_free (node->child_list);
 	}
 
+	if (node->child_index) {
+		int i;
+		for (i = 0; i < 256; i++)
+			r_list_free (node->child_index[i]);
+		free (node->child_index);
+	}
+
 	free (node);
 }
 
@@ -521,21 +530,22 @@ static void print_node (const RAnal *anal, const RFlirtNode *node, int indent) {
 	}
 }
 
-static int module_match_buffer (const RAnal *anal, const RFlirtModule *module,
-		ut8 *b, ut64 address, int buf_size) {
+static int module_match_buffer (const RFlirtModule *module, const ut8 *b, int buf_size) {
 	/* Returns R_TRUE if module matches b, according to the signatures infos.
 	 * Return R_FALSE otherwise.
 	 * The buffer starts from the first byte after the pattern */
-	RFlirtFunction *flirt_func;
-	RAnalFunction *next_module_function;
-	RListIter *tail_byte_it, *flirt_func_it;
+	RListIter *tail_byte_it;
 	RFlirtTailByte *tail_byte;
 
+	if (module->crc_length > buf_size)
+		return R_FALSE;
 	if (module->crc16 != crc16 (b, module->crc_length))
 		return R_FALSE;
 
 	if (module->tail_bytes) {
 		r_list_foreach (module->tail_bytes, tail_byte_it, tail_byte) {
+			if (module->crc_length + tail_byte->offset >= buf_size)
+				return R_FALSE;
 			if (b[module->crc_length + tail_byte->offset] != tail_byte->value)
 				return R_FALSE;
 		}
@@ -543,6 +553,14 @@ static int module_match_buffer (const RAnal *anal, const RFlirtModule *module,
 
 	// TODO referenced functions
 
+	return R_TRUE;
+}
+
+static void module_apply (const RAnal *anal, const RFlirtModule *module, ut64 address) {
+	RFlirtFunction *flirt_func;
+	RAnalFunction *next_module_function;
+	RListIter *flirt_func_it;
+
 	r_list_foreach (module->public_functions, flirt_func_it, flirt_func) {
 		// Once the first module function is found, we need to go through the module->public_functions
 		// list to identify the others. See flirt doc for more information
@@ -560,11 +578,9 @@ static int module_match_buffer (const RAnal *anal, const RFlirtModule *module,
 			anal->printf ("Found %s\n", next_module_function->name);
 		}
 	}
-
-	return R_TRUE;
 }
 
-static int node_pattern_match (const RFlirtNode *node, ut8 *b, int buf_size) {
+static int node_pattern_match (const RFlirtNode *node, const ut8 *b, int buf_size) {
 	 /* Returns R_TRUE if b matches the pattern in node. */
 	 /* Returns R_FALSE otherwise. */
 	int i;
@@ -580,68 +596,227 @@ static int node_pattern_match (const RFlirtNode *node, ut8 *b, int buf_size) {
 	return R_TRUE;
 }
 
-static int node_match_buffer (const RAnal *anal, const RFlirtNode *node, ut8 *b,
-		ut64 address, int buf_size) {
+static const RFlirtModule *node_match_buffer (const RFlirtNode *node, const ut8 *b, int buf_size);
+
+/* returns the first module matching b below node, in file order */
+static const RFlirtModule *node_match_children (const RFlirtNode *node, const ut8 *b, int buf_size) {
 	RListIter *node_child_it, *module_it;
+	const RFlirtModule *ret;
 	RFlirtNode *child;
 	RFlirtModule *module;
+	RList *children;
 
-	if (node_pattern_match(node, b, buf_size)) {
-		if (node->child_list) {
-			r_list_foreach(node->child_list, node_child_it, child) {
-				if(node_match_buffer(anal, child, b + node->length, address, buf_size - node->length))
-					return R_TRUE;
-			}
-		} else if (node->module_list) {
-			r_list_foreach(node->module_list, module_it, module) {
-				if(module_match_buffer(anal, module, b + node->length, address, buf_size - node->length))
-					return R_TRUE;
+	if (node->child_list) {
+		children = node->child_list;
+		if (node->child_index) {
+			if (buf_size < 1) return NULL;
+			children = node->child_index[b[0]];
+			if (!children) return NULL;
+		}
+		r_list_foreach (children, node_child_it, child) {
+			if ((ret = node_match_buffer (child, b, buf_size)))
+				return ret;
+		}
+	} else if (node->module_list) {
+		r_list_foreach (node->module_list, module_it, module) {
+			if (module_match_buffer (module, b, buf_size))
+				return module;
+		}
+	}
+	return NULL;
+}
+
+static const RFlirtModule *node_match_buffer (const RFlirtNode *node, const ut8 *b, int buf_size) {
+	if (!node_pattern_match (node, b, buf_size))
+		return NULL;
+	return node_match_children (node, b + node->length, buf_size - node->length);
+}
+
+/* Nodes with many children get a table of the children whose pattern can
+ * start with each byte value, children starting with a variant byte are
+ * in every slot. The file order is kept in each slot. */
+#define FLIRT_INDEX_MIN 4
+
+static int node_index (RFlirtNode *node) {
+	RListIter *it;
+	RFlirtNode *child;
+	int i;
+
+	if (!node->child_list)
+		return R_TRUE;
+	if (r_list_length (node->child_list) >= FLIRT_INDEX_MIN) {
+		if (!(node->child_index = calloc (256, sizeof (RList *))))
+			return R_FALSE;
+		r_list_foreach (node->child_list, it, child) {
+			int any = (child->length < 1 || child->variant_bool_array[0]);
+			for (i = 0; i < 256; i++) {
+				if (!any && i != child->pattern_bytes[0])
+					continue;
+				if (!node->child_index[i] && !(node->child_index[i] = r_list_new ()))
+					return R_FALSE;
+				r_list_append (node->child_index[i], child);
 			}
 		}
 	}
+	r_list_foreach (node->child_list, it, child) {
+		if (!node_index (child))
+			return R_FALSE;
+	}
+	return R_TRUE;
+}
+
+/* Functions are read in windows of at least FLIRT_WINDOW bytes in address
+ * order and matched in parallel, FLIRT_BATCH bytes of code at a time */
+#define FLIRT_WINDOW (1024*1024)
+#define FLIRT_BATCH (32*1024*1024)
+#define FLIRT_MAX_THREADS 16
+
+typedef struct {
+	RAnalFunction *fcn;
+	int idx; // position in anal->fcns
+	const ut8 *buf;
+} RFlirtCandidate;
+
+typedef struct {
+	const RFlirtNode *root;
+	RFlirtCandidate *cands;
+	const RFlirtModule **matches; // indexed by RFlirtCandidate.idx
+	int from;
+	int to;
+} RFlirtWorker;
+
+static int candidate_cmp (const void *a, const void *b) {
+	const RFlirtCandidate *ca = a, *cb = b;
+	if (ca->fcn->addr < cb->fcn->addr) return -1;
+	return ca->fcn->addr > cb->fcn->addr;
+}
+
+static void match_range (RFlirtWorker *w) {
+	int i;
+	for (i = w->from; i < w->to; i++) {
+		RFlirtCandidate *c = &w->cands[i];
+		w->matches[c->idx] = node_match_children (w->root, c->buf, c->fcn->size);
+	}
+}
 
+static int match_thread (RThread *th) {
+	match_range (th->user);
 	return R_FALSE;
 }
 
+static int flirt_threads () {
+	return R_MIN (r_sys_cpus (), FLIRT_MAX_THREADS);
+}
+
+/* match cands[from..to) whose code is already in memory */
+static void match_batch (const RFlirtNode *root, RFlirtCandidate *cands,
+		const RFlirtModule **matches, int from, int to, int nth) {
+	RFlirtWorker workers[FLIRT_MAX_THREADS];
+	RThread *threads[FLIRT_MAX_THREADS];
+	int i, n = to - from;
+
+	if (nth > n / 64) nth = n / 64;
+	if (nth < 2) {
+		RFlirtWorker w = { root, cands, matches, from, to };
+		match_range (&w);
+		return;
+	}
+	for (i = 0; i < nth; i++) {
+		workers[i].root = root;
+		workers[i].cands = cands;
+		workers[i].matches = matches;
+		workers[i].from = from + (n * i) / nth;
+		workers[i].to = from + (n * (i + 1)) / nth;
+		threads[i] = r_th_new (match_thread, &workers[i], 0);
+		if (!threads[i])
+			match_range (&workers[i]);
+	}
+	for (i = 0; i < nth; i++) {
+		if (threads[i])
+			r_th_free (threads[i]);
+	}
+}
+
 static int node_match_functions (const RAnal *anal, const RFlirtNode *root_node) {
 	/* Tries to find matching functions between the signature infos in root_node
 	 * and the analyzed functions in anal
 	 * Returns R_FALSE on error. */
 
-	RListIter *it_func, *node_child_it;
-	ut8 *func_buf = NULL;
+	RListIter *it_func;
 	RAnalFunction *func;
-	RFlirtNode *child;
-	int size, ret = R_TRUE;
+	RFlirtCandidate *cands = NULL;
+	const RFlirtModule **matches = NULL;
+	RList *windows = NULL;
+	int i, j, n = 0, nfcns, ret = R_TRUE, nth = flirt_threads ();
 
 	if (r_list_length(anal->fcns) == 0) {
 		anal->printf("There is no analyzed functions. Have you run 'aa'?\n");
 		return R_TRUE;
 	}
-
-	anal->flb.set_fs (anal->flb.f, "flirt");
+	nfcns = r_list_length (anal->fcns);
+	cands = calloc (nfcns, sizeof (RFlirtCandidate));
+	matches = calloc (nfcns, sizeof (RFlirtModule *));
+	windows = r_list_newf (free);
+	if (!cands || !matches || !windows) {
+		ret = R_FALSE;
+		goto exit;
+	}
+	i = 0;
 	r_list_foreach (anal->fcns, it_func, func) {
+		int idx = i++;
 		if (func->type != R_ANAL_FCN_TYPE_FCN && func->type != R_ANAL_FCN_TYPE_LOC) { // scan only for unknown functions
 			continue;
 		}
-
-		func_buf = malloc (func->size);
-		size = anal->iob.read_at (anal->iob.io, func->addr, func_buf, func->size);
-		if  (size != func->size) {
-			eprintf ("Couldn't read function\n");
-			ret = R_FALSE;
-			goto exit;
-		}
-		r_list_foreach (root_node->child_list, node_child_it, child) {
-			if (node_match_buffer (anal, child, func_buf, func->addr, func->size)) {
-				break;
+		if (func->size < 1)
+			continue;
+		cands[n].fcn = func;
+		cands[n].idx = idx;
+		n++;
+	}
+	qsort (cands, n, sizeof (RFlirtCandidate), candidate_cmp);
+
+	for (i = 0; i < n; ) {
+		ut64 batch = 0, wfrom = 0, wto = 0;
+		ut8 *wbuf = NULL;
+		for (j = i; j < n && batch < FLIRT_BATCH; j++) {
+			RAnalFunction *f = cands[j].fcn;
+			if (!wbuf || f->addr < wfrom || f->addr + f->size > wto) {
+				int wlen = R_MAX (FLIRT_WINDOW, f->size);
+				if (!(wbuf = malloc (wlen))) {
+					ret = R_FALSE;
+					goto exit;
+				}
+				r_list_append (windows, wbuf);
+				/* the window may extend past the end of the map */
+				if (anal->iob.read_at (anal->iob.io, f->addr, wbuf, wlen) < (int)f->size) {
+					eprintf ("Couldn't read function\n");
+					ret = R_FALSE;
+					goto exit;
+				}
+				wfrom = f->addr;
+				wto = f->addr + wlen;
+				batch += wlen;
 			}
+			cands[j].buf = wbuf + (f->addr - wfrom);
 		}
-		if (func_buf) {free (func_buf); func_buf = NULL;}
+		match_batch (root_node, cands, matches, i, j, nth);
+		r_list_purge (windows);
+		i = j;
+	}
+
+	/* flags and names are updated in the function list order */
+	anal->flb.set_fs (anal->flb.f, "flirt");
+	i = 0;
+	r_list_foreach (anal->fcns, it_func, func) {
+		if (i < nfcns && matches[i])
+			module_apply (anal, matches[i], func->addr);
+		i++;
 	}
 
 exit:
-	if (func_buf) free (func_buf);
+	r_list_free (windows);
+	free (matches);
+	free (cands);
 	return ret;
 }
 
@@ -1305,7 +1480,7 @@ R_API void r_sign_flirt_scan (const RAnal *anal, const char *flirt_file) {
 	node = flirt_parse (anal, flirt_buf);
 	r_buf_free (flirt_buf);
 	if (node) {
-		if (!node_match_functions (anal, node)) {
+		if (!node_index (node) || !node_match_functions (anal, node)) {
 			eprintf ("Error while scanning the file\n");
 		}
 		node_free (node);
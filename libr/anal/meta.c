@@ -1,182 +1,331 @@
 /* radare - LGPL - Copyright 2008-2015 - nibble, pancake */
 
-// TODO: rename to r_anal_meta_get() ??
-#if 0
-    TODO
-    ====
-    - handle sync to synchronize all the data on disk.
-    - actually listing only works in memory
-    - array_add doesnt needs index, right?
-    - remove unused arguments from r_meta_find (where ?)
-    - implement r_meta_find
-#endif
-#if 0
-  SDB SPECS
+/* Metadata items live in memory, one RAnalMetaStore per type (see
+ * R_META_TYPES). The hash finds an item by its start address and the
+ * array, sorted by address, answers the range queries by bisection:
+ * maxto[] only grows, so the items that may cover an address start at
+ * the first maxto above it. Items added out of order are appended and
+ * merged in by the next ordered query, so bulk imports are not sorted
+ * once per item. Deleted items stay in the array until that merge.
+
+   SDB SPECS
 
 DatabaseName:
   'anal.meta'
 Keys:
-  'meta.<type>.count=<int>'     number of added metas where 'type' is a single char
-  'meta.<type>.<last>=<array>'  splitted array, each block contains K elements
-  'meta.<type>.<addr>=<string>' string representing extra information of the meta type at given address
-  'range.<baddr>=<array>'       store valid addresses in a base range array
-#endif
+  'meta.<type>.<addr>=<size>,<space>,<b64str>'
+
+  The stores are only written there by r_meta_sync when saving, and
+  read back by r_meta_load.
+ */
 
 #include <r_anal.h>
 #include <r_print.h>
 
-#define META_RANGE_BASE(x) ((x)>>12)
-#define META_RANGE_SIZE 0xfff
 #undef DB
 #define DB a->sdb_meta
 
-#if 0
-// Defined but not used. Shall we remove it?
-static char *meta_inrange_get (RAnal *a, ut64 addr, int size) {
-	char key[64];
-	ut64 base, base2;
-	base = META_RANGE_BASE (addr);
-	base2 = META_RANGE_BASE (addr+size);
-	// return string array of all the offsets where there are stuff
-	for (; base<base2; base += META_RANGE_SIZE) {
-		snprintf (key, sizeof (key)-1, "range.0x%"PFMT64x, base);
-		sdb_array_get (DB, key, 0, 0);
+static int meta_index(int type) {
+	const char *t;
+	if (type < 1 || type > 0xff)
+		return -1;
+	t = strchr (R_META_TYPES, type);
+	return t? (int)(t - R_META_TYPES): -1;
+}
+
+static RAnalMetaStore *meta_store(RAnal *a, int type, int create) {
+	RAnalMetaStore *st;
+	int i = meta_index (type);
+	if (i == -1)
+		return NULL;
+	if (a->meta_stores[i] || !create)
+		return a->meta_stores[i];
+	st = R_NEW0 (RAnalMetaStore);
+	if (!st) return NULL;
+	st->ht = r_hashtable64_new ();
+	st->lock = r_th_lock_new ();
+	if (!st->ht || !st->lock) {
+		r_hashtable64_free (st->ht);
+		r_th_lock_free (st->lock);
+		free (st);
+		return NULL;
 	}
-	return NULL;
+	return a->meta_stores[i] = st;
+}
+
+static void store_free(RAnalMetaStore *st) {
+	int i;
+	if (!st) return;
+	for (i = 0; i < st->n; i++)
+		r_meta_item_free (st->items[i]);
+	free (st->items);
+	free (st->maxto);
+	r_hashtable64_free (st->ht);
+	r_th_lock_free (st->lock);
+	free (st);
+}
+
+R_API void r_meta_free(RAnal *a) {
+	int i;
+	for (i = 0; i < R_META_NTYPES; i++) {
+		store_free (a->meta_stores[i]);
+		a->meta_stores[i] = NULL;
+	}
+}
+
+static int store_add(RAnalMetaStore *st, RAnalMetaItem *mi) {
+	int n = st->n;
+	if (n == st->size) {
+		int size = st->size? st->size * 2: 64;
+		RAnalMetaItem **items = realloc (st->items, size * sizeof (RAnalMetaItem*));
+		ut64 *maxto;
+		if (!items) return R_FALSE;
+		st->items = items;
+		maxto = realloc (st->maxto, size * sizeof (ut64));
+		if (!maxto) return R_FALSE;
+		st->maxto = maxto;
+		st->size = size;
+	}
+	if (!r_hashtable64_insert (st->ht, mi->from, mi))
+		return R_FALSE;
+	/* appending in address order keeps the array sorted */
+	if (st->sorted == n && (!n || st->items[n-1]->from < mi->from)) {
+		st->maxto[n] = n? R_MAX (st->maxto[n-1], mi->to): mi->to;
+		st->sorted++;
+	}
+	st->items[st->n++] = mi;
+	return R_TRUE;
+}
+
+/* the item is freed by the next store_order */
+static int store_del(RAnalMetaStore *st, ut64 addr) {
+	RAnalMetaItem *mi = st? r_hashtable64_lookup (st->ht, addr): NULL;
+	if (!mi) return R_FALSE;
+	r_hashtable64_remove (st->ht, addr);
+	R_FREE (mi->str);
+	mi->type = 0;
+	st->dead++;
+	return R_TRUE;
+}
+
+static int item_cmp(const void *a, const void *b) {
+	const RAnalMetaItem *x = *(const RAnalMetaItem **)a;
+	const RAnalMetaItem *y = *(const RAnalMetaItem **)b;
+	return (x->from > y->from) - (x->from < y->from);
+}
+
+static void store_order(RAnalMetaStore *st) {
+	RAnalMetaItem **tmp;
+	int i, j, k, sorted;
+	if (st->dead) {
+		for (i = j = sorted = 0; i < st->n; i++) {
+			RAnalMetaItem *mi = st->items[i];
+			if (!mi->type) {
+				r_meta_item_free (mi);
+				continue;
+			}
+			if (i < st->sorted)
+				sorted++;
+			st->items[j++] = mi;
+		}
+		st->n = j;
+		st->sorted = sorted;
+		st->dead = 0;
+		st->stale = 1;
+	}
+	if (st->sorted < st->n) {
+		qsort (st->items + st->sorted, st->n - st->sorted,
+			sizeof (RAnalMetaItem*), item_cmp);
+		tmp = malloc (st->size * sizeof (RAnalMetaItem*));
+		if (tmp) {
+			for (i = k = 0, j = st->sorted; i < st->sorted && j < st->n; )
+				tmp[k++] = (st->items[j]->from < st->items[i]->from)?
+					st->items[j++]: st->items[i++];
+			while (i < st->sorted) tmp[k++] = st->items[i++];
+			while (j < st->n) tmp[k++] = st->items[j++];
+			free (st->items);
+			st->items = tmp;
+		} else qsort (st->items, st->n, sizeof (RAnalMetaItem*), item_cmp);
+		st->sorted = st->n;
+		st->stale = 1;
+	}
+	if (st->stale) {
+		for (i = 0; i < st->n; i++)
+			st->maxto[i] = i? R_MAX (st->maxto[i-1], st->items[i]->to):
+				st->items[i]->to;
+		st->stale = 0;
+	}
+}
+
+/* readers holding anal->lock may race to sort the array. Once this
+ * returns it stays ordered until the next write */
+static RAnalMetaStore *store_ordered(RAnal *a, int type) {
+	RAnalMetaStore *st = meta_store (a, type, R_FALSE);
+	if (st) {
+		r_th_lock_enter (st->lock);
+		store_order (st);
+		r_th_lock_leave (st->lock);
+	}
+	return st;
+}
+
+/* first item starting at or after addr */
+static int store_lower(RAnalMetaStore *st, ut64 addr) {
+	int lo = 0, hi = st->n;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (st->items[mid]->from < addr) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
 }
-#endif
 
-static int meta_inrange_add (RAnal *a, ut64 addr, int size) {
-	int set = 0;
-	char key[64];
-	ut64 base, base2;
-	base = META_RANGE_BASE (addr);
-	base2 = META_RANGE_BASE (addr+size);
-	for (; base<base2; base += META_RANGE_SIZE) {
-		snprintf (key, sizeof (key)-1, "range.0x%"PFMT64x, base);
-		if (sdb_array_add_num (DB, key, addr, 0))
-			set = 1;
-	}
-	return set;
-}
-
-static int meta_inrange_del (RAnal *a, ut64 addr, int size) {
-	int set = 0;
-	char key[64];
-	ut64 base, base2;
-	base = META_RANGE_BASE (addr);
-	base2 = META_RANGE_BASE (addr+size);
-// TODO: optimize this thing?
-	for (; base<base2; base += META_RANGE_SIZE) {
-		snprintf (key, sizeof (key)-1, "range.0x%"PFMT64x, base);
-		if (sdb_array_remove_num (DB, key, addr, 0))
-			set = 1;
-	}
-	//sdb_array_del (DB);
-	return set;
-}
-
-// 512 = 1.5s
-// 256 = 1.3s
-// 128 = 1.2s
-// 64 = 1.14
-// 32 = 1.12
-// not storing any = 1
-#define K 256
-
-static int meta_type_add (RAnal *a, char type, ut64 addr) {
-	char key[32];
-	ut32 count, last;
-	snprintf (key, sizeof (key)-1, "meta.%c.count", type);
-	count = (ut32)sdb_num_inc (DB, key, 1, 0);
-	last = count/K;
-
-	snprintf (key, sizeof (key)-1, "meta.%c.%d", type, last);
-	sdb_array_add_num (DB, key, addr, 0);
+/* first item that may end after addr */
+static int store_reach(RAnalMetaStore *st, ut64 addr) {
+	int lo = 0, hi = st->n;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (st->maxto[mid] <= addr) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+/* items overlapping [from, to) in address order, counted and added to
+ * the list when there is one */
+static int store_range(RAnalMetaStore *st, ut64 from, ut64 to, RList *list) {
+	int i, hi, count = 0;
+	if (!st || from >= to)
+		return 0;
+	hi = store_lower (st, to);
+	for (i = store_reach (st, from); i < hi; i++) {
+		if (st->items[i]->to > from) {
+			if (list) r_list_append (list, st->items[i]);
+			count++;
+		}
+	}
 	return count;
 }
 
+static RAnalMetaItem *meta_set(RAnal *a, int type, ut64 from, ut64 size, int space, const char *str) {
+	RAnalMetaStore *st = meta_store (a, type, R_TRUE);
+	RAnalMetaItem *mi, *old;
+	if (!st) return NULL;
+	mi = old = r_hashtable64_lookup (st->ht, from);
+	if (old) {
+		free (old->str);
+		if (old->size != size)
+			st->stale = 1;
+	} else if (!(mi = r_meta_item_new (type))) {
+		return NULL;
+	}
+	mi->from = from;
+	mi->size = size;
+	mi->to = from + size;
+	mi->space = space;
+	mi->str = str? strdup (str): NULL;
+	if (!old && !store_add (st, mi)) {
+		r_meta_item_free (mi);
+		return NULL;
+	}
+	return mi;
+}
+
 // TODO: Add APIs to resize meta? nope, just del and add
 R_API int r_meta_set_string(RAnal *a, int type, ut64 addr, const char *s) {
-	char key[100], val[2048], *e_str;
-	int ret;
-	ut64 size;
-	int space_idx = a->meta_spaces.space_idx;
-	meta_type_add (a, type, addr);
-
-	snprintf (key, sizeof (key)-1, "meta.%c.0x%"PFMT64x, type, addr);
-	size = sdb_array_get_num (DB, key, 0, 0);
-	if (!size) {
-		size = strlen (s);
-		meta_inrange_add (a, addr, size);
-		ret = R_TRUE;
-	} else ret = R_FALSE;
-	e_str = sdb_encode ((const void*)s, -1);
-	snprintf (val, sizeof (val)-1, "%d,%d,%s", (int)size, space_idx, e_str);
-	sdb_set (DB, key, val, 0);
-	free ((void*)e_str);
-	return ret;
+	RAnalMetaItem *mi = r_meta_get_at (a, addr, type);
+	ut64 size = mi? mi->size: strlen (s);
+	if (!meta_set (a, type, addr, size, a->meta_spaces.space_idx, s))
+		return R_FALSE;
+	return mi? R_FALSE: R_TRUE;
 }
 
 R_API char *r_meta_get_string(RAnal *a, int type, ut64 addr) {
-	char key[100];
-	const char *k, *p, *p2;
-	snprintf (key, sizeof (key)-1, "meta.%c.0x%"PFMT64x, 'C', addr);
-	k = sdb_const_get (DB, key, NULL);
-	if (!k) return NULL;
-	p = strchr (k, SDB_RS);
-	if (!p) return NULL;
-	k = p+1;
-	p2 = strchr (k, SDB_RS);
-	if (!p2) {
-		return (char *)sdb_decode (k, NULL);
+	RAnalMetaItem *mi = r_meta_get_at (a, addr, type);
+	return (mi && mi->str)? strdup (mi->str): NULL;
+}
+
+/* the item starting at addr, owned by the store */
+R_API RAnalMetaItem *r_meta_get_at(RAnal *a, ut64 addr, int type) {
+	RAnalMetaStore *st;
+	RAnalMetaItem *mi;
+	const char *t;
+	if (type != R_META_TYPE_ANY) {
+		st = meta_store (a, type, R_FALSE);
+		return st? r_hashtable64_lookup (st->ht, addr): NULL;
+	}
+	for (t = R_META_TYPES; *t; t++) {
+		if ((mi = r_meta_get_at (a, addr, *t)))
+			return mi;
+	}
+	return NULL;
+}
+
+/* the closest item starting before or at addr that covers it */
+R_API RAnalMetaItem *r_meta_get_in(RAnal *a, ut64 addr, int type) {
+	RAnalMetaStore *st;
+	RAnalMetaItem *mi;
+	const char *t;
+	int i, lo;
+	if (type == R_META_TYPE_ANY) {
+		for (t = R_META_TYPES; *t; t++) {
+			if ((mi = r_meta_get_in (a, addr, *t)))
+				return mi;
+		}
+		return NULL;
+	}
+	if (!(st = store_ordered (a, type)))
+		return NULL;
+	lo = store_reach (st, addr);
+	for (i = store_lower (st, addr + 1) - 1; i >= lo; i--) {
+		if (st->items[i]->to > addr)
+			return st->items[i];
 	}
-	return (char *)sdb_decode (p2+1, NULL);
+	return NULL;
+}
+
+/* items overlapping [from, to), owned by the stores */
+R_API RList *r_meta_get_range(RAnal *a, int type, ut64 from, ut64 to) {
+	RList *list = r_list_new ();
+	const char *t;
+	if (!list) return NULL;
+	if (type != R_META_TYPE_ANY) {
+		store_range (store_ordered (a, type), from, to, list);
+		return list;
+	}
+	for (t = R_META_TYPES; *t; t++)
+		store_range (store_ordered (a, *t), from, to, list);
+	return list;
+}
+
+R_API int r_meta_count(RAnal *a, int type, ut64 from, ut64 to) {
+	const char *t;
+	int count = 0;
+	if (type != R_META_TYPE_ANY)
+		return store_range (store_ordered (a, type), from, to, NULL);
+	for (t = R_META_TYPES; *t; t++)
+		count += store_range (store_ordered (a, *t), from, to, NULL);
+	return count;
 }
 
 R_API int r_meta_del(RAnal *a, int type, ut64 addr, ut64 size, const char *str) {
-	char key[100], key2[100], *dtr, *s, *p, *next;
-	const char *ptr;
+	const char *t;
 	int i;
 	if (size == UT64_MAX) {
 		// FULL CLEANUP
-		// XXX: this thing ignores the type
 		if (type == R_META_TYPE_ANY) {
+			r_meta_free (a);
 			sdb_reset (DB);
-		} else {
-			snprintf (key, sizeof (key)-1, "meta.%c.count", type);
-			int last = (ut64)sdb_num_get (DB, key, NULL)/K;
-			for (i=0; i<last; i++) {
-				snprintf (key, sizeof (key)-1, "meta.%c.%d", type, i);
-				dtr = sdb_get (DB, key, 0);
-				for (p = dtr; p; p = next) {
-					s = sdb_anext (p, &next);
-					snprintf (key, sizeof (key)-1,
-						"meta.%c.0x%"PFMT64x,
-						type, sdb_atoi (s));
-					eprintf ("--> %s\n", key);
-					sdb_unset (DB, key, 0);
-					if (!next) break;
-				}
-				free (dtr);
-			}
+		} else if ((i = meta_index (type)) != -1) {
+			store_free (a->meta_stores[i]);
+			a->meta_stores[i] = NULL;
 		}
 		return R_FALSE;
 	}
-	meta_inrange_del (a, addr, size);
-	snprintf (key, sizeof (key)-1, type==R_META_TYPE_COMMENT ?
-		"meta.C.0x%"PFMT64x : "meta.0x%"PFMT64x, addr);
-	ptr = sdb_const_get (DB, key, 0);
-	if (ptr) {
-		for (i=0; ptr[i]; i++) {
-			if (ptr[i] != SDB_RS) {
-				snprintf (key2, sizeof (key2)-1,
-					"meta.%c.0x%"PFMT64x, ptr[i], addr);
-				sdb_unset (DB, key2, 0);
-			}
-		}
-	}
-	sdb_unset (DB, key, 0);
+	if (type == R_META_TYPE_ANY) {
+		for (t = R_META_TYPES; *t; t++)
+			store_del (meta_store (a, *t, R_FALSE), addr);
+	} else store_del (meta_store (a, type, R_FALSE), addr);
 	return R_FALSE;
 }
 
@@ -186,7 +335,10 @@ R_API int r_meta_cleanup(RAnal *a, ut64 from, ut64 to) {
 
 R_API void r_meta_item_free(void *_item) {
 	RAnalMetaItem *item = _item;
-	free (item);
+	if (item) {
+		free (item->str);
+		free (item);
+	}
 }
 
 R_API RAnalMetaItem *r_meta_item_new(int type) {
@@ -198,61 +350,41 @@ R_API RAnalMetaItem *r_meta_item_new(int type) {
 }
 
 R_API int r_meta_add(RAnal *a, int type, ut64 from, ut64 to, const char *str) {
-	int space_idx = a->meta_spaces.space_idx;
-	char *e_str, key[100], val[2048];
-	int exists;
 	if (from>to)
 		return R_FALSE;
 	if (from == to)
 		to = from+1;
-	if (type == 100 && (to-from)<1) {
-		return R_FALSE;
-	}
-	/* set entry */
-	e_str = sdb_encode ((const void*)str, -1);
-	snprintf (key, sizeof (key)-1, "meta.%c.0x%"PFMT64x, type, from);
-	snprintf (val, sizeof (val)-1, "%d,%d,%s", (int)(to-from), space_idx, e_str);
-	exists = sdb_exists (DB, key);
-
-	sdb_set (DB, key, val, 0);
-	free (e_str);
-
-	// XXX: This is totally inefficient, using array_add withuot
-	// checking return value is wrong practice, also it may lead
-	// to inconsistent DB, and pretty bad performance. We should
-	// store this list in a different storage that doesnt have
-	// those limits and it's O(1) instead of O(n)
-	if (!exists) {
-		//ut64 count;
-		/* set type index */
-		snprintf (key, sizeof (key)-1, "meta.0x%"PFMT64x, from);
-		snprintf (val, sizeof (val)-1, "%c", type);
-		sdb_array_add (DB, key, val, 0);
-		/* set type index */
-		//count = meta_type_add (a, type, from);
-	}
-
-	return R_TRUE;
+	return meta_set (a, type, from, to - from,
+		a->meta_spaces.space_idx, str)? R_TRUE: R_FALSE;
 }
 
+/* the item covering off, or the closest one before or after it. Owned
+ * by the store */
 R_API RAnalMetaItem *r_meta_find(RAnal *a, ut64 off, int type, int where) {
-	static RAnalMetaItem it = {0};
-	// XXX: return allocated item? wtf
-	if (where != R_META_WHERE_HERE) {
-		eprintf ("THIS WAS NOT SUPOSED TO HAPPEN\n");
-		return NULL;
-	}
-	//char *range = get_in_range (off);
-	if (type == R_META_TYPE_ANY) {
-		//const char *p;
-		char key [100];
-		snprintf (key, sizeof (key)-1, "meta.0x%"PFMT64x, off);
-		//p = sdb_const_get (DB, key, 0);
-// XXX: TODO unimplemented. see core/disasm.c:1070
-	} else {
-	//	snprintf (key, sizeof (key)-1, "meta.
+	RAnalMetaStore *st;
+	RAnalMetaItem *mi, *best = NULL;
+	const char *t;
+	int i;
+	if (where == R_META_WHERE_HERE)
+		return r_meta_get_in (a, off, type);
+	for (t = R_META_TYPES; *t; t++) {
+		if (type != R_META_TYPE_ANY && type != *t)
+			continue;
+		if (!(st = store_ordered (a, *t)))
+			continue;
+		if (where == R_META_WHERE_NEXT) {
+			i = store_lower (st, off + 1);
+			mi = (off != UT64_MAX && i < st->n)? st->items[i]: NULL;
+			if (mi && (!best || mi->from < best->from))
+				best = mi;
+		} else {
+			i = store_lower (st, off) - 1;
+			mi = (i >= 0)? st->items[i]: NULL;
+			if (mi && (!best || mi->from > best->from))
+				best = mi;
+		}
 	}
-	return &it;
+	return best;
 }
 
 R_API const char *r_meta_type_to_string(int type) {
@@ -382,160 +514,167 @@ static void printmetaitem(RAnal *a, RAnalMetaItem *d, int rad) {
 	}
 }
 
-static int meta_print_item(void *user, const char *k, const char *v) {
-	// const char *v; // size
-	const char *v2; // space_idx
-	RAnalMetaUserItem *ui = user;
-	RAnalMetaItem it;
-	if (strlen (k)<8)
-		return 1;
-	if (memcmp (k+6, ".0x", 3))
-		return 1;
-	it.type = k[5];
-	it.size = sdb_atoi (v);
-	it.from = sdb_atoi (k+7);
-
-	v2 = strchr (v, ',');
-	if (!v2) goto beach;
-	it.space = atoi (v2+1);
-	it.to = it.from + it.size;
-	it.str = strchr (v2+1, ',');
-	if (it.str)
-		it.str = (char *)sdb_decode ((const char*)it.str+1, 0);
-	else it.str = strdup (it.str); // don't break in free
-	printmetaitem (ui->anal, &it, ui->rad);
-	free (it.str);
-
-beach:
-
-	return 1;
+static int meta_cmp(const void *a, const void *b) {
+	const RAnalMetaItem *x = *(const RAnalMetaItem **)a;
+	const RAnalMetaItem *y = *(const RAnalMetaItem **)b;
+	if (x->from != y->from)
+		return (x->from > y->from)? 1: -1;
+	return meta_index (x->type) - meta_index (y->type);
 }
 
-R_API int r_meta_list_cb(RAnal *a, int type, int rad, SdbForeachCallback cb, void *user) {
-	RAnalMetaUserItem ui = { a, type, rad, cb, user, 0 };
-	if (rad=='j') a->printf ("[");
-	if (cb) {
-		sdb_foreach (DB, cb, &ui);
-	} else {
-		sdb_foreach (DB, meta_print_item, &ui);
+/* copies of the items sorted by address, so the callers may change the
+ * stores while walking the list */
+R_API RList *r_meta_enumerate(RAnal *a, int type) {
+	RList *list = r_list_new ();
+	RAnalMetaStore *st;
+	RAnalMetaItem **all, *it;
+	int i, j, n = 0;
+	if (!list) return NULL;
+	list->free = r_meta_item_free;
+	for (i = 0; i < R_META_NTYPES; i++) {
+		if (type != R_META_TYPE_ANY && type != R_META_TYPES[i])
+			continue;
+		if ((st = store_ordered (a, R_META_TYPES[i])))
+			n += st->n;
 	}
-	if (rad=='j') a->printf ("]\n");
-	return ui.count;
+	if (!n || !(all = malloc (n * sizeof (RAnalMetaItem*))))
+		return list;
+	for (i = n = 0; i < R_META_NTYPES; i++) {
+		if (type != R_META_TYPE_ANY && type != R_META_TYPES[i])
+			continue;
+		if (!(st = a->meta_stores[i]))
+			continue;
+		memcpy (all + n, st->items, st->n * sizeof (RAnalMetaItem*));
+		n += st->n;
+	}
+	if (type == R_META_TYPE_ANY)
+		qsort (all, n, sizeof (RAnalMetaItem*), meta_cmp);
+	for (j = 0; j < n; j++) {
+		if (!(it = R_NEW (RAnalMetaItem)))
+			break;
+		*it = *all[j];
+		it->str = it->str? strdup (it->str): NULL;
+		r_list_append (list, it);
+	}
+	free (all);
+	return list;
 }
 
-R_API int r_meta_list(RAnal *a, int type, int rad) {
-	return r_meta_list_cb (a, type, rad, NULL, NULL);
+static char *serialize(RAnalMetaItem *it, char *k, int klen) {
+	char *e_str = sdb_encode ((const ut8*)(it->str? it->str: ""), -1);
+	char *v = r_str_newf ("%d,%d,%s", (int)it->size, it->space, e_str? e_str: "");
+	snprintf (k, klen, "meta.%c.0x%"PFMT64x, it->type, it->from);
+	free (e_str);
+	return v;
 }
 
-static int meta_enumerate_cb(void *user, const char *k, const char *v) {
+static int deserialize(RAnalMetaItem *it, const char *k, const char *v) {
 	const char *v2;
-	RAnalMetaUserItem *ui = user;
-	RList *list = ui->user;
-	//RAnal *a = ui->anal;
-	RAnalMetaItem *it;
-	if (strlen (k)<8)
-		return 1;
+	if (strlen (k)<8 || strncmp (k, "meta.", 5))
+		return R_FALSE;
 	if (memcmp (k+6, ".0x", 3))
-		return 1;
-	it = R_NEW0 (RAnalMetaItem);
-	if (!it) return 0;
+		return R_FALSE;
 	it->type = k[5];
 	it->size = sdb_atoi (v);
 	it->from = sdb_atoi (k+7);
 	it->to = it->from + it->size;
 	v2 = strchr (v, ',');
-	if (!v2) {
-		free (it); 
-		goto beach;
-	}
+	if (!v2) return R_FALSE;
 	it->space = atoi (v2+1);
 	it->str = strchr (v2+1, ',');
-
-	if (it->str)
-		it->str = (char *)sdb_decode ((const char*)it->str+1, 0);
-	//printmetaitem (ui->anal, &it, ui->rad);
-	r_list_append (list, it);
-beach:
-	return 1;
+	it->str = it->str? (char *)sdb_decode ((const char*)it->str+1, 0): NULL;
+	return R_TRUE;
 }
 
-R_API RList *r_meta_enumerate(RAnal *a, int type) {
-	RList *list = r_list_new ();
-	r_meta_list_cb (a, type, 0, meta_enumerate_cb, list);
-	return list;
+R_API int r_meta_list_cb(RAnal *a, int type, int rad, SdbForeachCallback cb, void *user) {
+	RAnalMetaUserItem ui = { a, type, rad, cb, user, 0 };
+	RList *list = r_meta_enumerate (a, type);
+	RAnalMetaItem *it;
+	RListIter *iter;
+	char key[100], *val;
+	int ret;
+	if (rad=='j') a->printf ("[");
+	r_list_foreach (list, iter, it) {
+		if (cb) {
+			val = serialize (it, key, sizeof (key));
+			ret = val? cb (&ui, key, val): 1;
+			free (val);
+			if (!ret) break;
+		} else {
+			printmetaitem (a, it, rad);
+			ui.count++;
+		}
+	}
+	if (rad=='j') a->printf ("]\n");
+	r_list_free (list);
+	return ui.count;
 }
 
-static int deserialize(RAnalMetaItem *it, const char *k, const char *v) {
-	const char *v2;
-	if (strlen (k)<8)
-		return 1;
-	if (memcmp (k+6, ".0x", 3))
-		return 1;
-	it->type = k[5];
-	it->size = sdb_atoi (v);
-	it->from = sdb_atoi (k+7);
-	it->to = it->from + it->size;
-	v2 = strchr (v, ',');
-	if (!v2) goto beach;
-	it->space = atoi (v2+1);
-	it->str = strchr (v2+1, ',');
-	//printmetaitem (ui->anal, &it, ui->rad);
-beach:
-	return 1;
+R_API int r_meta_list(RAnal *a, int type, int rad) {
+	return r_meta_list_cb (a, type, rad, NULL, NULL);
 }
 
-static void serialize(RAnalMetaItem *it, char *k, char *v) {
-	sprintf (k, "meta.%c.0x%"PFMT64x, it->type, it->from);
-	snprintf (v, 4095, "%d,%d,%s", (int)it->size, it->space, it->str);
+/* replaces the contents of anal->sdb_meta with the stores */
+R_API void r_meta_sync(RAnal *a) {
+	RAnalMetaStore *st;
+	char key[100], *val;
+	int i, j;
+	sdb_reset (DB);
+	for (i = 0; i < R_META_NTYPES; i++) {
+		if (!(st = store_ordered (a, R_META_TYPES[i])))
+			continue;
+		for (j = 0; j < st->n; j++) {
+			val = serialize (st->items[j], key, sizeof (key));
+			if (val) sdb_set (DB, key, val, 0);
+			free (val);
+		}
+	}
 }
 
-static int meta_unset_cb(void *user, const char *k, const char *v) {
-	char nk[128], nv[4096];
+static int meta_load_cb(void *user, const char *k, const char *v) {
 	RAnalMetaUserItem *ui = user;
-	RAnal *a = ui->anal;
-	RAnalMetaItem it;
-	if (!strstr(k, ".0x"))
+	RAnalMetaItem it = {0};
+	if (!deserialize (&it, k, v))
 		return 1;
-	deserialize (&it, k, v);
-	if (it.space != -1) {
-		it.space = -1;
-		serialize (&it, nk, nv);
-		sdb_set (DB, nk, nv, 0);
-	}
+	if (meta_set (ui->anal, it.type, it.from, it.size, it.space, it.str))
+		ui->count++;
+	free (it.str);
 	return 1;
 }
 
-R_API void r_meta_space_unset_for(RAnal *a, int type) {
-	r_meta_list_cb (a, type, 0, meta_unset_cb, NULL);
+/* moves the items serialized in anal->sdb_meta into the stores */
+R_API int r_meta_load(RAnal *a) {
+	RAnalMetaUserItem ui = { a, R_META_TYPE_ANY, 0, NULL, NULL, 0 };
+	sdb_foreach (DB, meta_load_cb, &ui);
+	sdb_reset (DB);
+	return ui.count;
 }
 
-typedef struct {
-	int count;
-	int index;
-	int ctx;
-} myMetaUser;
-
-static int meta_count_cb(void *user, const char *k, const char *v) {
-	RAnalMetaUserItem *ui = user;
-	myMetaUser *mu = ui->user;
-	RAnalMetaItem it;
-	if (!strstr(k, ".0x"))
-		return 1;
-	deserialize (&it, k, v);
-	if (mu) {
-		if (it.space == mu->ctx) {
-			mu->count++;
+R_API void r_meta_space_unset_for(RAnal *a, int ctx) {
+	RAnalMetaStore *st;
+	int i, j;
+	for (i = 0; i < R_META_NTYPES; i++) {
+		if (!(st = a->meta_stores[i]))
+			continue;
+		for (j = 0; j < st->n; j++) {
+			if (st->items[j]->space == ctx)
+				st->items[j]->space = -1;
 		}
 	}
-	return 1;
 }
 
 R_API int r_meta_space_count_for(RAnal *a, int ctx) {
-	myMetaUser mu = {0};
-	mu.ctx = ctx;
-	int type = a->meta_spaces.space_idx;
-	r_meta_list_cb (a, type, 0, meta_count_cb, &mu);
-	return mu.count;
+	RAnalMetaStore *st;
+	int i, j, count = 0;
+	for (i = 0; i < R_META_NTYPES; i++) {
+		if (!(st = a->meta_stores[i]))
+			continue;
+		for (j = 0; j < st->n; j++) {
+			if (st->items[j]->type && st->items[j]->space == ctx)
+				count++;
+		}
+	}
+	return count;
 }
 
 #if 0
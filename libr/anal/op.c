@@ -47,13 +47,123 @@ R_API void r_anal_op_free(void *_op) {
 	free (_op);
 }
 
+#define OPCACHE_WAYS 4
+
+/* anything the plugin output depends on besides addr and the bytes */
+static ut64 opcache_state(RAnal *anal) {
+	ut64 h = (ut64)(size_t)anal->cur;
+	h = h * 31 + anal->bits;
+	h = h * 31 + anal->big_endian;
+	h = h * 31 + anal->decode;
+	h = h * 31 + anal->gp;
+	h = h * 31 + (anal->cpu? r_str_hash (anal->cpu): 0);
+	return h;
+}
+
+/* deep copy, values and esil are owned by each side */
+static void opcache_copy(RAnalOp *dst, RAnalOp *src) {
+	int i;
+	*dst = *src;
+	dst->mnemonic = src->mnemonic? strdup (src->mnemonic): NULL;
+	for (i = 0; i < 3; i++)
+		dst->src[i] = src->src[i]? r_anal_value_copy (src->src[i]): NULL;
+	dst->dst = src->dst? r_anal_value_copy (src->dst): NULL;
+	r_strbuf_init (&dst->esil);
+	r_strbuf_set (&dst->esil, r_strbuf_get (&src->esil));
+}
+
+/* size entries are kept, 0 disables the cache */
+R_API int r_anal_opcache_set(RAnal *anal, int size) {
+	int n = OPCACHE_WAYS;
+	r_anal_opcache_flush (anal);
+	R_FREE (anal->opcache.items);
+	anal->opcache.size = 0;
+	if (size < 1)
+		return R_TRUE;
+	while (n < size)
+		n <<= 1;
+	anal->opcache.items = calloc (n, sizeof (RAnalOpCacheItem));
+	if (!anal->opcache.items)
+		return R_FALSE;
+	anal->opcache.size = n;
+	return R_TRUE;
+}
+
+R_API void r_anal_opcache_flush(RAnal *anal) {
+	RAnalOp *op;
+	int i;
+	for (i = 0; i < anal->opcache.size; i++) {
+		op = anal->opcache.items[i].op;
+		if (op) {
+			r_strbuf_fini (&op->esil);
+			r_anal_op_free (op);
+			anal->opcache.items[i].op = NULL;
+		}
+		anal->opcache.items[i].used = 0;
+	}
+}
+
+/* same layout as the asm one: set associative, on a miss the way to
+ * replace is a stale entry for the same addr or the least recently used */
+static RAnalOpCacheItem *opcache_get(RAnalOpCache *c, ut64 addr, ut64 state, const ut8 *buf, int len, RAnalOpCacheItem **victim) {
+	ut64 h = (addr ^ (addr >> 16)) * 0x9e3779b97f4a7c15ULL;
+	RAnalOpCacheItem *set = &c->items[(h >> 32) & (c->size - OPCACHE_WAYS)];
+	RAnalOpCacheItem *it, *lru = set;
+	int i;
+	for (i = 0; i < OPCACHE_WAYS; i++) {
+		it = &set[i];
+		if (it->op && it->op->addr == addr) {
+			if (it->state == state && it->op->size <= len &&
+					!memcmp (it->bytes, buf, it->op->size)) {
+				it->used = ++c->tick;
+				return it;
+			}
+			lru = it;
+			break;
+		}
+		if (it->used < lru->used)
+			lru = it;
+	}
+	*victim = lru;
+	return NULL;
+}
+
 R_API int r_anal_op(RAnal *anal, RAnalOp *op, ut64 addr, const ut8 *data, int len) {
+	RAnalOpCacheItem *hit, *it = NULL;
+	ut64 state = 0;
 	int ret = R_FALSE;
 	if (len>0 && anal && memset (op, 0, sizeof (RAnalOp)) &&
 		anal->cur && anal->cur->op) {
+		if (anal->opcache.size) {
+			state = opcache_state (anal);
+			hit = opcache_get (&anal->opcache, addr, state, data, len, &it);
+			if (hit) {
+				anal->opcache.hits++;
+				opcache_copy (op, hit->op);
+				return hit->ret;
+			}
+			anal->opcache.misses++;
+		}
 		ret = anal->cur->op (anal, op, addr, data, len);
 		op->addr = addr;
 		if (ret<1) op->type = R_ANAL_OP_TYPE_ILL;
+		/* ops chained to others are not cached */
+		else if (it && !op->next && !op->switch_op && op->size > 0 &&
+				op->size <= R_ANAL_OPCACHE_MAXLEN && op->size <= len) {
+			if (!it->op)
+				it->op = R_NEW0 (RAnalOp);
+			else {
+				r_strbuf_fini (&it->op->esil);
+				r_anal_op_fini (it->op);
+			}
+			if (it->op) {
+				opcache_copy (it->op, op);
+				it->state = state;
+				it->ret = ret;
+				it->used = ++anal->opcache.tick;
+				memcpy (it->bytes, data, op->size);
+			}
+		}
 	}
 	return ret;
 }
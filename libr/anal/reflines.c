@@ -6,6 +6,14 @@
 
 
 
+static void free_idx(RAnalReflineIdx *idx) {
+	if (!idx) return;
+	free (idx->lines);
+	free (idx->from);
+	free (idx->to);
+	free (idx);
+}
+
 static void free_refline_list (struct list_head *head){
 	struct list_head *pos, *n;
 	RAnalRefline *ref;
@@ -14,9 +22,67 @@ static void free_refline_list (struct list_head *head){
 		free (ref);
 	}
 	ref = list_entry (head, RAnalRefline, list);
+	free_idx (ref->idx);
 	free (ref);
 }
 
+static int key_cmp(const void *a, const void *b) {
+	const RAnalReflineKey *x = a, *y = b;
+	if (x->addr != y->addr)
+		return (x->addr < y->addr)? -1: 1;
+	return x->pos - y->pos;
+}
+
+/* first key at or after addr */
+static int key_lower(const RAnalReflineKey *k, int n, ut64 addr) {
+	int lo = 0, hi = n, mid;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (k[mid].addr < addr)
+			lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+/* built on first use, the lists are not changed once returned */
+static RAnalReflineIdx *reflines_idx(RAnalRefline *list) {
+	struct list_head *pos;
+	RAnalReflineIdx *idx;
+	int n = 0;
+
+	if (list->idx)
+		return list->idx;
+	list_for_each (pos, &list->list)
+		n++;
+	if (!(idx = R_NEW0 (RAnalReflineIdx)))
+		return NULL;
+	idx->lines = malloc ((n + 1) * sizeof (RAnalRefline *));
+	idx->from = malloc ((n + 1) * sizeof (RAnalReflineKey));
+	idx->to = malloc ((n + 1) * sizeof (RAnalReflineKey));
+	if (!idx->lines || !idx->from || !idx->to) {
+		free_idx (idx);
+		return NULL;
+	}
+	list_for_each (pos, &list->list) {
+		RAnalRefline *ref = list_entry (pos, RAnalRefline, list);
+		idx->lines[idx->n] = ref;
+		idx->from[idx->n].addr = ref->from;
+		idx->from[idx->n].pos = idx->n;
+		idx->to[idx->n].addr = ref->to;
+		idx->to[idx->n].pos = idx->n;
+		idx->n++;
+	}
+	qsort (idx->from, n, sizeof (RAnalReflineKey), key_cmp);
+	qsort (idx->to, n, sizeof (RAnalReflineKey), key_cmp);
+	return list->idx = idx;
+}
+
+R_API void r_anal_reflines_free(RAnalRefline *list) {
+	if (list)
+		free_refline_list (&list->list);
+}
+
 R_API struct r_anal_refline_t *r_anal_reflines_get(RAnal *anal,
 	ut64 addr, const ut8 *buf, ut64 len, int nlines, int linesout, int linescall)
 {
@@ -30,6 +96,7 @@ R_API struct r_anal_refline_t *r_anal_reflines_get(RAnal *anal,
 
 	list = R_NEW (RAnalRefline);
 	if (!list) return NULL;
+	list->idx = NULL;
 
 	INIT_LIST_HEAD (&(list->list));
 
@@ -209,61 +276,82 @@ R_API struct r_anal_refline_t *r_anal_reflines_fcn_get( struct r_anal_t *anal, R
 }
 
 R_API int r_anal_reflines_middle(RAnal *a, RAnalRefline *list, ut64 addr, int len) {
-	struct list_head *pos;
-	if (list)
-	for (pos = (&(list->list))->next; pos != (&(list->list)); pos = pos->next) {
-		RAnalRefline *ref = list_entry (pos, RAnalRefline, list);
-		if ((ref->to> addr) && (ref->to < addr+len))
-			return R_TRUE;
-	}
-	return R_FALSE;
+	RAnalReflineIdx *idx;
+	int i;
+	if (!list || !(idx = reflines_idx (list)))
+		return R_FALSE;
+	i = key_lower (idx->to, idx->n, addr + 1);
+	return (i < idx->n && idx->to[i].addr < addr + len);
 }
 
 // TODO: move into another file
-// TODO: this is TOO SLOW. do not iterate over all reflines or gtfo
+/* one column per line, in list order or reversed for asm.linestyle=0.
+ * the lines ending or starting at addr are found in the sorted views,
+ * they turn the rest of the row into an arrow. the columns cut out by
+ * asm.lineswidth are not drawn, only the arrow state they leave */
 R_API char* r_anal_reflines_str(void *core, ut64 addr, int opts) {
-	RBuffer *b;
 	int l, linestyle = opts & R_ANAL_REFLINE_TYPE_STYLE;
 	int dir = 0, wide = opts & R_ANAL_REFLINE_TYPE_WIDE;
-	char ch = ' ', *str = NULL;
-	struct list_head *pos;
+	int i, n, p, first = 0, last = -1, lastin = -1, colw, lw, in;
+	char ch = ' ', *str = NULL, *s, *mark;
 	RAnalRefline *ref, *list = ((RCore*)core)->reflines;
+	RAnalReflineIdx *idx;
 
-	if (!list) return NULL;
-
-	b = r_buf_new ();
-	r_buf_append_string (b, " ");
-	for (pos = linestyle?(&(list->list))->next:(&(list->list))->prev;
-		pos != (&(list->list)); pos = linestyle?pos->next:pos->prev) {
-		ref = list_entry (pos, RAnalRefline, list);
-		dir = (addr == ref->to)? 1: (addr == ref->from)? 2: dir;
-		if (addr == ref->to) {
-			r_buf_append_string (b, (ref->from>ref->to)? "." : "`");
+	if (!list || !(idx = reflines_idx (list)))
+		return NULL;
+	n = idx->n;
+	colw = wide? 2: 1;
+	lw = ((RCore*)core)->anal->lineswidth;
+	l = 1 + n * colw;
+	if (lw > 0 && l > lw)
+		first = (l - lw - 1) / colw;
+	mark = calloc (n - first + 1, 1);
+	str = malloc ((n - first) * colw + 2);
+	if (!mark || !str) {
+		free (mark);
+		free (str);
+		return NULL;
+	}
+#define COL(pos) (linestyle? (pos): n - 1 - (pos))
+#define ENDPOINT(col, t) \
+	if ((col) >= first) mark[(col) - first] = t; \
+	else if ((col) > lastin) { lastin = (col); ch = (t == 1)? '-': '='; } \
+	if ((col) > last) { last = (col); dir = t; }
+	for (i = key_lower (idx->to, n, addr); i < n && idx->to[i].addr == addr; i++) {
+		p = COL (idx->to[i].pos);
+		ENDPOINT (p, 1);
+	}
+	for (i = key_lower (idx->from, n, addr); i < n && idx->from[i].addr == addr; i++) {
+		if (idx->lines[idx->from[i].pos]->to == addr)
+			continue;	// drawn as the target
+		p = COL (idx->from[i].pos);
+		ENDPOINT (p, 2);
+	}
+	s = str;
+	if (!first)
+		*s++ = ' ';
+	for (p = first; p < n; p++) {
+		ref = idx->lines[COL (p)];
+		if (mark[p - first] == 1) {
+			*s++ = (ref->from>ref->to)? '.' : '`';
 			ch = '-';
-		} else if (addr == ref->from) {
-			r_buf_append_string (b, (ref->from>ref->to)? "`" : ",");
+		} else if (mark[p - first] == 2) {
+			*s++ = (ref->from>ref->to)? '`' : ',';
 			ch = '=';
-		} else if (ref->from < ref->to) {
-			if (addr > ref->from && addr < ref->to) {
-				if (ch=='-' || ch=='=')
-					r_buf_append_bytes (b, (const ut8*)&ch, 1);
-				else r_buf_append_string (b, "|");
-			} else r_buf_append_bytes (b, (const ut8*)&ch, 1);
 		} else {
-			if (addr < ref->from && addr > ref->to) {
-				if (ch=='-' || ch=='=')
-					r_buf_append_bytes (b, (const ut8*)&ch, 1);
-				else r_buf_append_string (b, "|"); // line going up
-			} else r_buf_append_bytes (b, (const ut8*)&ch, 1);
-		}
-		if (wide) {
-			char w = (ch=='=' || ch=='-')? ch : ' ';
-			r_buf_append_bytes (b, (const ut8*)&w, 1);
+			in = (ref->from < ref->to)?
+				(addr > ref->from && addr < ref->to):
+				(addr < ref->from && addr > ref->to);
+			*s++ = (in && ch != '-' && ch != '=')? '|': ch;
 		}
+		if (wide)
+			*s++ = (ch=='=' || ch=='-')? ch : ' ';
 	}
-	str = r_buf_free_to_string (b);
-	if (((RCore*)core)->anal->lineswidth>0) {
-		int lw = ((RCore*)core)->anal->lineswidth;
+	*s = 0;
+#undef COL
+#undef ENDPOINT
+	free (mark);
+	if (lw>0) {
 		l = strlen (str);
 		if (l > lw) {
 			r_str_cpy (str, str + l - lw);
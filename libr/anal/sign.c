@@ -5,6 +5,129 @@
 
 R_LIB_VERSION (r_sign);
 
+/* Byte signatures are indexed by the first SIGN_IDX_LEN consecutive
+ * unmasked bytes found in their first SIGN_IDX_OFF bytes. One hashtable
+ * is kept per distinct offset of that run, so r_sign_check() only has to
+ * compare the signatures whose run matches the buffer at that offset */
+#define SIGN_IDX_LEN 4
+#define SIGN_IDX_OFF 32
+
+typedef struct {
+	int idx; /* position in sig->items, the first match wins */
+	RSignItem *si;
+} RSignEntry;
+
+struct r_sign_index_t {
+	RSignEntry *entries;
+	int noffs;
+	int offs[SIGN_IDX_OFF];
+	RHashTable *ht[SIGN_IDX_OFF];
+	RList *lists; /* bucket lists, owned */
+	RList *rest; /* signatures without an unmasked run */
+	int maxoff; /* buffers shorter than this are scanned linearly */
+};
+
+static void sign_index_free(RSign *sig) {
+	RSignIndex *si = sig->index;
+	int i;
+	if (!si) return;
+	for (i = 0; i < si->noffs; i++)
+		r_hashtable_free (si->ht[i]);
+	r_list_free (si->lists);
+	r_list_free (si->rest);
+	free (si->entries);
+	free (si);
+	sig->index = NULL;
+}
+
+static int sign_item_run(RSignItem *si) {
+	int i, n = 0, lim = R_MIN (si->size, SIGN_IDX_OFF + SIGN_IDX_LEN);
+	for (i = 0; i < lim; i++) {
+		if (si->mask[i] != 0xff) {
+			n = 0;
+			continue;
+		}
+		if (++n == SIGN_IDX_LEN)
+			return i + 1 - SIGN_IDX_LEN;
+	}
+	return -1;
+}
+
+static RSignIndex *sign_index_build(RSign *sig) {
+	RSignIndex *ix = R_NEW0 (RSignIndex);
+	RListIter *iter;
+	RSignItem *si;
+	int i, n = 0;
+
+	if (!ix) return NULL;
+	ix->entries = calloc (r_list_length (sig->items) + 1, sizeof (RSignEntry));
+	ix->lists = r_list_newf ((RListFree)r_list_free);
+	ix->rest = r_list_new ();
+	if (!ix->entries || !ix->lists || !ix->rest)
+		goto fail;
+	r_list_foreach (sig->items, iter, si) {
+		RSignEntry *e = &ix->entries[n];
+		RList *bucket;
+		ut32 key;
+		int off;
+		e->idx = n++;
+		e->si = si;
+		if (si->type != R_SIGN_BYTE)
+			continue;
+		off = sign_item_run (si);
+		if (off < 0) {
+			r_list_append (ix->rest, e);
+			continue;
+		}
+		for (i = 0; i < ix->noffs; i++)
+			if (ix->offs[i] == off) break;
+		if (i == ix->noffs) {
+			if (!(ix->ht[i] = r_hashtable_new ()))
+				goto fail;
+			ix->offs[i] = off;
+			ix->noffs++;
+			if (off + SIGN_IDX_LEN > ix->maxoff)
+				ix->maxoff = off + SIGN_IDX_LEN;
+		}
+		memcpy (&key, si->bytes + off, sizeof (key));
+		bucket = r_hashtable_lookup (ix->ht[i], key);
+		if (!bucket) {
+			bucket = r_list_new ();
+			r_list_append (ix->lists, bucket);
+			r_hashtable_insert (ix->ht[i], key, bucket);
+		}
+		r_list_append (bucket, e);
+	}
+	sig->index = ix;
+	return ix;
+fail:
+	sig->index = ix;
+	sign_index_free (sig);
+	return NULL;
+}
+
+static int sign_item_match(RSignItem *si, const ut8 *buf, int len) {
+	int i, l = R_MIN (len, si->size);
+	for (i = 0; i < l; i++) {
+		if ((buf[i] & si->mask[i]) != (si->bytes[i] & si->mask[i]))
+			return R_FALSE;
+	}
+	return R_TRUE;
+}
+
+/* returns the lowest index of a matching entry below best */
+static int sign_list_check(RList *list, const ut8 *buf, int len, int best) {
+	RListIter *iter;
+	RSignEntry *e;
+	r_list_foreach (list, iter, e) {
+		if (e->idx >= best)
+			break;
+		if (sign_item_match (e->si, buf, len))
+			return e->idx;
+	}
+	return best;
+}
+
 R_API RSign *r_sign_new() {
 	RSign *sig = R_NEW0 (RSign);
 	if (sig) {
@@ -55,6 +178,7 @@ R_API int r_sign_add(RSign *sig, RAnal *anal, int type, const char *name, const
 		if (!r_list_append (sig->items, si)){
 			r_sign_item_free (si);
 		}
+		sign_index_free (sig);
 		break;
 	case R_SIGN_HEAD: // function prefix (push ebp..)
 	case R_SIGN_BYTE: // function mask
@@ -75,6 +199,7 @@ R_API int r_sign_add(RSign *sig, RAnal *anal, int type, const char *name, const
 			r_sign_item_free (si);
 		} else {
 			r_list_append (sig->items, si);
+			sign_index_free (sig);
 			if (type==R_SIGN_HEAD)
 				sig->s_head++;
 			else if (type==R_SIGN_BYTE)
@@ -119,6 +244,7 @@ R_API void r_sign_list(RSign *sig, int rad) {
 R_API void r_sign_reset(RSign *sig) {
 	if (!sig)
 		return;
+	sign_index_free (sig);
 	r_list_free (sig->items);
 	sig->items = r_list_new ();
 	sig->s_anal = sig->s_byte = sig->s_head = sig->s_func = 0;
@@ -133,6 +259,7 @@ R_API int r_sign_remove_ns(RSign* sig, const char* ns) {
 	if (!sig || !ns)
 		return -1;
 
+	sign_index_free (sig);
 	plen = strlen (ns);
 	r_list_foreach_safe (sig->items, iter, iter2, si) {
 		if (!strncmp (si->name, ns, plen)) {
@@ -151,6 +278,7 @@ R_API int r_sign_remove_ns(RSign* sig, const char* ns) {
 
 R_API RSign *r_sign_free(RSign *sig) {
 	if (!sig) return NULL;
+	sign_index_free (sig);
 	r_list_free (sig->items);
 	free (sig);
 	return NULL;
@@ -167,18 +295,30 @@ R_API void r_sign_item_free(void *_item) {
 
 
 R_API RSignItem *r_sign_check(RSign *sig, const ut8 *buf, int len) {
+	RSignIndex *ix;
 	RListIter *iter;
 	RSignItem *si;
+	int i, best;
 
 	if (!sig || !buf)
 		return NULL;
-
-	r_list_foreach (sig->items, iter, si) {
-		if (si->type == R_SIGN_BYTE) {
-			int l = (len>si->size)?si->size:len;
-			if (!r_mem_cmp_mask (buf, si->bytes, si->mask, l))
+	ix = sig->index? sig->index: sign_index_build (sig);
+	if (!ix || len < ix->maxoff) {
+		/* near the end of the buffer signatures match partially */
+		r_list_foreach (sig->items, iter, si) {
+			if (si->type == R_SIGN_BYTE && sign_item_match (si, buf, len))
 				return si;
 		}
+		return NULL;
 	}
-	return NULL;
+	best = sign_list_check (ix->rest, buf, len, ST32_MAX);
+	for (i = 0; i < ix->noffs; i++) {
+		ut32 key;
+		RList *bucket;
+		memcpy (&key, buf + ix->offs[i], sizeof (key));
+		bucket = r_hashtable_lookup (ix->ht[i], key);
+		if (bucket)
+			best = sign_list_check (bucket, buf, len, best);
+	}
+	return (best != ST32_MAX)? ix->entries[best].si: NULL;
 }
@@ -0,0 +1,173 @@
+/* incremental update of the blocks touched by writes: patched terminators
+ * split and merge blocks and move the refs done from them */
+
+#include <r_anal.h>
+
+#define BASE 0x1000
+#define CALLEE 0x1100
+
+static ut8 mem[0x200] = {
+	0x31, 0xc0,                   /* 0x1000 xor eax, eax */
+	0x85, 0xc9,                   /* 0x1002 test ecx, ecx */
+	0x74, 0x05,                   /* 0x1004 je 0x100b */
+	0xe8, 0xf5, 0x00, 0x00, 0x00, /* 0x1006 call 0x1100 */
+	0x40,                         /* 0x100b inc eax */
+	0x90, 0x90,                   /* 0x100c nop; nop */
+	0xc3,                         /* 0x100e ret */
+};
+
+static int mem_read(RIO *io, ut64 addr, ut8 *buf, int len) {
+	int i;
+	for (i = 0; i < len; i++)
+		buf[i] = (addr + i >= BASE && addr + i < BASE + sizeof (mem))?
+			mem[addr + i - BASE]: 0xff;
+	return len;
+}
+
+static int mem_valid(RIO *io, ut64 addr, int hasperm) {
+	return addr >= BASE && addr < BASE + sizeof (mem);
+}
+
+/* what the io write hook does in core */
+static void patch(RAnal *anal, ut64 addr, const char *hex) {
+	ut8 buf[32];
+	int len = r_hex_str2bin (hex, buf);
+	memcpy (mem + addr - BASE, buf, len);
+	r_anal_fcn_bb_dirty (anal, addr, len);
+}
+
+/* the blocks as "addr:size>jump,fail" sorted by address */
+static char *bbs_str(RAnalFunction *fcn) {
+	RAnalBlock *bb, *min;
+	RListIter *iter;
+	ut64 last = 0;
+	char *s = strdup ("");
+	int first = 1;
+	for (;;) {
+		min = NULL;
+		r_list_foreach (fcn->bbs, iter, bb) {
+			if ((first || bb->addr > last) && (!min || bb->addr < min->addr))
+				min = bb;
+		}
+		if (!min) break;
+		s = r_str_concatf (s, "%s%"PFMT64x":%x>%"PFMT64x",%"PFMT64x,
+			first? "": " ", min->addr, min->size,
+			min->jump == UT64_MAX? 0: min->jump,
+			min->fail == UT64_MAX? 0: min->fail);
+		last = min->addr;
+		first = 0;
+	}
+	return s;
+}
+
+static int has_ref(RList *refs, ut64 at, ut64 addr, int type) {
+	RListIter *iter;
+	RAnalRef *ref;
+	r_list_foreach (refs, iter, ref) {
+		if (ref->at == at && ref->addr == addr && ref->type == type)
+			return 1;
+	}
+	return 0;
+}
+
+/* the ref done from at is in the xrefs db */
+static int has_xref(RAnal *anal, ut64 at, ut64 addr, int type) {
+	RList *xrefs = r_anal_xrefs_get (anal, addr);
+	int ret;
+	if (!xrefs) return 0;
+	xrefs->free = r_anal_ref_free;
+	ret = has_ref (xrefs, addr, at, type);
+	r_list_free (xrefs);
+	return ret;
+}
+
+static int check_ref(RAnal *anal, RAnalFunction *fcn, ut64 at, ut64 addr, int type, int exp) {
+	RAnalFunction *callee = r_anal_get_fcn_at (anal, addr, 0);
+	int fail = 0;
+	if (has_ref (fcn->refs, at, addr, type) != exp)
+		fail++;
+	if (has_xref (anal, at, addr, type) != exp)
+		fail++;
+	if (type == R_ANAL_REF_TYPE_CALL && callee
+			&& has_ref (callee->xrefs, at, addr, type) != exp)
+		fail++;
+	if (fail)
+		printf ("[-] ref 0x%"PFMT64x" -> 0x%"PFMT64x" should %sexist\n",
+			at, addr, exp? "": "not ");
+	return fail;
+}
+
+static int step(RAnal *anal, RAnalFunction *fcn, const char *what, int n, const char *exp) {
+	int ret = r_anal_fcn_update_dirty (anal);
+	char *s = bbs_str (fcn);
+	int fail = ret != n || strcmp (s, exp);
+	printf ("%s %s: %s (%d blocks decoded)\n", fail? "[-]": "[+]", what, s, ret);
+	if (fail)
+		printf ("    expected %s (%d blocks decoded)\n", exp, n);
+	free (s);
+	return fail;
+}
+
+int main() {
+	RAnal *anal = r_anal_new ();
+	RAnalFunction *fcn;
+	int i, fail = 0;
+
+	if (!r_anal_use (anal, "x86.udis")) {
+		printf ("[-] x86.udis is not available\n");
+		return 1;
+	}
+	r_anal_set_bits (anal, 32);
+	anal->iob.read_at = mem_read;
+	anal->iob.is_valid_offset = mem_valid;
+	r_anal_fcn_add (anal, CALLEE, 1, "callee", R_ANAL_FCN_TYPE_FCN, NULL);
+	r_anal_fcn_add (anal, BASE, 0xf, "main", R_ANAL_FCN_TYPE_FCN, NULL);
+	fcn = r_anal_get_fcn_at (anal, BASE, 0);
+	if (!fcn || !r_anal_get_fcn_at (anal, CALLEE, 0))
+		return 1;
+	/* a single block covering the whole function is split by its branches */
+	r_anal_fcn_add_bb (anal, fcn, BASE, 0xf, UT64_MAX, UT64_MAX, R_ANAL_BB_TYPE_HEAD, NULL);
+	r_anal_fcn_bb_dirty (anal, BASE, 0xf);
+	fail += step (anal, fcn, "initial", 3, "1000:6>100b,1006 1006:5>100b,0 100b:4>0,0");
+	fail += check_ref (anal, fcn, 0x1004, 0x100b, R_ANAL_REF_TYPE_CODE, 1);
+	fail += check_ref (anal, fcn, 0x1006, CALLEE, R_ANAL_REF_TYPE_CALL, 1);
+	fail += step (anal, fcn, "no writes", 0, "1000:6>100b,1006 1006:5>100b,0 100b:4>0,0");
+
+	/* je -> nop nop: the head falls into its only successor and absorbs it */
+	patch (anal, 0x1004, "9090");
+	fail += step (anal, fcn, "je removed", 1, "1000:b>100b,0 100b:4>0,0");
+	fail += check_ref (anal, fcn, 0x1004, 0x100b, R_ANAL_REF_TYPE_CODE, 0);
+	fail += check_ref (anal, fcn, 0x1006, CALLEE, R_ANAL_REF_TYPE_CALL, 1);
+
+	/* the call is gone from the function, the callee and the xrefs db.
+	 * the block now falls into its only successor and absorbs it */
+	patch (anal, 0x1006, "9090909090");
+	fail += step (anal, fcn, "call removed", 1, "1000:f>0,0");
+	fail += check_ref (anal, fcn, 0x1006, CALLEE, R_ANAL_REF_TYPE_CALL, 0);
+
+	/* a new jmp in the middle of the block splits it */
+	patch (anal, 0x100c, "eb00");
+	fail += step (anal, fcn, "jmp added", 2, "1000:e>100e,0 100e:1>0,0");
+	fail += check_ref (anal, fcn, 0x100c, 0x100e, R_ANAL_REF_TYPE_CODE, 1);
+
+	/* and removing it merges them back */
+	patch (anal, 0x100c, "9090");
+	fail += step (anal, fcn, "jmp removed", 1, "1000:f>0,0");
+	fail += check_ref (anal, fcn, 0x100c, 0x100e, R_ANAL_REF_TYPE_CODE, 0);
+
+	/* writes outside of any block decode nothing */
+	patch (anal, 0x1180, "cc");
+	fail += step (anal, fcn, "unrelated write", 0, "1000:f>0,0");
+
+	/* too many scattered writes are folded into a single range */
+	for (i = 0; i < 10000; i++)
+		r_anal_fcn_bb_dirty (anal, 0x1080 + (i % 2) * 0x100, 1);
+	fail += step (anal, fcn, "scattered writes", 0, "1000:f>0,0");
+	for (i = 0; i < 10000; i++)
+		r_anal_fcn_bb_dirty (anal, (i % 2)? 0x1180: 0x100e, 1);
+	fail += step (anal, fcn, "scattered writes", 1, "1000:f>0,0");
+
+	printf ("%s\n", fail? "[-] failed": "[+] ok");
+	r_anal_free (anal);
+	return fail? 1: 0;
+}
@@ -0,0 +1,129 @@
+/* one writer adding analysis results while readers query them under RAnal.lock */
+
+#include <r_anal.h>
+
+#define NREADERS 4
+
+typedef struct {
+	RAnal *anal;
+	int n;      /* functions to add */
+	int done;   /* functions added so far, guarded by anal->lock */
+	int stop;
+} Shared;
+
+typedef struct {
+	Shared *sh;
+	int seed;
+	int queries;
+	int fail;
+} Reader;
+
+#define FCN_ADDR(i) (0x10000 + (ut64)(i) * 0x100)
+#define CALLER(i) (0x800000 + (ut64)(i) * 4)
+
+static int writer_thread(RThread *th) {
+	Shared *sh = th->user;
+	RAnal *anal = sh->anal;
+	char cmt[32];
+	int i;
+
+	for (i = 0; i < sh->n; i++) {
+		ut64 addr = FCN_ADDR (i);
+		snprintf (cmt, sizeof (cmt), "c.%d", i);
+		r_anal_lock_write (anal);
+		r_anal_fcn_add (anal, addr, 0x80, NULL, R_ANAL_FCN_TYPE_FCN, NULL);
+		r_anal_xrefs_set (anal, R_ANAL_REF_TYPE_CALL, CALLER (i), addr);
+		/* a dropped and re-added reference keeps the array runs busy */
+		r_anal_xrefs_set (anal, R_ANAL_REF_TYPE_CALL, CALLER (i) + 1, addr);
+		r_anal_xrefs_deln (anal, R_ANAL_REF_TYPE_CALL, CALLER (i) + 1, addr);
+		r_meta_set_string (anal, R_META_TYPE_COMMENT, addr, cmt);
+		r_anal_hint_set_size (anal, addr, 1 + (i % 15));
+		sh->done = i + 1;
+		r_anal_unlock (anal);
+	}
+	return R_FALSE;
+}
+
+static int check(RAnal *anal, int i) {
+	ut64 addr = FCN_ADDR (i);
+	RAnalFunction *fcn = r_anal_get_fcn_in (anal, addr + 0x10, 0);
+	RAnalHint *hint;
+	RAnalRef *ref;
+	RList *refs;
+	char cmt[32], *s;
+	int ok = fcn && fcn->addr == addr;
+
+	refs = r_anal_xrefs_get (anal, addr);
+	if (refs) {
+		refs->free = r_anal_ref_free;
+		ref = r_list_first (refs);
+		ok &= r_list_length (refs) == 1 && ref->addr == CALLER (i);
+		r_list_free (refs);
+	} else ok = 0;
+	snprintf (cmt, sizeof (cmt), "c.%d", i);
+	s = r_meta_get_string (anal, R_META_TYPE_COMMENT, addr);
+	ok &= s && !strcmp (s, cmt);
+	free (s);
+	hint = r_anal_hint_get (anal, addr);
+	ok &= hint && hint->size == 1 + (i % 15);
+	r_anal_hint_free (hint);
+	return ok;
+}
+
+static int reader_thread(RThread *th) {
+	Reader *r = th->user;
+	Shared *sh = r->sh;
+	int done, stop;
+
+	do {
+		r_anal_lock_read (sh->anal);
+		done = sh->done;
+		stop = sh->stop;
+		if (done > 0) {
+			r->seed = r->seed * 1103515245 + 12345;
+			if (!check (sh->anal, ((ut32)r->seed >> 8) % done))
+				r->fail++;
+			r->queries++;
+		}
+		r_anal_unlock (sh->anal);
+	} while (!stop);
+	return R_FALSE;
+}
+
+int main(int argc, char **argv) {
+	Shared sh = { 0 };
+	Reader readers[NREADERS];
+	RThread *wth, *rth[NREADERS];
+	int i, queries = 0, fail = 0;
+	ut64 t0, t1;
+
+	sh.anal = r_anal_new ();
+	sh.n = argc > 1? atoi (argv[1]): 2000;
+	t0 = r_sys_now ();
+	for (i = 0; i < NREADERS; i++) {
+		readers[i].sh = &sh;
+		readers[i].seed = i + 1;
+		readers[i].queries = readers[i].fail = 0;
+		rth[i] = r_th_new (reader_thread, &readers[i], 0);
+	}
+	wth = r_th_new (writer_thread, &sh, 0);
+	r_th_free (wth);
+	r_anal_lock_write (sh.anal);
+	sh.stop = 1;
+	r_anal_unlock (sh.anal);
+	for (i = 0; i < NREADERS; i++) {
+		r_th_free (rth[i]);
+		queries += readers[i].queries;
+		fail += readers[i].fail;
+	}
+	/* everything must be there once the writer is gone */
+	for (i = 0; i < sh.n; i++)
+		if (!check (sh.anal, i))
+			fail++;
+	t1 = r_sys_now ();
+	printf ("%d functions, %d queries from %d readers, %.3f ms\n",
+		sh.n, queries, NREADERS, (double)(t1 - t0) / 1000);
+	printf ("%s\n", fail? "[-] failed": "[+] ok");
+	r_anal_free (sh.anal);
+	return fail? 1: 0;
+}
@@ -0,0 +1,129 @@
+/* metadata stores: bulk insertion of comments and strings in random
+ * order, point and range queries checked against a linear scan */
+
+#include <r_anal.h>
+
+#define NQUERIES 200
+
+typedef struct {
+	ut64 from;
+	ut64 size;
+	int type;
+	int alive;
+} Item;
+
+/* a bijection on [0, 2^bits), so every address is used once */
+static ut64 item_addr(int i, int bits) {
+	return ((ut64)i * 2654435761U) & ((1ULL << bits) - 1);
+}
+
+/* the covering item that starts last, or -1 */
+static int scan_in(Item *it, int n, int type, ut64 addr) {
+	int i, best = -1;
+	for (i = 0; i < n; i++) {
+		if (!it[i].alive || it[i].type != type)
+			continue;
+		if (it[i].from <= addr && addr < it[i].from + it[i].size)
+			if (best == -1 || it[i].from > it[best].from)
+				best = i;
+	}
+	return best;
+}
+
+static int scan_count(Item *it, int n, int type, ut64 from, ut64 to) {
+	int i, count = 0;
+	for (i = 0; i < n; i++) {
+		if (it[i].alive && it[i].type == type
+				&& it[i].from < to && it[i].from + it[i].size > from)
+			count++;
+	}
+	return count;
+}
+
+int main(int argc, char **argv) {
+	int i, j, n = argc > 1? atoi (argv[1]): 1000000;
+	int bits = 6, fail = 0, hits = 0;
+	RAnal *anal = r_anal_new ();
+	Item *it = calloc (n, sizeof (Item));
+	RAnalMetaItem *mi;
+	char str[32], *s;
+	ut64 t0, t1, t2, t3;
+
+	if (!it)
+		return 1;
+	while ((1ULL << bits) < (ut64)n * 64)
+		bits++;
+	srand (1337);
+	for (i = 0; i < n; i++) {
+		it[i].from = item_addr (i, bits);
+		it[i].size = 1 + rand () % 64;
+		it[i].type = (i % 3)? R_META_TYPE_COMMENT: R_META_TYPE_STRING;
+		it[i].alive = 1;
+	}
+	t0 = r_sys_now ();
+	for (i = 0; i < n; i++) {
+		snprintf (str, sizeof (str), "m.%d", i);
+		r_meta_add (anal, it[i].type, it[i].from,
+			it[i].from + it[i].size, str);
+	}
+	for (i = 0; i < n; i += 7) {
+		r_meta_del (anal, it[i].type, it[i].from, 1, NULL);
+		it[i].alive = 0;
+	}
+	t1 = r_sys_now ();
+	for (i = 0; i < n; i++) {
+		mi = r_meta_get_at (anal, it[i].from, it[i].type);
+		snprintf (str, sizeof (str), "m.%d", i);
+		if (it[i].alive? (!mi || mi->size != it[i].size || strcmp (mi->str, str)): !!mi)
+			fail++;
+	}
+	t2 = r_sys_now ();
+	t3 = 0;
+	for (i = 0; i < NQUERIES; i++) {
+		int count, type = (i & 1)? R_META_TYPE_COMMENT: R_META_TYPE_STRING;
+		ut64 addr = item_addr (rand () % n, bits) + (rand () % 64);
+		ut64 len = 1 + rand () % 4096, t;
+		t = r_sys_now ();
+		mi = r_meta_get_in (anal, addr, type);
+		count = r_meta_count (anal, type, addr, addr + len);
+		t3 += r_sys_now () - t;
+		j = scan_in (it, n, type, addr);
+		if ((j == -1)? !!mi: (!mi || mi->from != it[j].from))
+			fail++;
+		if (count != scan_count (it, n, type, addr, addr + len))
+			fail++;
+		hits += (j != -1);
+	}
+	if (fail)
+		printf ("[-] %d queries differ from the linear scan\n", fail);
+	/* save and load back */
+	r_meta_sync (anal);
+	r_meta_del (anal, R_META_TYPE_ANY, 0, UT64_MAX, NULL);
+	r_meta_sync (anal);
+	if (r_meta_get_at (anal, it[1].from, it[1].type))
+		fail++;
+	for (i = 0; i < n; i++) {
+		if (it[i].alive)
+			r_meta_add (anal, it[i].type, it[i].from, it[i].from + it[i].size, "x");
+	}
+	r_meta_sync (anal);
+	r_meta_free (anal);
+	j = r_meta_load (anal);
+	for (i = 0; i < n; i++) {
+		if (it[i].alive) j--;
+		s = r_meta_get_string (anal, it[i].type, it[i].from);
+		if (it[i].alive? (!s || strcmp (s, "x")): !!s)
+			fail++;
+		free (s);
+	}
+	if (j)
+		fail++;
+	printf ("%d items: add+del %.3f ms, %d point queries %.3f ms, "
+		"%d range queries (%d hits) %.3f ms\n", n,
+		(double)(t1 - t0) / 1000, n, (double)(t2 - t1) / 1000,
+		NQUERIES * 2, hits, (double)t3 / 1000);
+	printf ("%s\n", fail? "[-] failed": "[+] ok");
+	free (it);
+	r_anal_free (anal);
+	return fail? 1: 0;
+}
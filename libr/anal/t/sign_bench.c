@@ -0,0 +1,75 @@
+/* zignature scan benchmark: linear list walk vs indexed r_sign_check */
+
+#include <r_sign.h>
+
+#define NSIGS 5000
+#define BUFSZ (1024*1024)
+
+static RSignItem *linear_check(RSign *sig, const ut8 *buf, int len) {
+	RListIter *iter;
+	RSignItem *si;
+	r_list_foreach (sig->items, iter, si) {
+		if (si->type == R_SIGN_BYTE) {
+			int l = (len>si->size)?si->size:len;
+			if (!r_mem_cmp_mask (buf, si->bytes, si->mask, l))
+				return si;
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv) {
+	RAnal *anal = r_anal_new ();
+	RSign *sig = r_sign_new ();
+	ut8 *buf = malloc (BUFSZ);
+	int i, j, n, nsigs = argc>1? atoi (argv[1]): NSIGS;
+	int hits = 0, fail = 0, len = BUFSZ;
+	char hex[128], name[32];
+	ut64 t0, t1, t2;
+
+	srand (1337);
+	for (i=0; i<len; i++)
+		buf[i] = rand ();
+	for (i=0; i<nsigs; i++) {
+		int size = 16 + (rand () % 16);
+		int pos = rand () % (len - size);
+		/* every fourth signature is planted in the buffer */
+		if (!(i%4)) for (j=0; j<size; j++)
+			buf[pos+j] = rand ();
+		for (j=0; j<size; j++) {
+			if (j>4 && !(rand () % 6))
+				strcpy (hex+j*2, "..");
+			else snprintf (hex+j*2, 3, "%02x", (i%4)? rand ()&0xff: buf[pos+j]);
+		}
+		snprintf (name, sizeof (name), "s%d", i);
+		r_sign_add (sig, anal, R_SIGN_BYTE, name, hex);
+	}
+	/* the linear walk is way slower, compare a slice of the buffer */
+	n = R_MIN (len, 64*1024);
+	t0 = r_sys_now ();
+	for (i=0; i<n; i++)
+		linear_check (sig, buf+i, len-i);
+	t1 = r_sys_now ();
+	for (i=0; i<len; i++) {
+		if (r_sign_check (sig, buf+i, len-i))
+			hits++;
+	}
+	t2 = r_sys_now ();
+	for (i=0; i<n; i++) {
+		if (r_sign_check (sig, buf+i, len-i) != linear_check (sig, buf+i, len-i))
+			fail++;
+	}
+	/* the tail is scanned partially */
+	for (i=len-64; i<len; i++) {
+		if (r_sign_check (sig, buf+i, len-i) != linear_check (sig, buf+i, len-i))
+			fail++;
+	}
+	printf ("%d signatures, %d hits\n", nsigs, hits);
+	printf ("linear:  %.1f ns/offset (%d offsets)\n", (double)(t1-t0)*1000/n, n);
+	printf ("indexed: %.1f ns/offset (%d offsets)\n", (double)(t2-t1)*1000/len, len);
+	printf ("%s\n", fail? "[-] results differ": "[+] same results");
+	r_sign_free (sig);
+	r_anal_free (anal);
+	free (buf);
+	return fail? 1: 0;
+}
@@ -18,6 +18,7 @@
    along with this program; see the file COPYING3. If not,
    see <http://www.gnu.org/licenses/>.  */
 
+#include <r_types.h>
 #include "sysdep.h"
 #include "dis-asm.h"
 #include "libiberty.h"
@@ -39,9 +40,9 @@ enum map_type
   MAP_DATA
 };
 
-static enum map_type last_type;
-static int last_mapping_sym = -1;
-static bfd_vma last_mapping_addr = 0;
+static R_TH_LOCAL enum map_type last_type;
+static R_TH_LOCAL int last_mapping_sym = -1;
+static R_TH_LOCAL bfd_vma last_mapping_addr = 0;
 
 /* Other options */
 static int no_aliases = 0;	/* If set disassemble as most general inst.  */
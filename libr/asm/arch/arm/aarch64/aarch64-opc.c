@@ -1047,15 +1047,25 @@ aarch64_logical_immediate_p (uint64_t value, int is32, aarch64_insn *encoding)
 {
   simd_imm_encoding imm_enc;
   const simd_imm_encoding *imm_encoding;
-  static bfd_boolean initialized = FALSE;
+  /* 0: not built, 1: being built, 2: ready.  The disassemblers of
+     several threads may get here at once, only one builds the table.  */
+  static int initialized = 0;
+  int state = 0;
 
   DEBUG_TRACE ("enter with 0x%" PRIx64 "(%" PRIi64 "), is32: %d", value,
 	       value, is32);
 
-  if (initialized == FALSE)
+  if (__atomic_load_n (&initialized, __ATOMIC_ACQUIRE) != 2)
     {
-      build_immediate_table ();
-      initialized = TRUE;
+      if (__atomic_compare_exchange_n (&initialized, &state, 1, 0,
+				       __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+	{
+	  build_immediate_table ();
+	  __atomic_store_n (&initialized, 2, __ATOMIC_RELEASE);
+	}
+      else
+	while (__atomic_load_n (&initialized, __ATOMIC_ACQUIRE) != 2)
+	  ;
     }
 
   if (is32)
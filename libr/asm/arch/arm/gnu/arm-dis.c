@@ -22,6 +22,7 @@
    Foundation, Inc., 51 Franklin Street - Fifth Floor, Boston,
    MA 02110-1301, USA.  */
 
+#include <r_types.h>
 #include "sysdep.h"
 
 #include "dis-asm.h"
@@ -1759,20 +1760,20 @@ static const char *const iwmmxt_cregnames[] =
 };
 
 /* Default to GCC register name set.  */
-static unsigned int regname_selected = 1;
+static R_TH_LOCAL unsigned int regname_selected = 1;
 
 #define NUM_ARM_REGNAMES  NUM_ELEM (regnames)
 #define arm_regnames      regnames[regname_selected].reg_names
 
-static bfd_boolean force_thumb = FALSE;
+static R_TH_LOCAL bfd_boolean force_thumb = FALSE;
 
 /* Current IT instruction state.  This contains the same state as the IT
    bits in the CPSR.  */
-static unsigned int ifthen_state;
+static R_TH_LOCAL unsigned int ifthen_state;
 /* IT state for the next instruction.  */
-static unsigned int ifthen_next_state;
+static R_TH_LOCAL unsigned int ifthen_next_state;
 /* The address of the insn for which the IT state is valid.  */
-static bfd_vma ifthen_address;
+static R_TH_LOCAL bfd_vma ifthen_address;
 #define IFTHEN_COND ((ifthen_state >> 4) & 0xf)
 /* Indicates that the current Conditional state is unconditional or outside
    an IT block.  */
@@ -4829,7 +4830,7 @@ print_insn (bfd_vma pc, struct disassemble_info *info, bfd_boolean little)
   /* PR 10288: Control which instructions will be disassembled.  */
   if (info->private_data == NULL)
     {
-      static struct arm_private_data private;
+      static R_TH_LOCAL struct arm_private_data private;
 
       if ((info->flags & USER_SPECIFIED_MACHINE_TYPE) == 0)
 	/* If the user did not use the -m command line switch then default to
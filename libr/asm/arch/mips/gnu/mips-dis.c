@@ -21,6 +21,7 @@
    Foundation, Inc., 51 Franklin Street - Fifth Floor, Boston,
    MA 02110-1301, USA.  */
 
+#include <r_types.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -439,17 +440,17 @@ const struct mips_arch_choice mips_arch_choices[] =
 /* ISA and processor type to disassemble for, and register names to use.
    set_default_mips_dis_options and parse_mips_dis_options fill in these
    values.  */
-static int mips_processor;
-static int mips_isa;
-static const char * const *mips_gpr_names;
-static const char * const *mips_fpr_names;
-static const char * const *mips_cp0_names;
-static const struct mips_cp0sel_name *mips_cp0sel_names;
-static int mips_cp0sel_names_len;
-static const char * const *mips_hwr_names;
+static R_TH_LOCAL int mips_processor;
+static R_TH_LOCAL int mips_isa;
+static R_TH_LOCAL const char * const *mips_gpr_names;
+static R_TH_LOCAL const char * const *mips_fpr_names;
+static R_TH_LOCAL const char * const *mips_cp0_names;
+static R_TH_LOCAL const struct mips_cp0sel_name *mips_cp0sel_names;
+static R_TH_LOCAL int mips_cp0sel_names_len;
+static R_TH_LOCAL const char * const *mips_hwr_names;
 
 /* Other options */
-static int no_aliases;	/* If set disassemble as most general inst.  */
+static R_TH_LOCAL int no_aliases;	/* If set disassemble as most general inst.  */
 
 static const struct mips_abi_choice *
 choose_abi_by_name (const char *name, unsigned int namelen)
@@ -482,8 +483,8 @@ choose_arch_by_name (const char *name, unsigned int namelen)
 static const struct mips_arch_choice *
 choose_arch_by_number (unsigned long mach)
 {
-  static unsigned long hint_bfd_mach;
-  static const struct mips_arch_choice *hint_arch_choice;
+  static R_TH_LOCAL unsigned long hint_bfd_mach;
+  static R_TH_LOCAL const struct mips_arch_choice *hint_arch_choice;
   const struct mips_arch_choice *c;
   unsigned int i;
 
@@ -1232,8 +1233,8 @@ print_insn_mips (bfd_vma memaddr,
 		 struct disassemble_info *info)
 {
   const struct mips_opcode *op;
-  static bfd_boolean init = 0;
-  static const struct mips_opcode *mips_hash[OP_MASK_OP + 1];
+  static R_TH_LOCAL bfd_boolean init = 0;
+  static R_TH_LOCAL const struct mips_opcode *mips_hash[OP_MASK_OP + 1];
 
   /* Build a hash table to shorten the search time.  */
   if (! init)
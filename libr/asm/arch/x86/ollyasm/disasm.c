@@ -24,6 +24,7 @@
 //#include <dir.h>
 #include <math.h>
 #include <float.h>
+#include <r_types.h>
 //#pragma hdrstop
 
 static int lowercase = 1; // Force lowercase display XXX remove it
@@ -80,25 +81,25 @@ char * strlwr (char *a) {
 ////////////////////////////////////////////////////////////////////////////////
 //////////////////////////// DISASSEMBLER FUNCTIONS ////////////////////////////
 
-// Work variables of disassembler
-static ulong     datasize;             // Size of data (1,2,4 bytes)
-static ulong     addrsize;             // Size of address (2 or 4 bytes)
-static int       segprefix;            // Segment override prefix or SEG_UNDEF
-static int       hasrm;                // Command has ModR/M byte
-static int       hassib;               // Command has SIB byte
-static int       dispsize;             // Size of displacement (if any)
-static int       immsize;              // Size of immediate data (if any)
-static int       softerror;            // Noncritical disassembler error
-static int       ndump;                // Current length of command dump
-static int       nresult;              // Current length of disassembly
-static int       addcomment;           // Comment value of operand
+// Work variables of disassembler, per thread so that several can run at once
+static R_TH_LOCAL ulong     datasize;             // Size of data (1,2,4 bytes)
+static R_TH_LOCAL ulong     addrsize;             // Size of address (2 or 4 bytes)
+static R_TH_LOCAL int       segprefix;            // Segment override prefix or SEG_UNDEF
+static R_TH_LOCAL int       hasrm;                // Command has ModR/M byte
+static R_TH_LOCAL int       hassib;               // Command has SIB byte
+static R_TH_LOCAL int       dispsize;             // Size of displacement (if any)
+static R_TH_LOCAL int       immsize;              // Size of immediate data (if any)
+static R_TH_LOCAL int       softerror;            // Noncritical disassembler error
+static R_TH_LOCAL int       ndump;                // Current length of command dump
+static R_TH_LOCAL int       nresult;              // Current length of disassembly
+static R_TH_LOCAL int       addcomment;           // Comment value of operand
 
 // Copy of input parameters of function Disasm()
-static const unsigned char *cmd;                // Pointer to binary data
-static const unsigned char *pfixup;             // Pointer to possible fixups or NULL
-static ulong              size;                 // Remaining size of the command buffer
-static t_disasm           *da;                  // Pointer to disassembly results
-static int                mode;                 // Disassembly mode (DISASM_xxx)
+static R_TH_LOCAL const unsigned char *cmd;                // Pointer to binary data
+static R_TH_LOCAL const unsigned char *pfixup;             // Pointer to possible fixups or NULL
+static R_TH_LOCAL ulong              size;                 // Remaining size of the command buffer
+static R_TH_LOCAL t_disasm           *da;                  // Pointer to disassembly results
+static R_TH_LOCAL int                mode;                 // Disassembly mode (DISASM_xxx)
 
 // Disassemble name of 1, 2 or 4-byte general-purpose integer register and, if
 // requested and available, dump its contents. Parameter type changes decoding
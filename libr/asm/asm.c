@@ -139,6 +139,7 @@ R_API RAsm *r_asm_new() {
 	a->ofilter = NULL;
 	a->syntax = R_ASM_SYNTAX_INTEL;
 	a->syscall = NULL;
+	memset (&a->opcache, 0, sizeof (RAsmOpCache));
 	a->plugins = r_list_new ();
 	if (!a->plugins){
 		free (a);
@@ -197,6 +198,7 @@ R_API RAsm *r_asm_free(RAsm *a) {
 			a->plugins = NULL;
 		}
 		free (a->cpu);
+		r_asm_opcache_set (a, 0);
 		// TODO: any memory leak here?
 		sdb_free (a->pair);
 		a->pair = NULL;
@@ -316,11 +318,88 @@ R_API int r_asm_set_pc(RAsm *a, ut64 pc) {
 	return R_TRUE;
 }
 
-R_API int r_asm_disassemble(RAsm *a, RAsmOp *op, const ut8 *buf, int len) {
-	int oplen, ret = op->payload = 0;
+#define OPCACHE_WAYS 4
+
+/* anything the decoder output depends on besides pc and the bytes */
+static ut64 opcache_state(RAsm *a) {
+	ut64 h = (ut64)(size_t)a->cur;
+	h = h * 31 + a->bits;
+	h = h * 31 + a->big_endian;
+	h = h * 31 + a->syntax;
+	h = h * 31 + (a->cpu? r_str_hash (a->cpu): 0);
+	h = h * 31 + (a->features? r_str_hash (a->features): 0);
+	return h;
+}
+
+/* size entries are kept, 0 disables the cache */
+R_API int r_asm_opcache_set(RAsm *a, int size) {
+	int n = OPCACHE_WAYS;
+	r_asm_opcache_flush (a);
+	R_FREE (a->opcache.items);
+	a->opcache.size = 0;
+	if (size < 1)
+		return R_TRUE;
+	while (n < size)
+		n <<= 1;
+	a->opcache.items = calloc (n, sizeof (RAsmOpCacheItem));
+	if (!a->opcache.items)
+		return R_FALSE;
+	a->opcache.size = n;
+	return R_TRUE;
+}
+
+R_API void r_asm_opcache_flush(RAsm *a) {
+	int i;
+	for (i = 0; i < a->opcache.size; i++) {
+		R_FREE (a->opcache.items[i].str);
+		a->opcache.items[i].used = 0;
+	}
+}
+
+/* set associative lookup. on a miss returns NULL and the way to
+ * replace: a stale entry for the same pc or the least recently used */
+static RAsmOpCacheItem *opcache_get(RAsmOpCache *c, ut64 pc, ut64 state, const ut8 *buf, int len, RAsmOpCacheItem **victim) {
+	ut64 h = (pc ^ (pc >> 16)) * 0x9e3779b97f4a7c15ULL;
+	RAsmOpCacheItem *set = &c->items[(h >> 32) & (c->size - OPCACHE_WAYS)];
+	RAsmOpCacheItem *it, *lru = set;
+	int i;
+	for (i = 0; i < OPCACHE_WAYS; i++) {
+		it = &set[i];
+		if (it->str && it->pc == pc) {
+			if (it->state == state && it->size <= len &&
+					!memcmp (it->bytes, buf, it->size)) {
+				it->used = ++c->tick;
+				return it;
+			}
+			lru = it;
+			break;
+		}
+		if (it->used < lru->used)
+			lru = it;
+	}
+	*victim = lru;
+	return NULL;
+}
+
+/* fills size, payload and buf_asm of op, the raw and hex bytes are left to the callers */
+static int asm_decode(RAsm *a, RAsmOp *op, const ut8 *buf, int len) {
+	RAsmOpCacheItem *hit, *it = NULL;
+	ut64 state = 0;
+	int ret = op->payload = 0;
 	op->size = 4;
-	if (len<1)
-		return 0;
+	/* the output filter has its own state, do not cache through it */
+	if (a->opcache.size && !a->ofilter) {
+		state = opcache_state (a);
+		hit = opcache_get (&a->opcache, a->pc, state, buf, len, &it);
+		if (hit) {
+			a->opcache.hits++;
+			op->size = hit->size;
+			op->payload = hit->payload;
+			strcpy (op->buf_asm, hit->str);
+			return hit->ret;
+		}
+		a->opcache.misses++;
+	}
 	// on mips/arm/sparc .. use word size
 	sprintf (op->buf_asm,".byte 0x%02x %d", buf[0], len);
 	if (a->cur && a->cur->disassemble)
@@ -328,15 +407,36 @@ R_API int r_asm_disassemble(RAsm *a, RAsmOp *op, const ut8 *buf, int len) {
 	// avoid undefined behaviour
 	if (ret<0)
 		ret = 0;
-	oplen = r_asm_op_get_size (op);
-	oplen = op->size;
-	if (oplen>len) oplen = len;
-	if (oplen<1) oplen = 1;
 	if (ret > 0) {
 		if (a->ofilter)
 			r_parse_parse (a->ofilter, op->buf_asm, op->buf_asm);
+		if (it && op->size > 0 && op->size <= R_ASM_OPCACHE_MAXLEN && op->size <= len) {
+			free (it->str);
+			it->str = strdup (op->buf_asm);
+			it->pc = a->pc;
+			it->state = state;
+			it->size = op->size;
+			it->payload = op->payload;
+			it->ret = ret;
+			it->used = ++a->opcache.tick;
+			memcpy (it->bytes, buf, op->size);
+		}
 	//	r_hex_bin2str (buf, oplen, op->buf_hex);
 	} else ret = 0;
+	return ret;
+}
+
+R_API int r_asm_disassemble(RAsm *a, RAsmOp *op, const ut8 *buf, int len) {
+	int oplen, ret;
+	if (len<1) {
+		op->size = 4;
+		op->payload = 0;
+		return 0;
+	}
+	ret = asm_decode (a, op, buf, len);
+	oplen = op->size;
+	if (oplen>len) oplen = len;
+	if (oplen<1) oplen = 1;
 	r_mem_copyendian (op->buf, buf, oplen, !a->big_endian);
 	*op->buf_hex = 0;
 	if ((oplen*4)>=sizeof(op->buf_hex))
@@ -379,9 +479,10 @@ R_API int r_asm_assemble(RAsm *a, RAsmOp *op, const char *buf) {
 
 R_API RAsmCode* r_asm_mdisassemble(RAsm *a, const ut8 *buf, int len) {
 	RAsmCode *acode;
-	int ret, slen;
+	int ret, slen, size, n;
 	RAsmOp op;
 	ut64 idx;
+	char *s;
 
 	if (!(acode = r_asm_code_new ()))
 		return NULL;
@@ -391,12 +492,14 @@ R_API RAsmCode* r_asm_mdisassemble(RAsm *a, const ut8 *buf, int len) {
 	if (!(acode->buf_hex = malloc (2*len+1)))
 		return r_asm_code_free (acode);
 	r_hex_bin2str (buf, len, acode->buf_hex);
-	if (!(acode->buf_asm = malloc (4)))
+	/* grown geometrically, appending used to be quadratic */
+	size = len + 64;
+	if (!(acode->buf_asm = malloc (size)))
 		return r_asm_code_free (acode);
 
 	for (idx = ret = slen = 0, acode->buf_asm[0] = '\0'; idx < len; idx+=ret) {
 		r_asm_set_pc (a, a->pc + ret);
-		ret = r_asm_disassemble (a, &op, buf+idx, len-idx);
+		ret = asm_decode (a, &op, buf+idx, len-idx);
 		if (ret<1) {
 // TODO: this warning is sometimes useful
 //			eprintf ("disassemble error at offset %"PFMT64d"\n", idx);
@@ -407,16 +510,244 @@ R_API RAsmCode* r_asm_mdisassemble(RAsm *a, const ut8 *buf, int len) {
 		}
 		if (a->ofilter)
 			r_parse_parse (a->ofilter, op.buf_asm, op.buf_asm);
-		slen += strlen (op.buf_asm) + 2;
-		if (!(acode->buf_asm = realloc (acode->buf_asm, slen)))
-			return r_asm_code_free (acode);
-		strcat (acode->buf_asm, op.buf_asm);
-		strcat (acode->buf_asm, "\n");
+		n = strlen (op.buf_asm);
+		if (slen + n + 2 > size) {
+			size = (slen + n + 2) * 2;
+			if (!(s = realloc (acode->buf_asm, size)))
+				return r_asm_code_free (acode);
+			acode->buf_asm = s;
+		}
+		memcpy (acode->buf_asm + slen, op.buf_asm, n);
+		slen += n;
+		acode->buf_asm[slen++] = '\n';
+		acode->buf_asm[slen] = '\0';
 	}
 	acode->len = idx;
 	return acode;
 }
 
+/* no instruction is started at or after the end offset of buf */
+static int asm_batch(RAsm *a, RAsmBatch *b, const ut8 *buf, int len, int end) {
+	RAsmOpRec *rec;
+	ut64 pc = a->pc;
+	int idx = 0, ret, n;
+	RAsmOp op;
+
+	while (idx < end && b->nops < b->maxops) {
+		if (b->minlen > 0 && len - idx < b->minlen)
+			break;
+		a->pc = pc + idx;
+		ret = asm_decode (a, &op, buf+idx, len-idx);
+		n = strlen (op.buf_asm) + 1;
+		if (b->textlen + n > b->textsize)
+			break;
+		rec = &b->ops[b->nops++];
+		rec->addr = a->pc;
+		rec->size = (ret<1)? 1: ret;
+		rec->type = (ret<1)? R_ASM_OPREC_INVALID: R_ASM_OPREC_VALID;
+		rec->text = b->textlen;
+		memcpy (b->text + b->textlen, op.buf_asm, n);
+		b->textlen += n;
+		idx += rec->size;
+	}
+	a->pc = pc + idx;
+	return idx;
+}
+
+/* decode buf into the records and text arena of b, appending to what
+ * they hold. stops when b is full or less than b->minlen bytes are left,
+ * returns the bytes consumed and leaves a->pc right after them */
+R_API int r_asm_disassemble_batch(RAsm *a, RAsmBatch *b, const ut8 *buf, int len) {
+	return asm_batch (a, b, buf, len, len);
+}
+
+#define SWEEP_THREADS 16
+#define SWEEP_MINCHUNK (64*1024)
+
+typedef struct {
+	RAsm a;		// private copy, the decoders keep per RAsm state
+	const ut8 *buf;
+	int len;
+	int from, to;
+	RAsmBatch b;
+	int fail;
+} SweepChunk;
+
+static int sweep_threads(int n) {
+	if (n < 1)
+		n = r_sys_cpus ();
+	return R_MIN (n, SWEEP_THREADS);
+}
+
+/* room for at least one more record and its text */
+static int sweep_grow(RAsmBatch *b) {
+	void *p;
+	if (b->nops >= b->maxops) {
+		int n = b->maxops? b->maxops * 2: 4096;
+		if (!(p = realloc (b->ops, n * sizeof (RAsmOpRec))))
+			return R_FALSE;
+		b->ops = p;
+		b->maxops = n;
+	}
+	if (b->textsize - b->textlen <= R_ASM_BUFSIZE) {
+		int n = b->textsize? b->textsize * 2: 4096 * 32;
+		if (!(p = realloc (b->text, n)))
+			return R_FALSE;
+		b->text = p;
+		b->textsize = n;
+	}
+	return R_TRUE;
+}
+
+/* decode the instructions starting in [from, end) of buf at pc, growing b */
+static int sweep_decode(RAsm *a, RAsmBatch *b, const ut8 *buf, int len, ut64 pc, int from, int end) {
+	int idx = from, n;
+	while (idx < end) {
+		if (!sweep_grow (b))
+			return -1;
+		a->pc = pc + idx;
+		n = asm_batch (a, b, buf + idx, len - idx, end - idx);
+		if (!n)
+			break;	// less than minlen bytes left
+		idx += n;
+	}
+	return idx;
+}
+
+static void sweep_chunk(SweepChunk *c) {
+	if (sweep_decode (&c->a, &c->b, c->buf, c->len, c->a.pc, c->from, c->to) < 0)
+		c->fail = 1;
+}
+
+static int sweep_thread(RThread *th) {
+	sweep_chunk (th->user);
+	return R_FALSE;
+}
+
+/* index of the record of c starting at off, or -1 */
+static int sweep_find(SweepChunk *c, ut64 pc, int off) {
+	int lo = 0, hi = c->b.nops - 1, mid;
+	ut64 addr = pc + off;
+	while (lo <= hi) {
+		mid = lo + (hi - lo) / 2;
+		if (c->b.ops[mid].addr == addr)
+			return mid;
+		if (c->b.ops[mid].addr < addr)
+			lo = mid + 1;
+		else hi = mid - 1;
+	}
+	return -1;
+}
+
+/* append the records of c from the k-th on */
+static int sweep_append(RAsmBatch *b, SweepChunk *c, int k) {
+	int i, n = c->b.nops - k, tlen, delta;
+	void *p;
+	if (n < 1)
+		return R_TRUE;
+	tlen = c->b.textlen - c->b.ops[k].text;
+	if (b->nops + n > b->maxops) {
+		if (!(p = realloc (b->ops, (b->nops + n) * sizeof (RAsmOpRec))))
+			return R_FALSE;
+		b->ops = p;
+		b->maxops = b->nops + n;
+	}
+	if (b->textlen + tlen > b->textsize) {
+		if (!(p = realloc (b->text, b->textlen + tlen)))
+			return R_FALSE;
+		b->text = p;
+		b->textsize = b->textlen + tlen;
+	}
+	delta = b->textlen - c->b.ops[k].text;
+	memcpy (b->ops + b->nops, c->b.ops + k, n * sizeof (RAsmOpRec));
+	for (i = 0; i < n; i++)
+		b->ops[b->nops + i].text += delta;
+	memcpy (b->text + b->textlen, c->b.text + c->b.ops[k].text, tlen);
+	b->nops += n;
+	b->textlen += tlen;
+	return R_TRUE;
+}
+
+/* linear sweep of buf split in chunks decoded by nthreads workers (0 for
+ * one per cpu), each with its own copy of a. the records are appended to
+ * b in address order exactly as r_asm_disassemble_batch would produce
+ * them, b->ops and b->text are reallocated as needed.
+ * a chunk is spliced where the stream of the previous one lands on one of
+ * its instructions; variable length code that does not, like x86 past a
+ * chunk boundary, is decoded again here until both streams meet. plugins
+ * with global decoder state and output filters run on a single thread, and
+ * so does thumb, whose IT blocks carry state from one instruction to the
+ * next and may straddle a chunk boundary */
+R_API int r_asm_sweep(RAsm *a, RAsmBatch *b, const ut8 *buf, int len, int nthreads) {
+	RThread *th[SWEEP_THREADS];
+	SweepChunk *chunks;
+	ut64 pc = a->pc;
+	int i, k, off, n, step, ok = R_TRUE;
+
+	nthreads = sweep_threads (nthreads);
+	if (nthreads > len / SWEEP_MINCHUNK)
+		nthreads = len / SWEEP_MINCHUNK;
+	if (nthreads < 2 || !a->cur || !a->cur->reentrant || a->ofilter
+			|| (a->bits == 16 && a->cur->arch && !strcmp (a->cur->arch, "arm"))) {
+		off = sweep_decode (a, b, buf, len, pc, 0, len);
+		a->pc = pc + R_MAX (off, 0);
+		return off;
+	}
+	if (!(chunks = calloc (nthreads, sizeof (SweepChunk))))
+		return -1;
+	/* aligned boundaries keep fixed width instructions in sync */
+	step = (len / nthreads) & ~15;
+	for (i = 0; i < nthreads; i++) {
+		SweepChunk *c = &chunks[i];
+		memcpy (&c->a, a, sizeof (RAsm));
+		memset (&c->a.opcache, 0, sizeof (RAsmOpCache));
+		c->a.plugins = NULL;
+		c->buf = buf;
+		c->len = len;
+		c->from = i * step;
+		c->to = (i == nthreads - 1)? len: (i + 1) * step;
+		c->b.minlen = b->minlen;
+	}
+	for (i = 1; i < nthreads; i++)
+		th[i] = r_th_new (sweep_thread, &chunks[i], 0);
+	sweep_chunk (&chunks[0]);
+	for (i = 1; i < nthreads; i++) {
+		if (th[i])
+			r_th_free (th[i]);
+		else sweep_chunk (&chunks[i]);
+	}
+	/* chunk 0 starts the stream, the next ones are joined in order */
+	for (off = i = 0; ok && i < nthreads; i++) {
+		SweepChunk *c = &chunks[i];
+		if (c->fail) {
+			ok = R_FALSE;
+			break;
+		}
+		while ((k = sweep_find (c, pc, off)) < 0 && off < c->to) {
+			n = sweep_decode (a, b, buf, len, pc, off, off + 1);
+			if (n <= off) {
+				ok = n == off;
+				break;
+			}
+			off = n;
+		}
+		if (k >= 0 && c->b.nops > 0) {
+			RAsmOpRec *last = &c->b.ops[c->b.nops - 1];
+			ok = sweep_append (b, c, k);
+			off = (int)(last->addr - pc) + last->size;
+		}
+		if (off < c->to && k < 0)
+			break;	// stopped short of minlen
+	}
+	for (i = 0; i < nthreads; i++) {
+		free (chunks[i].b.ops);
+		free (chunks[i].b.text);
+	}
+	free (chunks);
+	a->pc = pc + off;
+	return ok? off: -1;
+}
+
 R_API RAsmCode* r_asm_mdisassemble_hexstr(RAsm *a, const char *hexstr) {
 	RAsmCode *ret;
 	ut8 *buf;
@@ -65,10 +65,10 @@ static const struct arm_arch_option_table arm_archs[] = {
 };
 #endif
 
-static int arm_mode = 0;
-static unsigned long Offset = 0;
-static char *buf_global = NULL;
-static unsigned char bytes[8];
+static R_TH_LOCAL int arm_mode = 0;
+static R_TH_LOCAL unsigned long Offset = 0;
+static R_TH_LOCAL char *buf_global = NULL;
+static R_TH_LOCAL unsigned char bytes[8];
 
 static int arm_buffer_read_memory (bfd_vma memaddr, bfd_byte *myaddr,
 		unsigned int length, struct disassemble_info *info) {
@@ -114,8 +114,8 @@ static int buf_fprintf(void *stream, const char *format, ...) {
 }
 
 static int disassemble(RAsm *a, RAsmOp *op, const ut8 *buf, int len) {
-	static char *oldcpu = NULL;
-	static int oldcpucode = 0;
+	static R_TH_LOCAL char *oldcpu = NULL;
+	static R_TH_LOCAL int oldcpucode = 0;
 	int opsize, cpucode = 0;
 	struct disassemble_info obj;
 	char *options = (a->bits==16)? "force-thumb": "no-force-thumb";
@@ -184,7 +184,8 @@ RAsmPlugin r_asm_plugin_arm_gnu = {
 	.fini = NULL,
 	.disassemble = &disassemble,
 	.assemble = NULL,
-	.license = "GPL3"
+	.license = "GPL3",
+	.reentrant = R_TRUE
 };
 
 #ifndef CORELIB
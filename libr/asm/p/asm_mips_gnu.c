@@ -13,10 +13,10 @@
 #include "opcode/mips.h"
 int mips_assemble(const char *str, ut64 pc, ut8 *out);
 
-static int mips_mode = 0;
-static unsigned long Offset = 0;
-static char *buf_global = NULL;
-static unsigned char bytes[4];
+static R_TH_LOCAL int mips_mode = 0;
+static R_TH_LOCAL unsigned long Offset = 0;
+static R_TH_LOCAL char *buf_global = NULL;
+static R_TH_LOCAL unsigned char bytes[4];
 
 static int mips_buffer_read_memory (bfd_vma memaddr, bfd_byte *myaddr, unsigned int length, struct disassemble_info *info) {
 	memcpy (myaddr, bytes, length);
@@ -58,7 +58,7 @@ static int buf_fprintf(void *stream, const char *format, ...) {
 }
 
 static int disassemble(struct r_asm_t *a, struct r_asm_op_t *op, const ut8 *buf, int len) {
-	static struct disassemble_info disasm_obj;
+	static R_TH_LOCAL struct disassemble_info disasm_obj;
 	if (len<4) return -1;
 	buf_global = op->buf_asm;
 	Offset = a->pc;
@@ -104,6 +104,7 @@ RAsmPlugin r_asm_plugin_mips_gnu = {
 	.fini = NULL,
 	.disassemble = &disassemble,
 	.assemble = &assemble,
+	.reentrant = R_TRUE
 };
 
 #ifndef CORELIB
@@ -12,9 +12,9 @@
 #include "dis-asm.h"
 
 
-static unsigned long Offset = 0;
-static char *buf_global = NULL;
-static unsigned char bytes[4];
+static R_TH_LOCAL unsigned long Offset = 0;
+static R_TH_LOCAL char *buf_global = NULL;
+static R_TH_LOCAL unsigned char bytes[4];
 
 static int ppc_buffer_read_memory (bfd_vma memaddr, bfd_byte *myaddr, ut32 length, struct disassemble_info *info) {
 	memcpy (myaddr, bytes, length);
@@ -97,7 +97,8 @@ RAsmPlugin r_asm_plugin_ppc_gnu = {
 	.init = NULL,
 	.fini = NULL,
 	.disassemble = &disassemble,
-	.assemble = NULL
+	.assemble = NULL,
+	.reentrant = R_TRUE
 };
 
 #ifndef CORELIB
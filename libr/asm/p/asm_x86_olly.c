@@ -51,6 +51,7 @@ RAsmPlugin r_asm_plugin_x86_olly = {
 	.fini = NULL,
 	.disassemble = &disassemble,
 	.assemble = &assemble,
+	.reentrant = R_TRUE
 };
 
 #ifndef CORELIB
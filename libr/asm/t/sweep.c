@@ -0,0 +1,75 @@
+/* r_asm_sweep against a single threaded sweep of the same bytes */
+
+#include <r_asm.h>
+#include <r_util.h>
+
+static double run(RAsm *a, RAsmBatch *b, const ut8 *buf, int len, int threads, int *ret) {
+	ut64 t0, t1;
+	b->nops = b->textlen = 0;
+	r_asm_set_pc (a, 0x400000);
+	t0 = r_sys_now ();
+	*ret = r_asm_sweep (a, b, buf, len, threads);
+	t1 = r_sys_now ();
+	return (double)len / (t1 - t0 + 1);
+}
+
+static int same(RAsmBatch *x, RAsmBatch *y) {
+	int i;
+	if (x->nops != y->nops || x->textlen != y->textlen)
+		return R_FALSE;
+	for (i = 0; i < x->nops; i++) {
+		RAsmOpRec *p = &x->ops[i], *q = &y->ops[i];
+		if (p->addr != q->addr || p->size != q->size || p->type != q->type
+				|| strcmp (x->text + p->text, y->text + q->text))
+			return R_FALSE;
+	}
+	return R_TRUE;
+}
+
+int main(int argc, char **argv) {
+	const char *arch = argc > 2? argv[2]: "arm.gnu";
+	int bits = argc > 3? atoi (argv[3]): 64;
+	int threads = argc > 4? atoi (argv[4]): 0;
+	RAsmBatch b0 = {0}, b1 = {0};
+	int i, len, r0, r1, fail = 0;
+	double mb0, mb1;
+	RAsm *a = r_asm_new ();
+	ut8 *buf;
+
+	if (argc < 2) {
+		eprintf ("Usage: sweep [file] [arch] [bits] [threads]\n");
+		return 1;
+	}
+	if (!(buf = (ut8*)r_file_slurp (argv[1], &len)) || !r_asm_use (a, arch)) {
+		eprintf ("Cannot load %s or use %s\n", argv[1], arch);
+		return 1;
+	}
+	r_asm_set_bits (a, bits);
+	mb0 = run (a, &b0, buf, len, 1, &r0);
+	mb1 = run (a, &b1, buf, len, threads, &r1);
+	if (r0 != r1 || !same (&b0, &b1)) {
+		printf ("[-] %s: threaded sweep differs\n", arch);
+		fail++;
+	}
+	/* odd sizes move the chunk boundaries into the middle of instructions */
+	for (i = 1; !fail && i < 8; i++) {
+		int n = len - i * 997;
+		b1.minlen = b0.minlen = i;
+		run (a, &b0, buf + i, n, 1, &r0);
+		run (a, &b1, buf + i, n, threads, &r1);
+		if (r0 != r1 || !same (&b0, &b1)) {
+			printf ("[-] %s: threaded sweep differs at +%d\n", arch, i);
+			fail++;
+		}
+	}
+	printf ("%s %d bits: %d bytes, %d ops, %.1f MB/s single, %.1f MB/s threaded\n",
+		arch, bits, len, b0.nops, mb0, mb1);
+	printf ("%s\n", fail? "[-] failed": "[+] ok");
+	free (b0.ops);
+	free (b0.text);
+	free (b1.ops);
+	free (b1.text);
+	free (buf);
+	r_asm_free (a);
+	return fail? 1: 0;
+}
@@ -0,0 +1,571 @@
+/* radare - LGPL - Copyright 2015 - pancake */
+
+#include <r_core.h>
+
+/* Binary analysis cache
+ *
+ * Functions (with their basic blocks and refs), flags, metadata, hints
+ * and xrefs are dumped into a versioned file named after the sha1 of the
+ * analyzed file, so reopening the same binary restores the analysis in
+ * bulk instead of running "aa" again or replaying r2 commands.
+ *
+ *   "R2AC" version:u32 sha1:str
+ *   [ tag:u32 length:u64 payload ]*
+ *
+ * Integers are stored little endian whatever the host is, and strings as
+ * u32 length + bytes (0xffffffff for NULL). Unknown sections are skipped.
+ */
+
+#define ACACHE_MAGIC "R2AC"
+#define ACACHE_VERSION 1
+#define ACACHE_TAG(a,b,c,d) ((a)|((b)<<8)|((c)<<16)|((d)<<24))
+#define ACACHE_FCNS ACACHE_TAG('f','c','n','s')
+#define ACACHE_FLAG ACACHE_TAG('f','l','a','g')
+#define ACACHE_MSPC ACACHE_TAG('m','s','p','c')
+#define ACACHE_SDB  ACACHE_TAG('s','d','b',' ')
+#define ACACHE_NULLSTR UT32_MAX
+
+/* anal namespaces stored as plain key/value pairs */
+static const char *acache_sdbs[] = { "fcns", "meta", "hints", "xrefs", NULL };
+
+typedef struct {
+	const ut8 *buf;
+	ut64 len;
+	ut64 off;
+	int error;
+} ACacheReader;
+
+static void w_u32(FILE *fp, ut32 n) {
+	ut8 b[4];
+	int i;
+	for (i = 0; i < 4; i++)
+		b[i] = (n >> (i * 8)) & 0xff;
+	fwrite (b, sizeof (b), 1, fp);
+}
+
+static void w_u64(FILE *fp, ut64 n) {
+	w_u32 (fp, (ut32)n);
+	w_u32 (fp, (ut32)(n >> 32));
+}
+
+static void w_str(FILE *fp, const char *s) {
+	if (s) {
+		ut32 len = strlen (s);
+		w_u32 (fp, len);
+		fwrite (s, 1, len, fp);
+	} else w_u32 (fp, ACACHE_NULLSTR);
+}
+
+static const ut8 *r_get(ACacheReader *r, ut64 n) {
+	const ut8 *p;
+	if (r->error || n > r->len - r->off) {
+		r->error = 1;
+		return NULL;
+	}
+	p = r->buf + r->off;
+	r->off += n;
+	return p;
+}
+
+static ut32 r_u32(ACacheReader *r) {
+	const ut8 *p = r_get (r, 4);
+	if (!p) return 0;
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((ut32)p[3] << 24);
+}
+
+static ut64 r_u64(ACacheReader *r) {
+	ut64 lo = r_u32 (r);
+	return lo | ((ut64)r_u32 (r) << 32);
+}
+
+/* returns a new string or NULL */
+static char *r_str(ACacheReader *r) {
+	const ut8 *p;
+	char *s;
+	ut32 len = r_u32 (r);
+	if (len == ACACHE_NULLSTR || r->error)
+		return NULL;
+	if (!(p = r_get (r, len)) || !(s = malloc (len + 1)))
+		return NULL;
+	memcpy (s, p, len);
+	s[len] = 0;
+	return s;
+}
+
+/* writes the section header and returns the offset of the length */
+static long w_section(FILE *fp, ut32 tag) {
+	long at;
+	w_u32 (fp, tag);
+	at = ftell (fp);
+	w_u64 (fp, 0);
+	return at;
+}
+
+static void w_section_end(FILE *fp, long at) {
+	long end = ftell (fp);
+	fseek (fp, at, SEEK_SET);
+	w_u64 (fp, (ut64)(end - at - sizeof (ut64)));
+	fseek (fp, end, SEEK_SET);
+}
+
+static void w_refs(FILE *fp, RList *refs) {
+	RListIter *iter;
+	RAnalRef *ref;
+	w_u32 (fp, r_list_length (refs));
+	r_list_foreach (refs, iter, ref) {
+		w_u32 (fp, ref->type);
+		w_u64 (fp, ref->addr);
+		w_u64 (fp, ref->at);
+	}
+}
+
+static void r_refs(ACacheReader *r, RList *refs) {
+	ut32 i, n = r_u32 (r);
+	for (i = 0; i < n && !r->error; i++) {
+		RAnalRef *ref = r_anal_ref_new ();
+		if (!ref) {
+			r->error = 1;
+			break;
+		}
+		ref->type = r_u32 (r);
+		ref->addr = r_u64 (r);
+		ref->at = r_u64 (r);
+		r_list_append (refs, ref);
+	}
+}
+
+static void w_fcns(FILE *fp, RAnal *anal) {
+	RListIter *iter, *iter2;
+	RAnalFunction *fcn;
+	RAnalBlock *bb;
+	long at = w_section (fp, ACACHE_FCNS);
+	w_u32 (fp, r_list_length (anal->fcns));
+	r_list_foreach (anal->fcns, iter, fcn) {
+		w_u64 (fp, fcn->addr);
+		w_u32 (fp, fcn->size);
+		w_str (fp, fcn->name);
+		w_u32 (fp, fcn->type);
+		w_u32 (fp, fcn->bits);
+		w_u32 (fp, fcn->call);
+		w_u32 (fp, fcn->stack);
+		w_u32 (fp, fcn->ninstr);
+		w_u32 (fp, fcn->nargs);
+		w_u32 (fp, fcn->depth);
+		w_u32 (fp, fcn->diff->type);
+		w_u64 (fp, fcn->diff->addr);
+		w_str (fp, fcn->diff->name);
+		w_refs (fp, fcn->refs);
+		w_refs (fp, fcn->xrefs);
+		w_u32 (fp, r_list_length (fcn->bbs));
+		r_list_foreach (fcn->bbs, iter2, bb) {
+			w_u64 (fp, bb->addr);
+			w_u32 (fp, bb->size);
+			w_u64 (fp, bb->jump);
+			w_u64 (fp, bb->fail);
+			w_u32 (fp, bb->type);
+			w_u32 (fp, bb->ninstr);
+			w_u32 (fp, bb->conditional);
+			w_u32 (fp, bb->returnbb);
+			w_u32 (fp, bb->diff? bb->diff->type: R_ANAL_DIFF_TYPE_NULL);
+			w_u64 (fp, bb->diff? bb->diff->addr: UT64_MAX);
+		}
+	}
+	w_section_end (fp, at);
+}
+
+static int r_fcns(ACacheReader *r, RAnal *anal) {
+	/* the usual duplicate check is a linear lookup per function,
+	 * skip it when there is nothing to collide with */
+	int fresh = r_list_empty (anal->fcns);
+	ut32 i, j, n = r_u32 (r);
+	for (i = 0; i < n && !r->error; i++) {
+		RAnalFunction *fcn = r_anal_fcn_new ();
+		ut32 nbbs;
+		if (!fcn) return R_FALSE;
+		fcn->addr = r_u64 (r);
+		fcn->size = r_u32 (r);
+		fcn->name = r_str (r);
+		fcn->type = r_u32 (r);
+		fcn->bits = r_u32 (r);
+		fcn->call = r_u32 (r);
+		fcn->stack = r_u32 (r);
+		fcn->ninstr = r_u32 (r);
+		fcn->nargs = r_u32 (r);
+		fcn->depth = r_u32 (r);
+		fcn->diff->type = r_u32 (r);
+		fcn->diff->addr = r_u64 (r);
+		fcn->diff->name = r_str (r);
+		r_refs (r, fcn->refs);
+		r_refs (r, fcn->xrefs);
+		nbbs = r_u32 (r);
+		for (j = 0; j < nbbs && !r->error; j++) {
+			RAnalBlock *bb = r_anal_bb_new ();
+			if (!bb) {
+				r->error = 1;
+				break;
+			}
+			bb->addr = r_u64 (r);
+			bb->size = r_u32 (r);
+			bb->jump = r_u64 (r);
+			bb->fail = r_u64 (r);
+			bb->type = r_u32 (r);
+			bb->ninstr = r_u32 (r);
+			bb->conditional = r_u32 (r);
+			bb->returnbb = r_u32 (r);
+			bb->diff->type = r_u32 (r);
+			bb->diff->addr = r_u64 (r);
+			r_list_append (fcn->bbs, bb);
+		}
+		if (r->error || !fcn->name) {
+			r_anal_fcn_free (fcn);
+			return R_FALSE;
+		}
+		if (!fresh) {
+			if (!r_anal_fcn_insert (anal, fcn))
+				r_anal_fcn_free (fcn);
+			continue;
+		}
+		r_list_append (anal->fcns, fcn);
+		if (anal->cb.on_fcn_new)
+			anal->cb.on_fcn_new (anal, anal->user, fcn);
+	}
+	return !r->error;
+}
+
+static void w_flags(FILE *fp, RFlag *f) {
+	RListIter *iter;
+	RFlagItem *fi;
+	int i, n = 0;
+	long at = w_section (fp, ACACHE_FLAG);
+	for (i = 0; i < R_FLAG_SPACES_MAX; i++)
+		if (f->spaces[i]) n++;
+	w_u32 (fp, n);
+	for (i = 0; i < R_FLAG_SPACES_MAX; i++) {
+		if (!f->spaces[i]) continue;
+		w_u32 (fp, i);
+		w_str (fp, f->spaces[i]);
+	}
+	w_u32 (fp, r_list_length (f->flags));
+	r_list_foreach (f->flags, iter, fi) {
+		w_str (fp, fi->name);
+		w_str (fp, fi->realname);
+		w_u64 (fp, fi->offset);
+		w_u64 (fp, fi->size);
+		w_u32 (fp, fi->space);
+		w_str (fp, fi->comment);
+		w_str (fp, fi->alias);
+		w_str (fp, fi->color);
+	}
+	w_section_end (fp, at);
+}
+
+static int r_flags(ACacheReader *r, RFlag *f) {
+	int space_map[R_FLAG_SPACES_MAX];
+	int old_space = f->space_idx;
+	st64 old_base = f->base;
+	ut32 i, n;
+
+	for (i = 0; i < R_FLAG_SPACES_MAX; i++)
+		space_map[i] = -1;
+	n = r_u32 (r);
+	for (i = 0; i < n && !r->error; i++) {
+		ut32 idx = r_u32 (r);
+		char *name = r_str (r);
+		if (name && idx < R_FLAG_SPACES_MAX)
+			space_map[idx] = r_flag_space_set (f, name);
+		free (name);
+	}
+	/* offsets are stored with the base already applied */
+	f->base = 0;
+	n = r_u32 (r);
+	for (i = 0; i < n && !r->error; i++) {
+		char *name = r_str (r);
+		char *realname = r_str (r);
+		ut64 off = r_u64 (r);
+		ut64 size = r_u64 (r);
+		ut32 space = r_u32 (r);
+		char *comment = r_str (r);
+		char *alias = r_str (r);
+		char *color = r_str (r);
+		RFlagItem *fi = (name && !r->error)?
+			r_flag_set (f, name, off, (ut32)size, 0): NULL;
+		if (fi) {
+			fi->size = size;
+			fi->space = (space < R_FLAG_SPACES_MAX)? space_map[space]: -1;
+			if (realname && strcmp (realname, name))
+				r_flag_item_set_name (fi, name, realname);
+			r_flag_item_set_comment (fi, comment);
+			r_flag_item_set_alias (fi, alias);
+			if (color) r_flag_color (f, fi, color);
+		}
+		free (name);
+		free (realname);
+		free (comment);
+		free (alias);
+		free (color);
+	}
+	f->base = old_base;
+	f->space_idx = old_space;
+	return !r->error;
+}
+
+/* meta items refer to their space by index, keep the same indexes */
+static void w_meta_spaces(FILE *fp, RSpaces *s) {
+	int i, n = 0;
+	long at = w_section (fp, ACACHE_MSPC);
+	for (i = 0; i < R_SPACES_MAX; i++)
+		if (s->spaces[i]) n++;
+	w_u32 (fp, n);
+	for (i = 0; i < R_SPACES_MAX; i++) {
+		if (!s->spaces[i]) continue;
+		w_u32 (fp, i);
+		w_str (fp, s->spaces[i]);
+	}
+	w_section_end (fp, at);
+}
+
+static int r_meta_spaces(ACacheReader *r, RSpaces *s) {
+	ut32 i, n = r_u32 (r);
+	for (i = 0; i < n && !r->error; i++) {
+		ut32 idx = r_u32 (r);
+		char *name = r_str (r);
+		if (name && idx < R_SPACES_MAX) {
+			free (s->spaces[idx]);
+			s->spaces[idx] = name;
+		} else free (name);
+	}
+	return !r->error;
+}
+
+static int w_sdb_cb(void *user, const char *k, const char *v) {
+	FILE *fp = user;
+	w_str (fp, k);
+	w_str (fp, v);
+	return 1;
+}
+
+static void w_sdb(FILE *fp, const char *name, Sdb *db) {
+	long at = w_section (fp, ACACHE_SDB);
+	w_str (fp, name);
+	sdb_foreach (db, w_sdb_cb, fp);
+	/* sdb keys are never empty */
+	w_str (fp, "");
+	w_section_end (fp, at);
+}
+
+static int r_sdb(ACacheReader *r, RAnal *anal) {
+	char *name = r_str (r);
+	Sdb *db = name? sdb_ns (anal->sdb, name, 0): NULL;
+	free (name);
+	if (!db) return R_FALSE;
+	for (;;) {
+		char *k = r_str (r);
+		char *v;
+		if (!k || !*k) {
+			free (k);
+			break;
+		}
+		v = r_str (r);
+		if (v) sdb_set (db, k, v, 0);
+		free (k);
+		free (v);
+	}
+	return !r->error;
+}
+
+#define ACACHE_HASH_CHUNK (1024 * 1024)
+
+/* sha1 of the whole file read through io in chunks. unlike r_core_hash_load
+ * it does not stop at cfg.hashlimit, big binaries are the ones worth caching */
+static int acache_hash_file(RCore *core, RCoreFile *cf, char *out) {
+	RIODesc *old = core->io->desc;
+	ut64 oldoff = core->io->off;
+	ut64 off, size;
+	RHash *ctx;
+	ut8 *buf;
+	int i, len, ret = R_FALSE;
+	if (!cf || !cf->desc)
+		return R_FALSE;
+	buf = malloc (ACACHE_HASH_CHUNK);
+	ctx = r_hash_new (R_FALSE, R_HASH_SHA1);
+	if (!buf || !ctx)
+		goto beach;
+	if (old != cf->desc)
+		r_io_use_desc (core->io, cf->desc);
+	size = r_io_size (core->io);
+	if (size == 0 || size == UT64_MAX)
+		goto restore;
+	for (off = 0; off < size; off += len) {
+		len = R_MIN (size - off, ACACHE_HASH_CHUNK);
+		if (r_io_pread (core->io, off, buf, len) != len)
+			goto restore;
+		r_hash_do_sha1 (ctx, buf, len);
+	}
+	r_hash_do_end (ctx, R_HASH_SHA1);
+	for (i = 0; i < R_HASH_SIZE_SHA1; i++)
+		sprintf (out + (i * 2), "%02x", ctx->digest[i]);
+	ret = R_TRUE;
+restore:
+	if (old && old != cf->desc)
+		r_io_use_desc (core->io, old);
+	r_io_seek (core->io, oldoff, R_IO_SEEK_SET);
+beach:
+	r_hash_free (ctx);
+	free (buf);
+	return ret;
+}
+
+static const char *acache_sha1(RCore *core) {
+	const char *sha1 = r_config_get (core->config, "file.sha1");
+	if (!sha1 || !*sha1) {
+		char hash[R_HASH_SIZE_SHA1 * 2 + 1];
+		if (!acache_hash_file (core, r_core_file_cur (core), hash))
+			return NULL;
+		r_config_set (core->config, "file.sha1", hash);
+		sha1 = r_config_get (core->config, "file.sha1");
+	}
+	return (sha1 && *sha1)? sha1: NULL;
+}
+
+/* path of the cache for the current file, or NULL when it has no hash */
+R_API char *r_core_anal_cache_file(RCore *core) {
+	const char *sha1 = acache_sha1 (core);
+	char *dir, *path;
+	if (!sha1)
+		return NULL;
+	dir = r_file_abspath (r_config_get (core->config, "dir.acache"));
+	if (!dir)
+		return NULL;
+	path = r_str_newf ("%s"R_SYS_DIR"%s.r2ac", dir, sha1);
+	free (dir);
+	return path;
+}
+
+R_API int r_core_anal_cache_save(RCore *core, const char *file) {
+	const char *sha1 = acache_sha1 (core);
+	char *path = file? strdup (file): r_core_anal_cache_file (core);
+	char *dir;
+	FILE *fp;
+	int i;
+	if (!path) {
+		eprintf ("Cannot compute the hash of the current file\n");
+		return R_FALSE;
+	}
+	dir = r_file_dirname (path);
+	if (dir) {
+		r_sys_rmkdir (dir);
+		free (dir);
+	}
+	fp = r_sandbox_fopen (path, "wb");
+	if (!fp) {
+		eprintf ("Cannot open '%s' for writing\n", path);
+		free (path);
+		return R_FALSE;
+	}
+	fwrite (ACACHE_MAGIC, 4, 1, fp);
+	w_u32 (fp, ACACHE_VERSION);
+	w_str (fp, sha1? sha1: "");
+	w_fcns (fp, core->anal);
+	w_flags (fp, core->flags);
+	w_meta_spaces (fp, &core->anal->meta_spaces);
+	/* the meta stores are only serialized into sdb for the dump */
+	r_meta_sync (core->anal);
+	for (i = 0; acache_sdbs[i]; i++) {
+		Sdb *db = sdb_ns (core->anal->sdb, acache_sdbs[i], 0);
+		if (db) w_sdb (fp, acache_sdbs[i], db);
+	}
+	sdb_reset (core->anal->sdb_meta);
+	if (ferror (fp)) {
+		eprintf ("Cannot write '%s'\n", path);
+		fclose (fp);
+		r_file_rm (path);
+		free (path);
+		return R_FALSE;
+	}
+	fclose (fp);
+	free (path);
+	return R_TRUE;
+}
+
+static const char *acache_section_name(ut32 tag) {
+	switch (tag) {
+	case ACACHE_FCNS: return "fcns";
+	case ACACHE_FLAG: return "flags";
+	case ACACHE_MSPC: return "metaspc";
+	case ACACHE_SDB: return "sdb";
+	}
+	return "unknown";
+}
+
+/* the loaded state is added to the current one. A cache for another
+ * file is rejected unless it was explicitly requested by path */
+R_API int r_core_anal_cache_load(RCore *core, const char *file) {
+	const char *sha1 = acache_sha1 (core);
+	char *path = file? strdup (file): r_core_anal_cache_file (core);
+	int timing = r_config_get_i (core->config, "cfg.timing");
+	ut64 t0 = r_sys_now (), t;
+	char *data, *fsha1;
+	ACacheReader r = {0};
+	int len = 0, ret = R_TRUE;
+
+	data = path? r_file_slurp (path, &len): NULL;
+	free (path);
+	if (!data)
+		return R_FALSE;
+	r.buf = (const ut8*)data;
+	r.len = len;
+	if (len < 8 || memcmp (data, ACACHE_MAGIC, 4)) {
+		free (data);
+		return R_FALSE;
+	}
+	r.off = 4;
+	if (r_u32 (&r) != ACACHE_VERSION) {
+		eprintf ("Analysis cache version mismatch\n");
+		free (data);
+		return R_FALSE;
+	}
+	fsha1 = r_str (&r);
+	if (!fsha1 || !sha1 || strcmp (fsha1, sha1)) {
+		if (!file) {
+			free (fsha1);
+			free (data);
+			return R_FALSE;
+		}
+		if (fsha1 && *fsha1)
+			eprintf ("WARNING: analysis cache sha1 mismatch\n");
+	}
+	free (fsha1);
+	if (timing)
+		eprintf ("read     %8"PFMT64d" us  %d bytes\n", r_sys_now () - t0, len);
+	while (ret && r.off < r.len && !r.error) {
+		ut32 tag = r_u32 (&r);
+		ut64 size = r_u64 (&r);
+		ACacheReader s = { r.buf + r.off, size, 0, 0 };
+		if (r.error || !r_get (&r, size))
+			break;
+		t = r_sys_now ();
+		switch (tag) {
+		case ACACHE_FCNS: ret = r_fcns (&s, core->anal); break;
+		case ACACHE_FLAG: ret = r_flags (&s, core->flags); break;
+		case ACACHE_MSPC: ret = r_meta_spaces (&s, &core->anal->meta_spaces); break;
+		case ACACHE_SDB: ret = r_sdb (&s, core->anal); break;
+		}
+		if (timing) {
+			/* sdb sections start with the namespace name */
+			ACacheReader n = { r.buf + r.off - size, size, 0, 0 };
+			char *ns = (tag == ACACHE_SDB)? r_str (&n): NULL;
+			eprintf ("%-8s %8"PFMT64d" us  %"PFMT64d" bytes\n",
+				ns? ns: acache_section_name (tag), r_sys_now () - t, size);
+			free (ns);
+		}
+	}
+	free (data);
+	r_meta_load (core->anal);
+	if (timing)
+		eprintf ("total    %8"PFMT64d" us\n", r_sys_now () - t0);
+	if (!ret || r.error) {
+		eprintf ("Corrupted analysis cache\n");
+		return R_FALSE;
+	}
+	return R_TRUE;
+}
@@ -901,6 +901,15 @@ static int cmd_anal_fcn(RCore *core, const char *input) {
 	case 'g': // "afg" - non-interactive VV
 		r_core_visual_graph (core, NULL, R_FALSE);
 		break;
+	case 'U': // "afU"
+		if (input[2] == '?') {
+			eprintf ("Usage: afU[v]   # re-decode the basic blocks changed by writes\n");
+		} else {
+			int n = r_anal_fcn_update_dirty (core->anal);
+			if (input[2] == 'v')
+				eprintf ("%d basic blocks updated\n", n);
+		}
+		break;
 	case '?':{ // "af?"
 		 const char* help_msg[] = {
 		 "Usage:", "af", "",
@@ -922,6 +931,7 @@ static int cmd_anal_fcn(RCore *core, const char *input) {
 		 "afn", " name [addr]", "rename name for function at address (change flag too)",
 		 "afna", "", "suggest automatic name for current offset",
 		 "afs", " [addr] [fcnsign]", "get/set function signature at current address",
+		 "afU", "[v]", "update the basic blocks and refs changed by writes (wx, wa, patches)",
 		 "afx", "[cCd-] src dst", "add/remove code/Call/data/string reference",
 		 "afv", "[?] [idx] [type] [name]", "add local var on current function",
 		 NULL};
@@ -1787,6 +1797,7 @@ static void cmd_anal_opcode(RCore *core, const char *input) {
 				"aoe", " 4", "emulate 4 opcodes starting at current offset",
 				"ao", " 5", "display opcode analysis of 5 opcodes",
 				"ao*", "", "display opcode in r commands",
+				"aoc", "[-]", "show opcode cache hit rate (or flush it)",
 				NULL};
 			r_core_cmd_help (core, help_msg);
 		}
@@ -1814,6 +1825,23 @@ static void cmd_anal_opcode(RCore *core, const char *input) {
 	case '*':
 		r_core_anal_hint_list (core->anal, input[0]);
 		break;
+	case 'c':
+		if (input[1] == '-') {
+			r_asm_opcache_flush (core->assembler);
+			r_anal_opcache_flush (core->anal);
+			core->assembler->opcache.hits = core->assembler->opcache.misses = 0;
+			core->anal->opcache.hits = core->anal->opcache.misses = 0;
+		} else {
+			RAsmOpCache *ac = &core->assembler->opcache;
+			RAnalOpCache *nc = &core->anal->opcache;
+			r_cons_printf ("asm:  %d entries, %"PFMT64d" hits, %"PFMT64d" misses (%.1f%%)\n",
+				ac->size, ac->hits, ac->misses,
+				ac->hits? 100.0 * ac->hits / (ac->hits + ac->misses): 0.0);
+			r_cons_printf ("anal: %d entries, %"PFMT64d" hits, %"PFMT64d" misses (%.1f%%)\n",
+				nc->size, nc->hits, nc->misses,
+				nc->hits? 100.0 * nc->hits / (nc->hits + nc->misses): 0.0);
+		}
+		break;
 	default:
 		{
 			int count = 0;
@@ -1874,6 +1902,42 @@ static void cmd_anal_calls(RCore *core, const char *input) {
 	}
 }
 
+static void cmd_anal_cache(RCore *core, const char *input) {
+	const char* help_msg[] = {
+		"Usage: aC[sl-?]", "", "analysis cache keyed by the file sha1 (see dir.acache)",
+		"aC", "", "show path of the analysis cache for the current file",
+		"aCs", " [file]", "save functions, flags, meta, hints and xrefs",
+		"aCl", " [file]", "load analysis cache",
+		"aC-", "", "remove analysis cache",
+		NULL};
+	const char *arg = (input[0] && input[1] == ' ')? input + 2: NULL;
+	char *path;
+
+	switch (input[0]) {
+	case 's': // "aCs"
+		if (!r_core_anal_cache_save (core, arg))
+			eprintf ("Cannot save analysis cache\n");
+		break;
+	case 'l': // "aCl"
+		if (!r_core_anal_cache_load (core, arg))
+			eprintf ("Cannot load analysis cache\n");
+		break;
+	case '-': // "aC-"
+		path = r_core_anal_cache_file (core);
+		if (path) r_file_rm (path);
+		free (path);
+		break;
+	case '\0': // "aC"
+		path = r_core_anal_cache_file (core);
+		if (path) r_cons_printf ("%s\n", path);
+		free (path);
+		break;
+	default:
+		r_core_cmd_help (core, help_msg);
+		break;
+	}
+}
+
 static void cmd_anal_syscall(RCore *core, const char *input) {
 	RSyscallItem *si;
 	RListIter *iter;
@@ -2537,6 +2601,7 @@ static int cmd_anal(void *data, const char *input) {
 		"a8", " [hexpairs]", "analyze bytes",
 		"aa", "", "analyze all (fcns + bbs) (aa0 to avoid sub renaming)",
 		"ac", " [cycles]", "analyze which op could be executed in [cycles]",
+		"aC", "[?sl-]", "analysis cache keyed by the file hash",
 		"ad", "", "analyze data trampoline (wip)",
 		"ad", " [from] [to]", "analyze data pointers to (from-to)",
 		"ae", " [expr]", "analyze opcode eval expression (see ao)",
@@ -2589,6 +2654,9 @@ static int cmd_anal(void *data, const char *input) {
 	case 's': // "as"
 		cmd_anal_syscall(core, input+1);
 		break;
+	case 'C': // "aC"
+		cmd_anal_cache (core, input+1);
+		break;
 	case 'x':
 		if (!cmd_anal_refs (core, input+1)) {
 			r_cons_break_end ();
@@ -2616,14 +2684,22 @@ static int cmd_anal(void *data, const char *input) {
 			break;
 		case '\0': // "aa"
 		case 'a': 
+			{
+			int breaked;
 			r_cons_break (NULL, NULL);
 			r_core_anal_all (core);
-			if (core->cons->breaked)
+			/* r_cons_break_end resets the flag */
+			breaked = core->cons->breaked;
+			if (breaked)
 				eprintf ("Interrupted\n");
 			r_cons_clear_line (1);
 			r_cons_break_end ();
 			if (input[1] == 'a') // "aaa"
-				r_core_cmd0 (core, ".afna @@ fcn.*"); break; // "aaa"
+				r_core_cmd0 (core, ".afna @@ fcn.*");
+			/* never cache a partial analysis */
+			if (!breaked && r_config_get_i (core->config, "anal.cache"))
+				r_core_anal_cache_save (core, NULL);
+			}
 			break;
 		default: r_core_cmd_help (core, help_msg_aa); break;
 		}
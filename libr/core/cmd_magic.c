@@ -5,6 +5,48 @@ static int magicdepth = 99; //XXX: do not use global var here
 static RMagic *ck = NULL; // XXX: Use RCore->magic
 static char *ofile = NULL;
 
+#define MAGIC_MAX_THREADS 16
+#define MAGIC_CHUNK (256 * 1024)
+
+static RMagic *magic_load_path(const char *path) {
+	RMagic *ms = r_magic_new (0);
+	if (ms && r_magic_load (ms, path) == -1) {
+		eprintf ("failed r_magic_load (\"%s\") %s\n", path, r_magic_error (ms));
+		r_magic_free (ms);
+		return NULL;
+	}
+	return ms;
+}
+
+/* the magic of the given file or dir.magic, kept loaded across calls */
+static RMagic *magic_get(RCore *core, const char *file) {
+	const char *path;
+	if (file) {
+		if (*file == ' ') file++;
+		if (!*file) file = NULL;
+	}
+	path = file? file: r_config_get (core->config, "dir.magic");
+	if (!path)
+		return NULL;
+	if (ck && ofile && !strcmp (ofile, path))
+		return ck;
+	r_magic_free (ck);
+	free (ofile);
+	ofile = NULL;
+	if ((ck = magic_load_path (path)))
+		ofile = strdup (path);
+	return ck;
+}
+
+static int magic_is_data(const char *str) {
+#if USE_LIB_MAGIC
+	return !strcmp (str, "data") || strstr (str, "ASCII") ||
+		strstr (str, "ISO") || strstr (str, "no line terminator");
+#else
+	return !strcmp (str, "data");
+#endif
+}
+
 static int r_core_magic_at(RCore *core, const char *file, ut64 addr, int depth, int v) {
 	const char *fmt;
 	char *q, *p;
@@ -33,38 +75,8 @@ static int r_core_magic_at(RCore *core, const char *file, ut64 addr, int depth,
 	}
 	if (((addr&7)==0) && ((addr&(7<<8))==0))
 		eprintf ("0x%08"PFMT64x"\r", addr);
-	if (file) {
-		if (*file == ' ') file++;
-		if (!*file) file = NULL;
-	}
-	if (file && ofile && file != ofile) {
-		if (strcmp (file, ofile)) {
-			r_magic_free (ck);
-			ck = NULL;
-		}
-	}
-	if (ck==NULL) {
-		// TODO: Move RMagic into RCore
-		r_magic_free (ck);
-		// allocate once
-		ck = r_magic_new (0);
-		if (file) {
-			free (ofile);
-			ofile = strdup (file);
-			if (r_magic_load (ck, file) == -1) {
-				eprintf ("failed r_magic_load (\"%s\") %s\n", file, r_magic_error (ck));
-				ck = NULL;
-				return -1;
-			}
-		} else {
-			const char *magicpath = r_config_get (core->config, "dir.magic");
-			if (r_magic_load (ck, magicpath) == -1) {
-				ck = NULL;
-				eprintf ("failed r_magic_load (dir.magic) %s\n", r_magic_error (ck));
-				return -1;
-			}
-		}
-	}
+	if (!magic_get (core, file))
+		return -1;
 //repeat:
 	//if (v) r_cons_printf ("  %d # pm %s @ 0x%"PFMT64x"\n", depth, file? file: "", addr);
 	if (delta+2>core->blocksize) {
@@ -74,11 +86,7 @@ static int r_core_magic_at(RCore *core, const char *file, ut64 addr, int depth,
 	str = r_magic_buffer (ck, core->block+delta, core->blocksize-delta);
 	if (str) {
 		const char *cmdhit;
-#if USE_LIB_MAGIC
-		if (!v && (!strcmp (str, "data") || strstr(str, "ASCII") || strstr(str, "ISO") || strstr(str, "no line terminator"))) {
-#else
-		if (!v && (!strcmp (str, "data"))) {
-#endif
+		if (!v && magic_is_data (str)) {
 			int mod = core->search->align;
 			if (mod<1) mod = 1;
 			//r_magic_free (ck);
@@ -125,8 +133,6 @@ static int r_core_magic_at(RCore *core, const char *file, ut64 addr, int depth,
 			}
 		}
 		free (p);
-		r_magic_free (ck);
-		ck = NULL;
 
 		found ++;
 //		return adelta+1;
@@ -157,3 +163,115 @@ static void r_core_magic(RCore *core, const char *file, int v) {
 	if (addr != core->offset)
 		r_core_seek (core, addr, R_TRUE);
 }
+
+typedef struct {
+	RMagic *ms;
+	const ut8 *buf;
+	ut64 base;	/* address of buf[0] */
+	int window;	/* bytes identified at every offset */
+	int align;
+	int from, to;	/* offsets of buf scanned by this worker */
+	ut64 *hits;
+	int nhits, size;
+} RCoreMagicWorker;
+
+static void magic_scan_range(RCoreMagicWorker *w) {
+	const char *str;
+	int i;
+	for (i = w->from; i < w->to; i++) {
+		if (w->align > 1 && (w->base + i) % w->align)
+			continue;
+		str = r_magic_buffer (w->ms, w->buf + i, w->window);
+		if (!str || magic_is_data (str))
+			continue;
+		if (w->nhits == w->size) {
+			int size = w->size? w->size * 2: 64;
+			ut64 *hits = realloc (w->hits, size * sizeof (ut64));
+			if (!hits) break;
+			w->hits = hits;
+			w->size = size;
+		}
+		w->hits[w->nhits++] = w->base + i;
+	}
+}
+
+static int magic_thread(RThread *th) {
+	magic_scan_range ((RCoreMagicWorker *)th->user);
+	return R_FALSE;
+}
+
+static int magic_threads() {
+	return R_MIN (r_sys_cpus (), MAGIC_MAX_THREADS);
+}
+
+/* "/m": the workers identify their share of every chunk with their own
+ * RMagic, then the hits are reported in order through r_core_magic_at */
+static void r_core_magic_scan(RCore *core, const char *file, ut64 from, ut64 to) {
+	RCoreMagicWorker workers[MAGIC_MAX_THREADS];
+	RThread *threads[MAGIC_MAX_THREADS];
+	int i, j, nth = magic_threads (), window = core->blocksize;
+	ut64 at, len;
+	ut8 *buf = NULL;
+
+	if (!magic_get (core, file))
+		return;
+	memset (workers, 0, sizeof (workers));
+	for (i = 0; i < nth; i++) {
+		if (!(workers[i].ms = magic_load_path (ofile)))
+			break;
+		workers[i].window = window;
+		workers[i].align = core->search->align;
+	}
+	nth = i;
+	if (nth > 0)
+		buf = malloc ((size_t)nth * MAGIC_CHUNK + window);
+	for (at = from; buf && at < to; at += len) {
+		if (r_cons_singleton ()->breaked)
+			break;
+		eprintf ("0x%08"PFMT64x"\r", at);
+		len = R_MIN (to - at, (ut64)nth * MAGIC_CHUNK);
+		/* the last offsets of the chunk also see a whole block */
+		r_io_read_at (core->io, at, buf, (int)len + window);
+		for (i = 0; i < nth; i++) {
+			RCoreMagicWorker *w = &workers[i];
+			w->buf = buf;
+			w->base = at;
+			w->from = (int)(len * i / nth);
+			w->to = (int)(len * (i + 1) / nth);
+			w->nhits = 0;
+			threads[i] = (i && w->from < w->to)?
+				r_th_new (magic_thread, w, 0): NULL;
+		}
+		magic_scan_range (&workers[0]);
+		for (i = 1; i < nth; i++) {
+			if (threads[i])
+				r_th_free (threads[i]);
+			else magic_scan_range (&workers[i]);
+		}
+		for (i = 0; i < nth; i++) {
+			for (j = 0; j < workers[i].nhits; j++) {
+				if (r_cons_singleton ()->breaked)
+					break;
+				r_core_seek (core, workers[i].hits[j], R_TRUE);
+				r_core_magic_at (core, file, workers[i].hits[j], 99, R_FALSE);
+			}
+		}
+	}
+	for (i = 0; i < MAGIC_MAX_THREADS; i++) {
+		r_magic_free (workers[i].ms);
+		free (workers[i].hits);
+	}
+	free (buf);
+}
+
+/* "pmc": store the parsed magic as file.mgc, later loads map it */
+static void r_core_magic_compile(RCore *core, const char *file) {
+	RMagic *ms = r_magic_new (0);
+	const char *path;
+	if (!ms) return;
+	while (*file == ' ') file++;
+	path = *file? file: r_config_get (core->config, "dir.magic");
+	if (path && r_magic_compile (ms, path) == -1)
+		eprintf ("failed r_magic_compile (\"%s\") %s\n", path, r_magic_error (ms));
+	r_magic_free (ms);
+}
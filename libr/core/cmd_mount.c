@@ -52,6 +52,20 @@ static int cmd_mount(void *data, const char *_input) {
 				root->p->name, root->delta, root->path);
 		}
 		break;
+	case 'c': // block cache of the mountpoints
+		if (input[1] == '-') {
+			r_list_foreach (core->fs->roots, iter, root)
+				r_fs_cache_reset (root->cache);
+			break;
+		}
+		r_list_foreach (core->fs->roots, iter, root) {
+			RFSCache *c = root->cache;
+			if (!c) continue;
+			r_cons_printf ("%s\t%d/%d blocks of %d\thits %"PFMT64d
+				"\tmisses %"PFMT64d"\n", root->path, c->count,
+				c->size, c->bsize, c->hits, c->misses);
+		}
+		break;
 	case 'l': // list of plugins
 		r_list_foreach (core->fs->plugins, iter, plug) {
 			r_cons_printf ("%10s  %s\n", plug->name, plug->desc);
@@ -179,6 +193,8 @@ static int cmd_mount(void *data, const char *_input) {
 			"Usage:", "m[-?*dgy] [...] ", "Mountpoints management",
 			"m", "", "List all mountpoints in human readable format",
 			"m*", "", "Same as above, but in r2 commands",
+			"mc", "", "Show the block cache usage of the mountpoints",
+			"mc-", "", "Drop the cached blocks of the mountpoints",
 			"ml", "", "List filesystem plugins",
 			"m", " /mnt", "Mount fs at /mnt with autodetect fs and current offset",
 			"m", " /mnt ext2 0", "Mount ext2 fs at /mnt with delta 0 on IO",
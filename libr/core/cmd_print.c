@@ -2335,7 +2335,10 @@ static int cmd_print(void *data, const char *input) {
 				"|   @0x40      # use current magic file on address 0x40\n"
 				"|   \\n         # append newline\n"
 				"| e dir.magic  # defaults to "R_MAGIC_PATH"\n"
+				"| pmc [file|dir]  # compile to file.mgc, loaded instead of the sources\n"
 				);
+		} else if (input[1]=='c') {
+			r_core_magic_compile (core, input+2);
 		} else r_core_magic (core, input+1, R_TRUE);
 		break;
 	case 'u': //pu
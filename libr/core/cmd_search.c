@@ -1740,20 +1740,9 @@ static int cmd_search(void *data, const char *input) {
 	case 'm': // "/m"
 		dosearch = R_FALSE;
 		if (input[1]==' ' || input[1]=='\0') {
-			int ret;
 			const char *file = input[1]? input+2: NULL;
-			ut64 addr = param.from;
 			r_cons_break (NULL, NULL);
-			for (; addr<param.to; addr++) {
-				if (r_cons_singleton ()->breaked)
-					break;
-				ret = r_core_magic_at (core, file, addr, 99, R_FALSE);
-				if (ret == -1) {
-					// something went terribly wrong.
-					break;
-				}
-				addr += ret-1;
-			}
+			r_core_magic_scan (core, file, param.from, param.to);
 			r_cons_clear_line (1);
 			r_cons_break_end ();
 		} else eprintf ("Usage: /m [file]\n");
@@ -47,39 +47,15 @@ static int cmd_seek(void *data, const char *input) {
 				r_core_cmd0 (core, "C*~^\"CC");
 			} else
 			if (input[1]==' ') {
-				typedef struct {
-					ut64 addr;
-					char *str;
-				} MetaCallback;
+				RList *list = r_meta_enumerate (core->anal, R_META_TYPE_COMMENT);
+				RAnalMetaItem *mi, *found = NULL;
+				RListIter *iter;
 				int count = 0;
-				MetaCallback cb = { 0, NULL };
-				ut64 addr;
-				char key[128];
-				const char *val, *comma;
-				char *list = sdb_get (core->anal->sdb_meta, "meta.C", 0);
-				char *str, *next, *cur = list;
-				if (list) {
-					for (;;) {
-						cur = sdb_anext (cur, &next);
-						addr = sdb_atoi (cur);
-						snprintf (key, sizeof (key)-1, "meta.C.0x%"PFMT64x, addr);
-						val = sdb_const_get (core->anal->sdb_meta, key, 0);
-						if (val) {
-							comma = strchr (val, ',');
-							if (comma) {
-								str = (char *)sdb_decode (comma+1, 0);
-								if (strstr (str, input+2)) {
-									r_cons_printf ("0x%08"PFMT64x"  %s\n", addr, str);
-									count++;
-									cb.addr = addr;
-									free (cb.str);
-									cb.str = str;
-								} else free (str);
-							}
-						} else eprintf ("sdb_const_get key not found '%s'\n", key);
-						if (!next)
-							break;
-						cur = next;
+				r_list_foreach (list, iter, mi) {
+					if (mi->str && strstr (mi->str, input+2)) {
+						r_cons_printf ("0x%08"PFMT64x"  %s\n", mi->from, mi->str);
+						found = mi;
+						count++;
 					}
 				}
 
@@ -88,7 +64,7 @@ static int cmd_seek(void *data, const char *input) {
 					eprintf ("No matching comments\n");
 					break;
 				case 1:
-					off = cb.addr;
+					off = found->from;
 					r_io_sundo_push (core->io, core->offset);
 					r_core_seek (core, off, 1);
 					r_core_block_read (core, 0);
@@ -97,7 +73,7 @@ static int cmd_seek(void *data, const char *input) {
 					eprintf ("Too many results\n");
 					break;
 				}
-				free (cb.str);
+				r_list_free (list);
 			} else eprintf ("Usage: sC[?*] comment-grep\n"
 				"sC*        list all comments\n"
 				"sC const   seek to comment matching 'const'\n");
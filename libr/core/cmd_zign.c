@@ -1,5 +1,14 @@
 /* radare - LGPL - Copyright 2009-2015 - pancake */
 
+static void zign_found(RSignItem *si, ut64 ini, int idx, int count) {
+	if (si->type == 'f')
+		r_cons_printf ("f sign.fun_%s_%d @ 0x%08"PFMT64x"\n",
+			si->name, idx, ini+idx); //core->offset);
+	else r_cons_printf ("f sign.%s @ 0x%08"PFMT64x"\n",
+		si->name, ini+idx); //core->offset+idx);
+	eprintf ("- Found %d matching function signatures\r", count);
+}
+
 static int cmd_zign(void *data, const char *input) {
 	RCore *core = (RCore *)data;
 	RAnalFunction *fcni;
@@ -147,18 +156,24 @@ static int cmd_zign(void *data, const char *input) {
 				r_cons_printf ("fs sign\n");
 				r_cons_break (NULL, NULL);
 				if (r_io_read_at (core->io, ini, buf, len) == len) {
-					for (idx=0; idx<len; idx++) {
-						if (r_cons_singleton ()->breaked)
-							break;
-						si = r_sign_check (core->sign, buf+idx, len-idx);
-						if (si) {
-							count++;
-							if (si->type == 'f')
-								r_cons_printf ("f sign.fun_%s_%d @ 0x%08"PFMT64x"\n",
-									si->name, idx, ini+idx); //core->offset);
-							else r_cons_printf ("f sign.%s @ 0x%08"PFMT64x"\n",
-								si->name, ini+idx); //core->offset+idx);
-							eprintf ("- Found %d matching function signatures\r", count);
+					if (r_config_get_i (core->config, "zign.fcnonly")) {
+						r_list_foreach (core->anal->fcns, iter, fcni) {
+							if (r_cons_singleton ()->breaked)
+								break;
+							if (fcni->addr < ini || fcni->addr >= fin)
+								continue;
+							idx = fcni->addr - ini;
+							si = r_sign_check (core->sign, buf+idx, len-idx);
+							if (si) zign_found (si, ini, idx, ++count);
+						}
+					} else {
+						int align = r_config_get_i (core->config, "zign.align");
+						if (align < 1) align = 1;
+						for (idx=(align-(ini%align))%align; idx<len; idx+=align) {
+							if (r_cons_singleton ()->breaked)
+								break;
+							si = r_sign_check (core->sign, buf+idx, len-idx);
+							if (si) zign_found (si, ini, idx, ++count);
 						}
 					}
 				} else eprintf ("Cannot read %d bytes at 0x%08"PFMT64x"\n", len, ini);
@@ -195,7 +210,7 @@ static int cmd_zign(void *data, const char *input) {
 			"z*", "", "display all zignatures",
 			"z-", "namespace", "Unload zignatures in namespace",
 			"z-*", "", "unload all zignatures",
-			"z/", "[ini] [end]", "search zignatures between these regions",
+			"z/", "[ini] [end]", "search zignatures between these regions (see zign.align and zign.fcnonly)",
 			"za", " ...", "define new zignature for analysis",
 			"zb", " name bytes", "define zignature for bytes",
 			"zB", " size", "Generate zignatures for current offset/flag",
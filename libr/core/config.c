@@ -331,6 +331,16 @@ static int cb_asmlineswidth(void *user, void *data) {
 	return R_TRUE;
 }
 
+static int cb_asmopcache(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode *) data;
+	if (node->i_value < 0)
+		return R_FALSE;
+	r_asm_opcache_set (core->assembler, node->i_value);
+	r_anal_opcache_set (core->anal, node->i_value);
+	return R_TRUE;
+}
+
 static int cb_asmos(void *user, void *data) {
 	RCore *core = (RCore*) user;
 	int asmbits = r_config_get_i (core->config, "asm.bits");
@@ -714,6 +724,13 @@ static int cb_ioff(void *user, void *data) {
 	return R_TRUE;
 }
 
+static int cb_iogzidx(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode *) data;
+	core->io->gzidx = node->i_value;
+	return R_TRUE;
+}
+
 static int cb_ioautofd(void *user, void *data) {
 	RCore *core = (RCore *) user;
 	RConfigNode *node = (RConfigNode *) data;
@@ -1033,6 +1050,7 @@ R_API int r_core_config_init(RCore *core) {
 	SETI("anal.depth", 16, "Max depth at code analysis"); // XXX: warn if depth is > 50 .. can be problematic
 	SETICB("anal.sleep", 0, &cb_analsleep, "Sleep N usecs every so often during analysis. Avoid 100% CPU usage");
 	SETPREF("anal.hasnext", "true", "Continue analysis after each function");
+	SETPREF("anal.cache", "false", "Load the analysis cache (aC) on open and save it after aa");
 	SETPREF("anal.esil", "false", "Use the new ESIL code analysis");
 	SETCB("anal.nopskip", "true", &cb_analnopskip, "Skip nops at the beginning of functions");
 	SETCB("anal.bbsplit", "true", &cb_analbbsplit, "Use the experimental basic block split for JMPs");
@@ -1077,6 +1095,7 @@ R_API int r_core_config_init(RCore *core) {
 	SETPREF("asm.lineswide", "false", "Put a space between lines");
 	SETICB("asm.lineswidth", 7, &cb_asmlineswidth, "Number of columns for program flow arrows");
 	SETPREF("asm.middle", "false", "Allow disassembling jumps in the middle of an instruction");
+	SETICB("asm.opcache", 4096, &cb_asmopcache, "Number of decoded opcodes cached by asm and anal (0 to disable)");
 	SETPREF("asm.offset", "true", "Show offsets at disassembly");
 	SETPREF("asm.reloff", "false", "Show relative offsets instead of absolute address in disasm");
 	SETPREF("asm.section", "false", "Show section name before offset");
@@ -1143,12 +1162,17 @@ R_API int r_core_config_init(RCore *core) {
 	SETPREF("cfg.prefixdump", "dump", "Filename prefix for automated dumps");
 	SETCB("cfg.sandbox", "false", &cb_cfgsanbox, "Sandbox mode disables systems and open on upper directories");
 	SETPREF("cfg.wseek", "false", "Seek after write");
+	SETPREF("cfg.timing", "false", "Show per subsystem load times of projects and analysis caches");
 
 	/* diff */
 	SETI("diff.from", 0, "Set source diffing address for px (uses cc command)");
 	SETI("diff.to", 0, "Set destination diffing address for px (uses cc command)");
 	SETPREF("diff.bare", "false", "Never show function names in diff output");
 
+	/* zign */
+	SETI("zign.align", 1, "Only test zignatures at offsets aligned to this value in z/");
+	SETPREF("zign.fcnonly", "false", "Only test zignatures at function starts in z/");
+
 	/* dir */
 	SETPREF("dir.magic", R_MAGIC_PATH, "Path to r_magic files");
 	SETPREF("dir.plugins", R2_LIBDIR"/radare2/"R2_VERSION"/", "Path to plugin files to be loaded at startup");
@@ -1156,10 +1180,13 @@ R_API int r_core_config_init(RCore *core) {
 	SETPREF("dir.types", "/usr/include", "Default path to look for cparse type files");
 #if __ANDROID__
 	SETPREF("dir.projects", "/data/data/org.radare2.installer/radare2/projects", "Default path for projects");
+	SETPREF("dir.acache", "/data/data/org.radare2.installer/radare2/acache", "Default path for analysis caches");
 #elif __WINDOWS__
 	SETPREF("dir.projects", "~\\"R2_HOMEDIR"\\projects", "Default path for projects");
+	SETPREF("dir.acache", "~\\"R2_HOMEDIR"\\acache", "Default path for analysis caches");
 #else
 	SETPREF("dir.projects", "~/"R2_HOMEDIR"/projects", "Default path for projects");
+	SETPREF("dir.acache", "~/"R2_HOMEDIR"/acache", "Default path for analysis caches");
 #endif
 	SETPREF("stack.bytes", "true", "Show bytes instead of words in stack");
 	SETPREF("stack.anotated", "false", "Show anotated hexdump in visual debug");
@@ -1373,6 +1400,7 @@ R_API int r_core_config_init(RCore *core) {
 	SETCB("io.va", "true", &cb_iova, "Use virtual address layout");
 	SETCB("io.zeromap", "0", &cb_iozeromap, "Double map the last opened file to address zero");
 	SETCB("io.autofd", "true", &cb_ioautofd, "Change fd when opening a new file");
+	SETCB("io.gzidx", "false", &cb_iogzidx, "Save the gzip:// access point index in <file>.gzidx and reuse it");
 	SETCB("io.vio", "false", &cb_iovio, "Enable the new vio (reading only) (WIP)");
 
 	/* file */
@@ -94,6 +94,19 @@ static char *core_cmdstr_callback (void *user, const char *cmd) {
 	return r_core_cmd_str (core, cmd);
 }
 
+static void core_post_write_callback (void *user, ut64 addr, int len) {
+	RCore *core = (RCore *)user;
+	RListIter *iter;
+	RFSRoot *root;
+	if (core->anal)
+		r_anal_fcn_bb_dirty (core->anal, addr, len);
+	/* the mounted filesystems must not serve the old blocks */
+	if (core->fs) {
+		r_list_foreach (core->fs->roots, iter, root)
+			r_fs_cache_reset (root->cache);
+	}
+}
+
 static ut64 getref (RCore *core, int n, char t, int type) {
 	RAnalFunction *fcn = r_anal_get_fcn_in (core->anal, core->offset, 0);
 	RListIter *iter;
@@ -901,6 +914,7 @@ R_API int r_core_init(RCore *core) {
 	core->io->user = (void *)core;
 	core->io->cb_core_cmd = core_cmd_callback;
 	core->io->cb_core_cmdstr = core_cmdstr_callback;
+	core->io->cb_core_post_write = core_post_write_callback;
 	core->sign = r_sign_new ();
 	core->search = r_search_new (R_SEARCH_KEYWORD);
 	r_io_undo_enable (core->io, 1, 0); // TODO: configurable via eval
@@ -974,6 +988,7 @@ R_API RCore *r_core_fini(RCore *c) {
 	r_list_free (c->files);
 	r_list_free (c->watchers);
 	r_list_free (c->scriptstack);
+	r_list_free (c->graph_layouts);
 	c->rcmd = r_cmd_free (c->rcmd);
 	c->anal = r_anal_free (c->anal);
 	c->assembler = r_asm_free (c->assembler);
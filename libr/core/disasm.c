@@ -362,27 +362,33 @@ static RDisasmState * handle_init_ds (RCore * core) {
 static void handle_reflines_init (RCore *core, RDisasmState *ds) {
 	if (ds->show_lines) {
 		// TODO: make anal->reflines implicit
-		free (core->reflines); // TODO: leak
-		free (core->reflines2); // TODO: leak
+		r_anal_reflines_free (core->reflines);
+		r_anal_reflines_free (core->reflines2);
 		core->reflines = r_anal_reflines_get (core->anal,
 			ds->addr, ds->buf, ds->len, ds->l,
 			ds->linesout, ds->show_linescall);
 		core->reflines2 = r_anal_reflines_get (core->anal,
 			ds->addr, ds->buf, ds->len, ds->l,
 			ds->linesout, 1);
-	} else core->reflines = core->reflines2 = NULL;
+	} else {
+		r_anal_reflines_free (core->reflines);
+		r_anal_reflines_free (core->reflines2);
+		core->reflines = core->reflines2 = NULL;
+	}
 }
 
 static void handle_reflines_fcn_init (RCore *core, RDisasmState *ds,  RAnalFunction *fcn, ut8* buf) {
 	if (ds->show_lines) {
 		// TODO: make anal->reflines implicit
-		free (core->reflines); // TODO: leak
+		r_anal_reflines_free (core->reflines);
 		core->reflines = r_anal_reflines_fcn_get (core->anal,
 				fcn, -1, ds->linesout, ds->show_linescall);
-		free (core->reflines2); // TODO: leak
+		r_anal_reflines_free (core->reflines2);
 		core->reflines2 = r_anal_reflines_fcn_get (core->anal,
 				fcn, -1, ds->linesout, 1);
 	} else {
+		r_anal_reflines_free (core->reflines);
+		r_anal_reflines_free (core->reflines2);
 		core->reflines = core->reflines2 = NULL;
 	}
 }
@@ -1270,47 +1276,15 @@ static void handle_adistrick_comments (RCore *core, RDisasmState *ds) {
 
 static int handle_print_meta_infos (RCore * core, RDisasmState *ds, ut8* buf, int len, int idx) {
 	int ret = 0;
-	const char *infos, *metas;
-	char key[100];
-	RAnalMetaItem MI, *mi = &MI;
-	Sdb *s = core->anal->sdb_meta;
-
-	snprintf (key, sizeof (key)-1, "meta.0x%"PFMT64x, ds->at);
-	infos = sdb_const_get (s, key, 0);
-	if (infos)
-	for (;*infos; infos++) {
-		/* XXX wtf, must use anal.meta.deserialize() */
-		char *p, *q;
-		if (*infos==',')
-			continue;
-		snprintf (key, sizeof (key)-1, "meta.%c.0x%"PFMT64x, *infos, ds->at);
-		metas = sdb_const_get (s, key, 0);
-		MI.size = sdb_array_get_num (s, key, 0, 0);
-		MI.type = *infos;
-		MI.from = ds->at;
-		MI.to = ds->at + MI.size;
-		if (metas) {
-			p = strchr (metas, ',');
-			if (!p) {
-				continue;
-			}
-			MI.space = atoi (p+1);
-			q = strchr (p+1, ',');
-			if (!q) {
-				continue;
-			}
-			MI.str = (char*)sdb_decode (q+1, 0);
-		} else MI.str = NULL;
-		// sdb-get blah
-		// TODO: implement ranged meta find (if not at the begging of function..
-#if 0
-		RAnalMetaItem *mi = r_meta_find (core->anal, ds->at,
-			R_META_TYPE_ANY, R_META_WHERE_HERE);
-#endif
-		char *out = NULL;
-		int hexlen;
-		int delta;
-		ds->mi_found = 0;
+	int hexlen, delta;
+	const char *t;
+	char *out;
+	RAnalMetaItem *mi;
+
+	/* items are found by their start address, one lookup per type */
+	ds->mi_found = 0;
+	for (t = R_META_TYPES; *t; t++) {
+		mi = r_meta_get_at (core->anal, ds->at, *t);
 		if (mi) {
 			switch (mi->type) {
 			case R_META_TYPE_STRING:
@@ -1396,10 +1370,6 @@ static int handle_print_meta_infos (RCore * core, RDisasmState *ds, ut8* buf, in
 				break;
 			}
 		}
-		if (MI.str) {
-			free (MI.str);
-			MI.str = NULL;
-		}
 	}
 	return ret;
 }
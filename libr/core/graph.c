@@ -30,8 +30,6 @@ static int mousemode = 0;
 #define hash_set(sdb,k,v) (sdb_num_set (sdb, sdb_fmt (0, "%"PFMT64u, (ut64)(size_t)k), (ut64)(size_t)v, 0))
 #define hash_get(sdb,k) (sdb_num_get (sdb, sdb_fmt (0, "%"PFMT64u, (ut64)(size_t)k), NULL))
 #define hash_get_rnode(sdb,k) ((RGraphNode *)(size_t)hash_get (sdb, k))
-#define hash_get_rlist(sdb,k) ((RList *)(size_t)hash_get (sdb, k))
-#define hash_get_int(sdb,k) ((int)hash_get (sdb, k))
 
 #define get_anode(gn) ((ANode *)gn->data)
 
@@ -43,12 +41,6 @@ struct len_pos_t {
 	int pos;
 };
 
-struct dist_t {
-	const RGraphNode *from;
-	const RGraphNode *to;
-	int dist;
-};
-
 struct layer_t {
 	int n_nodes;
 	RGraphNode **nodes;
@@ -68,6 +60,14 @@ typedef struct ascii_node {
 	int is_dummy;
 	int is_reversed;
 	int class;
+
+	/* layout temporaries, reset by set_layout_bb */
+	const RGraphNode *layer_parent; /* deepest parent seen by assign_layers */
+	RList *vert; /* vertical class: the node and the dummies below it */
+	int xminus, xplus; /* left and right placements */
+	int placed;
+	int dir, dir_eq; /* direction of dummy sequences in place_original */
+	int dist_right, has_dist_right; /* fixed distance to the next in layer */
 } ANode;
 
 typedef struct ascii_graph {
@@ -99,7 +99,7 @@ typedef struct ascii_graph {
 	RList *long_edges;
 	struct layer_t *layers;
 	int n_layers;
-	RList *dists; /* RList<struct dist_t> */
+	int has_dists; /* use the explicit distances between nodes */
 } AGraph;
 
 struct agraph_refresh_data {
@@ -107,6 +107,17 @@ struct agraph_refresh_data {
 	int fs;
 };
 
+/* positions of the nodes of a basic block graph, indexed by the hash of its
+ * nodes, their sizes and their edges. Kept in RCore.graph_layouts */
+struct layout_t {
+	ut64 hash;
+	int n_nodes;
+	ut64 *addr;
+	int *xy;
+};
+
+#define LAYOUT_CACHE_SIZE 16
+
 #define G(x,y) r_cons_canvas_gotoxy (g->can, x, y)
 #define W(x) r_cons_canvas_write (g->can, x)
 #define B(x,y,w,h) r_cons_canvas_box(g->can, x,y,w,h,NULL)
@@ -251,116 +262,96 @@ static void normal_ANode_print(const AGraph *g, const ANode *n, int cur) {
 	}
 }
 
-static int **get_crossing_matrix (const RGraph *g,
-								  const struct layer_t layers[],
-								  int maxlayer, int i, int from_up,
-								  int *n_rows) {
+static int cmp_int (const void *a, const void *b) {
+	return *(const int *)a - *(const int *)b;
+}
+
+/* positions of the neighbours of the nodes of layer i in the previous
+ * (from_up) or next layer, as sorted rows: row p is adj[off[p]..off[p+1]).
+ * Edges that do not reach the next layer are only kept when !strict, for
+ * the downward sweep, as the crossing matrix used to do */
+static int *get_adjacent_pos (const RGraph *g, const struct layer_t layers[],
+							  int i, int from_up, int strict, int **off) {
 	int len = layers[i].n_nodes;
-	int **m;
-	int j;
+	int l = from_up ? i - 1 : i;
+	int j, k, p, n_edges = 0, *adj, *o;
+	const RGraphNode *gk;
+	const ANode *ak;
 
-	m = R_NEWS0 (int *, len);
-	if (!m)
-		return NULL;
+	o = R_NEWS0 (int, len + 2);
+	if (!o) return NULL;
 
-	for (j = 0; j < len; ++j) {
-		m[j] = R_NEWS0 (int, len);
-		if (!m[j])
-			goto err_row;
-	}
-
-	/* calculate crossings between layer i and layer i-1 */
-	/* consider the crossings generated by each pair of edges */
-	if (i > 0 && from_up) {
-		for (j = 0; j < layers[i - 1].n_nodes; ++j) {
-			const RGraphNode *gj = layers[i - 1].nodes[j];
-			const RList *neigh = r_graph_get_neighbours (g, gj);
-			RGraphNode *gk;
-			RListIter *itk;
-
-			r_list_foreach (neigh, itk, gk) {
-				int s;
-				for (s = 0; s < j; ++s) {
-					const RGraphNode *gs = layers[i - 1].nodes[s];
-					const RList *neigh_s = r_graph_get_neighbours (g, gs);
-					RGraphNode *gt;
-					RListIter *itt;
-
-					r_list_foreach (neigh_s, itt, gt) {
-						const ANode *ak, *at; /* k and t should be "indexes" on layer i */
-
-						if (gt == gk) continue;
-						ak = get_anode (gk);
-						at = get_anode (gt);
-						if (ak->layer != i || at->layer != i) {
-							 eprintf("%llx or %llx are not on the right layer (%d)\n", ak->addr, at->addr, i);
-							 eprintf("edge from %llx to %llx is wrong\n", ((ANode*)(gj->data))->addr, ak->addr);
-							 eprintf("edge from %llx to %llx is wrong\n\n", ((ANode*)(gs->data))->addr, at->addr);
-
-							 continue;
-						}
-						m[ak->pos_in_layer][at->pos_in_layer]++;
-					}
-				}
-			}
+	/* count the edges of each row */
+	for (j = 0; j < layers[l].n_nodes; ++j) {
+		const RGraphNode *gj = layers[l].nodes[j];
+
+		r_graph_foreach_out (gj, k, gk) {
+			ak = get_anode (gk);
+			if ((from_up || strict) && ak->layer != l + 1) continue;
+			p = from_up ? ak->pos_in_layer : j;
+			o[p + 2]++;
+			n_edges++;
 		}
 	}
+	for (p = 0; p < len; ++p)
+		o[p + 2] += o[p + 1];
 
-	/* calculate crossings between layer i and layer i+1 */
-	if (i < maxlayer - 1 && !from_up) {
-		for (j = 0; j < layers[i].n_nodes; ++j) {
-			const RGraphNode *gj = layers[i].nodes[j];
-			const RList *neigh = r_graph_get_neighbours (g, gj);
-			const ANode *ak, *aj = get_anode (gj);
-			RGraphNode *gk;
-			RListIter *itk;
+	adj = R_NEWS (int, n_edges + 1);
+	if (!adj) {
+		free (o);
+		return NULL;
+	}
 
-			graph_foreach_anode (neigh, itk, gk, ak) {
-				int s;
-				for (s = 0; s < layers[i].n_nodes; ++s) {
-					const RGraphNode *gs = layers[i].nodes[s];
-					const RList *neigh_s;
-					RGraphNode *gt;
-					RListIter *itt;
-					const ANode *at, *as = get_anode (gs);
-
-					if (gs == gj) continue;
-					neigh_s = r_graph_get_neighbours (g, gs);
-					graph_foreach_anode (neigh_s, itt, gt, at) {
-						if (at->pos_in_layer < ak->pos_in_layer)
-							m[aj->pos_in_layer][as->pos_in_layer]++;
-					}
-				}
-			}
+	/* fill them, walking the upper layer in order keeps from_up rows sorted */
+	for (j = 0; j < layers[l].n_nodes; ++j) {
+		const RGraphNode *gj = layers[l].nodes[j];
+
+		r_graph_foreach_out (gj, k, gk) {
+			ak = get_anode (gk);
+			if ((from_up || strict) && ak->layer != l + 1) continue;
+			if (from_up)
+				adj[o[ak->pos_in_layer + 1]++] = j;
+			else
+				adj[o[j + 1]++] = ak->pos_in_layer;
 		}
 	}
+	if (!from_up) {
+		for (p = 0; p < len; ++p)
+			qsort (adj + o[p], o[p + 1] - o[p], sizeof (int), cmp_int);
+	}
+
+	*off = o;
+	return adj;
+}
 
-	if (n_rows)
-		*n_rows = len;
-	return m;
+/* number of crossings between the edges of u and the edges of v when u is
+ * placed to the left of v, given their sorted neighbour positions */
+static int count_crossings (const int *a, int na, const int *b, int nb) {
+	int x, y = 0, res = 0;
 
-err_row:
-	for (i = 0; i < len; ++i) {
-		if (m[i])
-			free (m[i]);
+	for (x = 0; x < na; ++x) {
+		while (y < nb && b[y] < a[x])
+			y++;
+		res += y;
 	}
-	free (m);
-	return NULL;
+	return res;
 }
 
 static int layer_sweep (const RGraph *g, const struct layer_t layers[],
 						int maxlayer, int i, int from_up) {
-	int **cross_matrix;
 	RGraphNode *u, *v;
 	const ANode *au, *av;
-	int n_rows, j, changed = R_FALSE;
+	int j, changed = R_FALSE;
 	int len = layers[i].n_nodes;
+	int *adj, *off;
 
-	cross_matrix = get_crossing_matrix (g, layers, maxlayer, i, from_up, &n_rows);
-	if (!cross_matrix) return R_FALSE;
+	if ((from_up && i == 0) || (!from_up && i >= maxlayer - 1))
+		return R_FALSE;
+	adj = get_adjacent_pos (g, layers, i, from_up, R_FALSE, &off);
+	if (!adj) return R_FALSE;
 
 	for (j = 0; j < len - 1; ++j) {
-		int auidx, avidx;
+		int auidx, avidx, cuv, cvu;
 
 		u = layers[i].nodes[j];
 		v = layers[i].nodes[j + 1];
@@ -369,7 +360,11 @@ static int layer_sweep (const RGraph *g, const struct layer_t layers[],
 		auidx = au->pos_in_layer;
 		avidx = av->pos_in_layer;
 
-		if (cross_matrix[auidx][avidx] > cross_matrix[avidx][auidx]) {
+		cuv = count_crossings (adj + off[auidx], off[auidx + 1] - off[auidx],
+				adj + off[avidx], off[avidx + 1] - off[avidx]);
+		cvu = count_crossings (adj + off[avidx], off[avidx + 1] - off[avidx],
+				adj + off[auidx], off[auidx + 1] - off[auidx]);
+		if (cuv > cvu) {
 			/* swap elements */
 			layers[i].nodes[j] = v;
 			layers[i].nodes[j + 1] = u;
@@ -378,19 +373,54 @@ static int layer_sweep (const RGraph *g, const struct layer_t layers[],
 	}
 
 	/* update position in the layer of each node. During the swap of some
-	 * elements we didn't swap also the pos_in_layer because the cross_matrix
-	 * is indexed by it, so do it now! */
+	 * elements we didn't swap also the pos_in_layer because the rows of
+	 * adj are indexed by it, so do it now! */
 	for (j = 0; j < layers[i].n_nodes; ++j) {
 		ANode *n = get_anode (layers[i].nodes[j]);
 		n->pos_in_layer = j;
 	}
 
-	for (j = 0; j < n_rows; ++j)
-		free (cross_matrix[j]);
-	free (cross_matrix);
+	free (adj);
+	free (off);
 	return changed;
 }
 
+/* total number of crossings between layer i and layer i+1, counted with an
+ * accumulator tree in O(E log V) (Barth, Juenger, Mutzel) */
+static int layer_crossings (const RGraph *g, const struct layer_t layers[], int i) {
+	int j, k, first = 1, res = 0, *tree, *adj, *off;
+
+	adj = get_adjacent_pos (g, layers, i, R_FALSE, R_TRUE, &off);
+	if (!adj) return 0;
+	while (first < layers[i + 1].n_nodes)
+		first <<= 1;
+	tree = R_NEWS0 (int, 2 * first);
+	if (tree) {
+		for (k = 0; k < off[layers[i].n_nodes]; ++k) {
+			j = adj[k] + first - 1;
+			tree[j]++;
+			while (j > 0) {
+				if (j % 2)
+					res += tree[j + 1];
+				j = (j - 1) / 2;
+				tree[j]++;
+			}
+		}
+	}
+	free (tree);
+	free (adj);
+	free (off);
+	return res;
+}
+
+static int crossings (const AGraph *g) {
+	int i, res = 0;
+
+	for (i = 0; i < g->n_layers - 1; ++i)
+		res += layer_crossings (g->graph, g->layers, i);
+	return res;
+}
+
 static void view_cyclic_edge (RGraphNode *from, RGraphNode *to, const RGraphVisitor *vis) {
 	const AGraph *g = (AGraph *)vis->data;
 	RGraphEdge *e = R_NEW (RGraphEdge);
@@ -400,23 +430,22 @@ static void view_cyclic_edge (RGraphNode *from, RGraphNode *to, const RGraphVisi
 	r_list_append (g->back_edges, e);
 }
 
-static int get_depth (Sdb *path, const RGraphNode *n) {
+static int get_depth (const RGraphNode *n) {
 	int res = 0;
-	while ((n = hash_get_rnode (path, n)) != NULL) {
+	while ((n = get_anode (n)->layer_parent) != NULL) {
 		res++;
 	}
 	return res;
 }
 
 static void set_layer (const RGraphNode *from, const RGraphNode *to, const RGraphVisitor *vis) {
-	Sdb *path = (Sdb *)vis->data;
 	int bdepth, adepth;
 
-	adepth = get_depth (path, from);
-	bdepth = get_depth (path, to);
+	adepth = get_depth (from);
+	bdepth = get_depth (to);
 
 	if (adepth + 1 > bdepth)
-		hash_set (path, to, from);
+		get_anode (to)->layer_parent = from;
 }
 
 static void view_dummy (RGraphNode *from, RGraphNode *to, const RGraphVisitor *vis) {
@@ -453,21 +482,17 @@ static void remove_cycles (AGraph *g) {
 /* assign a layer to each node of the graph */
 static void assign_layers (const AGraph *g) {
 	RGraphVisitor layer_vis = { NULL, NULL, NULL, NULL, NULL, NULL };
-	Sdb *path_layers = sdb_new0 ();
 	const RGraphNode *gn;
 	const RListIter *it;
 	ANode *n;
 
-	layer_vis.data = path_layers;
 	layer_vis.tree_edge = (RGraphEdgeCallback)set_layer;
 	layer_vis.fcross_edge = (RGraphEdgeCallback)set_layer;
 	r_graph_dfs (g->graph, &layer_vis);
 
 	graph_foreach_anode (r_graph_get_nodes (g->graph), it, gn, n) {
-		n->layer = get_depth (path_layers, gn);
+		n->layer = get_depth (gn);
 	}
-
-	sdb_free (path_layers);
 }
 
 static int find_edge (const RGraphEdge *a, const RGraphEdge *b) {
@@ -549,72 +574,85 @@ static void create_layers (AGraph *g) {
 /* layer-by-layer sweep */
 /* it permutes each layer, trying to find the best ordering for each layer
  * to minimize the number of crossing edges */
-static void minimize_crossings (const AGraph *g) {
-	int i, cross_changed;
+/* the sweeps are not guaranteed to converge, so stop after a few of them
+ * without any gain and keep the best ordering seen */
+#define MAX_SWEEPS_NO_GAIN 4
 
-	do {
-		cross_changed = R_FALSE;
+static void save_layers (const AGraph *g, RGraphNode **saved) {
+	int i;
 
-		for (i = 0; i < g->n_layers; ++i)
-			cross_changed |= layer_sweep (g->graph, g->layers, g->n_layers, i, R_TRUE);
-	} while (cross_changed);
+	for (i = 0; i < g->n_layers; ++i) {
+		memcpy (saved, g->layers[i].nodes, g->layers[i].n_nodes * sizeof (RGraphNode *));
+		saved += g->layers[i].n_nodes;
+	}
+}
 
+static void restore_layers (const AGraph *g, RGraphNode **saved) {
+	int i, j;
+
+	for (i = 0; i < g->n_layers; ++i) {
+		for (j = 0; j < g->layers[i].n_nodes; ++j) {
+			g->layers[i].nodes[j] = *saved++;
+			get_anode (g->layers[i].nodes[j])->pos_in_layer = j;
+		}
+	}
+}
+
+static void sweep_layers (const AGraph *g, int from_up, RGraphNode **best) {
+	int i, cross_changed, cur, min = crossings (g), no_gain = 0;
+
+	save_layers (g, best);
 	do {
 		cross_changed = R_FALSE;
 
-		for (i = g->n_layers - 1; i >= 0; --i)
-			cross_changed |= layer_sweep (g->graph, g->layers, g->n_layers, i, R_FALSE);
-	} while (cross_changed);
+		if (from_up) {
+			for (i = 0; i < g->n_layers; ++i)
+				cross_changed |= layer_sweep (g->graph, g->layers, g->n_layers, i, R_TRUE);
+		} else {
+			for (i = g->n_layers - 1; i >= 0; --i)
+				cross_changed |= layer_sweep (g->graph, g->layers, g->n_layers, i, R_FALSE);
+		}
+		cur = crossings (g);
+		if (cur < min) {
+			min = cur;
+			no_gain = 0;
+			save_layers (g, best);
+		} else no_gain++;
+	} while (cross_changed && no_gain < MAX_SWEEPS_NO_GAIN);
+	restore_layers (g, best);
 }
 
-static int find_dist (const struct dist_t *a, const struct dist_t *b) {
-	return a->from == b->from && a->to == b->to ? 0 : 1;
+static void minimize_crossings (const AGraph *g) {
+	RGraphNode **best;
+	int i, n = 0;
+
+	for (i = 0; i < g->n_layers; ++i)
+		n += g->layers[i].n_nodes;
+	best = R_NEWS (RGraphNode *, n + 1);
+	if (!best) return;
+	sweep_layers (g, R_TRUE, best);
+	sweep_layers (g, R_FALSE, best);
+	free (best);
 }
 
-/* returns the distance between two nodes */
-/* if the distance between two nodes were explicitly set, returns that;
- * otherwise calculate the distance of two nodes on the same layer */
+/* returns the distance between two nodes on the same layer, using the
+ * distances explicitly set between consecutive nodes when there are */
 static int dist_nodes (const AGraph *g, const RGraphNode *a, const RGraphNode *b) {
-	struct dist_t d;
 	const ANode *aa, *ab;
-	RListIter *it;
-	int res = 0;
-
-	if (g->dists) {
-		d.from = a;
-		d.to = b;
-		it = r_list_find (g->dists, &d, (RListComparator)find_dist);
-		if (it) {
-			struct dist_t *old = (struct dist_t *)r_list_iter_get_data (it);
-			return old->dist;
-		}
-	}
+	int i, res = 0;
 
 	aa = get_anode (a);
 	ab = get_anode (b);
 	if (aa->layer == ab->layer) {
-		int i;
-
-		res = 0;
 		for (i = aa->pos_in_layer; i < ab->pos_in_layer; ++i) {
 			const RGraphNode *cur = g->layers[aa->layer].nodes[i];
 			const RGraphNode *next = g->layers[aa->layer].nodes[i + 1];
 			const ANode *anext = get_anode (next);
 			const ANode *acur = get_anode (cur);
-			int found = R_FALSE;
-
-			if (g->dists) {
-				d.from = cur;
-				d.to = next;
-				it = r_list_find (g->dists, &d, (RListComparator)find_dist);
-				if (it) {
-					struct dist_t *old = (struct dist_t *)r_list_iter_get_data (it);
-					res += old->dist;
-					found = R_TRUE;
-				}
-			}
 
-			if (!found) {
+			if (g->has_dists && acur->has_dist_right) {
+				res += acur->dist_right;
+			} else {
 				int space = acur->is_dummy && anext->is_dummy ? 1 : HORIZONTAL_NODE_SPACING;
 				res += acur->w / 2 + anext->w / 2 + space;
 			}
@@ -624,24 +662,18 @@ static int dist_nodes (const AGraph *g, const RGraphNode *a, const RGraphNode *b
 	return res;
 }
 
-/* explictly set the distance between two nodes on the same layer */
+/* explictly set the distance between two consecutive nodes on the same layer,
+ * the first distance set is the one that is kept */
 static void set_dist_nodes (const AGraph *g, int l, int cur, int next) {
-	struct dist_t *d;
-	const RGraphNode *vi, *vip;
-	const ANode *avi, *avip;
-
-	if (!g->dists) return;
-	d = R_NEW (struct dist_t);
+	ANode *avi, *avip;
 
-	vi = g->layers[l].nodes[cur];
-	vip = g->layers[l].nodes[next];
-	avi = get_anode (vi);
-	avip = get_anode (vip);
+	if (!g->has_dists) return;
 
-	d->from = vi;
-	d->to = vip;
-	d->dist = avip->x - avi->x;
-	r_list_push (g->dists, d);
+	avi = get_anode (g->layers[l].nodes[cur]);
+	avip = get_anode (g->layers[l].nodes[next]);
+	if (avi->has_dist_right) return;
+	avi->dist_right = avip->x - avi->x;
+	avi->has_dist_right = R_TRUE;
 }
 
 static int is_valid_pos (const AGraph *g, int l, int pos) {
@@ -652,19 +684,17 @@ static int is_valid_pos (const AGraph *g, int l, int pos) {
 /* if v is an original node, L(v) = { v }
  * if v is a dummy node, L(v) is the set of all the dummies node that belongs
  *      to the same long edge */
-static Sdb *compute_vertical_nodes (const AGraph *g) {
-	Sdb *res = sdb_new0 ();
+static void compute_vertical_nodes (const AGraph *g) {
 	int i, j;
 
 	for (i = 0; i < g->n_layers; ++i) {
 		for (j = 0; j < g->layers[i].n_nodes; ++j) {
 			RGraphNode *gn = g->layers[i].nodes[j];
-			const RList *Ln = hash_get_rlist (res, gn);
-			const ANode *an = get_anode (gn);
+			ANode *an = get_anode (gn);
 
-			if (!Ln) {
+			if (!an->vert) {
 				RList *vert = r_list_new ();
-				hash_set (res, gn, vert);
+				an->vert = vert;
 				if (an->is_dummy) {
 					RGraphNode *next = gn;
 					const ANode *anext = get_anode (next);
@@ -681,8 +711,17 @@ static Sdb *compute_vertical_nodes (const AGraph *g) {
 			}
 		}
 	}
+}
 
-	return res;
+static void free_vertical_nodes (const AGraph *g) {
+	const RGraphNode *gn;
+	const RListIter *it;
+	ANode *n;
+
+	graph_foreach_anode (r_graph_get_nodes (g->graph), it, gn, n) {
+		r_list_free (n->vert);
+		n->vert = NULL;
+	}
 }
 
 /* computes left or right classes, used to place dummies node */
@@ -690,7 +729,7 @@ static Sdb *compute_vertical_nodes (const AGraph *g) {
  * - v E C
  * - w E C => L(v) is a subset of C
  * - w E C, the s+(w) exists and is not in any class yet => s+(w) E C */
-static RList **compute_classes (const AGraph *g, Sdb *v_nodes, int is_left, int *n_classes) {
+static RList **compute_classes (const AGraph *g, int is_left, int *n_classes) {
 	int i, j, c;
 	RList **res = R_NEWS0 (RList *, g->n_layers);
 	RGraphNode *gn;
@@ -711,7 +750,7 @@ static RList **compute_classes (const AGraph *g, Sdb *v_nodes, int is_left, int
 			const ANode *aj = get_anode (gj);
 
 			if (aj->class == -1) {
-				const RList *laj = hash_get_rlist (v_nodes, gj);
+				const RList *laj = aj->vert;
 
 				if (!res[c])
 					res[c] = r_list_new ();
@@ -749,20 +788,20 @@ static RGraphNode *get_sibling (const AGraph *g, const ANode *n, int is_left, in
 }
 
 static int adjust_class_val (const AGraph *g, const RGraphNode *gn,
-							 const RGraphNode *sibl, Sdb *res, int is_left) {
+							 const RGraphNode *sibl, int is_left) {
 	if (is_left)
-		return hash_get_int (res, sibl) - hash_get_int (res, gn) - dist_nodes (g, gn, sibl);
+		return get_anode (sibl)->xminus - get_anode (gn)->xminus - dist_nodes (g, gn, sibl);
 	else
-		return hash_get_int (res, gn) - hash_get_int (res, sibl) - dist_nodes (g, sibl, gn);
+		return get_anode (gn)->xplus - get_anode (sibl)->xplus - dist_nodes (g, sibl, gn);
 }
 
 /* adjusts the position of previously placed left/right classes */
 /* tries to place classes as close as possible */
 static void adjust_class (const AGraph *g, int is_left,
-						  RList **classes, Sdb *res, int c) {
+						  RList **classes, int c) {
 	const RGraphNode *gn;
 	const RListIter *it;
-	const ANode *an;
+	ANode *an;
 	int dist, v, is_first = R_TRUE;
 
 	graph_foreach_anode (classes[c], it, gn, an) {
@@ -773,7 +812,7 @@ static void adjust_class (const AGraph *g, int is_left,
 		if (!sibling) continue;
 		sibl_anode = get_anode (sibling);
 		if (sibl_anode->class == c) continue;
-		v = adjust_class_val (g, gn, sibling, res, is_left);
+		v = adjust_class_val (g, gn, sibling, is_left);
 		dist = is_first ? v : R_MIN (dist, v);
 		is_first = R_FALSE;
 	}
@@ -806,18 +845,19 @@ static void adjust_class (const AGraph *g, int is_left,
 	}
 
 	graph_foreach_anode (classes[c], it, gn, an) {
-		int old_val = hash_get_int (res, gn);
-		int new_val = is_left ?  old_val + dist : old_val - dist;
-		hash_set (res, gn, new_val);
+		if (is_left)
+			an->xminus += dist;
+		else
+			an->xplus -= dist;
 	}
 }
 
 static int place_nodes_val (const AGraph *g, const RGraphNode *gn,
-							const RGraphNode *sibl, Sdb *res, int is_left) {
+							const RGraphNode *sibl, int is_left) {
 	if (is_left)
-		return hash_get_int (res, sibl) + dist_nodes (g, sibl, gn);
+		return get_anode (sibl)->xminus + dist_nodes (g, sibl, gn);
 	else
-		return hash_get_int (res, sibl) - dist_nodes (g, gn, sibl);
+		return get_anode (sibl)->xplus - dist_nodes (g, gn, sibl);
 }
 
 static int place_nodes_sel_p (int newval, int oldval, int is_first, int is_left) {
@@ -832,12 +872,12 @@ static int place_nodes_sel_p (int newval, int oldval, int is_first, int is_left)
 
 /* places left/right the nodes of a class */
 static void place_nodes (const AGraph *g, const RGraphNode *gn, int is_left,
-						 Sdb *v_nodes, RList **classes, Sdb *res, Sdb *placed) {
-	const RList *lv = hash_get_rlist (v_nodes, gn);
+						 RList **classes) {
+	const RList *lv = get_anode (gn)->vert;
 	int p, v, is_first = R_TRUE;
 	const RGraphNode *gk;
 	const RListIter *itk;
-	const ANode *ak;
+	ANode *ak;
 
 	graph_foreach_anode (lv, itk, gk, ak) {
 		const RGraphNode *sibling;
@@ -847,10 +887,10 @@ static void place_nodes (const AGraph *g, const RGraphNode *gn, int is_left,
 		if (!sibling) continue;
 		sibl_anode = get_anode (sibling);
 		if (ak->class == sibl_anode->class) {
-			if (!hash_get (placed, sibling))
-				place_nodes (g, sibling, is_left, v_nodes, classes, res, placed);
+			if (!sibl_anode->placed)
+				place_nodes (g, sibling, is_left, classes);
 
-			v = place_nodes_val (g, gk, sibling, res, is_left);
+			v = place_nodes_val (g, gk, sibling, is_left);
 			p = place_nodes_sel_p (v, p, is_first, is_left);
 			is_first = R_FALSE;
 		}
@@ -860,42 +900,49 @@ static void place_nodes (const AGraph *g, const RGraphNode *gn, int is_left,
 		p = is_left ? 0 : 50;
 
 	graph_foreach_anode (lv, itk, gk, ak) {
-		hash_set (res, gk, p);
-		hash_set (placed, gk, R_TRUE);
+		if (is_left)
+			ak->xminus = p;
+		else
+			ak->xplus = p;
+		ak->placed = R_TRUE;
 	}
 }
 
-/* computes the position to the left/right of all the nodes */
-static Sdb *compute_pos (const AGraph *g, int is_left, Sdb *v_nodes) {
-	Sdb *res, *placed;
+/* computes the position to the left/right of all the nodes, in xminus or
+ * xplus */
+static int compute_pos (const AGraph *g, int is_left) {
+	const RGraphNode *gn;
+	const RListIter *it;
 	RList **classes;
 	int n_classes, i;
+	ANode *n;
 
-	classes = compute_classes (g, v_nodes, is_left, &n_classes);
-	if (!classes) return NULL;
+	classes = compute_classes (g, is_left, &n_classes);
+	if (!classes) return R_FALSE;
 
-	res = sdb_new0 ();
-	placed = sdb_new0 ();
+	graph_foreach_anode (r_graph_get_nodes (g->graph), it, gn, n) {
+		n->placed = R_FALSE;
+		if (is_left)
+			n->xminus = 0;
+		else
+			n->xplus = 0;
+	}
 	for (i = 0; i < n_classes; ++i) {
-		const RGraphNode *gn;
-		const RListIter *it;
-
 		r_list_foreach (classes[i], it, gn) {
-			if (!hash_get_rnode (placed, gn)) {
-				place_nodes (g, gn, is_left, v_nodes, classes, res, placed);
+			if (!get_anode (gn)->placed) {
+				place_nodes (g, gn, is_left, classes);
 			}
 		}
 
-		adjust_class (g, is_left, classes, res, i);
+		adjust_class (g, is_left, classes, i);
 	}
 
-	sdb_free (placed);
 	for (i = 0; i < n_classes; ++i) {
 		if (classes[i])
 			r_list_free (classes[i]);
 	}
 	free (classes);
-	return res;
+	return R_TRUE;
 }
 
 /* calculates position of all nodes, but in particular dummies nodes */
@@ -903,28 +950,18 @@ static Sdb *compute_pos (const AGraph *g, int is_left, Sdb *v_nodes) {
  * position of each node to the average of the values in the two placements */
 static void place_dummies (const AGraph *g) {
 	const RList *nodes;
-	Sdb *xminus, *xplus, *vertical_nodes;
 	const RGraphNode *gn;
 	const RListIter *it;
 	ANode *n;
 
-	vertical_nodes = compute_vertical_nodes (g);
-	if (!vertical_nodes) return;
-	xminus = compute_pos (g, R_TRUE, vertical_nodes);
-	if (!xminus) goto xminus_err;
-	xplus = compute_pos (g, R_FALSE, vertical_nodes);
-	if (!xplus) goto xplus_err;
-
-	nodes = r_graph_get_nodes (g->graph);
-	graph_foreach_anode (nodes, it, gn, n) {
-		n->x = (hash_get_int (xminus, gn) + hash_get_int (xplus, gn)) / 2;
+	compute_vertical_nodes (g);
+	if (compute_pos (g, R_TRUE) && compute_pos (g, R_FALSE)) {
+		nodes = r_graph_get_nodes (g->graph);
+		graph_foreach_anode (nodes, it, gn, n) {
+			n->x = (n->xminus + n->xplus) / 2;
+		}
 	}
-
-	sdb_free (xplus);
-xplus_err:
-	sdb_free (xminus);
-xminus_err:
-	sdb_free (vertical_nodes);
+	free_vertical_nodes (g);
 }
 
 static RGraphNode *get_right_dummy (const AGraph *g, const RGraphNode *n) {
@@ -962,9 +999,9 @@ static int all_reversed_right (const AGraph *g, const RGraphNode *n) {
 	return R_TRUE;
 }
 
-static void adjust_directions (const AGraph *g, int i, int from_up, Sdb *D, Sdb *P) {
+static void adjust_directions (const AGraph *g, int i, int from_up) {
 	const RGraphNode *vm = NULL, *wm = NULL;
-	const ANode *vma = NULL, *wma = NULL;
+	ANode *vma = NULL, *wma = NULL;
 	int j, d = from_up ? 1 : -1;
 
 	if (i + d < 0 || i + d >= g->n_layers) return;
@@ -975,14 +1012,14 @@ static void adjust_directions (const AGraph *g, int i, int from_up, Sdb *D, Sdb
 
 		if (!vpa->is_dummy) continue;
 		if (from_up)
-			wp = r_list_get_n (r_graph_innodes (g->graph, vp), 0);
+			wp = r_graph_nth_innode (g->graph, vp, 0);
 		else
 			wp = r_graph_nth_neighbour (g->graph, vp, 0);
 		wpa = get_anode (wp);
 		if (!wpa->is_dummy) continue;
 
 		if (vm) {
-			int p = hash_get_int (P, wm);
+			int p = wma->dir_eq;
 			int k;
 
 			for (k = wma->pos_in_layer + 1; k < wpa->pos_in_layer; ++k) {
@@ -990,16 +1027,16 @@ static void adjust_directions (const AGraph *g, int i, int from_up, Sdb *D, Sdb
 				const ANode *aw = get_anode (w);
 
 				if (aw->is_dummy)
-					p &= hash_get_int (P, w);
+					p &= aw->dir_eq;
 			}
 			if (p) {
-				hash_set (D, vm, from_up);
+				vma->dir = from_up;
 				for (k = vma->pos_in_layer + 1; k < vpa->pos_in_layer; ++k) {
 					const RGraphNode *v = g->layers[vma->layer].nodes[k];
-					const ANode *av = get_anode (v);
+					ANode *av = get_anode (v);
 
 					if (av->is_dummy)
-						hash_set (D, v, from_up);
+						av->dir = from_up;
 				}
 			}
 		}
@@ -1237,7 +1274,7 @@ static void shift_right_dummies (const AGraph *g, int l, int right_pos) {
 				while (vj && aj && aj->is_dummy && aj->is_reversed) {
 					aj->x = newv;
 
-					vj = r_list_get_n (r_graph_innodes (g->graph, vj), 0);
+					vj = r_graph_nth_innode (g->graph, vj, 0);
 					aj = get_anode (vj);
 				}
 
@@ -1257,7 +1294,7 @@ static void shift_right_dummies (const AGraph *g, int l, int right_pos) {
 /* finds the placements of nodes while traversing the graph in the given
  * direction */
 /* places all the sequences of consecutive original nodes in each layer. */
-static void original_traverse_l (const AGraph *g, Sdb *D, Sdb *P, int from_up) {
+static void original_traverse_l (const AGraph *g, int from_up) {
 	int i, k, va, vr;
 
 	for (i = from_up ? 0 : g->n_layers - 1;
@@ -1265,12 +1302,12 @@ static void original_traverse_l (const AGraph *g, Sdb *D, Sdb *P, int from_up) {
 		i = from_up ? i + 1 : i - 1) {
 		int j;
 		const RGraphNode *bm = NULL;
-		const ANode *bma = NULL;
+		ANode *bma = NULL;
 
 		j = 0;
 		while (j < g->layers[i].n_nodes && !bm) {
 			const RGraphNode *gn = g->layers[i].nodes[j];
-			const ANode *an = get_anode (gn);
+			ANode *an = get_anode (gn);
 
 			if (an->is_dummy) {
 				va = 0;
@@ -1309,19 +1346,19 @@ static void original_traverse_l (const AGraph *g, Sdb *D, Sdb *P, int from_up) {
 				if (is_valid_pos (g, i, va))
 					set_dist_nodes (g, i, bma->pos_in_layer, va);
 				shift_right_dummies (g, i, vr - 1);
-			} else if (hash_get_int (D, bm) == from_up) {
+			} else if (bma->dir == from_up) {
 				bpa = get_anode (bp);
 				va = bma->pos_in_layer + 1;
 				vr = bpa->pos_in_layer;
 				place_sequence (g, i, bm, bp, from_up, va, vr);
-				hash_set (P, bm, R_TRUE);
+				bma->dir_eq = R_TRUE;
 				shift_right_dummies (g, i, vr - 1);
 			}
 
 			bm = bp;
 		}
 
-		adjust_directions (g, i, from_up, D, P);
+		adjust_directions (g, i, from_up);
 	}
 }
 
@@ -1330,15 +1367,15 @@ static void original_traverse_l (const AGraph *g, Sdb *D, Sdb *P, int from_up) {
 /* set the node placements traversing the graph downward and then upward */
 static void place_original (AGraph *g) {
 	const RList *nodes = r_graph_get_nodes (g->graph);
-	Sdb *D, *P;
 	const RGraphNode *gn;
 	const RListIter *itn;
-	const ANode *an;
+	ANode *an;
 
-	D = sdb_new0 ();
-	P = sdb_new0 ();
-	g->dists = r_list_new ();
-	g->dists->free = (RListFree)free;
+	graph_foreach_anode (nodes, itn, gn, an) {
+		an->dir = an->dir_eq = 0;
+		an->has_dist_right = R_FALSE;
+	}
+	g->has_dists = R_TRUE;
 
 	graph_foreach_anode (nodes, itn, gn, an) {
 		if (!an->is_dummy) continue;
@@ -1346,19 +1383,14 @@ static void place_original (AGraph *g) {
 		if (right_v) {
 			const ANode *right = get_anode (right_v);
 
-			hash_set (D, gn, 0);
-			int dt_eq = right->x - an->x == dist_nodes (g, gn, right_v);
-			hash_set (P, gn, dt_eq);
+			an->dir_eq = right->x - an->x == dist_nodes (g, gn, right_v);
 		}
 	}
 
-	original_traverse_l (g, D, P, R_TRUE);
-	original_traverse_l (g, D, P, R_FALSE);
+	original_traverse_l (g, R_TRUE);
+	original_traverse_l (g, R_FALSE);
 
-	r_list_free (g->dists);
-	g->dists = NULL;
-	sdb_free (P);
-	sdb_free (D);
+	g->has_dists = R_FALSE;
 }
 
 static void restore_original_edges (const AGraph *g) {
@@ -1401,8 +1433,14 @@ static void remove_dummy_nodes (const AGraph *g) {
  * 5) assign x and y coordinates to each node
  * 6) restore the original graph, with long edges and cycles */
 static void set_layout_bb(AGraph *g) {
+	const RGraphNode *gn;
+	const RListIter *it;
+	ANode *n;
 	int i, j, k;
 
+	graph_foreach_anode (r_graph_get_nodes (g->graph), it, gn, n) {
+		n->layer_parent = NULL;
+	}
 	remove_cycles (g);
 	assign_layers (g);
 	create_dummy_nodes (g);
@@ -1413,7 +1451,7 @@ static void set_layout_bb(AGraph *g) {
 	for (i = 0; i < g->n_layers; i++) {
 		int rh = 0;
 		for (j = 0; j < g->layers[i].n_nodes; ++j) {
-			const ANode *n = get_anode (g->layers[i].nodes[j]);
+			n = get_anode (g->layers[i].nodes[j]);
 			if (n->h > rh)
 				rh = n->h;
 		}
@@ -1429,7 +1467,7 @@ static void set_layout_bb(AGraph *g) {
 	/* vertical align */
 	for (i = 0; i < g->n_layers; ++i) {
 		for (j = 0; j < g->layers[i].n_nodes; ++j) {
-			ANode *n = get_anode (g->layers[i].nodes[j]);
+			n = get_anode (g->layers[i].nodes[j]);
 			n->y = 1;
 			for (k = 0; k < n->layer; ++k) {
 				n->y += g->layers[k].height + VERTICAL_NODE_SPACING;
@@ -1440,7 +1478,7 @@ static void set_layout_bb(AGraph *g) {
 	/* finalize x coordinate */
 	for (i = 0; i < g->n_layers; ++i) {
 		for (j = 0; j < g->layers[i].n_nodes; ++j) {
-			ANode *n = get_anode (g->layers[i].nodes[j]);
+			n = get_anode (g->layers[i].nodes[j]);
 			n->x -= n->w / 2;
 		}
 	}
@@ -1708,11 +1746,113 @@ static void update_graph_sizes (AGraph *g) {
 	g->h = max_y - g->y;
 }
 
+static ut64 layout_hash (const AGraph *g) {
+	const RGraphNode *gn, *gk;
+	const RListIter *it, *itk;
+	const ANode *an, *ak;
+	ut64 h = 0xcbf29ce484222325ULL;
+#define H(x) h = (h ^ (ut64)(x)) * 0x100000001b3ULL
+
+	graph_foreach_anode (r_graph_get_nodes (g->graph), it, gn, an) {
+		H (an->addr);
+		H (an->w);
+		H (an->h);
+		graph_foreach_anode (r_graph_get_neighbours (g->graph, gn), itk, gk, ak) {
+			H (ak->addr);
+		}
+		H (UT64_MAX);
+	}
+#undef H
+	return h;
+}
+
+static void layout_free (struct layout_t *l) {
+	free (l->addr);
+	free (l->xy);
+	free (l);
+}
+
+/* a hash collision must not move the nodes of another graph */
+static int layout_match (const AGraph *g, const struct layout_t *l, ut64 hash) {
+	const RGraphNode *gn;
+	const RListIter *it;
+	const ANode *an;
+	int i = 0;
+
+	if (l->hash != hash || l->n_nodes != g->graph->n_nodes)
+		return R_FALSE;
+	graph_foreach_anode (r_graph_get_nodes (g->graph), it, gn, an) {
+		if (l->addr[i++] != an->addr)
+			return R_FALSE;
+	}
+	return R_TRUE;
+}
+
+static int layout_cache_get (const AGraph *g, ut64 hash) {
+	const struct layout_t *l;
+	const RGraphNode *gn;
+	const RListIter *it;
+	ANode *an;
+	int i = 0;
+
+	if (!g->core->graph_layouts)
+		return R_FALSE;
+	r_list_foreach (g->core->graph_layouts, it, l) {
+		if (layout_match (g, l, hash))
+			break;
+	}
+	if (!it) return R_FALSE;
+	graph_foreach_anode (r_graph_get_nodes (g->graph), it, gn, an) {
+		an->x = l->xy[i++];
+		an->y = l->xy[i++];
+	}
+	return R_TRUE;
+}
+
+static void layout_cache_set (const AGraph *g, ut64 hash) {
+	RCore *core = g->core;
+	struct layout_t *l = R_NEW (struct layout_t);
+	const RGraphNode *gn;
+	const RListIter *it;
+	const ANode *an;
+	int i = 0;
+
+	if (!l) return;
+	l->hash = hash;
+	l->n_nodes = g->graph->n_nodes;
+	l->addr = R_NEWS (ut64, l->n_nodes);
+	l->xy = R_NEWS (int, 2 * l->n_nodes);
+	if (!l->addr || !l->xy) {
+		layout_free (l);
+		return;
+	}
+	graph_foreach_anode (r_graph_get_nodes (g->graph), it, gn, an) {
+		l->addr[i / 2] = an->addr;
+		l->xy[i++] = an->x;
+		l->xy[i++] = an->y;
+	}
+	if (!core->graph_layouts)
+		core->graph_layouts = r_list_newf ((RListFree)layout_free);
+	if (!core->graph_layouts) {
+		layout_free (l);
+		return;
+	}
+	r_list_prepend (core->graph_layouts, l);
+	if (r_list_length (core->graph_layouts) > LAYOUT_CACHE_SIZE)
+		layout_free (r_list_pop (core->graph_layouts));
+}
+
 static void agraph_set_layout(AGraph *g) {
-	if (g->is_callgraph)
+	if (g->is_callgraph) {
 		set_layout_callgraph(g);
-	else
-		set_layout_bb(g);
+	} else {
+		/* the layout only depends on the blocks, their edges and sizes */
+		ut64 hash = layout_hash (g);
+		if (!layout_cache_get (g, hash)) {
+			set_layout_bb(g);
+			layout_cache_set (g, hash);
+		}
+	}
 
 	g->curnode = find_near_of (g, NULL, R_TRUE);
 	update_graph_sizes (g);
@@ -2001,6 +2141,56 @@ static AGraph *agraph_new(RCore *core, RConsCanvas *can, RAnalFunction *fcn) {
 	return g;
 }
 
+/* run the basic block layout of the visual graph over any graph. wh has
+ * the width and height of the node with index i at wh[2*i], wh[2*i+1],
+ * and its position is stored the same way in xy. used by core/t */
+R_API int r_core_graph_layout(RGraph *graph, const int *wh, int *xy) {
+	AGraph g = { 0 };
+	const RList *nodes = r_graph_get_nodes (graph);
+	RGraphNode *gn;
+	RListIter *it = NULL;
+	void **data;
+	ANode *n;
+	int i = 0, saved, ret = R_FALSE;
+
+	if (!graph || !wh || !xy)
+		return R_FALSE;
+	if (!graph->n_nodes)
+		return R_TRUE;
+	if (!(data = R_NEWS (void *, graph->n_nodes)))
+		return R_FALSE;
+	r_list_foreach (nodes, it, gn) {
+		data[i++] = gn->data;
+		if (!(n = ascii_node_new (R_FALSE))) {
+			gn->data = NULL;
+			break;
+		}
+		n->addr = gn->idx;
+		n->w = wh[2 * gn->idx];
+		n->h = wh[2 * gn->idx + 1];
+		gn->data = n;
+	}
+	if (!it) {
+		g.graph = graph;
+		set_layout_bb (&g);
+		ret = R_TRUE;
+	}
+	saved = i;
+	i = 0;
+	r_list_foreach (nodes, it, gn) {
+		if (i == saved)
+			break;
+		if ((n = gn->data)) {
+			xy[2 * gn->idx] = n->x;
+			xy[2 * gn->idx + 1] = n->y;
+			free (n);
+		}
+		gn->data = data[i++];
+	}
+	free (data);
+	return ret;
+}
+
 R_API int r_core_visual_graph(RCore *core, RAnalFunction *_fcn, int is_interactive) {
 	int exit_graph = R_FALSE, is_error = R_FALSE;
 	struct agraph_refresh_data *grd;
@@ -294,6 +294,8 @@ R_API int r_core_write_at(RCore *core, ut64 addr, const ut8 *buf, int size) {
 		ret = r_io_write_at (core->io, addr, buf, size);
 		if (addr >= core->offset && addr <= core->offset+core->blocksize)
 			r_core_block_read (core, 0);
+		/* some anal plugins read past the bytes they are given */
+		r_anal_opcache_flush (core->anal);
 	}
 	return (ret==-1)? R_FALSE: R_TRUE;
 }
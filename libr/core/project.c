@@ -159,10 +159,71 @@ R_API int r_core_project_delete(RCore *core, const char *prjfile) {
 	return 0;
 }
 
+/* the same analysis as anal.r2ac written as r2 commands, only when the
+ * cache cannot be written */
+static int r_core_project_save_script(RCore *core, const char *prj) {
+	char *path = r_str_newf ("%s.d"R_SYS_DIR"anal.r2", prj);
+	int fd, fdold, tmp;
+	fd = path? r_sandbox_open (path, O_BINARY|O_RDWR|O_CREAT|O_TRUNC, 0644): -1;
+	if (fd == -1) {
+		eprintf ("Cannot open '%s' for writing\n", path);
+		free (path);
+		return R_FALSE;
+	}
+	free (path);
+	fdold = r_cons_singleton ()->fdout;
+	r_cons_singleton ()->fdout = fd;
+	r_cons_singleton ()->is_interactive = R_FALSE;
+	r_str_write (fd, "# flags\n");
+	tmp = core->flags->space_idx;
+	core->flags->space_idx = -1;
+	r_flag_list (core->flags, R_TRUE, NULL);
+	core->flags->space_idx = tmp;
+	r_cons_flush ();
+	r_str_write (fd, "# meta\n");
+	r_meta_list (core->anal, R_META_TYPE_ANY, 1);
+	r_cons_flush ();
+	r_core_cmd (core, "ax*", 0);
+	r_cons_flush ();
+	r_core_cmd (core, "afl*", 0);
+	r_cons_flush ();
+	r_core_cmd (core, "ah*", 0);
+	r_cons_flush ();
+	close (fd);
+	r_cons_singleton ()->fdout = fdold;
+	r_cons_singleton ()->is_interactive = R_TRUE;
+	return R_TRUE;
+}
+
+static void r_core_project_load_anal(RCore *core, const char *prj, const char *prjfile) {
+	char *anal = r_str_newf ("%s.d"R_SYS_DIR"anal.r2ac", prj);
+	char *script = r_str_newf ("%s.d"R_SYS_DIR"anal.r2", prj);
+	if (anal && r_file_exists (anal)) {
+		if (r_core_anal_cache_load (core, anal))
+			goto beach;
+		eprintf ("Cannot load analysis from '%s'\n", anal);
+		/* drop what the cache loaded before failing */
+		r_anal_purge (core->anal);
+	}
+	if (script && r_file_exists (script)) {
+		/* the script has every flag, not only the analysis ones */
+		r_flag_unset_all (core->flags);
+		r_core_cmd_file (core, script);
+	} else {
+		/* projects saved as commands keep the xrefs in a separate sdb */
+		r_anal_project_load (core->anal, prjfile);
+	}
+beach:
+	free (anal);
+	free (script);
+}
+
 R_API int r_core_project_open(RCore *core, const char *prjfile) {
 	int askuser = 1;
 	int ret, close_current_session = 1;
+	int timing = r_config_get_i (core->config, "cfg.timing");
 	char *prj, *filepath;
+	ut64 t0;
 	if (!prjfile || !*prjfile)
 		return R_FALSE;
 	prj = r_core_project_file (core, prjfile);
@@ -223,8 +284,11 @@ R_API int r_core_project_open(RCore *core, const char *prjfile) {
 		// TODO: handle base address
 		r_core_bin_load (core, filepath, UT64_MAX);
 	}
+	t0 = r_sys_now ();
 	ret = r_core_cmd_file (core, prj);
-	r_anal_project_load (core->anal, prjfile);
+	if (timing)
+		eprintf ("script   %8"PFMT64d" us\n", r_sys_now () - t0);
+	r_core_project_load_anal (core, prj, prjfile);
 	r_core_cmd0 (core, "s entry0");
 	free (filepath);
 	free (prj);
@@ -272,8 +336,8 @@ R_API char *r_core_project_info(RCore *core, const char *prjfile) {
 }
 
 R_API int r_core_project_save(RCore *core, const char *file) {
-	int fd, fdold, tmp, ret = R_TRUE;
-	char *prj;
+	int fd, fdold, ret = R_TRUE, save_script = R_TRUE;
+	char *prj, *anal, *script;
 
 	if (file == NULL || *file == '\0')
 		return R_FALSE;
@@ -289,19 +353,12 @@ R_API int r_core_project_save(RCore *core, const char *file) {
 		return R_FALSE;
 	}
 	r_core_project_init (core);
-	r_anal_project_save (core->anal, prj);
 	fd = r_sandbox_open (prj, O_BINARY|O_RDWR|O_CREAT|O_TRUNC, 0644);
 	if (fd != -1) {
 		fdold = r_cons_singleton ()->fdout;
 		r_cons_singleton ()->fdout = fd;
 		r_cons_singleton ()->is_interactive = R_FALSE;
 		r_str_write (fd, "# r2 rdb project file\n");
-		r_str_write (fd, "# flags\n");
-		tmp = core->flags->space_idx;
-		core->flags->space_idx = -1;
-		r_flag_list (core->flags, R_TRUE, NULL);
-		core->flags->space_idx = tmp;
-		r_cons_flush ();
 		r_str_write (fd, "# eval\n");
 		// TODO: r_str_writef (fd, "e asm.arch=%s", r_config_get ("asm.arch"));
 		r_config_list (core->config, NULL, R_TRUE);
@@ -309,27 +366,25 @@ R_API int r_core_project_save(RCore *core, const char *file) {
 		r_str_write (fd, "# sections\n");
 		r_io_section_list (core->io, core->offset, 1);
 		r_cons_flush ();
-		r_str_write (fd, "# meta\n");
-		r_meta_list (core->anal, R_META_TYPE_ANY, 1);
-		r_cons_flush ();
-		 {
-			char buf[1024];
-			snprintf (buf, sizeof (buf), "%s.d"R_SYS_DIR"xrefs", prj);
-			sdb_file (core->anal->sdb_xrefs, buf);
-			sdb_sync (core->anal->sdb_xrefs);
-		 }
-		r_core_cmd (core, "ax*", 0);
-		r_cons_flush ();
-		r_core_cmd (core, "afl*", 0);
-		r_cons_flush ();
-		r_core_cmd (core, "ah*", 0);
-		r_cons_flush ();
+		/* functions, flags, meta, hints and xrefs are loaded in bulk */
+		anal = r_str_newf ("%s.d"R_SYS_DIR"anal.r2ac", prj);
+		script = r_str_newf ("%s.d"R_SYS_DIR"anal.r2", prj);
+		if (anal && r_core_anal_cache_save (core, anal)) {
+			/* an older script would be replayed if the cache is rejected */
+			if (script && r_file_exists (script))
+				r_file_rm (script);
+			save_script = R_FALSE;
+		}
+		free (anal);
+		free (script);
 		r_cons_printf ("# seek\n"
 			"s 0x%08"PFMT64x"\n", core->offset);
 		r_cons_flush ();
 		close (fd);
 		r_cons_singleton ()->fdout = fdold;
 		r_cons_singleton ()->is_interactive = R_TRUE;
+		if (save_script && !r_core_project_save_script (core, prj))
+			ret = R_FALSE;
 	} else {
 		eprintf ("Cannot open '%s' for writing\n", prj);
 		ret = R_FALSE;
@@ -0,0 +1,83 @@
+/* basic block layout of the visual graph on generated CFG-like graphs
+ * of growing size */
+
+#include <r_core.h>
+
+/* fallthrough edges, a forward jump every other node and a loop back
+ * every sixteenth, like the blocks of a big function */
+static RGraph *cfg_new(int nn, int *wh) {
+	RGraph *g = r_graph_new ();
+	int i, j;
+	if (!g) return NULL;
+	for (i = 0; i < nn; i++) {
+		r_graph_add_node (g, NULL);
+		wh[2 * i] = 20 + rand () % 40;
+		wh[2 * i + 1] = 3 + rand () % 16;
+	}
+	for (i = 0; i < nn - 1; i++) {
+		r_graph_add_edge (g, r_graph_get_node (g, i), r_graph_get_node (g, i + 1));
+		if (i & 1) {
+			j = R_MIN (i + 2 + rand () % 32, nn - 1);
+			r_graph_add_edge (g, r_graph_get_node (g, i), r_graph_get_node (g, j));
+		}
+		if (!(i % 16) && i > 8)
+			r_graph_add_edge (g, r_graph_get_node (g, i), r_graph_get_node (g, i - 1 - rand () % 8));
+	}
+	return g;
+}
+
+/* edges within a row and overlapping boxes in a row. the layering
+ * does not avoid them on every graph, so they are reported */
+static void check_layout(RGraph *g, const int *wh, const int *xy, int *flat, int *overlaps) {
+	RGraphNode *n, *m;
+	int i, k;
+	*flat = *overlaps = 0;
+	r_graph_foreach_node (g, i, n) {
+		r_graph_foreach_out (n, k, m) {
+			if (xy[2 * m->idx + 1] == xy[2 * n->idx + 1])
+				(*flat)++;
+		}
+	}
+	r_graph_foreach_node (g, i, n) {
+		r_graph_foreach_node (g, k, m) {
+			if (k <= i || xy[2 * i + 1] != xy[2 * k + 1])
+				continue;
+			if (xy[2 * i] < xy[2 * k] + wh[2 * k] && xy[2 * k] < xy[2 * i] + wh[2 * i])
+				(*overlaps)++;
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	int max = argc > 1? atoi (argv[1]): 2000;
+	int nn, n_edges, flat, overlaps, fail = 0;
+	int *wh = malloc (2 * max * sizeof (int));
+	int *xy = malloc (2 * max * sizeof (int));
+	RGraph *g;
+	ut64 t0;
+
+	if (!wh || !xy)
+		return 1;
+	srand (1337);
+	for (nn = 250; nn <= max; nn *= 2) {
+		if (!(g = cfg_new (nn, wh)))
+			return 1;
+		n_edges = g->n_edges;
+		t0 = r_sys_now ();
+		if (!r_core_graph_layout (g, wh, xy))
+			fail++;
+		t0 = r_sys_now () - t0;
+		if (g->n_nodes != nn || g->n_edges != n_edges) {
+			printf ("[-] the layout did not restore the graph\n");
+			fail++;
+		}
+		check_layout (g, wh, xy, &flat, &overlaps);
+		printf ("%6d nodes, %6d edges: layout %.3f ms (%d edges in a row, "
+			"%d overlaps)\n", nn, n_edges, (double)t0 / 1000, flat, overlaps);
+		r_graph_free (g);
+	}
+	printf ("%s\n", fail? "[-] failed": "[+] ok");
+	free (wh);
+	free (xy);
+	return fail? 1: 0;
+}
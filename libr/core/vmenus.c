@@ -549,49 +549,35 @@ R_API int r_core_visual_comments (RCore *core) {
 	int format = 0;
 	int found = 0;
 	ut64 from = 0, size = 0;
+	RAnalMetaItem *mi;
+	RListIter *iter;
+	RList *list;
 
 	for (;;) {
 		r_cons_clear00 ();
 		r_cons_strcat ("Comments:\n");
 		i = 0;
 		found = 0;
-#undef DB
-#define DB core->anal->sdb_meta
-				ut64 addr;
-				char key[128];
-				const char *val, *comma = NULL;
-				char *list = sdb_get (DB, "meta.C", 0);
-				char *str, *next, *cur = list;
-				if (list) {
-					for (i=0; ;i++) {
-						cur = sdb_anext (cur, &next);
-						addr = sdb_atoi (cur);
-						snprintf (key, sizeof (key)-1, "meta.C.0x%08"PFMT64x, addr);
-						val = sdb_const_get (DB, key, 0);
-						if (val)
-							comma = strchr (val, ',');
-						if (comma) {
-							str = (char *)sdb_decode (comma+1, 0);
-							if ((i>=option-delta) && ((i<option+delta)||((option<delta)&&(i<(delta<<1))))) {
-								r_str_sanitize (str);
-								if (option==i) {
-									found = 1;
-									from = addr;
-									size = 1; // XXX: remove this thing size for comments is useless d->size;
-									free (p);
-									p = str;
-									r_cons_printf ("  >  %s\n", str);
-								} else {
-									r_cons_printf ("     %s\n", str);
-									free (str);
-								}
-							} else free (str);
-						}
-						if (!next)
-							break;
-						cur = next;
-					}
+		list = r_meta_enumerate (core->anal, R_META_TYPE_COMMENT);
+		r_list_foreach (list, iter, mi) {
+			if ((i>=option-delta) && ((i<option+delta)||((option<delta)&&(i<(delta<<1))))) {
+				char *str = strdup (mi->str? mi->str: "");
+				r_str_sanitize (str);
+				if (option==i) {
+					found = 1;
+					from = mi->from;
+					size = 1; // XXX: remove this thing size for comments is useless d->size;
+					free (p);
+					p = str;
+					r_cons_printf ("  >  %s\n", str);
+				} else {
+					r_cons_printf ("     %s\n", str);
+					free (str);
 				}
+			}
+			i++;
+		}
+		r_list_free (list);
 
 		if (!found) {
 			option--;
@@ -129,7 +129,8 @@ eprintf ("XWJSTEP TOFALSE\n");
 			RIOGdb *g = d->data;
 			support_sw_bp = UNKNOWN;
 			support_hw_bp = UNKNOWN;
-			if (( desc = &g->desc ))
+			desc = &g->desc;
+			desc->big_endian = dbg->anal->big_endian;
 			switch (dbg->arch) {
 			case R_SYS_ARCH_X86:
 				if (dbg->anal->bits == 16 || dbg->anal->bits == 32) {
@@ -0,0 +1,159 @@
+/* radare - LGPL - Copyright 2015 - pancake */
+
+#include <r_fs.h>
+
+R_API RFSCache *r_fs_cache_new(int bsize, int size) {
+	RFSCache *c;
+	if (bsize < 1 || size < 1)
+		return NULL;
+	c = R_NEW0 (RFSCache);
+	if (!c) return NULL;
+	c->bsize = bsize;
+	c->size = size;
+	c->ht = r_hashtable64_new ();
+	c->lock = r_th_lock_new ();
+	c->iolock = r_th_lock_new ();
+	if (!c->ht || !c->lock || !c->iolock) {
+		r_fs_cache_free (c);
+		return NULL;
+	}
+	return c;
+}
+
+static void cache_clear(RFSCache *c) {
+	RFSCacheBlock *b, *next;
+	for (b = c->head; b; b = next) {
+		next = b->next;
+		r_hashtable64_remove (c->ht, b->blk);
+		free (b->buf);
+		free (b);
+	}
+	c->head = c->tail = NULL;
+	c->count = 0;
+}
+
+/* drop every block, the reads in flight will not insert theirs */
+R_API void r_fs_cache_reset(RFSCache *c) {
+	if (!c) return;
+	r_th_lock_enter (c->lock);
+	cache_clear (c);
+	c->gen++;
+	r_th_lock_leave (c->lock);
+}
+
+R_API void r_fs_cache_free(RFSCache *c) {
+	if (!c) return;
+	cache_clear (c);
+	r_hashtable64_free (c->ht);
+	r_th_lock_free (c->lock);
+	r_th_lock_free (c->iolock);
+	free (c);
+}
+
+static void cache_unlink(RFSCache *c, RFSCacheBlock *b) {
+	if (b->prev) b->prev->next = b->next;
+	else c->head = b->next;
+	if (b->next) b->next->prev = b->prev;
+	else c->tail = b->prev;
+	b->prev = b->next = NULL;
+}
+
+static void cache_push(RFSCache *c, RFSCacheBlock *b) {
+	b->prev = NULL;
+	b->next = c->head;
+	if (c->head) c->head->prev = b;
+	else c->tail = b;
+	c->head = b;
+}
+
+/* RIO seeks and reads in two steps, so only one worker can be inside */
+static int cache_io_read(RFSCache *c, RIOBind *iob, ut64 addr, ut8 *buf, int len) {
+	int ret;
+	r_th_lock_enter (c->iolock);
+	ret = iob->read_at (iob->io, addr, buf, len);
+	r_th_lock_leave (c->iolock);
+	return ret;
+}
+
+/* keep buf as the contents of blk, recycling the least recently used
+ * block when full. called with the lock held */
+static void cache_insert(RFSCache *c, ut64 blk, ut8 *buf) {
+	RFSCacheBlock *b;
+	if (c->count < c->size) {
+		if (!(b = R_NEW0 (RFSCacheBlock))) {
+			free (buf);
+			return;
+		}
+		c->count++;
+	} else {
+		b = c->tail;
+		cache_unlink (c, b);
+		r_hashtable64_remove (c->ht, b->blk);
+		free (b->buf);
+	}
+	b->blk = blk;
+	b->buf = buf;
+	r_hashtable64_insert (c->ht, blk, b);
+	cache_push (c, b);
+}
+
+/* copy len bytes at off of block blk. a missing block is read without
+ * holding the lock, so the other workers keep hitting the cache */
+static int cache_copy(RFSCache *c, RIOBind *iob, ut64 blk, int off, ut8 *out, int len) {
+	RFSCacheBlock *b;
+	ut32 gen;
+	ut8 *buf;
+
+	r_th_lock_enter (c->lock);
+	if ((b = r_hashtable64_lookup (c->ht, blk))) {
+		c->hits++;
+		if (b != c->head) {
+			cache_unlink (c, b);
+			cache_push (c, b);
+		}
+		memcpy (out, b->buf + off, len);
+		r_th_lock_leave (c->lock);
+		return R_TRUE;
+	}
+	c->misses++;
+	gen = c->gen;
+	r_th_lock_leave (c->lock);
+
+	if (!(buf = malloc (c->bsize)))
+		return R_FALSE;
+	if (cache_io_read (c, iob, blk * c->bsize, buf, c->bsize) == -1) {
+		free (buf);
+		return R_FALSE;
+	}
+	memcpy (out, buf + off, len);
+	r_th_lock_enter (c->lock);
+	/* another worker read it meanwhile, or it was written since */
+	if (gen != c->gen || r_hashtable64_lookup (c->ht, blk))
+		free (buf);
+	else cache_insert (c, blk, buf);
+	r_th_lock_leave (c->lock);
+	return R_TRUE;
+}
+
+/* reads at least a quarter of the cache long go straight to the io,
+ * so the metadata blocks are not evicted by the contents of big files */
+R_API int r_fs_cache_read(RFSCache *c, RIOBind *iob, ut64 addr, ut8 *buf, int len) {
+	int n, off, ret = len;
+
+	if (len < 1)
+		return 0;
+	if (!c)
+		return iob->read_at (iob->io, addr, buf, len);
+	if (len >= c->bsize * (c->size / 4))
+		return cache_io_read (c, iob, addr, buf, len);
+	while (len > 0) {
+		off = (int)(addr % c->bsize);
+		n = R_MIN (len, c->bsize - off);
+		if (!cache_copy (c, iob, addr / c->bsize, off, buf, n))
+			return -1;
+		addr += n;
+		buf += n;
+		len -= n;
+	}
+	return ret;
+}
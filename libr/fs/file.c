@@ -19,7 +19,8 @@ R_API void r_fs_file_free (RFSFile *file) {
 // TODO: Use RFSRoot and pass it in the stack instead of heap? problematic with bindings
 R_API RFSRoot *r_fs_root_new (const char *path, ut64 delta) {
 	char *p;
-	RFSRoot *root = R_NEW (RFSRoot);
+	RFSRoot *root = R_NEW0 (RFSRoot);
+	if (!root) return NULL;
 	root->path = strdup (path);
 	p = root->path + strlen (path);
 	if (*p == '/') *p = 0; // chop tailing slash
@@ -31,11 +32,17 @@ R_API void r_fs_root_free (RFSRoot *root) {
 	if (root) {
 		if (root->p && root->p->umount)
 			root->p->umount (root);
+		r_fs_cache_free (root->cache);
 		free (root->path);
 		free (root);
 	}
 }
 
+/* read from the mounted device, addr is relative to the partition */
+R_API int r_fs_root_read(RFSRoot *root, ut64 addr, ut8 *buf, int len) {
+	return r_fs_cache_read (root->cache, &root->iob, root->delta + addr, buf, len);
+}
+
 R_API RFSPartition *r_fs_partition_new(int num, ut64 start, ut64 length) {
 	RFSPartition *p = R_NEW0 (RFSPartition);
 	p->number = num;
@@ -49,8 +49,9 @@ R_API RFSPlugin *r_fs_plugin_get (RFS *fs, const char *name) {
 R_API void r_fs_free (RFS* fs) {
 	if (!fs) return;
 	//r_io_free (fs->iob.io);
-	r_list_free (fs->plugins);
+	/* the roots are unmounted by their plugin */
 	r_list_free (fs->roots);
+	r_list_free (fs->plugins);
 	free (fs);
 }
 
@@ -119,6 +120,7 @@ R_API RFSRoot *r_fs_mount (RFS* fs, const char *fstype, const char *path, ut64 d
 	root->p = p;
 	//memcpy (&root->iob, &fs->iob, sizeof (root->iob));
 	root->iob = fs->iob;
+	root->cache = r_fs_cache_new (R_FS_CACHE_BSIZE, R_FS_CACHE_SIZE);
 	if (!p->mount (root)) {
 		eprintf ("r_fs_mount: Cannot mount partition\n");
 		free (str);
@@ -213,6 +215,14 @@ R_API int r_fs_read (RFS* fs, RFSFile *file, ut64 addr, int len) {
 		eprintf ("r_fs_read: too short read\n");
 		return R_FALSE;
 	}
+	if (fs && file && file->p && file->p->read_at) {
+		/* the buffer is reused by the following reads */
+		ut8 *data = realloc (file->data, len+1);
+		if (!data)
+			return R_FALSE;
+		file->data = data;
+		return file->p->read_at (file, addr, data, len) != -1;
+	}
 	if (fs && file) {
 		free (file->data);
 		file->data = malloc (len+1);
@@ -224,6 +234,18 @@ R_API int r_fs_read (RFS* fs, RFSFile *file, ut64 addr, int len) {
 	return R_FALSE;
 }
 
+/* read into the caller buffer, returns the bytes read or -1 */
+R_API int r_fs_read_at (RFS* fs, RFSFile *file, ut64 addr, ut8 *buf, int len) {
+	if (!fs || !file || !file->p || len<0)
+		return -1;
+	if (file->p->read_at)
+		return file->p->read_at (file, addr, buf, len);
+	if (!r_fs_read (fs, file, addr, len))
+		return -1;
+	memcpy (buf, file->data, len);
+	return len;
+}
+
 R_API RList *r_fs_dir(RFS* fs, const char *p) {
 	RList *roots, *ret = NULL;
 	RFSRoot *root;
@@ -249,55 +271,162 @@ R_API RList *r_fs_dir(RFS* fs, const char *p) {
 	return ret;
 }
 
-R_API int r_fs_dir_dump (RFS* fs, const char *path, const char *name) {
+#define MAX_THREADS 16
+#define DUMP_CHUNK (1024 * 1024)
+
+typedef struct {
+	char *src, *dst;
+} RFSDumpJob;
+
+typedef struct {
+	RFS *fs;
+	RListIter *next;	/* next job to take, guarded by lock */
+	RThreadLock *lock;
+} RFSDump;
+
+static void dump_job_free(RFSDumpJob *job) {
+	free (job->src);
+	free (job->dst);
+	free (job);
+}
+
+/* stream the file contents to dst, a chunk at a time */
+static int dump_file(RFS *fs, const char *src, const char *dst) {
+	RFSFile *file = r_fs_open (fs, src);
+	int n, ret = R_FALSE;
+	FILE *fd = NULL;
+	ut8 *buf = NULL;
+	ut64 off;
+
+	if (!file)
+		return R_FALSE;
+	if ((buf = malloc (DUMP_CHUNK)) && (fd = r_sandbox_fopen (dst, "wb"))) {
+		ret = R_TRUE;
+		for (off = 0; off < file->size; off += n) {
+			n = (int)R_MIN (file->size - off, DUMP_CHUNK);
+			if (r_fs_read_at (fs, file, off, buf, n) != n ||
+					fwrite (buf, 1, n, fd) != n) {
+				ret = R_FALSE;
+				break;
+			}
+		}
+		fclose (fd);
+	}
+	free (buf);
+	r_fs_close (fs, file);
+	r_fs_file_free (file);
+	return ret;
+}
+
+static void dump_jobs(RFSDump *d) {
+	RFSDumpJob *job;
+	for (;;) {
+		r_th_lock_enter (d->lock);
+		job = d->next? d->next->data: NULL;
+		if (d->next)
+			d->next = d->next->n;
+		r_th_lock_leave (d->lock);
+		if (!job)
+			break;
+		if (!dump_file (d->fs, job->src, job->dst))
+			eprintf ("Cannot dump \"%s\"\n", job->src);
+	}
+}
+
+static int dump_thread(RThread *th) {
+	dump_jobs ((RFSDump *)th->user);
+	return R_FALSE;
+}
+
+/* create the directories of the tree and queue its files */
+static int dump_collect(RFS *fs, const char *path, const char *name, RList *jobs) {
 	RList *list;
 	RListIter *iter;
-	RFSFile *file, *item;
+	RFSFile *file;
+	RFSDumpJob *job;
 	char *str, *npath;
 
 	list = r_fs_dir (fs, path);
 	if (!list)
 		return R_FALSE;
+	list->free = (RListFree)r_fs_file_free;
 	if (!r_sys_mkdir (name)) {
 		if (r_sys_mkdir_failed ()) {
 			eprintf ("Cannot create \"%s\"\n", name);
+			r_list_free (list);
 			return R_FALSE;
 		}
 	}
 	r_list_foreach (list, iter, file) {
 		if (!strcmp (file->name, ".") || !strcmp (file->name, ".."))
 			continue;
-		str = (char *) malloc (strlen (name) + strlen (file->name) + 2);
-		if (!str)
-			return R_FALSE;
-		strcpy (str, name);
-		strcat (str, "/");
-		strcat (str, file->name);
-		npath = malloc (strlen (path) + strlen (file->name) + 2);
-		if (!npath) {
+		str = r_str_newf ("%s/%s", name, file->name);
+		npath = r_str_newf ("%s/%s", path, file->name);
+		if (!str || !npath) {
 			free (str);
+			free (npath);
+			r_list_free (list);
 			return R_FALSE;
 		}
-		strcpy (npath, path);
-		strcat (npath, "/");
-		strcat (npath, file->name);
 		if (file->type != R_FS_FILE_TYPE_DIRECTORY) {
-			item = r_fs_open (fs, npath);
-			if (item) {
-				r_fs_read (fs, item, 0, item->size);
-				r_file_dump (str, item->data, item->size, 0);
-				free (item->data);
-				r_fs_close (fs, item);
+			if ((job = R_NEW0 (RFSDumpJob))) {
+				job->src = npath;
+				job->dst = str;
+				r_list_append (jobs, job);
+				continue;
 			}
 		} else {
-			r_fs_dir_dump (fs, npath, str);
+			dump_collect (fs, npath, str, jobs);
 		}
 		free (npath);
 		free (str);
 	}
+	r_list_free (list);
 	return R_TRUE;
 }
 
+R_API int r_fs_threads(int n) {
+	if (n < 1)
+		n = r_sys_cpus ();
+	return R_MIN (n, MAX_THREADS);
+}
+
+/* extract path into the name directory. the files are read by nthreads
+ * workers (0 for one per cpu), sharing the block cache of their root */
+R_API int r_fs_dir_dump_threads (RFS* fs, const char *path, const char *name, int nthreads) {
+	RThread *threads[MAX_THREADS];
+	RList *jobs = r_list_newf ((RListFree)dump_job_free);
+	RFSDump d;
+	int i;
+
+	if (!jobs)
+		return R_FALSE;
+	if (!dump_collect (fs, path, name, jobs)) {
+		r_list_free (jobs);
+		return R_FALSE;
+	}
+	d.fs = fs;
+	d.next = r_list_iterator (jobs);
+	d.lock = r_th_lock_new ();
+	nthreads = r_fs_threads (nthreads);
+	if (nthreads > r_list_length (jobs))
+		nthreads = R_MAX (r_list_length (jobs), 1);
+	for (i = 1; i < nthreads; i++)
+		threads[i] = r_th_new (dump_thread, &d, 0);
+	dump_jobs (&d);
+	for (i = 1; i < nthreads; i++) {
+		if (threads[i])
+			r_th_free (threads[i]);
+	}
+	r_th_lock_free (d.lock);
+	r_list_free (jobs);
+	return R_TRUE;
+}
+
+R_API int r_fs_dir_dump (RFS* fs, const char *path, const char *name) {
+	return r_fs_dir_dump_threads (fs, path, name, 0);
+}
+
 static void r_fs_find_off_aux (RFS* fs, const char *name, ut64 offset, RList *list) {
 	RList *dirs;
 	RListIter *iter;
@@ -387,7 +516,7 @@ R_API RFSFile *r_fs_slurp(RFS* fs, const char *path) {
 			continue;
 		if (root->p->open && root->p->read && root->p->close) {
 			file = root->p->open (root, path);
-			if (file) root->p->read (file, 0, file->size); //file->data
+			if (file) r_fs_read (fs, file, 0, file->size); //file->data
 			else eprintf ("r_fs_slurp: cannot open file\n");
 		} else {
 			if (root->p->slurp) {
@@ -469,13 +598,17 @@ R_API RList *r_fs_partitions (RFS *fs, const char *ptype, ut64 delta) {
 		void *disk = NULL;
 		if (partitions[i].iterate == (void*)&grub_parhook) {
 			struct grub_partition_map *gpt = partitions[i].ptr;
-			grubfs_bind_io (NULL, 0);
-			disk = (void*)grubfs_disk (&fs->iob);
-			if (gpt) {
-				gpt->iterate (disk,
-					(void*)partitions[i].iterate, list);
+			RFSRoot *root = r_fs_root_new ("/", 0);
+			if (root) {
+				root->iob = fs->iob;
+				disk = (void*)grubfs_disk (root);
+				if (gpt) {
+					gpt->iterate (disk,
+						(void*)partitions[i].iterate, list);
+				}
+				grubfs_free (disk);
+				r_fs_root_free (root);
 			}
-			grubfs_free (disk);
 		} else {
 #else
 		{
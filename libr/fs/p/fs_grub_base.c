@@ -5,10 +5,9 @@
 
 static RFSFile* FSP(_open)(RFSRoot *root, const char *path) {
 	RFSFile *file = r_fs_file_new (root, path);
-	GrubFS *gfs = grubfs_new (&FSIPTR, &root->iob);
+	GrubFS *gfs = grubfs_new (&FSIPTR, root);
 	file->ptr = gfs;
 	file->p = root->p;
-	grubfs_bind_io (NULL, file->root->delta);
 	if (gfs->file->fs->open (gfs->file, path)) {
 		r_fs_file_free (file);
 		grubfs_free (gfs);
@@ -20,22 +19,28 @@ static RFSFile* FSP(_open)(RFSRoot *root, const char *path) {
 	return file;
 }
 
-static boolt FSP(_read)(RFSFile *file, ut64 addr, int len) {
+static int FSP(_read_at)(RFSFile *file, ut64 addr, ut8 *buf, int len) {
 	GrubFS *gfs = file->ptr;
-	grubfs_bind_io (NULL, file->root->delta);
-	gfs->file->fs->read (gfs->file, (char*)file->data, len);
+	grub_ssize_t ret;
+	gfs->file->offset = addr;
+	ret = gfs->file->fs->read (gfs->file, (char*)buf, len);
 	file->off = grub_hack_lastoff; //gfs->file->offset;
-	return R_FALSE;
+	return (int)ret;
+}
+
+static boolt FSP(_read)(RFSFile *file, ut64 addr, int len) {
+	return FSP(_read_at) (file, addr, file->data, len) == len;
 }
 
 static void FSP(_close)(RFSFile *file) {
 	GrubFS *gfs = file->ptr;
 	gfs->file->fs->close (gfs->file);
+	grubfs_free (gfs);
+	file->ptr = NULL;
 }
 
-static RList *list = NULL;
-
 static int dirhook (const char *filename, const struct grub_dirhook_info *info, void *closure) {
+	RList *list = closure;
 	RFSFile *fsf = r_fs_file_new (NULL, filename);
 	fsf->type = info->dir? 'd':'f';
 	fsf->time = info->mtime;
@@ -48,6 +53,7 @@ static int dirhook (const char *filename, const struct grub_dirhook_info *info,
 
 static RList *FSP(_dir)(RFSRoot *root, const char *path, int view) {
 	GrubFS *gfs;
+	RList *list;
 
 	if (root == NULL)
 		return NULL;
@@ -55,25 +61,18 @@ static RList *FSP(_dir)(RFSRoot *root, const char *path, int view) {
 	gfs = root->ptr;
 	list = r_list_new ();
 //	eprintf ("r_fs_???_dir: %s\n", path);
-	//gfs->file->device->data = &root->iob;
-	grubfs_bind_io (&root->iob, root->delta);
-	gfs->file->fs->dir (gfs->file->device, path, dirhook, 0);
-	grubfs_bind_io (NULL, root->delta);
+	gfs->file->fs->dir (gfs->file->device, path, dirhook, list);
 	return list;
 }
 
 static int do_nothing (const char *a, const struct grub_dirhook_info *b, void *c) { return 0; }
 
 static int FSP(_mount)(RFSRoot *root) {
-	int ret;
-	GrubFS *gfs = grubfs_new (&FSIPTR, &root->iob);
+	GrubFS *gfs = grubfs_new (&FSIPTR, root);
 	root->ptr = gfs;
-	grubfs_bind_io (&root->iob, root->delta);
 	// XXX: null hook seems to be problematic on some filesystems
 	//return gfs->file->fs->dir (gfs->file->device, "/", NULL, 0)? R_FALSE:R_TRUE;
-	ret = gfs->file->fs->dir (gfs->file->device, "/", do_nothing, 0)? R_FALSE:R_TRUE;
-	grubfs_bind_io (NULL, root->delta);
-	return ret;
+	return gfs->file->fs->dir (gfs->file->device, "/", do_nothing, 0)? R_FALSE:R_TRUE;
 }
 
 static void FSP(_umount)(RFSRoot *root) {
@@ -86,6 +85,7 @@ struct r_fs_plugin_t FSS(r_fs_plugin) = {
 	.desc = FSDESC,
 	.open = FSP(_open),
 	.read = FSP(_read),
+	.read_at = FSP(_read_at),
 	.close = FSP(_close),
 	.dir = FSP(_dir),
 	.mount = FSP(_mount),
@@ -27,6 +27,17 @@ static boolt fs_posix_read(RFSFile *file, ut64 addr, int len) {
 	return R_FALSE;
 }
 
+static int fs_posix_read_at(RFSFile *file, ut64 addr, ut8 *buf, int len) {
+	FILE *fd = r_sandbox_fopen (file->name, "rb");
+	int ret = -1;
+	if (fd) {
+		if (!fseek (fd, addr, SEEK_SET))
+			ret = fread (buf, 1, len, fd);
+		fclose (fd);
+	}
+	return ret;
+}
+
 static void fs_posix_close(RFSFile *file) {
 	//fclose (file->ptr);
 }
@@ -70,6 +81,7 @@ struct r_fs_plugin_t r_fs_plugin_posix = {
 	.desc = "POSIX filesystem",
 	.open = fs_posix_open,
 	.read = fs_posix_read,
+	.read_at = fs_posix_read_at,
 	.close = fs_posix_close,
 	.dir = &fs_posix_dir,
 	.mount = fs_posix_mount,
@@ -0,0 +1,147 @@
+/* block cache of the mounted filesystems: a tar image is extracted by one
+ * and by several workers, the files are checked and a write through the
+ * io must not be hidden by the cached blocks */
+
+#include <r_fs.h>
+#include <r_io.h>
+
+#define TAR_BLOCK 512
+
+static ut8 file_byte(int n, int off) {
+	return (ut8)(n * 31 + off * 7 + (off >> 9));
+}
+
+static void tar_header(ut8 *h, const char *name, int size) {
+	unsigned int i, sum = 0;
+	memset (h, 0, TAR_BLOCK);
+	snprintf ((char *)h, 100, "%s", name);
+	snprintf ((char *)h + 100, 8, "%07o", 0644);
+	snprintf ((char *)h + 108, 8, "%07o", 0);
+	snprintf ((char *)h + 116, 8, "%07o", 0);
+	snprintf ((char *)h + 124, 12, "%011o", size);
+	snprintf ((char *)h + 136, 12, "%011o", 0);
+	h[156] = '0';
+	memcpy (h + 257, "ustar", 6);
+	memcpy (h + 263, "00", 2);
+	memset (h + 148, ' ', 8);
+	for (i = 0; i < TAR_BLOCK; i++)
+		sum += h[i];
+	snprintf ((char *)h + 148, 8, "%06o", sum);
+}
+
+/* nfiles regular files of fsize bytes, padded and terminated as tar does */
+static ut8 *tar_image(int nfiles, int fsize, int *len) {
+	int i, j, pad = (fsize + TAR_BLOCK - 1) & ~(TAR_BLOCK - 1);
+	ut8 *img, *p;
+	char name[32];
+	*len = nfiles * (TAR_BLOCK + pad) + 2 * TAR_BLOCK;
+	if (!(img = calloc (1, *len)))
+		return NULL;
+	for (i = 0, p = img; i < nfiles; i++) {
+		snprintf (name, sizeof (name), "f%04d", i);
+		tar_header (p, name, fsize);
+		p += TAR_BLOCK;
+		for (j = 0; j < fsize; j++)
+			p[j] = file_byte (i, j);
+		p += pad;
+	}
+	return img;
+}
+
+/* the extracted files have the expected contents, and are removed */
+static int check_dump(const char *dir, int nfiles, int fsize) {
+	char path[1024];
+	int i, j, len, fail = 0;
+	ut8 *buf;
+	for (i = 0; i < nfiles; i++) {
+		snprintf (path, sizeof (path), "%s/f%04d", dir, i);
+		buf = (ut8 *)r_file_slurp (path, &len);
+		if (!buf || len != fsize) {
+			fail++;
+		} else {
+			for (j = 0; j < len; j++) {
+				if (buf[j] != file_byte (i, j)) {
+					fail++;
+					break;
+				}
+			}
+		}
+		free (buf);
+		r_file_rm (path);
+	}
+	r_file_rm (dir);
+	return fail;
+}
+
+static ut64 dump(RFS *fs, RFSRoot *root, const char *dir, int nthreads) {
+	ut64 t0;
+	r_fs_cache_reset (root->cache);
+	root->cache->hits = root->cache->misses = 0;
+	t0 = r_sys_now ();
+	if (!r_fs_dir_dump_threads (fs, "/", dir, nthreads))
+		return 0;
+	return r_sys_now () - t0;
+}
+
+int main(int argc, char **argv) {
+	int nfiles = argc > 1? atoi (argv[1]): 512;
+	int fsize = argc > 2? atoi (argv[2]): 0x10000;
+	int nthreads = r_fs_threads (argc > 3? atoi (argv[3]): 0);
+	int len, fail = 0;
+	char *tmp = r_file_tmpdir ();
+	char *img = r_str_newf ("%s/dump_bench.tar", tmp);
+	char *dir = r_str_newf ("%s/dump_bench.d", tmp);
+	ut8 *buf = tar_image (nfiles, fsize, &len), patch[4] = { 0xde, 0xad, 0xbe, 0xef };
+	ut8 rbuf[4];
+	RIO *io = r_io_new ();
+	RFS *fs = r_fs_new ();
+	RFSRoot *root;
+	RFSFile *file;
+	ut64 t1, tn;
+
+	if (!buf || !io || !fs || !r_file_dump (img, buf, len, 0))
+		return 1;
+	if (!r_io_open (io, img, R_IO_READ | R_IO_WRITE, 0644))
+		return 1;
+	r_io_bind (io, &fs->iob);
+	if (!(root = r_fs_mount (fs, "tar", "/", 0)) || !root->cache) {
+		printf ("[-] cannot mount the tar image\n");
+		return 1;
+	}
+	t1 = dump (fs, root, dir, 1);
+	fail += check_dump (dir, nfiles, fsize);
+	tn = dump (fs, root, dir, nthreads);
+	fail += check_dump (dir, nfiles, fsize);
+	if (!t1 || !tn)
+		fail++;
+	printf ("%d files of %d bytes: 1 worker %.3f ms, %d workers %.3f ms, "
+		"%"PFMT64d" hits %"PFMT64d" misses\n", nfiles, fsize,
+		(double)t1 / 1000, nthreads, (double)tn / 1000,
+		root->cache->hits, root->cache->misses);
+
+	/* reads after a write see it once the cache is reset, as core does */
+	file = r_fs_open (fs, "/f0000");
+	if (!file || r_fs_read_at (fs, file, 0, rbuf, 4) != 4) {
+		fail++;
+	} else {
+		r_io_write_at (io, TAR_BLOCK, patch, 4);
+		r_fs_cache_reset (root->cache);
+		if (r_fs_read_at (fs, file, 0, rbuf, 4) != 4 || memcmp (rbuf, patch, 4)) {
+			printf ("[-] the cached blocks hide the write\n");
+			fail++;
+		}
+	}
+	if (file) {
+		r_fs_close (fs, file);
+		r_fs_file_free (file);
+	}
+	printf ("%s\n", fail? "[-] failed": "[+] ok");
+	r_fs_free (fs);
+	r_io_free (io);
+	r_file_rm (img);
+	free (buf);
+	free (img);
+	free (dir);
+	free (tmp);
+	return fail? 1: 0;
+}
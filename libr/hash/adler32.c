@@ -1,15 +1,74 @@
-/* radare - LGPL - Copyright 2013 pancake */
+/* radare - LGPL - Copyright 2013-2015 pancake */
 
 #include <r_hash.h>
+#include "cpu.h"
 
-static const int MOD_ADLER = 65521;
+#define MOD_ADLER 65521
+/* largest n such that 255n(n+1)/2 + (n+1)(MOD_ADLER-1) fits in 32 bits */
+#define NMAX 5552
+
+#if R_HASH_X86
+/* 32 bytes per step: a grows by the byte sums (psadbw) and b by the
+ * sums weighted 32..1 (pmaddubsw) plus 32 times the previous a */
+static R_HASH_TARGET("ssse3") void adler32_ssse3(ut32 *pa, ut32 *pb, const ut8 *buf, ut64 blocks) {
+	const __m128i tap1 = _mm_setr_epi8 (32, 31, 30, 29, 28, 27, 26, 25,
+		24, 23, 22, 21, 20, 19, 18, 17);
+	const __m128i tap2 = _mm_setr_epi8 (16, 15, 14, 13, 12, 11, 10, 9,
+		8, 7, 6, 5, 4, 3, 2, 1);
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i ones = _mm_set1_epi16 (1);
+	ut32 a = *pa, b = *pb;
+
+	while (blocks) {
+		ut32 n = R_MIN (blocks, NMAX / 32);
+		__m128i vps = _mm_set_epi32 (0, 0, 0, a * n);
+		__m128i vb = _mm_set_epi32 (0, 0, 0, b);
+		__m128i va = zero;
+		blocks -= n;
+		do {
+			const __m128i b1 = _mm_loadu_si128 ((const __m128i *)buf);
+			const __m128i b2 = _mm_loadu_si128 ((const __m128i *)(buf + 16));
+			vps = _mm_add_epi32 (vps, va);
+			va = _mm_add_epi32 (va, _mm_sad_epu8 (b1, zero));
+			vb = _mm_add_epi32 (vb, _mm_madd_epi16 (_mm_maddubs_epi16 (b1, tap1), ones));
+			va = _mm_add_epi32 (va, _mm_sad_epu8 (b2, zero));
+			vb = _mm_add_epi32 (vb, _mm_madd_epi16 (_mm_maddubs_epi16 (b2, tap2), ones));
+			buf += 32;
+		} while (--n);
+		vb = _mm_add_epi32 (vb, _mm_slli_epi32 (vps, 5));
+		va = _mm_add_epi32 (va, _mm_shuffle_epi32 (va, _MM_SHUFFLE (2, 3, 0, 1)));
+		va = _mm_add_epi32 (va, _mm_shuffle_epi32 (va, _MM_SHUFFLE (1, 0, 3, 2)));
+		vb = _mm_add_epi32 (vb, _mm_shuffle_epi32 (vb, _MM_SHUFFLE (2, 3, 0, 1)));
+		vb = _mm_add_epi32 (vb, _mm_shuffle_epi32 (vb, _MM_SHUFFLE (1, 0, 3, 2)));
+		a = (a + (ut32)_mm_cvtsi128_si32 (va)) % MOD_ADLER;
+		b = (ut32)_mm_cvtsi128_si32 (vb) % MOD_ADLER;
+	}
+	*pa = a;
+	*pb = b;
+}
+#endif
 
 ut32 r_hash_adler32(const ut8 *data, int len) {
 	ut32 a = 1, b = 0;
-	int index;
-	for (index = 0; index < len; ++index) {
-		a = (a + data[index]) % MOD_ADLER;
-		b = (b + a) % MOD_ADLER;
+	int i, n;
+#if R_HASH_X86
+	if (len >= 32 && (r_hash_cpu_features () & R_HASH_CPU_SSSE3)) {
+		adler32_ssse3 (&a, &b, data, len / 32);
+		data += len & ~31;
+		len &= 31;
+	}
+#endif
+	/* defer the modulo for as long as the sums cannot overflow */
+	while (len > 0) {
+		n = R_MIN (len, NMAX);
+		len -= n;
+		for (i = 0; i < n; i++) {
+			a += data[i];
+			b += a;
+		}
+		data += n;
+		a %= MOD_ADLER;
+		b %= MOD_ADLER;
 	}
 	return (b << 16) | a;
 }
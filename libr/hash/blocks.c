@@ -0,0 +1,134 @@
+/* radare - LGPL - Copyright 2015 - pancake */
+
+#include "r_hash.h"
+#include "r_util.h"
+
+#define MAX_THREADS 16
+
+typedef struct {
+	ut64 algobit;
+	const ut8 *buf;
+	ut64 len;
+	int bsize;
+	ut8 *out;
+	int dlen;
+	ut64 from, to; /* block range */
+} HashWorker;
+
+static void hash_range(HashWorker *w) {
+	RHash *ctx = r_hash_new (R_TRUE, w->algobit);
+	ut64 i, off;
+	int n;
+
+	if (!ctx) return;
+	for (i = w->from; i < w->to; i++) {
+		off = i * w->bsize;
+		n = (off + w->bsize > w->len)? (int)(w->len - off): w->bsize;
+		memset (ctx->digest, 0, w->dlen);
+		r_hash_calculate (ctx, w->algobit, w->buf + off, n);
+		memcpy (w->out + i * w->dlen, ctx->digest, w->dlen);
+	}
+	r_hash_free (ctx);
+}
+
+static int hash_thread(RThread *th) {
+	hash_range ((HashWorker *)th->user);
+	return R_FALSE;
+}
+
+R_API int r_hash_threads(int n) {
+	if (n < 1)
+		n = r_sys_cpus ();
+	return R_MIN (n, MAX_THREADS);
+}
+
+/* digest every bsize block of buf with a single algorithm, in parallel.
+ * out gets one r_hash_size(algobit) digest per block, in order.
+ * returns the number of blocks, or -1 */
+R_API int r_hash_calculate_blocks(ut64 algobit, const ut8 *buf, ut64 len, int bsize, ut8 *out, int nthreads) {
+	HashWorker workers[MAX_THREADS];
+	RThread *threads[MAX_THREADS];
+	ut64 nblocks, per;
+	int i, dlen = r_hash_size (algobit);
+
+	if (!buf || !out || !dlen || bsize < 1)
+		return -1;
+	nblocks = (len + bsize - 1) / bsize;
+	if (!nblocks)
+		return 0;
+	nthreads = r_hash_threads (nthreads);
+	if (nthreads > nblocks)
+		nthreads = nblocks;
+	/* lazily built tables (crc32) must not be initialized by the workers */
+	{
+		RHash *ctx = r_hash_new (R_TRUE, algobit);
+		if (ctx) {
+			r_hash_calculate (ctx, algobit, buf, 1);
+			r_hash_free (ctx);
+		}
+	}
+	per = (nblocks + nthreads - 1) / nthreads;
+	for (i = 0; i < nthreads; i++) {
+		HashWorker *w = &workers[i];
+		w->algobit = algobit;
+		w->buf = buf;
+		w->len = len;
+		w->bsize = bsize;
+		w->out = out;
+		w->dlen = dlen;
+		w->from = R_MIN (i * per, nblocks);
+		w->to = R_MIN (w->from + per, nblocks);
+		threads[i] = NULL;
+	}
+	for (i = 1; i < nthreads; i++)
+		threads[i] = r_th_new (hash_thread, &workers[i], 0);
+	hash_range (&workers[0]);
+	for (i = 1; i < nthreads; i++) {
+		if (threads[i])
+			r_th_free (threads[i]);
+		else hash_range (&workers[i]);
+	}
+	return (int)nblocks;
+}
+
+/* reduce n leaf digests to the merkle root: every level hashes the
+ * concatenation of two sibling digests, an odd last node is hashed alone.
+ * leaves is overwritten, the root is left in leaves[0..dlen) */
+R_API int r_hash_calculate_root(ut64 algobit, ut8 *leaves, int n, int nthreads) {
+	int dlen = r_hash_size (algobit);
+	ut8 *tmp;
+
+	if (!leaves || !dlen || n < 1)
+		return 0;
+	if (n == 1)
+		return dlen;
+	tmp = malloc (((n + 1) / 2) * dlen);
+	if (!tmp) return 0;
+	while (n > 1) {
+		n = r_hash_calculate_blocks (algobit, leaves, (ut64)n * dlen,
+			2 * dlen, tmp, nthreads);
+		if (n < 1) break;
+		memcpy (leaves, tmp, n * dlen);
+	}
+	free (tmp);
+	return n == 1? dlen: 0;
+}
+
+/* merkle tree digest of buf split in bsize leaves, written to out */
+R_API int r_hash_calculate_tree(ut64 algobit, const ut8 *buf, ut64 len, int bsize, ut8 *out, int nthreads) {
+	int n, dlen = r_hash_size (algobit);
+	ut8 *leaves;
+
+	if (!buf || !out || !dlen || bsize < 1)
+		return 0;
+	leaves = malloc (((len + bsize - 1) / bsize + 1) * dlen);
+	if (!leaves) return 0;
+	n = r_hash_calculate_blocks (algobit, buf, len, bsize, leaves, nthreads);
+	if (n < 1 || !r_hash_calculate_root (algobit, leaves, n, nthreads)) {
+		free (leaves);
+		return 0;
+	}
+	memcpy (out, leaves, dlen);
+	free (leaves);
+	return dlen;
+}
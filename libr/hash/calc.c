@@ -45,9 +45,10 @@ R_API int r_hash_calculate(RHash *ctx, ut64 algobit, const ut8 *buf, int len) {
 		memcpy (ctx->digest, &res, R_HASH_SIZE_CRC16);
 		return R_HASH_SIZE_CRC16;
 	}
-	if (algobit & R_HASH_CRC32) {
+	if (algobit & (R_HASH_CRC32 | R_HASH_CRC32C)) {
 		ut8 *pres;
-		ut32 res = r_hash_crc32 (buf, len);
+		ut32 res = (algobit & R_HASH_CRC32)?
+			r_hash_crc32 (buf, len): r_hash_crc32c (buf, len);
 #if CPU_ENDIAN
 		/* big endian here */
 		memcpy (ctx->digest, &res, R_HASH_SIZE_CRC32);
@@ -0,0 +1,39 @@
+/* radare - LGPL - Copyright 2015 - pancake */
+
+#include "r_hash.h"
+#include "cpu.h"
+#if R_HASH_X86
+#include <cpuid.h>
+#endif
+
+static int features = -1;
+
+static int cpu_detect(void) {
+	int f = 0;
+#if R_HASH_X86
+	unsigned int a, b, c, d;
+	if (__get_cpuid (1, &a, &b, &c, &d)) {
+		if (c & (1 << 9)) f |= R_HASH_CPU_SSSE3;
+		if (c & (1 << 19)) f |= R_HASH_CPU_SSE41;
+		if (c & (1 << 20)) f |= R_HASH_CPU_SSE42;
+		if (c & (1 << 1)) f |= R_HASH_CPU_PCLMUL;
+	}
+	if (__get_cpuid_max (0, NULL) >= 7) {
+		__cpuid_count (7, 0, a, b, c, d);
+		if (b & (1 << 29)) f |= R_HASH_CPU_SHA;
+	}
+#endif
+	return f;
+}
+
+/* R_HASH_CPU_* kernels usable on this machine */
+R_API int r_hash_cpu_features() {
+	if (features == -1)
+		features = cpu_detect ();
+	return features;
+}
+
+/* restrict the kernels in use, 0 selects the portable code */
+R_API void r_hash_cpu_use(int mask) {
+	features = cpu_detect () & mask;
+}
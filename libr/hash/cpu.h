@@ -0,0 +1,14 @@
+#ifndef R2_HASH_CPU_H
+#define R2_HASH_CPU_H
+
+/* x86 kernels are built with per-function target attributes and
+ * picked at runtime with r_hash_cpu_features() */
+#if (defined(__x86_64__) || defined(__i386__)) && (__GNUC__ >= 5 || defined(__clang__))
+#define R_HASH_X86 1
+#include <immintrin.h>
+#define R_HASH_TARGET(x) __attribute__((target(x)))
+#else
+#define R_HASH_X86 0
+#endif
+
+#endif
@@ -1,25 +1,166 @@
-/* Copyright (C) radare2 - 2007-2012 - pancake */
+/* Copyright (C) radare2 - 2007-2015 - pancake */
 
-#include "r_types.h"
+#include "r_hash.h"
+#include "cpu.h"
 
-static char crc_table_is_init = 0;
-static ut32 crc_table[256];
+/* slicing-by-8 tables, [0] is the classic bytewise table */
+static ut32 crc_table[8][256];
+static ut32 crcc_table[8][256];
+static volatile int crc_table_is_init = 0;
 
-// result is endian swap
-R_API ut32 r_hash_crc32(const ut8 *buf, ut64 len) {
-	unsigned int crc = 0;
+static void crc_table_init(ut32 t[8][256], ut32 poly) {
+	ut32 i, j, c;
+	for (i = 0; i < 256; i++) {
+		for (c = i, j = 0; j < 8; j++)
+			c = (c >> 1) ^ ((c & 1)? poly: 0);
+		t[0][i] = c;
+	}
+	for (i = 0; i < 256; i++)
+		for (j = 1; j < 8; j++)
+			t[j][i] = (t[j - 1][i] >> 8) ^ t[0][t[j - 1][i] & 0xff];
+}
+
+/* the tables are only published once complete, racing callers
+ * may build them twice with the same contents */
+static void crc_init(void) {
 	if (!crc_table_is_init) {
-		ut32 i, j, h = 1;
+		crc_table_init (crc_table, 0xedb88320);
+		crc_table_init (crcc_table, 0x82f63b78);
 		crc_table_is_init = 1;
-		crc_table[0] = 0;
-		for (i = 128; i; i >>= 1) {
-			h = (h >> 1) ^ ((h & 1) ? (int)0xedb88320 : 0);
-			for (j = 0; j < 256; j += 2*i)
-			crc_table[i+j] = crc_table[j] ^ h;
-		}
 	}
-	crc ^= 0xffffffff;
+}
+
+static ut32 crc_slice8(ut32 t[8][256], ut32 crc, const ut8 *buf, ut64 len) {
+	ut32 a, b;
+	for (; len && ((size_t)buf & 7); len--)
+		crc = (crc >> 8) ^ t[0][(crc ^ *buf++) & 0xff];
+	for (; len >= 8; len -= 8, buf += 8) {
+		a = (buf[0] | buf[1] << 8 | buf[2] << 16 | (ut32)buf[3] << 24) ^ crc;
+		b = buf[4] | buf[5] << 8 | buf[6] << 16 | (ut32)buf[7] << 24;
+		crc = t[7][a & 0xff] ^ t[6][(a >> 8) & 0xff] ^
+			t[5][(a >> 16) & 0xff] ^ t[4][a >> 24] ^
+			t[3][b & 0xff] ^ t[2][(b >> 8) & 0xff] ^
+			t[1][(b >> 16) & 0xff] ^ t[0][b >> 24];
+	}
+	while (len--)
+		crc = (crc >> 8) ^ t[0][(crc ^ *buf++) & 0xff];
+	return crc;
+}
+
+#if R_HASH_X86
+/* carry-less multiplication folding of 64 byte chunks, see Intel's
+ * "Fast CRC Computation Using PCLMULQDQ". len >= 64, multiple of 16 */
+static R_HASH_TARGET("pclmul,sse4.1") ut32 crc32_pclmul(ut32 crc, const ut8 *buf, ut64 len) {
+	static const ut64 k1k2[2] __attribute__((aligned(16))) = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+	static const ut64 k3k4[2] __attribute__((aligned(16))) = { 0x01751997d0ULL, 0x00ccaa009eULL };
+	static const ut64 k5k0[2] __attribute__((aligned(16))) = { 0x0163cd6124ULL, 0 };
+	static const ut64 poly[2] __attribute__((aligned(16))) = { 0x01db710641ULL, 0x01f7011641ULL };
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x1 = _mm_loadu_si128 ((const __m128i *)(buf + 0x00));
+	x2 = _mm_loadu_si128 ((const __m128i *)(buf + 0x10));
+	x3 = _mm_loadu_si128 ((const __m128i *)(buf + 0x20));
+	x4 = _mm_loadu_si128 ((const __m128i *)(buf + 0x30));
+	x1 = _mm_xor_si128 (x1, _mm_cvtsi32_si128 (crc));
+	x0 = _mm_load_si128 ((const __m128i *)k1k2);
+	buf += 64;
+	len -= 64;
+	for (; len >= 64; len -= 64, buf += 64) {
+		x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128 (x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128 (x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128 (x4, x0, 0x00);
+		x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128 (x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128 (x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128 (x4, x0, 0x11);
+		x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x5),
+			_mm_loadu_si128 ((const __m128i *)(buf + 0x00)));
+		x2 = _mm_xor_si128 (_mm_xor_si128 (x2, x6),
+			_mm_loadu_si128 ((const __m128i *)(buf + 0x10)));
+		x3 = _mm_xor_si128 (_mm_xor_si128 (x3, x7),
+			_mm_loadu_si128 ((const __m128i *)(buf + 0x20)));
+		x4 = _mm_xor_si128 (_mm_xor_si128 (x4, x8),
+			_mm_loadu_si128 ((const __m128i *)(buf + 0x30)));
+	}
+	/* fold the four lanes into one */
+	x0 = _mm_load_si128 ((const __m128i *)k3k4);
+	x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+	x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x2), x5);
+	x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+	x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x3), x5);
+	x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+	x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x4), x5);
+	for (; len >= 16; len -= 16, buf += 16) {
+		x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+		x1 = _mm_xor_si128 (_mm_xor_si128 (x1,
+			_mm_loadu_si128 ((const __m128i *)buf)), x5);
+	}
+	/* 128 to 64 bits */
+	x2 = _mm_clmulepi64_si128 (x1, x0, 0x10);
+	x3 = _mm_setr_epi32 (~0, 0, ~0, 0);
+	x1 = _mm_xor_si128 (_mm_srli_si128 (x1, 8), x2);
+	x0 = _mm_loadl_epi64 ((const __m128i *)k5k0);
+	x2 = _mm_srli_si128 (x1, 4);
+	x1 = _mm_and_si128 (x1, x3);
+	x1 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+	x1 = _mm_xor_si128 (x1, x2);
+	/* barrett reduction to 32 bits */
+	x0 = _mm_load_si128 ((const __m128i *)poly);
+	x2 = _mm_and_si128 (x1, x3);
+	x2 = _mm_clmulepi64_si128 (x2, x0, 0x10);
+	x2 = _mm_and_si128 (x2, x3);
+	x2 = _mm_clmulepi64_si128 (x2, x0, 0x00);
+	x1 = _mm_xor_si128 (x1, x2);
+	return (ut32)_mm_extract_epi32 (x1, 1);
+}
+
+static R_HASH_TARGET("sse4.2") ut32 crc32c_sse42(ut32 crc, const ut8 *buf, ut64 len) {
+	for (; len && ((size_t)buf & 7); len--)
+		crc = _mm_crc32_u8 (crc, *buf++);
+#if __x86_64__
+	{
+		ut64 c = crc;
+		for (; len >= 8; len -= 8, buf += 8)
+			c = _mm_crc32_u64 (c, *(const ut64 *)buf);
+		crc = (ut32)c;
+	}
+#else
+	for (; len >= 4; len -= 4, buf += 4)
+		crc = _mm_crc32_u32 (crc, *(const ut32 *)buf);
+#endif
 	while (len--)
-		crc = (crc >> 8) ^ crc_table[(crc ^ *buf++) & 0xff];
-	return crc ^ 0xffffffff;
+		crc = _mm_crc32_u8 (crc, *buf++);
+	return crc;
+}
+#endif
+
+// result is endian swap
+R_API ut32 r_hash_crc32(const ut8 *buf, ut64 len) {
+	ut32 crc = 0xffffffff;
+	crc_init ();
+#if R_HASH_X86
+	if (len >= 64 && (r_hash_cpu_features () & R_HASH_CPU_PCLMUL)
+			&& (r_hash_cpu_features () & R_HASH_CPU_SSE41)) {
+		ut64 n = len & ~(ut64)15;
+		crc = crc32_pclmul (crc, buf, n);
+		buf += n;
+		len -= n;
+	}
+#endif
+	return crc_slice8 (crc_table, crc, buf, len) ^ 0xffffffff;
+}
+
+/* castagnoli polynomial, as used by iscsi, ext4 and btrfs */
+R_API ut32 r_hash_crc32c(const ut8 *buf, ut64 len) {
+#if R_HASH_X86
+	if (r_hash_cpu_features () & R_HASH_CPU_SSE42)
+		return crc32c_sse42 (0xffffffff, buf, len) ^ 0xffffffff;
+#endif
+	crc_init ();
+	return crc_slice8 (crcc_table, 0xffffffff, buf, len) ^ 0xffffffff;
 }
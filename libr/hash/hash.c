@@ -18,6 +18,7 @@ static const hash_name_bytes[] = {
 	 {"sha512", R_HASH_SHA512},
 	 {"crc16", R_HASH_CRC16},
 	 {"crc32", R_HASH_CRC32},
+	 {"crc32c", R_HASH_CRC32C},
 	 {"adler32", R_HASH_ADLER32},
 	 {"xxhash", R_HASH_XXHASH},
 	 {"parity", R_HASH_PARITY},
@@ -97,6 +98,7 @@ R_API int r_hash_size(ut64 algo) {
 	if (algo & R_HASH_SHA512) return R_HASH_SIZE_SHA512;
 	if (algo & R_HASH_CRC16) return R_HASH_SIZE_CRC16;
 	if (algo & R_HASH_CRC32) return R_HASH_SIZE_CRC32;
+	if (algo & R_HASH_CRC32C) return R_HASH_SIZE_CRC32C;
 	if (algo & R_HASH_XXHASH) return R_HASH_SIZE_XXHASH;
 	if (algo & R_HASH_ADLER32) return R_HASH_SIZE_ADLER32;
 	if (algo & R_HASH_PARITY) return 1;
@@ -35,45 +35,216 @@
 
 #include "r_hash.h"
 #include "sha1.h"
+#include "cpu.h"
 
 #define SHA_ROT(X,n) (((X) << (n)) | ((X) >> (32-(n))))
 
-static void shaHashBlock(R_SHA_CTX *ctx) {
+static void shaCompress(ut32 H[5], ut32 W[80]) {
 	int t;
 	unsigned int A,B,C,D,E,TEMP;
 
 	for (t = 16; t <= 79; t++)
-		ctx->W[t] =
-			SHA_ROT(ctx->W[t-3] ^ ctx->W[t-8] ^ ctx->W[t-14] ^ ctx->W[t-16], 1);
+		W[t] = SHA_ROT(W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16], 1);
 
-	A = ctx->H[0];
-	B = ctx->H[1];
-	C = ctx->H[2];
-	D = ctx->H[3];
-	E = ctx->H[4];
+	A = H[0];
+	B = H[1];
+	C = H[2];
+	D = H[3];
+	E = H[4];
 
 	for (t = 0; t <= 19; t++) {
-		TEMP = SHA_ROT(A,5) + (((C^D)&B)^D)     + E + ctx->W[t] + 0x5a827999;
+		TEMP = SHA_ROT(A,5) + (((C^D)&B)^D)     + E + W[t] + 0x5a827999;
 		E = D; D = C; C = SHA_ROT(B, 30); B = A; A = TEMP;
 	}
 	for (t = 20; t <= 39; t++) {
-		TEMP = SHA_ROT(A,5) + (B^C^D)           + E + ctx->W[t] + 0x6ed9eba1;
+		TEMP = SHA_ROT(A,5) + (B^C^D)           + E + W[t] + 0x6ed9eba1;
 		E = D; D = C; C = SHA_ROT(B, 30); B = A; A = TEMP;
 	}
 	for (t = 40; t <= 59; t++) {
-		TEMP = SHA_ROT(A,5) + ((B&C)|(D&(B|C))) + E + ctx->W[t] + 0x8f1bbcdc;
+		TEMP = SHA_ROT(A,5) + ((B&C)|(D&(B|C))) + E + W[t] + 0x8f1bbcdc;
 		E = D; D = C; C = SHA_ROT(B, 30); B = A; A = TEMP;
 	}
 	for (t = 60; t <= 79; t++) {
-		TEMP = SHA_ROT(A,5) + (B^C^D)           + E + ctx->W[t] + 0xca62c1d6;
+		TEMP = SHA_ROT(A,5) + (B^C^D)           + E + W[t] + 0xca62c1d6;
 		E = D; D = C; C = SHA_ROT(B, 30); B = A; A = TEMP;
 	}
 
-	ctx->H[0] += A;
-	ctx->H[1] += B;
-	ctx->H[2] += C;
-	ctx->H[3] += D;
-	ctx->H[4] += E;
+	H[0] += A;
+	H[1] += B;
+	H[2] += C;
+	H[3] += D;
+	H[4] += E;
+}
+
+static void shaHashBlock(R_SHA_CTX *ctx) {
+	shaCompress (ctx->H, ctx->W);
+}
+
+#if R_HASH_X86
+static R_HASH_TARGET("sha,ssse3,sse4.1") void shaBlocksNI(ut32 H[5], const ut8 *p, int n) {
+	const __m128i mask = _mm_set_epi64x (0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+	__m128i abcd, abcd_save, e0, e0_save, e1, m0, m1, m2, m3;
+
+	abcd = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *)H), 0x1b);
+	e0 = _mm_set_epi32 (H[4], 0, 0, 0);
+	for (; n > 0; n--, p += 64) {
+		abcd_save = abcd;
+		e0_save = e0;
+		/* rounds 0-3 */
+		m0 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(p + 0)), mask);
+		e0 = _mm_add_epi32 (e0, m0);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 0);
+		/* rounds 4-7 */
+		m1 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(p + 16)), mask);
+		e1 = _mm_sha1nexte_epu32 (e1, m1);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 0);
+		m0 = _mm_sha1msg1_epu32 (m0, m1);
+		/* rounds 8-11 */
+		m2 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(p + 32)), mask);
+		e0 = _mm_sha1nexte_epu32 (e0, m2);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 0);
+		m1 = _mm_sha1msg1_epu32 (m1, m2);
+		m0 = _mm_xor_si128 (m0, m2);
+		/* rounds 12-15 */
+		m3 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(p + 48)), mask);
+		e1 = _mm_sha1nexte_epu32 (e1, m3);
+		e0 = abcd;
+		m0 = _mm_sha1msg2_epu32 (m0, m3);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 0);
+		m2 = _mm_sha1msg1_epu32 (m2, m3);
+		m1 = _mm_xor_si128 (m1, m3);
+		/* rounds 16-19 */
+		e0 = _mm_sha1nexte_epu32 (e0, m0);
+		e1 = abcd;
+		m1 = _mm_sha1msg2_epu32 (m1, m0);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 0);
+		m3 = _mm_sha1msg1_epu32 (m3, m0);
+		m2 = _mm_xor_si128 (m2, m0);
+		/* rounds 20-23 */
+		e1 = _mm_sha1nexte_epu32 (e1, m1);
+		e0 = abcd;
+		m2 = _mm_sha1msg2_epu32 (m2, m1);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 1);
+		m0 = _mm_sha1msg1_epu32 (m0, m1);
+		m3 = _mm_xor_si128 (m3, m1);
+		/* rounds 24-27 */
+		e0 = _mm_sha1nexte_epu32 (e0, m2);
+		e1 = abcd;
+		m3 = _mm_sha1msg2_epu32 (m3, m2);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 1);
+		m1 = _mm_sha1msg1_epu32 (m1, m2);
+		m0 = _mm_xor_si128 (m0, m2);
+		/* rounds 28-31 */
+		e1 = _mm_sha1nexte_epu32 (e1, m3);
+		e0 = abcd;
+		m0 = _mm_sha1msg2_epu32 (m0, m3);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 1);
+		m2 = _mm_sha1msg1_epu32 (m2, m3);
+		m1 = _mm_xor_si128 (m1, m3);
+		/* rounds 32-35 */
+		e0 = _mm_sha1nexte_epu32 (e0, m0);
+		e1 = abcd;
+		m1 = _mm_sha1msg2_epu32 (m1, m0);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 1);
+		m3 = _mm_sha1msg1_epu32 (m3, m0);
+		m2 = _mm_xor_si128 (m2, m0);
+		/* rounds 36-39 */
+		e1 = _mm_sha1nexte_epu32 (e1, m1);
+		e0 = abcd;
+		m2 = _mm_sha1msg2_epu32 (m2, m1);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 1);
+		m0 = _mm_sha1msg1_epu32 (m0, m1);
+		m3 = _mm_xor_si128 (m3, m1);
+		/* rounds 40-43 */
+		e0 = _mm_sha1nexte_epu32 (e0, m2);
+		e1 = abcd;
+		m3 = _mm_sha1msg2_epu32 (m3, m2);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 2);
+		m1 = _mm_sha1msg1_epu32 (m1, m2);
+		m0 = _mm_xor_si128 (m0, m2);
+		/* rounds 44-47 */
+		e1 = _mm_sha1nexte_epu32 (e1, m3);
+		e0 = abcd;
+		m0 = _mm_sha1msg2_epu32 (m0, m3);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 2);
+		m2 = _mm_sha1msg1_epu32 (m2, m3);
+		m1 = _mm_xor_si128 (m1, m3);
+		/* rounds 48-51 */
+		e0 = _mm_sha1nexte_epu32 (e0, m0);
+		e1 = abcd;
+		m1 = _mm_sha1msg2_epu32 (m1, m0);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 2);
+		m3 = _mm_sha1msg1_epu32 (m3, m0);
+		m2 = _mm_xor_si128 (m2, m0);
+		/* rounds 52-55 */
+		e1 = _mm_sha1nexte_epu32 (e1, m1);
+		e0 = abcd;
+		m2 = _mm_sha1msg2_epu32 (m2, m1);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 2);
+		m0 = _mm_sha1msg1_epu32 (m0, m1);
+		m3 = _mm_xor_si128 (m3, m1);
+		/* rounds 56-59 */
+		e0 = _mm_sha1nexte_epu32 (e0, m2);
+		e1 = abcd;
+		m3 = _mm_sha1msg2_epu32 (m3, m2);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 2);
+		m1 = _mm_sha1msg1_epu32 (m1, m2);
+		m0 = _mm_xor_si128 (m0, m2);
+		/* rounds 60-63 */
+		e1 = _mm_sha1nexte_epu32 (e1, m3);
+		e0 = abcd;
+		m0 = _mm_sha1msg2_epu32 (m0, m3);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 3);
+		m2 = _mm_sha1msg1_epu32 (m2, m3);
+		m1 = _mm_xor_si128 (m1, m3);
+		/* rounds 64-67 */
+		e0 = _mm_sha1nexte_epu32 (e0, m0);
+		e1 = abcd;
+		m1 = _mm_sha1msg2_epu32 (m1, m0);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 3);
+		m3 = _mm_sha1msg1_epu32 (m3, m0);
+		m2 = _mm_xor_si128 (m2, m0);
+		/* rounds 68-71 */
+		e1 = _mm_sha1nexte_epu32 (e1, m1);
+		e0 = abcd;
+		m2 = _mm_sha1msg2_epu32 (m2, m1);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 3);
+		m3 = _mm_xor_si128 (m3, m1);
+		/* rounds 72-75 */
+		e0 = _mm_sha1nexte_epu32 (e0, m2);
+		e1 = abcd;
+		m3 = _mm_sha1msg2_epu32 (m3, m2);
+		abcd = _mm_sha1rnds4_epu32 (abcd, e0, 3);
+		/* rounds 76-79 */
+		e1 = _mm_sha1nexte_epu32 (e1, m3);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32 (abcd, e1, 3);
+		e0 = _mm_sha1nexte_epu32 (e0, e0_save);
+		abcd = _mm_add_epi32 (abcd, abcd_save);
+	}
+	_mm_storeu_si128 ((__m128i *)H, _mm_shuffle_epi32 (abcd, 0x1b));
+	H[4] = _mm_extract_epi32 (e0, 3);
+}
+#endif
+
+/* whole 64 byte blocks straight from the input */
+static void shaHashBlocks(R_SHA_CTX *ctx, const ut8 *p, int n) {
+	ut32 W[80];
+	int t;
+#if R_HASH_X86
+	if ((r_hash_cpu_features () & R_HASH_CPU_SHA) && (r_hash_cpu_features () & R_HASH_CPU_SSE41)) {
+		shaBlocksNI (ctx->H, p, n);
+		return;
+	}
+#endif
+	for (; n > 0; n--, p += 64) {
+		for (t = 0; t < 16; t++)
+			W[t] = (ut32)p[4*t] << 24 | p[4*t+1] << 16 | p[4*t+2] << 8 | p[4*t+3];
+		shaCompress (ctx->H, W);
+	}
 }
 
 void SHA1_Init(R_SHA_CTX *ctx) {
@@ -96,11 +267,22 @@ void SHA1_Init(R_SHA_CTX *ctx) {
 
 void SHA1_Update(R_SHA_CTX *ctx, const void *_dataIn, int len) {
 	const unsigned char *dataIn = _dataIn;
-	int i;
+	int i, n;
 
 	/* Read the data into W and process blocks as they get full
 	 */
 	for (i = 0; i < len; i++) {
+		if (!ctx->lenW && len - i >= 64) {
+			ut64 size = ((ut64)ctx->sizeHi << 32) | ctx->sizeLo;
+			n = (len - i) / 64;
+			shaHashBlocks (ctx, dataIn + i, n);
+			size += (ut64)n * 512;
+			ctx->sizeLo = (ut32)size;
+			ctx->sizeHi = (ut32)(size >> 32);
+			i += n * 64;
+			if (i == len)
+				break;
+		}
 		ctx->W[ctx->lenW / 4] <<= 8;
 		ctx->W[ctx->lenW / 4] |= (unsigned int)dataIn[i];
 		if ((++ctx->lenW) % 64 == 0) {
@@ -36,6 +36,7 @@
 #include <assert.h>	/* assert() */
 #include "r_hash.h"
 #include "sha2.h"
+#include "cpu.h"
 
 #define WEAK_ALIASING 0
 
@@ -528,6 +529,160 @@ void SHA256_Transform(R_SHA256_CTX* context, const sha2_word32* data) {
 
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+#if R_HASH_X86
+static R_HASH_TARGET("sha,ssse3,sse4.1") void SHA256_BlocksNI(sha2_word32 state[8], const sha2_byte *p, size_t n) {
+	const __m128i mask = _mm_set_epi64x (0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i st0, st1, msg, tmp, m0, m1, m2, m3, abef_save, cdgh_save;
+
+	tmp = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *)&state[0]), 0xb1);
+	st1 = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *)&state[4]), 0x1b);
+	st0 = _mm_alignr_epi8 (tmp, st1, 8);      /* abef */
+	st1 = _mm_blend_epi16 (st1, tmp, 0xf0);   /* cdgh */
+	for (; n > 0; n--, p += SHA256_BLOCK_LENGTH) {
+		abef_save = st0;
+		cdgh_save = st1;
+		/* rounds 0-3 */
+		m0 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(p + 0)), mask);
+		msg = _mm_add_epi32 (m0, _mm_set_epi64x (0xe9b5dba5b5c0fbcfULL, 0x71374491428a2f98ULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		/* rounds 4-7 */
+		m1 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(p + 16)), mask);
+		msg = _mm_add_epi32 (m1, _mm_set_epi64x (0xab1c5ed5923f82a4ULL, 0x59f111f13956c25bULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		m0 = _mm_sha256msg1_epu32 (m0, m1);
+		/* rounds 8-11 */
+		m2 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(p + 32)), mask);
+		msg = _mm_add_epi32 (m2, _mm_set_epi64x (0x550c7dc3243185beULL, 0x12835b01d807aa98ULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		m1 = _mm_sha256msg1_epu32 (m1, m2);
+		/* rounds 12-15 */
+		m3 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(p + 48)), mask);
+		msg = _mm_add_epi32 (m3, _mm_set_epi64x (0xc19bf1749bdc06a7ULL, 0x80deb1fe72be5d74ULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		tmp = _mm_alignr_epi8 (m3, m2, 4);
+		m0 = _mm_sha256msg2_epu32 (_mm_add_epi32 (m0, tmp), m3);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		m2 = _mm_sha256msg1_epu32 (m2, m3);
+		/* rounds 16-19 */
+		msg = _mm_add_epi32 (m0, _mm_set_epi64x (0x240ca1cc0fc19dc6ULL, 0xefbe4786e49b69c1ULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		tmp = _mm_alignr_epi8 (m0, m3, 4);
+		m1 = _mm_sha256msg2_epu32 (_mm_add_epi32 (m1, tmp), m0);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		m3 = _mm_sha256msg1_epu32 (m3, m0);
+		/* rounds 20-23 */
+		msg = _mm_add_epi32 (m1, _mm_set_epi64x (0x76f988da5cb0a9dcULL, 0x4a7484aa2de92c6fULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		tmp = _mm_alignr_epi8 (m1, m0, 4);
+		m2 = _mm_sha256msg2_epu32 (_mm_add_epi32 (m2, tmp), m1);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		m0 = _mm_sha256msg1_epu32 (m0, m1);
+		/* rounds 24-27 */
+		msg = _mm_add_epi32 (m2, _mm_set_epi64x (0xbf597fc7b00327c8ULL, 0xa831c66d983e5152ULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		tmp = _mm_alignr_epi8 (m2, m1, 4);
+		m3 = _mm_sha256msg2_epu32 (_mm_add_epi32 (m3, tmp), m2);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		m1 = _mm_sha256msg1_epu32 (m1, m2);
+		/* rounds 28-31 */
+		msg = _mm_add_epi32 (m3, _mm_set_epi64x (0x1429296706ca6351ULL, 0xd5a79147c6e00bf3ULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		tmp = _mm_alignr_epi8 (m3, m2, 4);
+		m0 = _mm_sha256msg2_epu32 (_mm_add_epi32 (m0, tmp), m3);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		m2 = _mm_sha256msg1_epu32 (m2, m3);
+		/* rounds 32-35 */
+		msg = _mm_add_epi32 (m0, _mm_set_epi64x (0x53380d134d2c6dfcULL, 0x2e1b213827b70a85ULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		tmp = _mm_alignr_epi8 (m0, m3, 4);
+		m1 = _mm_sha256msg2_epu32 (_mm_add_epi32 (m1, tmp), m0);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		m3 = _mm_sha256msg1_epu32 (m3, m0);
+		/* rounds 36-39 */
+		msg = _mm_add_epi32 (m1, _mm_set_epi64x (0x92722c8581c2c92eULL, 0x766a0abb650a7354ULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		tmp = _mm_alignr_epi8 (m1, m0, 4);
+		m2 = _mm_sha256msg2_epu32 (_mm_add_epi32 (m2, tmp), m1);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		m0 = _mm_sha256msg1_epu32 (m0, m1);
+		/* rounds 40-43 */
+		msg = _mm_add_epi32 (m2, _mm_set_epi64x (0xc76c51a3c24b8b70ULL, 0xa81a664ba2bfe8a1ULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		tmp = _mm_alignr_epi8 (m2, m1, 4);
+		m3 = _mm_sha256msg2_epu32 (_mm_add_epi32 (m3, tmp), m2);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		m1 = _mm_sha256msg1_epu32 (m1, m2);
+		/* rounds 44-47 */
+		msg = _mm_add_epi32 (m3, _mm_set_epi64x (0x106aa070f40e3585ULL, 0xd6990624d192e819ULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		tmp = _mm_alignr_epi8 (m3, m2, 4);
+		m0 = _mm_sha256msg2_epu32 (_mm_add_epi32 (m0, tmp), m3);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		m2 = _mm_sha256msg1_epu32 (m2, m3);
+		/* rounds 48-51 */
+		msg = _mm_add_epi32 (m0, _mm_set_epi64x (0x34b0bcb52748774cULL, 0x1e376c0819a4c116ULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		tmp = _mm_alignr_epi8 (m0, m3, 4);
+		m1 = _mm_sha256msg2_epu32 (_mm_add_epi32 (m1, tmp), m0);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		m3 = _mm_sha256msg1_epu32 (m3, m0);
+		/* rounds 52-55 */
+		msg = _mm_add_epi32 (m1, _mm_set_epi64x (0x682e6ff35b9cca4fULL, 0x4ed8aa4a391c0cb3ULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		tmp = _mm_alignr_epi8 (m1, m0, 4);
+		m2 = _mm_sha256msg2_epu32 (_mm_add_epi32 (m2, tmp), m1);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		/* rounds 56-59 */
+		msg = _mm_add_epi32 (m2, _mm_set_epi64x (0x8cc7020884c87814ULL, 0x78a5636f748f82eeULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		tmp = _mm_alignr_epi8 (m2, m1, 4);
+		m3 = _mm_sha256msg2_epu32 (_mm_add_epi32 (m3, tmp), m2);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		/* rounds 60-63 */
+		msg = _mm_add_epi32 (m3, _mm_set_epi64x (0xc67178f2bef9a3f7ULL, 0xa4506ceb90befffaULL));
+		st1 = _mm_sha256rnds2_epu32 (st1, st0, msg);
+		msg = _mm_shuffle_epi32 (msg, 0x0e);
+		st0 = _mm_sha256rnds2_epu32 (st0, st1, msg);
+		st0 = _mm_add_epi32 (st0, abef_save);
+		st1 = _mm_add_epi32 (st1, cdgh_save);
+	}
+	tmp = _mm_shuffle_epi32 (st0, 0x1b);      /* feba */
+	st1 = _mm_shuffle_epi32 (st1, 0xb1);      /* dchg */
+	_mm_storeu_si128 ((__m128i *)&state[0], _mm_blend_epi16 (tmp, st1, 0xf0));
+	_mm_storeu_si128 ((__m128i *)&state[4], _mm_alignr_epi8 (st1, tmp, 8));
+}
+#endif
+
+/* n whole blocks, with the SHA extensions when the cpu has them */
+static void SHA256_Blocks(R_SHA256_CTX* context, const sha2_byte *data, size_t n) {
+#if R_HASH_X86
+	if ((r_hash_cpu_features () & R_HASH_CPU_SHA) && (r_hash_cpu_features () & R_HASH_CPU_SSE41)) {
+		SHA256_BlocksNI (context->state, data, n);
+		return;
+	}
+#endif
+	for (; n > 0; n--, data += SHA256_BLOCK_LENGTH)
+		SHA256_Transform(context, (const sha2_word32*)data);
+}
+
 void SHA256_Update(R_SHA256_CTX* context, const sha2_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
 
@@ -550,7 +705,7 @@ void SHA256_Update(R_SHA256_CTX* context, const sha2_byte *data, size_t len) {
 			context->bitcount += freespace << 3;
 			len -= freespace;
 			data += freespace;
-			SHA256_Transform(context, (sha2_word32*)context->buffer);
+			SHA256_Blocks(context, context->buffer, 1);
 		} else {
 			/* The buffer is not yet full */
 			MEMCPY_BCOPY(&context->buffer[usedspace], data, len);
@@ -560,12 +715,13 @@ void SHA256_Update(R_SHA256_CTX* context, const sha2_byte *data, size_t len) {
 			return;
 		}
 	}
-	while (len >= SHA256_BLOCK_LENGTH) {
+	if (len >= SHA256_BLOCK_LENGTH) {
 		/* Process as many complete blocks as we can */
-		SHA256_Transform(context, (sha2_word32*)data);
-		context->bitcount += SHA256_BLOCK_LENGTH << 3;
-		len -= SHA256_BLOCK_LENGTH;
-		data += SHA256_BLOCK_LENGTH;
+		size_t n = len / SHA256_BLOCK_LENGTH;
+		SHA256_Blocks(context, data, n);
+		context->bitcount += (ut64)n * SHA256_BLOCK_LENGTH << 3;
+		len -= n * SHA256_BLOCK_LENGTH;
+		data += n * SHA256_BLOCK_LENGTH;
 	}
 	if (len > 0) {
 		/* There's left-overs, so save 'em */
@@ -602,7 +758,7 @@ void SHA256_Final(sha2_byte digest[], R_SHA256_CTX* context) {
 					MEMSET_BZERO(&context->buffer[usedspace], SHA256_BLOCK_LENGTH - usedspace);
 				}
 				/* Do second-to-last transform: */
-				SHA256_Transform(context, (sha2_word32*)context->buffer);
+				SHA256_Blocks(context, context->buffer, 1);
 
 				/* And set-up for the last transform: */
 				MEMSET_BZERO(context->buffer, SHA256_SHORT_BLOCK_LENGTH);
@@ -625,7 +781,7 @@ void SHA256_Final(sha2_byte digest[], R_SHA256_CTX* context) {
 #endif
 
 		/* Final transform: */
-		SHA256_Transform(context, (sha2_word32*)context->buffer);
+		SHA256_Blocks(context, context->buffer, 1);
 
 #if BYTE_ORDER == LITTLE_ENDIAN
 		{
@@ -0,0 +1,95 @@
+/* r_hash kernels throughput: portable code vs the cpu specific one */
+
+#include <r_hash.h>
+#include <r_util.h>
+
+static const char *algos[] = {
+	"crc32", "crc32c", "adler32", "sha1", "sha256", "md5", NULL
+};
+
+/* digests of "123456789" */
+static const struct { const char *algo, *hex; } vectors[] = {
+	{ "crc32", "cbf43926" },
+	{ "crc32c", "e3069283" },
+	{ "adler32", "de011e09" },
+	{ "sha1", "f7c3bc1d808e04732adf679965ccc34ca7ae3441" },
+	{ "sha256", "15e2b0d3c33891ebb0f1ef609ec419420c20e320ce94c65fbc8c3312448eb225" },
+	{ NULL, NULL }
+};
+
+static double run(ut64 algo, const ut8 *buf, int len, int rounds, ut8 *digest) {
+	RHash *ctx = r_hash_new (R_TRUE, algo);
+	ut64 t0, t1;
+	int i, dlen = 0;
+
+	t0 = r_sys_now ();
+	for (i = 0; i < rounds; i++)
+		dlen = r_hash_calculate (ctx, algo, buf, len);
+	t1 = r_sys_now ();
+	memcpy (digest, ctx->digest, dlen);
+	r_hash_free (ctx);
+	return (double)len * rounds / (t1 - t0 + 1) / 1000;
+}
+
+static char *hex(const ut8 *d, int len) {
+	static char s[256];
+	int i;
+	for (i = 0; i < len; i++)
+		sprintf (s + i * 2, "%02x", d[i]);
+	return s;
+}
+
+int main(int argc, char **argv) {
+	int i, j, len = argc > 1? atoi (argv[1]): 64 << 20;
+	int fail = 0, cpu = r_hash_cpu_features ();
+	ut8 *buf = malloc (len), d0[128], d1[128];
+	double gb0, gb1;
+
+	if (!buf)
+		return 1;
+	for (i = 0; i < len; i++)
+		buf[i] = (i * 2654435761U) >> 13;
+	printf ("cpu:%s%s%s%s%s\n", (cpu & R_HASH_CPU_SSSE3)? " ssse3": "",
+		(cpu & R_HASH_CPU_SSE41)? " sse4.1": "",
+		(cpu & R_HASH_CPU_SSE42)? " sse4.2": "",
+		(cpu & R_HASH_CPU_PCLMUL)? " pclmul": "",
+		(cpu & R_HASH_CPU_SHA)? " sha": "");
+	for (i = 0; vectors[i].algo; i++) {
+		ut64 algo = r_hash_name_to_bits (vectors[i].algo);
+		int dlen = r_hash_size (algo);
+		for (j = 0; j < 2; j++) {
+			r_hash_cpu_use (j? cpu: 0);
+			run (algo, (const ut8 *)"123456789", 9, 1, d0);
+			if (strcmp (hex (d0, dlen), vectors[i].hex)) {
+				printf ("[-] %s%s: %s\n", vectors[i].algo,
+					j? "": " (portable)", hex (d0, dlen));
+				fail++;
+			}
+		}
+	}
+	printf ("%-8s %10s %10s\n", "algo", "portable", "native");
+	for (i = 0; algos[i]; i++) {
+		ut64 algo = r_hash_name_to_bits (algos[i]);
+		int dlen = r_hash_size (algo);
+		r_hash_cpu_use (0);
+		gb0 = run (algo, buf, len, 4, d0);
+		r_hash_cpu_use (cpu);
+		gb1 = run (algo, buf, len, 4, d1);
+		/* odd lengths and offsets go through the scalar heads and tails */
+		for (j = 1; j < 404 && !memcmp (d0, d1, dlen); j++) {
+			int n = (j < 400)? j: len / 3 - j;
+			r_hash_cpu_use (0);
+			run (algo, buf + j % 13, n, 1, d0);
+			r_hash_cpu_use (cpu);
+			run (algo, buf + j % 13, n, 1, d1);
+		}
+		if (memcmp (d0, d1, dlen)) {
+			printf ("[-] %s: native kernel differs\n", algos[i]);
+			fail++;
+		}
+		printf ("%-8s %6.2f GB/s %6.2f GB/s\n", algos[i], gb0, gb1);
+	}
+	printf ("%s\n", fail? "[-] failed": "[+] ok");
+	free (buf);
+	return fail? 1: 0;
+}
@@ -6,6 +6,8 @@ extern "C" {
 #endif
 
 /** hashtable **/
+/* open addressing with robin hood linear probing, the hash is the key.
+ * free slots have NULL data */
 typedef struct r_hashtable_entry_t {
 	ut32 hash;
 	void *data;
@@ -14,11 +16,9 @@ typedef struct r_hashtable_entry_t {
 typedef struct r_hashtable_t {
 	RHashTableEntry *table;
 	ut32 size;
-	ut32 rehash;
 	ut32 max_entries;
 	ut32 size_index;
 	ut32 entries;
-	ut32 deleted_entries;
 } RHashTable;
 
 typedef struct r_hashtable64_entry_t {
@@ -29,11 +29,9 @@ typedef struct r_hashtable64_entry_t {
 typedef struct r_hashtable64_t {
 	RHashTable64Entry *table;
 	ut64 size;
-	ut64 rehash;
 	ut64 max_entries;
 	ut64 size_index;
 	ut64 entries;
-	ut64 deleted_entries;
 } RHashTable64;
 
 R_API RHashTable* r_hashtable_new(void);
@@ -52,6 +52,21 @@ typedef struct r_anal_meta_item_t {
 	int space;
 } RAnalMetaItem;
 
+/* items of one meta type. The hash finds them by start address and the
+ * array keeps them sorted by address for the range queries. New items
+ * are appended and merged in by the next ordered query */
+typedef struct r_anal_meta_store_t {
+	RHashTable64 *ht;
+	RAnalMetaItem **items;
+	ut64 *maxto; // highest 'to' of items[0..i]
+	int n;
+	int size;
+	int sorted; // items[0..sorted) are in order
+	int dead; // deleted items left in the array
+	int stale; // maxto must be recomputed
+	RThreadLock *lock; // ordered queries may run from many readers
+} RAnalMetaStore;
+
 typedef struct {
 	struct r_anal_t *anal;
 	int type;
@@ -345,6 +360,10 @@ enum {
 	R_META_TYPE_COMMENT = 'C',
 };
 
+/* every type has its own store, in this order */
+#define R_META_TYPES "Ccdfhms"
+#define R_META_NTYPES 7
+
 // anal
 enum {
 	R_ANAL_OP_FAMILY_UNKNOWN = 0,
@@ -558,6 +577,25 @@ typedef struct r_anal_callbacks_t {
 
 #define R_ANAL_ESIL_GOTO_LIMIT 4096
 
+#define R_ANAL_OPCACHE_MAXLEN 16
+
+/* analyzed opcodes keyed by address, bytes and anal state */
+typedef struct r_anal_opcache_item_t {
+	ut64 state;
+	ut8 bytes[R_ANAL_OPCACHE_MAXLEN];
+	int ret;
+	ut32 used;
+	struct r_anal_op_t *op;
+} RAnalOpCacheItem;
+
+typedef struct r_anal_opcache_t {
+	RAnalOpCacheItem *items;
+	int size; // power of two, 0 when disabled
+	ut32 tick;
+	ut64 hits;
+	ut64 misses;
+} RAnalOpCache;
+
 typedef struct r_anal_t {
 	char *cpu;
 	int bits;
@@ -599,7 +637,8 @@ typedef struct r_anal_t {
 	RList *plugins;
 	Sdb *sdb_xrefs;
 	Sdb *sdb_types;
-	Sdb *sdb_meta; // TODO: Future r_meta api
+	Sdb *sdb_meta; // meta_stores serialized by r_meta_sync
+	RAnalMetaStore *meta_stores[R_META_NTYPES];
 	RSpaces meta_spaces;
 	PrintfCallback printf;
 //moved from RAnalFcn
@@ -617,6 +656,15 @@ typedef struct r_anal_t {
 	Sdb *sdb_hints; // OK
 	//RList *hints; // XXX use better data structure here (slist?)
 	RAnalCallbacks cb;
+	RAnalOpCache opcache;
+	RAnalRange *dirty; // written since the last r_anal_fcn_update_dirty
+	int ndirty;
+	/* Analysis results (fcns, sdb_xrefs, meta_stores, sdb_hints) may be
+	 * queried from many threads while holding the read side of this
+	 * lock, also for as long as the returned functions are used. Code
+	 * changing them takes the write side. Decoding with r_anal_op is
+	 * not covered: it uses the plugin state and the opcache */
+	RThreadRWLock *lock;
 } RAnal;
 
 typedef struct r_anal_hint_t {
@@ -697,6 +745,7 @@ typedef struct r_anal_bb_t {
 	int returnbb;
 	int conditional;
 	int traced;
+	int dirty; /* bytes changed since it was analyzed */
 	char *label;
 	ut8 *fingerprint;
 	RAnalDiff *diff;
@@ -761,11 +810,25 @@ typedef struct r_anal_ref_t {
 	ut64 at;
 } RAnalRef;
 
+typedef struct r_anal_refline_key_t {
+	ut64 addr;
+	int pos;	// position of the line in the list
+} RAnalReflineKey;
+
+/* sorted views of a refline list, for the per instruction lookups */
+typedef struct r_anal_refline_idx_t {
+	struct r_anal_refline_t **lines;	// in list order
+	RAnalReflineKey *from;	// sorted by source address
+	RAnalReflineKey *to;	// sorted by target address
+	int n;
+} RAnalReflineIdx;
+
 typedef struct r_anal_refline_t {
 	ut64 from;
 	ut64 to;
 	int index;
 	struct list_head list;
+	RAnalReflineIdx *idx;	// only set on the list head
 } RAnalRefline;
 
 typedef struct r_anal_state_type_t {
@@ -1111,6 +1174,9 @@ R_API int r_anal_set_big_endian(RAnal *anal, int boolean);
 R_API char *r_anal_strmask (RAnal *anal, const char *data);
 R_API void r_anal_trace_bb(RAnal *anal, ut64 addr);
 R_API const char *r_anal_fcn_type_tostring(int type);
+R_API void r_anal_lock_read(RAnal *anal);
+R_API void r_anal_lock_write(RAnal *anal);
+R_API void r_anal_unlock(RAnal *anal);
 
 /* bb.c */
 R_API RAnalBlock *r_anal_bb_new(void);
@@ -1128,6 +1194,8 @@ R_API void r_anal_op_free(void *op);
 R_API void r_anal_op_fini(RAnalOp *op);
 R_API int r_anal_op_is_eob (RAnalOp *op);
 R_API RList *r_anal_op_list_new(void);
+R_API int r_anal_opcache_set(RAnal *anal, int size);
+R_API void r_anal_opcache_flush(RAnal *anal);
 R_API int r_anal_op(RAnal *anal, RAnalOp *op, ut64 addr,
 		const ut8 *data, int len);
 R_API RAnalOp *r_anal_op_hexstr(RAnal *anal, ut64 addr,
@@ -1219,6 +1287,8 @@ R_API int r_anal_fcn_var_del_byindex (RAnal *a, ut64 fna, const char kind,
 R_API int r_anal_fcn_cc(RAnalFunction *fcn);
 R_API int r_anal_fcn_split_bb(RAnal *anal, RAnalFunction *fcn, RAnalBlock *bb, ut64 addr);
 R_API int r_anal_fcn_bb_overlaps(RAnalFunction *fcn, RAnalBlock *bb);
+R_API int r_anal_fcn_bb_dirty(RAnal *anal, ut64 addr, int len);
+R_API int r_anal_fcn_update_dirty(RAnal *anal);
 R_API RAnalVar *r_anal_fcn_get_var(RAnalFunction *fs, int num, int dir);
 R_API void r_anal_fcn_fit_overlaps (RAnal *anal, RAnalFunction *fcn);
 R_API RAnalFunction *r_anal_fcn_next(RAnal *anal, ut64 addr);
@@ -1322,6 +1392,7 @@ R_API RAnalCond *r_anal_cond_new_from_string(const char *str);
 R_API RAnalRefline *r_anal_reflines_get(RAnal *anal,
 	ut64 addr, const ut8 *buf, ut64 len, int nlines, int linesout, int linescall);
 R_API int r_anal_reflines_middle(RAnal *anal, RAnalRefline *list, ut64 addr, int len);
+R_API void r_anal_reflines_free(RAnalRefline *list);
 R_API char* r_anal_reflines_str(void *core, ut64 addr, int opts);
 R_API RAnalRefline *r_anal_reflines_fcn_get( struct r_anal_t *anal, RAnalFunction *fcn,
     int nlines, int linesout, int linescall);
@@ -1369,6 +1440,11 @@ R_API int r_meta_set_string(RAnal *m, int type, ut64 addr, const char *s);
 R_API int r_meta_del(RAnal *m, int type, ut64 from, ut64 size, const char *str);
 R_API int r_meta_add(RAnal *m, int type, ut64 from, ut64 size, const char *str);
 R_API RAnalMetaItem *r_meta_find(RAnal *m, ut64 off, int type, int where);
+R_API RAnalMetaItem *r_meta_get_at(RAnal *m, ut64 addr, int type);
+R_API RAnalMetaItem *r_meta_get_in(RAnal *m, ut64 addr, int type);
+R_API RList *r_meta_get_range(RAnal *m, int type, ut64 from, ut64 to);
+R_API void r_meta_sync(RAnal *m);
+R_API int r_meta_load(RAnal *m);
 R_API int r_meta_cleanup(RAnal *m, ut64 from, ut64 to);
 R_API const char *r_meta_type_to_string(int type);
 R_API RList *r_meta_enumerate(RAnal *a, int type);
@@ -68,6 +68,30 @@ typedef struct r_asm_op_t {
 	char buf_hex[R_ASM_BUFSIZE];
 } RAsmOp;
 
+enum {
+	R_ASM_OPREC_VALID = 0,
+	R_ASM_OPREC_INVALID,
+};
+
+/* one decoded instruction of a batch */
+typedef struct r_asm_op_rec_t {
+	ut64 addr;
+	int size;
+	int type;
+	ut32 text;	// offset of its nul terminated asm in the batch text
+} RAsmOpRec;
+
+/* caller owned buffers filled by r_asm_disassemble_batch */
+typedef struct r_asm_batch_t {
+	RAsmOpRec *ops;
+	int nops;
+	int maxops;
+	char *text;
+	int textlen;
+	int textsize;
+	int minlen;	// bytes kept back for a truncated last instruction
+} RAsmBatch;
+
 typedef struct r_asm_code_t {
 	int len;
 	ut8 *buf;
@@ -85,6 +109,28 @@ typedef struct {
 } RAsmEqu;
 
 #define _RAsmPlugin struct r_asm_plugin_t
+#define R_ASM_OPCACHE_MAXLEN 16
+
+/* decoded instructions keyed by address, bytes and asm state */
+typedef struct r_asm_opcache_item_t {
+	ut64 pc;
+	ut64 state;
+	ut8 bytes[R_ASM_OPCACHE_MAXLEN];
+	int size;
+	int payload;
+	int ret;
+	ut32 used;
+	char *str;
+} RAsmOpCacheItem;
+
+typedef struct r_asm_opcache_t {
+	RAsmOpCacheItem *items;
+	int size; // power of two, 0 when disabled
+	ut32 tick;
+	ut64 hits;
+	ut64 misses;
+} RAsmOpCache;
+
 typedef struct r_asm_t {
 	char *cpu;
 	int bits;
@@ -101,6 +147,7 @@ typedef struct r_asm_t {
 	RSyscall *syscall;
 	RNum *num;
 	char *features;
+	RAsmOpCache opcache;
 } RAsm;
 
 typedef int (*RAsmModifyCallback)(RAsm *a, ut8 *buf, int field, ut64 val);
@@ -120,6 +167,7 @@ typedef struct r_asm_plugin_t {
 	RAsmModifyCallback modify;
 	int (*set_subarch)(RAsm *a, const char *buf);
 	const char *features;
+	int reentrant;	// no global decoder state, r_asm_sweep may run it in threads
 } RAsmPlugin;
 
 #ifdef R_API
@@ -139,8 +187,12 @@ R_API int r_asm_set_big_endian(RAsm *a, int boolean);
 R_API int r_asm_set_syntax(RAsm *a, int syntax);
 R_API int r_asm_set_pc(RAsm *a, ut64 pc);
 R_API int r_asm_disassemble(RAsm *a, RAsmOp *op, const ut8 *buf, int len);
+R_API int r_asm_opcache_set(RAsm *a, int size);
+R_API void r_asm_opcache_flush(RAsm *a);
 R_API int r_asm_assemble(RAsm *a, RAsmOp *op, const char *buf);
 R_API RAsmCode* r_asm_mdisassemble(RAsm *a, const ut8 *buf, int len);
+R_API int r_asm_disassemble_batch(RAsm *a, RAsmBatch *b, const ut8 *buf, int len);
+R_API int r_asm_sweep(RAsm *a, RAsmBatch *b, const ut8 *buf, int len, int nthreads);
 R_API RAsmCode* r_asm_mdisassemble_hexstr(RAsm *a, const char *hexstr);
 R_API RAsmCode* r_asm_massemble(RAsm *a, const char *buf);
 R_API RAsmCode* r_asm_assemble_file(RAsm *a, const char *file);
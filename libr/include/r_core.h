@@ -144,6 +144,7 @@ typedef struct r_core_t {
 	RList *watchers;
 	RList *scriptstack;
 	RList *tasks;
+	RList *graph_layouts; // basic block graph positions cached by graph.c
 	int cmd_depth;
 	ut8 switch_file_view;
 	Sdb *sdb;
@@ -212,6 +213,7 @@ R_API int r_core_visual_types(RCore *core);
 R_API int r_core_visual(RCore *core, const char *input);
 R_API int r_core_visual_graph(RCore *core, RAnalFunction *_fcn, int is_interactive);
 R_API int r_core_fcn_graph(RCore *core, RAnalFunction *_fcn);
+R_API int r_core_graph_layout(RGraph *graph, const int *wh, int *xy);
 R_API int r_core_visual_panels(RCore *core);
 R_API int r_core_visual_cmd(RCore *core, int ch);
 R_API void r_core_visual_seek_animation (RCore *core, ut64 addr);
@@ -360,6 +362,11 @@ R_API int r_core_project_save(RCore *core, const char *file);
 R_API char *r_core_project_info(RCore *core, const char *file);
 R_API char *r_core_project_notes_file (RCore *core, const char *file);
 
+/* acache.c */
+R_API char *r_core_anal_cache_file(RCore *core);
+R_API int r_core_anal_cache_save(RCore *core, const char *file);
+R_API int r_core_anal_cache_load(RCore *core, const char *file);
+
 R_API char *r_core_sysenv_begin(RCore *core, const char *cmd);
 R_API void r_core_sysenv_end(RCore *core, const char *cmd);
 R_API void r_core_sysenv_help(const RCore* core);
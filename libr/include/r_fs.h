@@ -42,12 +42,37 @@ typedef struct r_fs_file_t {
 	void *ptr; // internal pointer
 } RFSFile;
 
+typedef struct r_fs_cache_block_t {
+	ut64 blk;
+	ut8 *buf;
+	struct r_fs_cache_block_t *prev, *next;
+} RFSCacheBlock;
+
+/* least recently used blocks read by a mounted filesystem, shared by
+ * the workers of r_fs_dir_dump. lock guards the blocks and counters,
+ * iolock the io reads, which are done without holding lock */
+typedef struct r_fs_cache_t {
+	int bsize;
+	int size;	/* max blocks kept */
+	int count;
+	RHashTable64 *ht;	/* block number -> RFSCacheBlock */
+	RFSCacheBlock *head, *tail;	/* most recently used first */
+	ut64 hits, misses;
+	ut32 gen;	/* bumped by r_fs_cache_reset */
+	RThreadLock *lock;
+	RThreadLock *iolock;
+} RFSCache;
+
+#define R_FS_CACHE_BSIZE 4096
+#define R_FS_CACHE_SIZE 1024
+
 typedef struct r_fs_root_t {
 	char *path;
 	ut64 delta;
 	struct r_fs_plugin_t *p;
 	void *ptr;
 	RIOBind iob;
+	RFSCache *cache;
 } RFSRoot;
 
 typedef struct r_fs_plugin_t {
@@ -56,6 +81,7 @@ typedef struct r_fs_plugin_t {
 	RFSFile* (*slurp)(RFSRoot *root, const char *path);
 	RFSFile* (*open)(RFSRoot *root, const char *path);
 	boolt (*read)(RFSFile *fs, ut64 addr, int len);
+	int (*read_at)(RFSFile *fs, ut64 addr, ut8 *buf, int len);
 	void (*close)(RFSFile *fs);
 	RList *(*dir)(RFSRoot *root, const char *path, int view);
 	void (*init)(void);
@@ -106,9 +132,12 @@ R_API RList *r_fs_root(RFS *fs, const char *path);
 R_API RFSFile *r_fs_open(RFS* fs, const char *path);
 R_API void r_fs_close(RFS* fs, RFSFile *file);
 R_API int r_fs_read(RFS* fs, RFSFile *file, ut64 addr, int len);
+R_API int r_fs_read_at(RFS* fs, RFSFile *file, ut64 addr, ut8 *buf, int len);
 R_API RFSFile *r_fs_slurp(RFS* fs, const char *path);
 R_API RList *r_fs_dir(RFS* fs, const char *path);
 R_API int r_fs_dir_dump(RFS* fs, const char *path, const char *name);
+R_API int r_fs_dir_dump_threads(RFS* fs, const char *path, const char *name, int nthreads);
+R_API int r_fs_threads(int n);
 R_API RList *r_fs_find_name(RFS* fs, const char *name, const char *glob);
 R_API RList *r_fs_find_off(RFS* fs, const char *name, ut64 off);
 R_API RList *r_fs_partitions(RFS* fs, const char *ptype, ut64 delta);
@@ -120,6 +149,13 @@ R_API RFSFile *r_fs_file_new(RFSRoot *root, const char *path);
 R_API void r_fs_file_free(RFSFile *file);
 R_API RFSRoot *r_fs_root_new(const char *path, ut64 delta);
 R_API void r_fs_root_free(RFSRoot *root);
+R_API int r_fs_root_read(RFSRoot *root, ut64 addr, ut8 *buf, int len);
+
+/* cache.c */
+R_API RFSCache *r_fs_cache_new(int bsize, int size);
+R_API void r_fs_cache_free(RFSCache *c);
+R_API void r_fs_cache_reset(RFSCache *c);
+R_API int r_fs_cache_read(RFSCache *c, RIOBind *iob, ut64 addr, ut8 *buf, int len);
 R_API RFSPartition *r_fs_partition_new(int num, ut64 start, ut64 length);
 R_API void r_fs_partition_free(RFSPartition *p);
 R_API const char *r_fs_partition_type(const char *part, int type);
@@ -70,6 +70,7 @@ typedef struct r_hash_seed_t {
 #define R_HASH_SIZE_SHA384 48
 #define R_HASH_SIZE_SHA512 64
 #define R_HASH_SIZE_ADLER32 4
+#define R_HASH_SIZE_CRC32C 4
 
 #define R_HASH_NONE 0
 #define R_HASH_MD5 1
@@ -89,8 +90,15 @@ typedef struct r_hash_seed_t {
 #define R_HASH_MOD255 16384
 #define R_HASH_XXHASH 32768
 #define R_HASH_ADLER32 65536
+#define R_HASH_CRC32C 131072
 #define R_HASH_ALL 0xFFFF
 
+#define R_HASH_CPU_SSSE3 1
+#define R_HASH_CPU_SSE41 2
+#define R_HASH_CPU_SSE42 4
+#define R_HASH_CPU_PCLMUL 8
+#define R_HASH_CPU_SHA 16
+
 #ifdef R_API
 /* OO */
 R_API RHash *r_hash_new(int rst, int flags);
@@ -112,6 +120,12 @@ R_API const char *r_hash_name(ut64 bit);
 R_API ut64 r_hash_name_to_bits(const char *name);
 R_API int r_hash_size(ut64 bit);
 R_API int r_hash_calculate(RHash *ctx, ut64 algobit, const ut8 *input, int len);
+R_API int r_hash_threads(int n);
+R_API int r_hash_cpu_features(void);
+R_API void r_hash_cpu_use(int mask);
+R_API int r_hash_calculate_blocks(ut64 algobit, const ut8 *buf, ut64 len, int bsize, ut8 *out, int nthreads);
+R_API int r_hash_calculate_root(ut64 algobit, ut8 *leaves, int n, int nthreads);
+R_API int r_hash_calculate_tree(ut64 algobit, const ut8 *buf, ut64 len, int bsize, ut8 *out, int nthreads);
 
 /* checksums */
 /* XXX : crc16 should use 0 as arg0 by default */
@@ -119,6 +133,7 @@ R_API int r_hash_calculate(RHash *ctx, ut64 algobit, const ut8 *input, int len);
 R_API ut8 r_hash_deviation(const ut8 *b, ut64 len);
 R_API ut16 r_hash_crc16(ut16 crc, const ut8 *buffer, ut64 len);
 R_API ut32 r_hash_crc32(const ut8 *buf, ut64 len);
+R_API ut32 r_hash_crc32c(const ut8 *buf, ut64 len);
 R_API ut32 r_hash_adler32(const ut8 *buf, int len);
 R_API ut32 r_hash_xxhash(const ut8 *buf, ut64 len);
 R_API ut8 r_hash_xor(const ut8 *b, ut64 len);
@@ -144,11 +144,13 @@ typedef struct r_io_t {
 	int buffer_enabled;
 	int ff;
 	int autofd;
+	int gzidx; /* keep the gzip:// access points in <file>.gzidx */
 	char *runprofile;
 	/* Core Callbacks  (used by rap) */
 	void *user;
 	int (*cb_core_cmd)(void *user, const char *str);
 	char* (*cb_core_cmdstr)(void *user, const char *str);
+	void (*cb_core_post_write)(void *user, ut64 addr, int len);
 } RIO;
 
 typedef struct r_io_plugin_t {
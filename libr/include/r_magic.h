@@ -230,6 +230,7 @@ struct mlist {
 	int mapped;  /* allocation type: 0 => apprentice_file
 		      *                  1 => apprentice_map + malloc
 		      *                  2 => apprentice_map + mmap */
+	struct r_magic_index *index;	/* candidates of the top level tests */
 	struct mlist *next, *prev;
 };
 
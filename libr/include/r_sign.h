@@ -29,6 +29,8 @@ typedef struct r_sign_item_t {
 	ut8 *mask;
 } RSignItem;
 
+typedef struct r_sign_index_t RSignIndex;
+
 typedef struct r_sign_t {
 	int s_anal;
 	int s_byte;
@@ -37,6 +39,7 @@ typedef struct r_sign_t {
 	char ns[32]; // namespace
 	PrintfCallback printf;
 	RList *items;
+	RSignIndex *index; /* lazily built by r_sign_check() */
 } RSign;
 
 typedef int (*RSignCallback)(RSignItem *si, void *user);
@@ -10,6 +10,7 @@
 #define HAVE_PTHREAD 0
 #define R_TH_TID HANDLE
 #define R_TH_LOCK_T PCRITICAL_SECTION
+#define R_TH_RWLOCK_T SRWLOCK
 //HANDLE
 
 #elif HAVE_PTHREAD
@@ -17,6 +18,7 @@
 #include <pthread.h>
 #define R_TH_TID pthread_t
 #define R_TH_LOCK_T pthread_mutex_t
+#define R_TH_RWLOCK_T pthread_rwlock_t
 
 #else
 #error Threading library only supported for ptrace and w32
@@ -33,6 +35,12 @@ typedef struct r_th_lock_t {
 	R_TH_LOCK_T lock;
 } RThreadLock;
 
+/* many readers or a single writer */
+typedef struct r_th_rwlock_t {
+	int writer;
+	R_TH_RWLOCK_T lock;
+} RThreadRWLock;
+
 typedef struct r_th_t {
 	R_TH_TID tid;
 	RThreadLock *lock;
@@ -42,6 +50,7 @@ typedef struct r_th_t {
 	int breaked;   // thread aims to be interruped
 	int delay;     // delay the startup of the thread N seconds
 	int ready;     // thread is properly setup
+	int joined;    // r_th_wait already collected it
 } RThread;
 
 typedef struct r_th_pool_t {
@@ -66,6 +75,12 @@ R_API int r_th_lock_enter(RThreadLock *thl);
 R_API int r_th_lock_leave(RThreadLock *thl);
 R_API void *r_th_lock_free(RThreadLock *thl);
 
+R_API RThreadRWLock *r_th_rwlock_new(void);
+R_API void r_th_rwlock_read(RThreadRWLock *thl);
+R_API void r_th_rwlock_write(RThreadRWLock *thl);
+R_API void r_th_rwlock_unlock(RThreadRWLock *thl);
+R_API void *r_th_rwlock_free(RThreadRWLock *thl);
+
 typedef struct r_thread_msg_t {
 	char *text;
 	char done;
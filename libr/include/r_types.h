@@ -90,6 +90,14 @@
   #define FUNC_ATTR_ALWAYS_INLINE
 #endif
 
+/* storage private to each thread, for the static state of decoders
+ * and filesystems */
+#ifdef _MSC_VER
+  #define R_TH_LOCAL __declspec(thread)
+#else
+  #define R_TH_LOCAL __thread
+#endif
+
 #include <r_userconf.h>
 #include <r_types_base.h>
 
@@ -272,6 +272,12 @@ typedef struct r_graph_node_t {
 	RList *in_nodes;
 	RList *all_neighbours;
 	RListFree free;
+	/* contiguous copies of out_nodes/in_nodes, same order */
+	struct r_graph_node_t **out;
+	struct r_graph_node_t **in;
+	int n_out, n_in;
+	int out_size, in_size;
+	RListIter *iter; /* position in RGraph.nodes */
 } RGraphNode;
 
 typedef struct r_graph_edge_t {
@@ -284,8 +290,18 @@ typedef struct r_graph_t {
 	unsigned int n_edges;
 	int last_index;
 	RList *nodes; /* RGraphNode */
+	RGraphNode **index; /* idx -> node, NULL once deleted */
+	int index_size;
 } RGraph;
 
+/* non-allocating iteration, the graph must not change inside the loop */
+#define r_graph_foreach_node(g, i, n) \
+	for (i = 0; i < (g)->last_index; i++) if (((n) = (g)->index[i]))
+#define r_graph_foreach_out(n, i, m) \
+	for (i = 0; i < (n)->n_out && ((m) = (n)->out[i]); i++)
+#define r_graph_foreach_in(n, i, m) \
+	for (i = 0; i < (n)->n_in && ((m) = (n)->in[i]); i++)
+
 typedef struct r_graph_visitor_t {
 	void (*discover_node)(RGraphNode *n, struct r_graph_visitor_t *vis);
 	void (*finish_node)(RGraphNode *n, struct r_graph_visitor_t *vis);
@@ -330,6 +346,7 @@ R_API void r_graph_add_edge (RGraph *g, RGraphNode *from, RGraphNode *to);
 R_API void r_graph_del_edge (RGraph *g, RGraphNode *from, RGraphNode *to);
 R_API const RList *r_graph_get_neighbours (const RGraph *g, const RGraphNode *n);
 R_API RGraphNode *r_graph_nth_neighbour (const RGraph *g, const RGraphNode *n, int nth);
+R_API RGraphNode *r_graph_nth_innode (const RGraph *g, const RGraphNode *n, int nth);
 R_API const RList *r_graph_innodes (const RGraph *g, const RGraphNode *n);
 R_API const RList *r_graph_all_neighbours (const RGraph *g, const RGraphNode *n);
 R_API int r_graph_adjacent (const RGraph *g, const RGraphNode *from, const RGraphNode *to);
@@ -600,6 +617,7 @@ R_API char *r_file_tmpdir(void);
 
 R_API ut64 r_sys_now(void);
 R_API int r_sys_fork(void);
+R_API int r_sys_cpus(void);
 R_API int r_sys_stop (void);
 R_API char *r_sys_pid_to_path(int pid);
 R_API int r_sys_run(const ut8 *buf, int len);
@@ -30,6 +30,7 @@ int cdb_init(struct cdb *, int fd);
 void cdb_findstart(struct cdb *);
 int cdb_read(struct cdb *, char *, unsigned int, ut32);
 int cdb_findnext(struct cdb *, ut32 u, const char *, ut32);
+int cdb_nextkv(struct cdb *, ut32 *pos, const char **key, ut32 *klen, const char **val, ut32 *vlen);
 
 #define cdb_datapos(c) ((c)->dpos)
 #define cdb_datalen(c) ((c)->dlen)
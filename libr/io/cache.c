@@ -122,6 +122,8 @@ R_API int r_io_cache_write(RIO *io, ut64 addr, const ut8 *buf, int len) {
 #endif
 	memcpy (ch->data, buf, len);
 	r_list_append (io->cache, ch);
+	if (io->cb_core_post_write)
+		io->cb_core_post_write (io->user, addr, len);
 	return len;
 }
 
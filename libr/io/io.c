@@ -672,6 +672,8 @@ R_API int r_io_write(RIO *io, const ut8 *buf, int len) {
 	} else {
 		if (io->desc) {
 			r_io_map_write_update (io, io->desc->fd, io->off, ret);
+			if (io->cb_core_post_write)
+				io->cb_core_post_write (io->user, io->off, ret);
 			io->off += ret;
 		}
 	}
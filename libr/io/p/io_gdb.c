@@ -18,20 +18,9 @@ static int __plugin_open(RIO *io, const char *file, ut8 many) {
 }
 
 static int debug_gdb_read_at(ut8 *buf, int sz, ut64 addr) {
-	ut32 size_max = 500;
-	ut32 packets = sz / size_max;
-	ut32 last = sz % size_max;
-	ut32 x;
 	if (sz < 1 || addr >= UT64_MAX) return -1;
-	for (x = 0; x < packets; x++) {
-		gdbr_read_memory(desc, addr + x * size_max, size_max);
-		memcpy((buf + x * size_max), desc->data + x * size_max, size_max);
-	}
-	if (last) {
-		gdbr_read_memory(desc, addr + x * size_max, last);
-		memcpy((buf + x * size_max), desc->data + x * size_max, last);
-	}
-	return sz;
+	// served from the libgdbr page cache, which is dropped on each stop
+	return gdbr_read_memory_at (desc, addr, buf, sz);
 }
 
 static int debug_gdb_write_at(const ut8 *buf, int sz, ut64 addr) {
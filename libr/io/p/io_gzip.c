@@ -1,105 +1,476 @@
-/* radare - LGPL - Copyright 2008-2014 - pancake */
+/* radare - LGPL - Copyright 2008-2015 - pancake */
 
 #include "r_io.h"
 #include "r_lib.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <zlib.h>
 
-// copypasta from RIOMalloc... we can heavily simplify this with RBuffer
+/* Random access to gzipped files without inflating them completely.
+ *
+ * The first time a file is opened the whole stream is inflated once
+ * (zran-style) and an access point is recorded every GZ_SPAN bytes of
+ * uncompressed data, holding the bit position in the compressed stream
+ * and the 32KB window needed to resume inflating from there. With
+ * io.gzidx enabled the index is stored next to the file (foo.gz.gzidx)
+ * and reused when the size and mtime of the compressed file did not
+ * change. It takes about 32KB per MB of uncompressed data.
+ *
+ * Reads inflate only from the nearest access point into GZ_BLOCK sized
+ * blocks kept in a small LRU cache. Writing or resizing falls back to
+ * inflating the whole file in memory. */
+
+#define GZ_SPAN (1024 * 1024)
+#define GZ_WINSIZE 32768
+#define GZ_CHUNK 16384
+#define GZ_BLOCK 65536
+#define GZ_CACHE_BLOCKS 8
+#define GZ_IDX_EXT ".gzidx"
+#define GZ_IDX_MAGIC "R2GZIDX2"
+/* little endian: in_size:u64 in_mtime:u64 size:u64 span:u32 npoints:u32 */
+#define GZ_IDX_HDRSZ 32
+/* little endian: out:u64 in:u64 bits:u8 window[GZ_WINSIZE] */
+#define GZ_IDX_POINTSZ (17 + GZ_WINSIZE)
+/* deflate cannot compress better than 1032:1 */
+#define GZ_MAX_RATIO 1032
+
+typedef struct {
+	ut64 out;  /* offset in the uncompressed data */
+	ut64 in;   /* offset of the first full byte in the compressed file */
+	int bits;  /* bits (1-7) taken from the byte at in-1, or 0 */
+	ut8 window[GZ_WINSIZE];
+} RIOGzipPoint;
+
+typedef struct {
+	ut64 addr; /* GZ_BLOCK aligned offset or UT64_MAX if unused */
+	int len;
+	ut32 age;
+	ut8 data[GZ_BLOCK];
+} RIOGzipBlock;
 
 typedef struct {
 	int fd;
-	ut8 *buf;
-	int size;
+	FILE *fp;
+	ut64 size;
 	ut64 offset;
+	int npoints;
+	RIOGzipPoint *points;
+	RIOGzipBlock *cache;
+	ut32 tick;
+	ut8 *buf; /* whole inflated file, only after a write or resize */
 } RIOGzip;
 
-#define RIOMALLOC_FD(x) (((RIOGzip*)x->data)->fd)
-#define RIOMALLOC_SZ(x) (((RIOGzip*)x->data)->size)
-#define RIOMALLOC_BUF(x) (((RIOGzip*)x->data)->buf)
-#define RIOMALLOC_OFF(x) (((RIOGzip*)x->data)->offset)
+#define RIOGZIP(x) ((RIOGzip*)x->data)
+
+static RIOGzipPoint *gz_addpoint(RIOGzip *gz, int bits, ut64 in, ut64 out, int left, const ut8 *window) {
+	RIOGzipPoint *p;
+	if (!(gz->npoints % 32)) {
+		p = realloc (gz->points, (gz->npoints + 32) * sizeof (RIOGzipPoint));
+		if (!p) return NULL;
+		gz->points = p;
+	}
+	p = &gz->points[gz->npoints++];
+	p->bits = bits;
+	p->in = in;
+	p->out = out;
+	/* the window is circular, unroll it starting at the oldest byte */
+	if (left)
+		memcpy (p->window, window + GZ_WINSIZE - left, left);
+	if (left < GZ_WINSIZE)
+		memcpy (p->window + left, window, GZ_WINSIZE - left);
+	return p;
+}
+
+static int gz_build_index(RIOGzip *gz) {
+	ut8 input[GZ_CHUNK];
+	ut8 window[GZ_WINSIZE];
+	ut64 totin = 0, totout = 0, last = 0;
+	z_stream strm;
+	int ret;
+
+	memset (&strm, 0, sizeof (strm));
+	/* + 32 tells zlib not to care whether the stream is a zlib or gzip stream */
+	if (inflateInit2 (&strm, MAX_WBITS + 32) != Z_OK)
+		return R_FALSE;
+	fseek (gz->fp, 0, SEEK_SET);
+	do {
+		strm.avail_in = fread (input, 1, GZ_CHUNK, gz->fp);
+		if (ferror (gz->fp) || strm.avail_in == 0) {
+			ret = Z_DATA_ERROR;
+			break;
+		}
+		strm.next_in = input;
+		do {
+			if (strm.avail_out == 0) {
+				strm.avail_out = GZ_WINSIZE;
+				strm.next_out = window;
+			}
+			totin += strm.avail_in;
+			totout += strm.avail_out;
+			/* Z_BLOCK stops at each deflate block boundary */
+			ret = inflate (&strm, Z_BLOCK);
+			totin -= strm.avail_in;
+			totout -= strm.avail_out;
+			if (ret == Z_NEED_DICT)
+				ret = Z_DATA_ERROR;
+			if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR || ret == Z_STREAM_END)
+				break;
+			/* at the end of a block which is not the last one */
+			if ((strm.data_type & 128) && !(strm.data_type & 64) &&
+					(totout == 0 || totout - last > GZ_SPAN)) {
+				if (!gz_addpoint (gz, strm.data_type & 7, totin,
+						totout, strm.avail_out, window)) {
+					ret = Z_MEM_ERROR;
+					break;
+				}
+				last = totout;
+			}
+		} while (strm.avail_in != 0);
+	} while (ret == Z_OK || ret == Z_BUF_ERROR);
+	inflateEnd (&strm);
+	if (ret != Z_STREAM_END) {
+		eprintf ("gzip: inflate error %d while indexing\n", ret);
+		return R_FALSE;
+	}
+	gz->size = totout;
+	return R_TRUE;
+}
+
+static void gz_put(ut8 *buf, ut64 n, int size) {
+	int i;
+	for (i = 0; i < size; i++)
+		buf[i] = (n >> (i * 8)) & 0xff;
+}
+
+static ut64 gz_get(const ut8 *buf, int size) {
+	ut64 n = 0;
+	int i;
+	for (i = size - 1; i >= 0; i--)
+		n = (n << 8) | buf[i];
+	return n;
+}
+
+/* the access points must be usable by gz_extract() whatever the index
+ * file contains: the first one at 0, both offsets growing, and every
+ * compressed offset inside the file */
+static int gz_check_points(RIOGzip *gz, ut64 in_size) {
+	int i;
+	for (i = 0; i < gz->npoints; i++) {
+		RIOGzipPoint *p = &gz->points[i];
+		if (p->bits < 0 || p->bits > 7 || p->in > in_size
+		|| (p->bits && p->in < 1) || p->out > gz->size)
+			return R_FALSE;
+		if (i? (p->out <= p[-1].out || p->in < p[-1].in): p->out != 0)
+			return R_FALSE;
+	}
+	return R_TRUE;
+}
+
+static int gz_load_index(RIOGzip *gz, const char *file) {
+	ut8 hdr[GZ_IDX_HDRSZ], pt[17];
+	ut64 in_size, size;
+	ut32 i, npoints;
+	struct stat st, ist;
+	char magic[8];
+	int ret = R_FALSE;
+	char *idx = r_str_newf ("%s"GZ_IDX_EXT, file);
+	FILE *fp = idx? r_sandbox_fopen (idx, "rb"): NULL;
+	free (idx);
+	if (!fp)
+		return R_FALSE;
+	if (stat (file, &st) || fstat (fileno (fp), &ist)
+	|| fread (magic, sizeof (magic), 1, fp) != 1
+	|| memcmp (magic, GZ_IDX_MAGIC, sizeof (magic))
+	|| fread (hdr, sizeof (hdr), 1, fp) != 1)
+		goto beach;
+	in_size = gz_get (hdr, 8);
+	size = gz_get (hdr + 16, 8);
+	npoints = gz_get (hdr + 28, 4);
+	if (in_size != (ut64)st.st_size || gz_get (hdr + 8, 8) != (ut64)st.st_mtime
+	|| gz_get (hdr + 24, 4) != GZ_SPAN || npoints < 1
+	|| size > in_size * GZ_MAX_RATIO
+	|| (ut64)ist.st_size != 8 + GZ_IDX_HDRSZ + (ut64)npoints * GZ_IDX_POINTSZ)
+		goto beach;
+	gz->points = malloc (npoints * sizeof (RIOGzipPoint));
+	if (!gz->points)
+		goto beach;
+	for (i = 0; i < npoints; i++) {
+		RIOGzipPoint *p = &gz->points[i];
+		if (fread (pt, sizeof (pt), 1, fp) != 1
+		|| fread (p->window, GZ_WINSIZE, 1, fp) != 1)
+			break;
+		p->out = gz_get (pt, 8);
+		p->in = gz_get (pt + 8, 8);
+		p->bits = pt[16];
+	}
+	gz->npoints = i;
+	gz->size = size;
+	if (i != npoints || !gz_check_points (gz, in_size)) {
+		eprintf ("gzip: ignoring invalid index for %s\n", file);
+		free (gz->points);
+		gz->points = NULL;
+		gz->npoints = 0;
+		gz->size = 0;
+		goto beach;
+	}
+	ret = R_TRUE;
+beach:
+	fclose (fp);
+	return ret;
+}
+
+static void gz_save_index(RIOGzip *gz, const char *file) {
+	ut8 hdr[GZ_IDX_HDRSZ], pt[17];
+	struct stat st;
+	char *idx;
+	FILE *fp;
+	int i, ok;
+	if (stat (file, &st))
+		return;
+	idx = r_str_newf ("%s"GZ_IDX_EXT, file);
+	fp = idx? r_sandbox_fopen (idx, "wb"): NULL;
+	if (!fp) {
+		/* not fatal, the index will be rebuilt next time */
+		free (idx);
+		return;
+	}
+	gz_put (hdr, st.st_size, 8);
+	gz_put (hdr + 8, st.st_mtime, 8);
+	gz_put (hdr + 16, gz->size, 8);
+	gz_put (hdr + 24, GZ_SPAN, 4);
+	gz_put (hdr + 28, gz->npoints, 4);
+	ok = fwrite (GZ_IDX_MAGIC, 8, 1, fp) == 1
+		&& fwrite (hdr, sizeof (hdr), 1, fp) == 1;
+	for (i = 0; ok && i < gz->npoints; i++) {
+		RIOGzipPoint *p = &gz->points[i];
+		gz_put (pt, p->out, 8);
+		gz_put (pt + 8, p->in, 8);
+		pt[16] = p->bits;
+		ok = fwrite (pt, sizeof (pt), 1, fp) == 1
+			&& fwrite (p->window, GZ_WINSIZE, 1, fp) == 1;
+	}
+	fclose (fp);
+	if (!ok)
+		r_file_rm (idx);
+	free (idx);
+}
+
+/* inflate len bytes at the uncompressed offset off from the closest
+ * access point. returns the amount of bytes written in buf or -1 */
+static int gz_extract(RIOGzip *gz, ut64 off, ut8 *buf, int len) {
+	ut8 input[GZ_CHUNK];
+	ut8 discard[GZ_WINSIZE];
+	RIOGzipPoint *here;
+	z_stream strm;
+	int i, ret, skip = R_TRUE;
+
+	if (len < 1 || gz->npoints < 1)
+		return -1;
+	for (i = 1; i < gz->npoints && gz->points[i].out <= off; i++)
+		;
+	here = &gz->points[i - 1];
+	if (off < here->out)
+		return -1;
+	memset (&strm, 0, sizeof (strm));
+	if (inflateInit2 (&strm, -MAX_WBITS) != Z_OK)
+		return -1;
+	if (fseek (gz->fp, here->in - (here->bits? 1: 0), SEEK_SET) == -1)
+		goto fail;
+	if (here->bits) {
+		int ch = getc (gz->fp);
+		if (ch == EOF)
+			goto fail;
+		inflatePrime (&strm, here->bits, ch >> (8 - here->bits));
+	}
+	inflateSetDictionary (&strm, here->window, GZ_WINSIZE);
+	off -= here->out;
+	do {
+		if (!off && skip) {
+			strm.avail_out = len;
+			strm.next_out = buf;
+			skip = R_FALSE;
+		}
+		if (off > GZ_WINSIZE) {
+			strm.avail_out = GZ_WINSIZE;
+			strm.next_out = discard;
+			off -= GZ_WINSIZE;
+		} else if (off) {
+			strm.avail_out = (unsigned int)off;
+			strm.next_out = discard;
+			off = 0;
+		}
+		do {
+			if (!strm.avail_in) {
+				strm.avail_in = fread (input, 1, GZ_CHUNK, gz->fp);
+				if (ferror (gz->fp) || !strm.avail_in)
+					goto fail;
+				strm.next_in = input;
+			}
+			ret = inflate (&strm, Z_NO_FLUSH);
+			if (ret == Z_NEED_DICT || ret == Z_MEM_ERROR || ret == Z_DATA_ERROR)
+				goto fail;
+		} while (strm.avail_out && ret != Z_STREAM_END);
+	} while (skip && ret != Z_STREAM_END);
+	inflateEnd (&strm);
+	return skip? 0: len - strm.avail_out;
+fail:
+	inflateEnd (&strm);
+	return -1;
+}
+
+static RIOGzipBlock *gz_block(RIOGzip *gz, ut64 addr) {
+	RIOGzipBlock *b, *lru = gz->cache;
+	int i;
+	for (i = 0; i < GZ_CACHE_BLOCKS; i++) {
+		b = &gz->cache[i];
+		if (b->addr == addr) {
+			b->age = ++gz->tick;
+			return b;
+		}
+		if (b->age < lru->age)
+			lru = b;
+	}
+	lru->len = gz_extract (gz, addr, lru->data,
+		(int)R_MIN (GZ_BLOCK, gz->size - addr));
+	if (lru->len < 1) {
+		lru->addr = UT64_MAX;
+		lru->age = 0;
+		return NULL;
+	}
+	lru->addr = addr;
+	lru->age = ++gz->tick;
+	return lru;
+}
+
+/* writes need the whole file in memory, as the old implementation did */
+static int gz_materialize(RIOGzip *gz) {
+	if (gz->buf)
+		return R_TRUE;
+	if (gz->size > ST32_MAX) {
+		eprintf ("gzip: file too big to be written in memory\n");
+		return R_FALSE;
+	}
+	gz->buf = malloc (gz->size + 1);
+	if (!gz->buf)
+		return R_FALSE;
+	if (gz->size && gz_extract (gz, 0, gz->buf, (int)gz->size) != gz->size) {
+		free (gz->buf);
+		gz->buf = NULL;
+		return R_FALSE;
+	}
+	return R_TRUE;
+}
 
 static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int count) {
+	RIOGzip *gz;
 	if (fd == NULL || fd->data == NULL)
 		return -1;
-	if (RIOMALLOC_OFF (fd) > RIOMALLOC_SZ (fd))
+	gz = RIOGZIP (fd);
+	if (gz->offset > gz->size)
 		return -1;
-	if (RIOMALLOC_OFF (fd) + count > RIOMALLOC_SZ (fd))
-		count -= (RIOMALLOC_OFF (fd) + count-(RIOMALLOC_SZ (fd)));
-
-	if (count > 0) {
-		memcpy (RIOMALLOC_BUF (fd) + RIOMALLOC_OFF (fd), buf, count);
-		RIOMALLOC_OFF (fd) += count;
+	if (gz->offset + count > gz->size)
+		count -= (gz->offset + count - gz->size);
+	if (count > 0 && gz_materialize (gz)) {
+		memcpy (gz->buf + gz->offset, buf, count);
+		gz->offset += count;
 		return count;
 	}
 	return -1;
 }
 
-
 static int __resize(RIO *io, RIODesc *fd, ut64 count) {
-	ut8 * new_buf = NULL;
+	RIOGzip *gz;
+	ut8 *new_buf;
 	if (fd == NULL || fd->data == NULL || count == 0)
 		return -1;
-	if (RIOMALLOC_OFF (fd) > RIOMALLOC_SZ (fd))
+	gz = RIOGZIP (fd);
+	if (gz->offset > gz->size || count > ST32_MAX || !gz_materialize (gz))
 		return -1;
-	new_buf = malloc (count);
+	new_buf = realloc (gz->buf, count);
 	if (!new_buf) return -1;
-	memcpy (new_buf, RIOMALLOC_BUF (fd), R_MIN(count, RIOMALLOC_SZ (fd)));
-	if (count > RIOMALLOC_SZ (fd) )
-		memset (new_buf+RIOMALLOC_SZ (fd), 0, count-RIOMALLOC_SZ (fd));
-
-	free (RIOMALLOC_BUF (fd));
-	RIOMALLOC_BUF (fd) = new_buf;
-	RIOMALLOC_SZ (fd) = count;
-
+	if (count > gz->size)
+		memset (new_buf + gz->size, 0, count - gz->size);
+	gz->buf = new_buf;
+	gz->size = count;
 	return count;
 }
 
 static int __read(RIO *io, RIODesc *fd, ut8 *buf, int count) {
+	RIOGzipBlock *b;
+	RIOGzip *gz;
+	int n, done = 0;
 	memset (buf, 0xff, count);
 	if (fd == NULL || fd->data == NULL)
 		return -1;
-	if (RIOMALLOC_OFF (fd) > RIOMALLOC_SZ (fd))
+	gz = RIOGZIP (fd);
+	if (gz->offset > gz->size)
 		return -1;
-	if (RIOMALLOC_OFF (fd) + count >= RIOMALLOC_SZ (fd))
-		count = RIOMALLOC_SZ (fd) - RIOMALLOC_OFF (fd);
-	memcpy (buf, RIOMALLOC_BUF (fd) + RIOMALLOC_OFF (fd), count);
-	return count;
+	if (gz->offset + count >= gz->size)
+		count = gz->size - gz->offset;
+	if (gz->buf) {
+		memcpy (buf, gz->buf + gz->offset, count);
+		gz->offset += count;
+		return count;
+	}
+	while (done < count) {
+		ut64 addr = gz->offset + done;
+		ut64 delta = addr % GZ_BLOCK;
+		b = gz_block (gz, addr - delta);
+		if (!b || b->len <= delta)
+			break;
+		n = R_MIN (count - done, b->len - (int)delta);
+		memcpy (buf + done, b->data + delta, n);
+		done += n;
+	}
+	gz->offset += done;
+	return done;
+}
+
+static void gz_free(RIOGzip *gz) {
+	if (!gz) return;
+	if (gz->fp)
+		fclose (gz->fp);
+	free (gz->points);
+	free (gz->cache);
+	free (gz->buf);
+	free (gz);
 }
 
 static int __close(RIODesc *fd) {
-	RIOGzip *riom;
+	RIOGzip *gz;
 	if (fd == NULL || fd->data == NULL)
 		return -1;
-	eprintf ("TODO: Writing changes into gzipped files is not yet supported\n");
-	riom = fd->data;
-	free (riom->buf);
-	riom->buf = NULL;
-	free (fd->data);
+	gz = fd->data;
+	if (gz->buf)
+		eprintf ("TODO: Writing changes into gzipped files is not yet supported\n");
+	gz_free (gz);
 	fd->data = NULL;
 	fd->state = R_IO_DESC_TYPE_CLOSED;
 	return 0;
 }
 
 static ut64 __lseek(RIO* io, RIODesc *fd, ut64 offset, int whence) {
+	RIOGzip *gz;
 	ut64 r_offset = offset;
 	if (!fd->data)
 		return offset;
+	gz = RIOGZIP (fd);
 	switch (whence) {
 	case SEEK_SET:
-		r_offset = (offset <= RIOMALLOC_SZ (fd)) ? offset : RIOMALLOC_SZ (fd);
+		r_offset = (offset <= gz->size) ? offset : gz->size;
 		break;
 	case SEEK_CUR:
-		r_offset = (RIOMALLOC_OFF (fd) + offset <= RIOMALLOC_SZ (fd)) ?
-			RIOMALLOC_OFF (fd) + offset : RIOMALLOC_SZ (fd);
+		r_offset = (gz->offset + offset <= gz->size) ?
+			gz->offset + offset : gz->size;
 		break;
 	case SEEK_END:
-		r_offset = RIOMALLOC_SZ (fd);
+		r_offset = gz->size;
 		break;
 	}
-	RIOMALLOC_OFF (fd) = r_offset;
-	return RIOMALLOC_OFF (fd);
+	gz->offset = r_offset;
+	return gz->offset;
 }
 
 static int __plugin_open(struct r_io_t *io, const char *pathname, ut8 many) {
@@ -107,22 +478,34 @@ static int __plugin_open(struct r_io_t *io, const char *pathname, ut8 many) {
 }
 
 static RIODesc *__open(RIO *io, const char *pathname, int rw, int mode) {
-	if (__plugin_open (io, pathname, 0)) {
-		RIOGzip *mal = R_NEW0 (RIOGzip);
-		if (!mal) return NULL;
-		int len;
-		ut8 *data = (ut8*)r_file_slurp (pathname+7, &len);
-		mal->buf = r_inflate (data, len, NULL, &mal->size);
-		if (mal->buf) {
-			RETURN_IO_DESC_NEW (&r_io_plugin_malloc,
-				mal->fd, pathname, rw, mode, mal);
+	const char *file = pathname + 7;
+	RIOGzip *gz;
+	int i;
+	if (!__plugin_open (io, pathname, 0))
+		return NULL;
+	gz = R_NEW0 (RIOGzip);
+	if (!gz) return NULL;
+	gz->fd = -2; /* causes r_io_desc_new() to set the correct fd */
+	gz->fp = r_sandbox_fopen (file, "rb");
+	gz->cache = malloc (GZ_CACHE_BLOCKS * sizeof (RIOGzipBlock));
+	if (!gz->fp || !gz->cache) {
+		eprintf ("Cannot open %s\n", file);
+		gz_free (gz);
+		return NULL;
+	}
+	for (i = 0; i < GZ_CACHE_BLOCKS; i++) {
+		gz->cache[i].addr = UT64_MAX;
+		gz->cache[i].age = 0;
+	}
+	if (!io->gzidx || !gz_load_index (gz, file)) {
+		if (!gz_build_index (gz)) {
+			gz_free (gz);
+			return NULL;
 		}
-		free (data);
-		eprintf ("Cannot allocate (%s) %d bytes\n", pathname+9,
-			mal->size);
-		free (mal);
+		if (io->gzidx)
+			gz_save_index (gz, file);
 	}
-	return NULL;
+	RETURN_IO_DESC_NEW (&r_io_plugin_gzip, gz->fd, pathname, rw, mode, gz);
 }
 
 struct r_io_plugin_t r_io_plugin_gzip = {
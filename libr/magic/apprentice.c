@@ -221,6 +221,7 @@ static int apprentice_1(RMagic *ms, const char *fn, int action, struct mlist *ml
 	ml->magic = magic;
 	ml->nmagic = nmagic;
 	ml->mapped = mapped;
+	ml->index = file_index (magic, nmagic);
 
 	mlist->prev->next = ml;
 	ml->prev = mlist->prev;
@@ -249,6 +250,103 @@ void file_delmagic(struct r_magic *p, int type, size_t entries) {
 	}
 }
 
+/*
+ * The offset and the byte a top level test needs to find there in order
+ * to match, as mget() and magiccheck() would see it. Returns 0 when the
+ * test has no such byte (indirect, masked, relations other than '=').
+ */
+static int index_key(const struct r_magic *m, ut32 *off, ut8 *byte) {
+	static const ut16 one = 1;
+	int be, size;
+	ut64 v = m->value.q;
+
+	if (m->cont_level || (m->flag & INDIR) || m->reln != '='
+	    || m->offset == MAGIC_ANYOFF)
+		return 0;
+	switch (m->type) {
+	case FILE_STRING:
+		if (m->str_flags || !m->vallen)
+			return 0;
+		*off = m->offset;
+		*byte = (ut8)m->value.s[0];
+		return 1;
+	case FILE_BYTE: size = 1; be = 0; break;
+	case FILE_SHORT: size = 2; be = !*(const ut8 *)&one; break;
+	case FILE_LONG: size = 4; be = !*(const ut8 *)&one; break;
+	case FILE_QUAD: size = 8; be = !*(const ut8 *)&one; break;
+	case FILE_BESHORT: size = 2; be = 1; break;
+	case FILE_BELONG: size = 4; be = 1; break;
+	case FILE_BEQUAD: size = 8; be = 1; break;
+	case FILE_LESHORT: size = 2; be = 0; break;
+	case FILE_LELONG: size = 4; be = 0; break;
+	case FILE_LEQUAD: size = 8; be = 0; break;
+	default:
+		return 0;
+	}
+	if (m->num_mask || (m->mask_op & FILE_OPINVERSE))
+		return 0;
+	*off = m->offset;
+	*byte = be? (ut8)(v >> (8 * (size - 1))): (ut8)v;
+	return 1;
+}
+
+struct r_magic_index *file_index(const struct r_magic *magic, ut32 nmagic) {
+	struct r_magic_index *ix;
+	ut32 i, off, nzero = 0;
+	ut8 byte;
+
+	if (!magic || !nmagic || !(ix = R_NEW0 (struct r_magic_index)))
+		return NULL;
+	for (i = 0; i < nmagic; i++) {
+		if (magic[i].cont_level)
+			continue;
+		if (index_key (&magic[i], &off, &byte) && !off) {
+			ix->head[byte + 1]++;
+			nzero++;
+		} else ix->nrest++;
+	}
+	ix->zero = malloc ((nzero + 1) * sizeof (ut32));
+	ix->rest = malloc ((ix->nrest + 1) * sizeof (ut32));
+	ix->rest_off = malloc ((ix->nrest + 1) * sizeof (ut32));
+	ix->rest_byte = malloc (ix->nrest + 1);
+	if (!ix->zero || !ix->rest || !ix->rest_off || !ix->rest_byte) {
+		file_delindex (ix);
+		return NULL;
+	}
+	for (i = 0; i < 256; i++)
+		ix->head[i + 1] += ix->head[i];
+	ix->nrest = 0;
+	{
+		ut32 fill[256];
+		memcpy (fill, ix->head, sizeof (fill));
+		for (i = 0; i < nmagic; i++) {
+			if (magic[i].cont_level)
+				continue;
+			if (!index_key (&magic[i], &off, &byte)) {
+				off = MAGIC_ANYOFF;
+				byte = 0;
+			} else if (!off) {
+				ix->zero[fill[byte]++] = i;
+				continue;
+			}
+			ix->rest[ix->nrest] = i;
+			ix->rest_off[ix->nrest] = off;
+			ix->rest_byte[ix->nrest++] = byte;
+		}
+	}
+	return ix;
+}
+
+void file_delindex(struct r_magic_index *ix) {
+	if (ix) {
+		free (ix->zero);
+		free (ix->rest);
+		free (ix->rest_off);
+		free (ix->rest_byte);
+		free (ix);
+	}
+}
+
 /* const char *fn: list of magic files and directories */
 struct mlist * file_apprentice(RMagic *ms, const char *fn, int action) {
 	char *p, *mfn;
@@ -1611,6 +1709,30 @@ static void eatsize(const char **p) {
 	*p = l;
 }
 
+/* newest modification time of a magic file or directory and its files */
+static time_t source_mtime(const char *fn) {
+	char subfn[MAXPATHLEN];
+	struct dirent *d;
+	struct stat st;
+	time_t t;
+	DIR *dir;
+
+	if (stat (fn, &st) != 0)
+		return 0;
+	t = st.st_mtime;
+	if (S_ISDIR (st.st_mode) && (dir = opendir (fn))) {
+		while ((d = readdir (dir))) {
+			if (*d->d_name == '.')
+				continue;
+			snprintf (subfn, sizeof (subfn), "%s/%s", fn, d->d_name);
+			if (stat (subfn, &st) == 0 && st.st_mtime > t)
+				t = st.st_mtime;
+		}
+		closedir (dir);
+	}
+	return t;
+}
+
 /*
  * handle a compiled file.
  */
@@ -1638,6 +1760,9 @@ static int apprentice_map(RMagic *ms, struct r_magic **magicp, ut32 *nmagicp, co
 		file_error (ms, 0, "file `%s' is too small", dbname);
 		goto error1;
 	}
+	/* parse the sources again if they changed after being compiled */
+	if (source_mtime (fn) > st.st_mtime)
+		goto error1;
 
 #ifdef QUICK
 	if ((mm = mmap (0, (size_t)st.st_size, PROT_READ, //OPENBSDBUG  |PROT_WRITE,
@@ -1710,14 +1835,15 @@ static const ut32 ar[] = {
 };
 
 /*
- * handle an mmaped file.
+ * write the parsed entries next to the sources, where apprentice_map
+ * looks for them.
  */
 static int apprentice_compile(RMagic *ms, struct r_magic **magicp, ut32 *nmagicp, const char *fn) {
 	int fd;
 	char *dbname;
 	int rv = -1;
 
-	dbname = mkdbname(fn, 1);
+	dbname = mkdbname(fn, 0);
 
 	if (dbname == NULL) 
 		goto out;
@@ -1765,6 +1891,9 @@ static char *mkdbname(const char *fn, int strip) {
 			fn = ++p;
 	}
 	fnlen = strlen (fn);
+	/* a directory given as "magic/" compiles to "magic.mgc" */
+	while (fnlen > 1 && fn[fnlen - 1] == '/')
+		fnlen--;
 	extlen = strlen (ext);
 	if (fnlen + extlen + 1 > MAXPATHLEN) {
 		return NULL;
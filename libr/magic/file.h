@@ -52,6 +52,21 @@
 /* Type for Unicode characters */
 typedef unsigned long unichar;
 
+/*
+ * Top level tests of an mlist that can only match a given byte at a
+ * fixed offset. The ones at offset 0 are bucketed by that byte, all
+ * others are kept in order with their byte, if any, to check it first.
+ */
+#define MAGIC_ANYOFF 0xffffffff
+struct r_magic_index {
+	ut32 head[257];		/* zero[head[b]..head[b + 1]) test byte b */
+	ut32 *zero;
+	ut32 *rest;
+	ut32 *rest_off;		/* MAGIC_ANYOFF when not filtered */
+	ut8 *rest_byte;
+	ut32 nrest;
+};
+
 struct stat;
 const char *file_fmttime(unsigned int, int);
 int file_buffer(struct r_magic_set *, int, const char *, const void *,
@@ -71,6 +86,8 @@ int file_softmagic(struct r_magic_set *, const unsigned char *, size_t, int);
 struct mlist *file_apprentice(struct r_magic_set *, const char *, int);
 ut64 file_signextend(RMagic *, struct r_magic *, ut64);
 void file_delmagic(struct r_magic *, int type, size_t entries);
+struct r_magic_index *file_index(const struct r_magic *, ut32);
+void file_delindex(struct r_magic_index *);
 void file_badread(struct r_magic_set *);
 void file_badseek(struct r_magic_set *);
 void file_oomem(struct r_magic_set *, size_t);
@@ -133,6 +133,7 @@ static void free_mlist(struct mlist *mlist) {
 		struct mlist *next = ml->next;
 		struct r_magic *mg = ml->magic;
 		file_delmagic (mg, ml->mapped, ml->nmagic);
+		file_delindex (ml->index);
 		free (ml);
 		ml = next;
 	}
@@ -41,7 +41,7 @@
 #include <time.h>
 
 static int match(RMagic *, struct r_magic *, ut32,
-    const ut8 *, size_t, int);
+    const struct r_magic_index *, const ut8 *, size_t, int);
 static int mget(RMagic *, const ut8 *,
     struct r_magic *, size_t, unsigned int);
 static int magiccheck(RMagic *, struct r_magic *);
@@ -71,11 +71,35 @@ int file_softmagic(RMagic *ms, const ut8 *buf, size_t nbytes, int mode) {
 	struct mlist *ml;
 	int rv;
 	for (ml = ms->mlist->next; ml != ms->mlist; ml = ml->next)
-		if ((rv = match(ms, ml->magic, ml->nmagic, buf, nbytes, mode)) != 0)
+		if ((rv = match(ms, ml->magic, ml->nmagic, ml->index, buf, nbytes, mode)) != 0)
 			return rv;
 	return 0;
 }
 
+/*
+ * First top level test at or after magindex that may match s, or nmagic.
+ * Both index lists are in magic order, so their cursors only move forward.
+ */
+static ut32 index_next(const struct r_magic_index *ix, const ut8 *s, size_t nbytes,
+    ut32 *zi, ut32 *ri, ut32 magindex, ut32 nmagic) {
+	ut32 zend = ix->head[s[0] + 1], z = nmagic, r = nmagic;
+
+	while (*zi < zend && ix->zero[*zi] < magindex)
+		(*zi)++;
+	if (*zi < zend)
+		z = ix->zero[*zi];
+	while (*ri < ix->nrest) {
+		ut32 off = ix->rest_off[*ri];
+		if (ix->rest[*ri] >= magindex && (off == MAGIC_ANYOFF ||
+		    (off < nbytes && s[off] == ix->rest_byte[*ri]))) {
+			r = ix->rest[*ri];
+			break;
+		}
+		(*ri)++;
+	}
+	return R_MIN (z, r);
+}
+
 /*
  * Go through the whole list, stopping if you find a match.  Process all
  * the continuations of that match before returning.
@@ -103,8 +127,9 @@ int file_softmagic(RMagic *ms, const ut8 *buf, size_t nbytes, int mode) {
  *	If a continuation matches, we bump the current continuation level
  *	so that higher-level continuations are processed.
  */
-static int match(RMagic *ms, struct r_magic *magic, ut32 nmagic, const ut8 *s, size_t nbytes, int mode) {
-	ut32 magindex = 0;
+static int match(RMagic *ms, struct r_magic *magic, ut32 nmagic,
+    const struct r_magic_index *ix, const ut8 *s, size_t nbytes, int mode) {
+	ut32 magindex = 0, zi = 0, ri = 0;
 	unsigned int cont_level = 0;
 	int need_separator = 0;
 	int returnval = 0; /* if a match is found it is set to 1*/
@@ -113,10 +138,19 @@ static int match(RMagic *ms, struct r_magic *magic, ut32 nmagic, const ut8 *s, s
 
 	if (file_check_mem (ms, cont_level) == -1)
 		return -1;
+	if (ix && nbytes > 0)
+		zi = ix->head[s[0]];
+	else ix = NULL;
 
 	for (magindex = 0; magindex < nmagic; magindex++) {
 		int flush;
-		struct r_magic *m = &magic[magindex];
+		struct r_magic *m;
+
+		/* skip the tests that cannot match this buffer */
+		if (ix && (magindex = index_next (ix, s, nbytes,
+		    &zi, &ri, magindex, nmagic)) >= nmagic)
+			break;
+		m = &magic[magindex];
 
 		if ((m->flag & BINTEST) != mode) {
 			/* Skip sub-tests */
@@ -183,53 +183,407 @@ R_API int r_diff_buffers_radiff(RDiff *d, const ut8 *a, int la, const ut8 *b, in
 	return 0;
 }
 
+/* content defined chunking: a gear rolling hash over the last 64 bytes
+ * cuts both buffers at the same content, so insertions only disturb the
+ * chunks around them. Chunks that appear exactly once in each buffer are
+ * paired, the longest in-order run of pairs is kept as anchors and the
+ * gaps between anchors are trimmed bytewise and reported */
+#define CDC_MIN 128
+#define CDC_MAX 8192
+#define CDC_MASK 0xff80000000000000ULL /* ~512 bytes over the minimum */
+
+typedef struct {
+	ut64 hash;
+	ut64 off;
+	ut32 len;
+	int idx;
+} DiffChunk;
+
+typedef struct {
+	int a, b;
+} DiffAnchor;
+
+static void cdc_gear(ut64 *gear) {
+	ut64 x = 0x9e3779b97f4a7c15ULL, z;
+	int i;
+	for (i = 0; i < 256; i++) {
+		z = (x += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		gear[i] = z ^ (z >> 31);
+	}
+}
+
+/* 8 bytes at a time, only used to group candidate chunks */
+static ut64 cdc_hash(const ut8 *buf, ut32 len) {
+	ut64 w, s = 0xcbf29ce484222325ULL ^ len;
+	for (; len >= 8; len -= 8, buf += 8) {
+		memcpy (&w, buf, 8);
+		s = (s ^ w) * 0x100000001b3ULL;
+		s ^= s >> 29;
+	}
+	while (len--)
+		s = (s ^ *buf++) * 0x100000001b3ULL;
+	return s ^ (s >> 32);
+}
+
+static DiffChunk *cdc_split(const ut64 *gear, const ut8 *buf, ut64 len, int *count) {
+	DiffChunk *c = NULL, *tmp;
+	int n = 0, size = 0;
+	ut64 i = 0, start, end, h;
+
+	while (i < len) {
+		start = i;
+		end = R_MIN (len, start + CDC_MAX);
+		/* the hash only depends on the last 64 bytes */
+		i = R_MIN (end, start + CDC_MIN - 64);
+		for (h = 0; i < end; i++) {
+			h = (h << 1) + gear[buf[i]];
+			if (!(h & CDC_MASK) && i - start >= CDC_MIN) {
+				i++;
+				break;
+			}
+		}
+		if (n == size) {
+			size = size? size * 2: 1024;
+			tmp = realloc (c, size * sizeof (DiffChunk));
+			if (!tmp) {
+				free (c);
+				return NULL;
+			}
+			c = tmp;
+		}
+		c[n].off = start;
+		c[n].len = (ut32)(i - start);
+		c[n].hash = cdc_hash (buf + start, c[n].len);
+		c[n].idx = n;
+		n++;
+	}
+	*count = n;
+	return c;
+}
+
+static int chunk_cmp(const void *a, const void *b) {
+	const DiffChunk *ca = a, *cb = b;
+	if (ca->hash != cb->hash)
+		return (ca->hash < cb->hash)? -1: 1;
+	if (ca->len != cb->len)
+		return (ca->len < cb->len)? -1: 1;
+	return 0;
+}
+
+static int anchor_cmp(const void *a, const void *b) {
+	return ((const DiffAnchor *)a)->b - ((const DiffAnchor *)b)->b;
+}
+
+/* pairs of chunks that are unique on both sides, sorted by b */
+static DiffAnchor *cdc_pairs(const ut8 *a, const DiffChunk *ca, int na, const ut8 *b, const DiffChunk *cb, int nb, int *count) {
+	DiffChunk *sa = malloc (na * sizeof (DiffChunk));
+	DiffChunk *sb = malloc (nb * sizeof (DiffChunk));
+	DiffAnchor *p = malloc ((R_MIN (na, nb) + 1) * sizeof (DiffAnchor));
+	int c, i = 0, j = 0, ei, ej, n = 0;
+
+	if (!sa || !sb || !p) {
+		free (sa);
+		free (sb);
+		free (p);
+		return NULL;
+	}
+	memcpy (sa, ca, na * sizeof (DiffChunk));
+	memcpy (sb, cb, nb * sizeof (DiffChunk));
+	qsort (sa, na, sizeof (DiffChunk), chunk_cmp);
+	qsort (sb, nb, sizeof (DiffChunk), chunk_cmp);
+	while (i < na && j < nb) {
+		c = chunk_cmp (&sa[i], &sb[j]);
+		if (c < 0) {
+			i++;
+			continue;
+		}
+		if (c > 0) {
+			j++;
+			continue;
+		}
+		for (ei = i + 1; ei < na && !chunk_cmp (&sa[ei], &sa[i]); ei++);
+		for (ej = j + 1; ej < nb && !chunk_cmp (&sb[ej], &sb[j]); ej++);
+		if (ei == i + 1 && ej == j + 1 && !memcmp (a + sa[i].off, b + sb[j].off, sa[i].len)) {
+			p[n].a = sa[i].idx;
+			p[n].b = sb[j].idx;
+			n++;
+		}
+		i = ei;
+		j = ej;
+	}
+	free (sa);
+	free (sb);
+	qsort (p, n, sizeof (DiffAnchor), anchor_cmp);
+	*count = n;
+	return p;
+}
+
+/* keep the longest run of pairs increasing in a too (patience sorting) */
+static int cdc_lis(DiffAnchor *p, int n) {
+	int *tails = malloc ((n + 1) * sizeof (int));
+	int *prev = malloc ((n + 1) * sizeof (int));
+	DiffAnchor *tmp = malloc ((n + 1) * sizeof (DiffAnchor));
+	int i, k, lo, hi, mid, len = 0;
+
+	if (!tails || !prev || !tmp) {
+		free (tails);
+		free (prev);
+		free (tmp);
+		return -1;
+	}
+	for (i = 0; i < n; i++) {
+		lo = 0;
+		hi = len;
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (p[tails[mid]].a < p[i].a)
+				lo = mid + 1;
+			else hi = mid;
+		}
+		prev[i] = lo? tails[lo - 1]: -1;
+		tails[lo] = i;
+		if (lo == len)
+			len++;
+	}
+	for (k = len? tails[len - 1]: -1, i = len - 1; i >= 0; i--) {
+		tmp[i] = p[k];
+		k = prev[k];
+	}
+	memcpy (p, tmp, len * sizeof (DiffAnchor));
+	free (tails);
+	free (prev);
+	free (tmp);
+	return len;
+}
+
+/* report a[a0..a1) => b[b0..b1) without its common head and tail.
+ * same sized gaps are compared position by position */
+static void cdc_gap(RDiff *d, const ut8 *a, ut64 a0, ut64 a1, const ut8 *b, ut64 b0, ut64 b1) {
+	while (a0 < a1 && b0 < b1 && a[a0] == b[b0]) {
+		a0++;
+		b0++;
+	}
+	while (a1 > a0 && b1 > b0 && a[a1 - 1] == b[b1 - 1]) {
+		a1--;
+		b1--;
+	}
+	if (a0 == a1 && b0 == b1)
+		return;
+	if (a1 - a0 == b1 - b0) {
+		RDiff s = *d;
+		s.off_a += a0;
+		s.off_b += b0;
+		r_diff_buffers_static (&s, a + a0, (int)(a1 - a0), b + b0, (int)(b1 - b0));
+	} else {
+		RDiffOp o = {
+			.a_off = d->off_a + a0, .a_buf = a + a0, .a_len = (int)(a1 - a0),
+			.b_off = d->off_b + b0, .b_buf = b + b0, .b_len = (int)(b1 - b0)
+		};
+		d->callback (d, d->user, &o);
+	}
+}
+
+/* near linear diff for big inputs where data was inserted, removed or
+ * moved. returns the number of matching chunks used as anchors, or -1 */
+R_API int r_diff_buffers_chunks(RDiff *d, const ut8 *a, ut64 la, const ut8 *b, ut64 lb) {
+	DiffChunk *ca = NULL, *cb = NULL;
+	DiffAnchor *p = NULL;
+	int i, na = 0, nb = 0, np = 0;
+	ut64 gear[256], pa = 0, pb = 0;
+
+	if (la && lb) {
+		cdc_gear (gear);
+		ca = cdc_split (gear, a, la, &na);
+		cb = cdc_split (gear, b, lb, &nb);
+		if (ca && cb)
+			p = cdc_pairs (a, ca, na, b, cb, nb, &np);
+		if (!p || (np = cdc_lis (p, np)) < 0) {
+			free (ca);
+			free (cb);
+			free (p);
+			return -1;
+		}
+	}
+	for (i = 0; i < np; i++) {
+		const DiffChunk *x = &ca[p[i].a], *y = &cb[p[i].b];
+		cdc_gap (d, a, pa, x->off, b, pb, y->off);
+		pa = x->off + x->len;
+		pb = y->off + y->len;
+	}
+	cdc_gap (d, a, pa, la, b, pb, lb);
+	free (ca);
+	free (cb);
+	free (p);
+	return np;
+}
+
 R_API int r_diff_buffers(RDiff *d, const ut8 *a, ut32 la, const ut8 *b, ut32 lb) {
 	if (d->delta)
 		return r_diff_buffers_delta (d, a, la, b, lb);
 	return r_diff_buffers_static (d, a, la, b, lb);
 }
 
-/* TODO: Move into r_util maybe? */
-R_API int r_diff_buffers_distance(RDiff *d, const ut8 *a, ut32 la, const ut8 *b, ut32 lb,
-		ut32 *distance, double *similarity) {
-	int i, j, cost, tmin, **m;
+/* Levenshtein distance, bit-parallel (Myers/Hyyrö) over 64 bit blocks of
+ * the shorter buffer. Memory is 256 words per block, time is O(n*m/64).
+ * The score at the bottom of each block is tracked so that the walk can
+ * stop once every cell of a column is known to be above maxdist */
+static ut32 distance_myers(const ut8 *a, ut32 la, const ut8 *b, ut32 lb, ut32 maxdist) {
+	ut64 *peq, *pv, *mv, eq, xv, xh, ph, mh, last;
+	ut32 i, j, k, nb, score, *bscore, lo;
+	int hin, hout;
 
-	if (!a || !b || la < 1 || lb < 1)
-		return R_FALSE;
-
-	if ((m = malloc ((la+1) * sizeof(int*))) == NULL)
-		return R_FALSE;
-	for(i = 0; i <= la; i++)
-		if ((m[i] = malloc ((lb+1) * sizeof(int))) == NULL) {
-			while (i--)
-				free (m[i]);
-			free (m);
-			return R_FALSE;
+	if (la > lb) {
+		const ut8 *t = a; a = b; b = t;
+		i = la; la = lb; lb = i;
+	}
+	nb = (la + 63) / 64;
+	peq = calloc ((size_t)nb * 259, sizeof (ut64));
+	if (!peq)
+		return UT32_MAX;
+	pv = peq + (size_t)nb * 256;
+	mv = pv + nb;
+	bscore = (ut32*)(mv + nb);
+	for (i = 0; i < la; i++)
+		peq[(size_t)a[i] * nb + i / 64] |= 1ULL << (i & 63);
+	for (k = 0; k < nb; k++) {
+		pv[k] = UT64_MAX;
+		bscore[k] = (k + 1) * 64;
+	}
+	last = 1ULL << ((la - 1) & 63);
+	bscore[nb - 1] = score = la;
+	for (j = 0; j < lb; j++) {
+		const ut64 *col = peq + (size_t)b[j] * nb;
+		hin = 1;
+		for (k = 0; k < nb; k++) {
+			eq = col[k];
+			xv = eq | mv[k];
+			if (hin < 0)
+				eq |= 1;
+			xh = (((eq & pv[k]) + pv[k]) ^ pv[k]) | eq;
+			ph = mv[k] | ~(xh | pv[k]);
+			mh = pv[k] & xh;
+			if (k == nb - 1)
+				hout = (ph & last)? 1: (mh & last)? -1: 0;
+			else hout = (ph >> 63)? 1: (mh >> 63)? -1: 0;
+			ph <<= 1;
+			mh <<= 1;
+			if (hin < 0)
+				mh |= 1;
+			else if (hin > 0)
+				ph |= 1;
+			pv[k] = mh | ~(xv | ph);
+			mv[k] = ph & xv;
+			bscore[k] += hout;
+			hin = hout;
 		}
+		score += hin;
+		/* cells within a block are at most 63 below its bottom one */
+		if (maxdist < la && (j & 63) == 63) {
+			for (lo = UT32_MAX, k = 0; k < nb; k++)
+				lo = R_MIN (lo, bscore[k]);
+			if (lo > maxdist + 63) {
+				score = maxdist + 1;
+				break;
+			}
+		}
+	}
+	free (peq);
+	return score;
+}
 
-	for (i = 0; i <= la; i++)
-		m[i][0] = i;
-	for (j = 0; j <= lb; j++)
-		m[0][j] = j;
+/* Two-row dynamic programming restricted to the diagonal band |i-j| <= k,
+ * giving up as soon as a whole row is above k. Returns k+1 in that case */
+static ut32 distance_banded(const ut8 *a, ut32 la, const ut8 *b, ut32 lb, ut32 k) {
+	ut32 i, j, lo, hi, v, rowmin, inf = k + 1;
+	ut32 *rows, *prev, *cur, *tmp;
 
+	if (!(rows = malloc (2 * ((size_t)lb + 1) * sizeof (ut32))))
+		return UT32_MAX;
+	prev = rows;
+	cur = rows + lb + 1;
+	for (j = 0; j <= lb; j++)
+		prev[j] = R_MIN (j, inf);
 	for (i = 1; i <= la; i++) {
-		for (j = 1; j <= lb; j++) {
-			if (a[i-1] == b[j-1])
-				cost = 0;
-			else cost = 1;
-			tmin = R_MIN (m[i-1][j] + 1, m[i][j-1] + 1);
-			m[i][j] = R_MIN (tmin, m[i-1][j-1] + cost);
+		lo = (i > k)? i - k: 1;
+		hi = R_MIN (lb, i + k);
+		cur[lo - 1] = (lo == 1)? R_MIN (i, inf): inf;
+		rowmin = cur[lo - 1];
+		for (j = lo; j <= hi; j++) {
+			v = prev[j - 1] + (a[i - 1] != b[j - 1]);
+			v = R_MIN (v, prev[j] + 1);
+			v = R_MIN (v, cur[j - 1] + 1);
+			cur[j] = v = R_MIN (v, inf);
+			if (v < rowmin)
+				rowmin = v;
 		}
+		if (hi < lb)
+			cur[hi + 1] = inf;
+		if (rowmin > k) {
+			free (rows);
+			return inf;
+		}
+		tmp = prev; prev = cur; cur = tmp;
 	}
+	v = prev[lb];
+	free (rows);
+	return v;
+}
+
+/* distance between a and b, or any value above maxdist if it is larger */
+static ut32 edit_distance(const ut8 *a, ut32 la, const ut8 *b, ut32 lb, ut32 maxdist) {
+	ut32 m, n;
 
+	/* common prefix and suffix do not change the distance */
+	while (la > 0 && lb > 0 && *a == *b) {
+		a++; b++; la--; lb--;
+	}
+	while (la > 0 && lb > 0 && a[la - 1] == b[lb - 1]) {
+		la--; lb--;
+	}
+	if (la == 0 || lb == 0)
+		return R_MAX (la, lb);
+	m = R_MIN (la, lb);
+	n = R_MAX (la, lb);
+	if (n - m > maxdist)
+		return maxdist + 1;
+	/* the band is cheaper than the bit vectors when the bound is tight */
+	if (maxdist < m && ((ut64)2 * maxdist + 1) * m < ((ut64)(m + 63) / 64) * n * 8)
+		return distance_banded (a, la, b, lb, maxdist);
+	return distance_myers (a, la, b, lb, maxdist);
+}
+
+static int distance_result(ut32 la, ut32 lb, ut32 dist, ut32 *distance, double *similarity) {
+	if (dist == UT32_MAX)
+		return R_FALSE;
 	if (distance != NULL)
-		*distance = m[la][lb];
+		*distance = dist;
 	if (similarity != NULL)
-		*similarity = (double)1 - (double)(m[la][lb])/(double)(R_MAX(la, lb));
+		*similarity = (double)1 - (double)dist / (double)R_MAX (la, lb);
+	return R_TRUE;
+}
 
-	for(i = 0; i <= la; i++)
-		free (m[i]);
-	free (m);
+R_API int r_diff_buffers_distance(RDiff *d, const ut8 *a, ut32 la, const ut8 *b, ut32 lb,
+		ut32 *distance, double *similarity) {
+	if (!a || !b || la < 1 || lb < 1)
+		return R_FALSE;
+	return distance_result (la, lb, edit_distance (a, la, b, lb, UT32_MAX - 1),
+		distance, similarity);
+}
 
-	return R_TRUE;
+/* Same as r_diff_buffers_distance, but stops as soon as the distance is known
+ * to be above maxdist; then it reports maxdist+1 and the matching similarity,
+ * which is always lower than the real one. */
+R_API int r_diff_buffers_distance_max(RDiff *d, const ut8 *a, ut32 la, const ut8 *b, ut32 lb,
+		ut32 maxdist, ut32 *distance, double *similarity) {
+	ut32 dist;
+	if (!a || !b || la < 1 || lb < 1)
+		return R_FALSE;
+	if (maxdist >= UT32_MAX - 1)
+		maxdist = UT32_MAX - 2;
+	dist = edit_distance (a, la, b, lb, maxdist);
+	if (dist != UT32_MAX && dist > maxdist)
+		dist = maxdist + 1;
+	return distance_result (la, lb, dist, distance, similarity);
 }
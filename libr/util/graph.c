@@ -25,64 +25,82 @@ static void r_graph_node_free (RGraphNode *n) {
 	r_list_free (n->out_nodes);
 	r_list_free (n->in_nodes);
 	r_list_free (n->all_neighbours);
+	free (n->out);
+	free (n->in);
 	free (n);
 }
 
-static int node_cmp (unsigned int idx, RGraphNode *b) {
-	return idx == b->idx ? 0 : -1;
+static int vec_append (RGraphNode ***v, int *count, int *size, RGraphNode *n) {
+	if (*count == *size) {
+		int sz = *size? *size * 2: 4;
+		RGraphNode **p = realloc (*v, sz * sizeof (RGraphNode *));
+		if (!p) return R_FALSE;
+		*v = p;
+		*size = sz;
+	}
+	(*v)[(*count)++] = n;
+	return R_TRUE;
 }
 
-static void dfs_node (RGraph *g, RGraphNode *n, RGraphVisitor *vis, int color[]) {
-	RStack *s;
-	RGraphEdge *edg;
-
-	s = r_stack_new (2 * g->n_edges);
-
-	edg = R_NEW (RGraphEdge);
-	edg->from = NULL;
-	edg->to = n;
-	r_stack_push (s, edg);
-	while (!r_stack_is_empty (s)) {
-		RGraphEdge *cur_edge = (RGraphEdge *)r_stack_pop (s);
-		RGraphNode *v, *cur = cur_edge->to, *from = cur_edge->from;
-		const RList *neighbours;
-		RListIter *it;
-
-		free (cur_edge);
-		if (from && cur) {
-			if (color[cur->idx] == WHITE_COLOR && vis->tree_edge)
-				vis->tree_edge (from, cur, vis);
-			else if (color[cur->idx] == GRAY_COLOR && vis->back_edge)
-				vis->back_edge (from, cur, vis);
-			else if (color[cur->idx] == BLACK_COLOR && vis->fcross_edge)
-				vis->fcross_edge (from, cur, vis);
-		} else if (!cur && from) {
-			if (color[from->idx] != BLACK_COLOR && vis->finish_node)
-				vis->finish_node (from, vis);
-			color[from->idx] = BLACK_COLOR;
+/* removes the first occurrence, keeping the order like r_list_delete_data */
+static void vec_delete (RGraphNode **v, int *count, const RGraphNode *n) {
+	int i;
+	for (i = 0; i < *count; i++) {
+		if (v[i] == n) {
+			memmove (v + i, v + i + 1, (*count - i - 1) * sizeof (RGraphNode *));
+			(*count)--;
+			return;
 		}
+	}
+}
 
-		if (!cur || color[cur->idx] != WHITE_COLOR)
+/* same visiting order as pushing every edge on a stack, without
+ * allocating per edge: one frame per gray node, edges walked backwards */
+static void dfs_node (RGraph *g, RGraphNode *n, RGraphVisitor *vis, int color[]) {
+	RGraphNode **st, *cur, *v;
+	int *pos, sp = 0;
+
+	if (color[n->idx] != WHITE_COLOR)
+		return;
+	st = malloc (g->last_index * sizeof (RGraphNode *));
+	pos = malloc (g->last_index * sizeof (int));
+	if (!st || !pos) {
+		free (st);
+		free (pos);
+		return;
+	}
+	if (vis->discover_node)
+		vis->discover_node (n, vis);
+	color[n->idx] = GRAY_COLOR;
+	st[sp] = n;
+	pos[sp++] = n->n_out;
+	while (sp > 0) {
+		cur = st[sp - 1];
+		if (pos[sp - 1] == 0) {
+			if (color[cur->idx] != BLACK_COLOR && vis->finish_node)
+				vis->finish_node (cur, vis);
+			color[cur->idx] = BLACK_COLOR;
+			sp--;
 			continue;
-
-		if (color[cur->idx] == WHITE_COLOR && vis->discover_node)
-			vis->discover_node (cur, vis);
-		color[cur->idx] = GRAY_COLOR;
-
-		edg = R_NEW (RGraphEdge);
-		edg->from = cur;
-		edg->to = NULL;
-		r_stack_push (s, edg);
-
-		neighbours = r_graph_get_neighbours (g, cur);
-		r_list_foreach (neighbours, it, v) {
-			edg = R_NEW (RGraphEdge);
-			edg->from = cur;
-			edg->to = v;
-			r_stack_push (s, edg);
+		}
+		v = cur->out[--pos[sp - 1]];
+		if (color[v->idx] == WHITE_COLOR) {
+			if (vis->tree_edge)
+				vis->tree_edge (cur, v, vis);
+			if (vis->discover_node)
+				vis->discover_node (v, vis);
+			color[v->idx] = GRAY_COLOR;
+			st[sp] = v;
+			pos[sp++] = v->n_out;
+		} else if (color[v->idx] == GRAY_COLOR) {
+			if (vis->back_edge)
+				vis->back_edge (cur, v, vis);
+		} else if (vis->fcross_edge) {
+			vis->fcross_edge (cur, v, vis);
 		}
 	}
-	r_stack_free (s);
+	free (st);
+	free (pos);
 }
 
 R_API RGraph *r_graph_new () {
@@ -96,23 +114,25 @@ R_API RGraph *r_graph_new () {
 
 R_API void r_graph_free (RGraph* t) {
 	r_list_free (t->nodes);
+	free (t->index);
 	free (t);
 }
 
 R_API RGraphNode *r_graph_get_node (const RGraph *t, unsigned int idx) {
-	RListIter *it = r_list_find (t->nodes, (void *)(size_t)idx, (RListComparator)node_cmp);
-	if (!it)
+	if (idx >= (unsigned int)t->last_index)
 		return NULL;
-
-	return (RGraphNode *)it->data;
+	return t->index[idx];
 }
 
 R_API RListIter *r_graph_node_iter (const RGraph *t, unsigned int idx) {
-	return r_list_find (t->nodes, (void *)(size_t)idx, (RListComparator)node_cmp);
+	RGraphNode *n = r_graph_get_node (t, idx);
+	return n? n->iter: NULL;
 }
 
 R_API void r_graph_reset (RGraph *t) {
 	r_list_free (t->nodes);
+	R_FREE (t->index);
+	t->index_size = 0;
 
 	t->nodes = r_list_new ();
 	t->nodes->free = (RListFree)r_graph_node_free;
@@ -122,10 +142,19 @@ R_API void r_graph_reset (RGraph *t) {
 }
 
 R_API RGraphNode *r_graph_add_node (RGraph *t, void *data) {
-	RGraphNode *n = r_graph_node_new (data);
+	RGraphNode *n;
 
+	if (t->last_index == t->index_size) {
+		int sz = t->index_size? t->index_size * 2: 32;
+		RGraphNode **p = realloc (t->index, sz * sizeof (RGraphNode *));
+		if (!p) return NULL;
+		t->index = p;
+		t->index_size = sz;
+	}
+	n = r_graph_node_new (data);
 	n->idx = t->last_index++;
-	r_list_append (t->nodes, n);
+	n->iter = r_list_append (t->nodes, n);
+	t->index[n->idx] = n;
 	t->n_nodes++;
 	return n;
 }
@@ -140,16 +169,19 @@ R_API void r_graph_del_node (RGraph *t, RGraphNode *n) {
 	r_list_foreach (n->in_nodes, it, gn) {
 		r_list_delete_data (gn->out_nodes, n);
 		r_list_delete_data (gn->all_neighbours, n);
+		vec_delete (gn->out, &gn->n_out, n);
 		t->n_edges--;
 	}
 
 	r_list_foreach (n->out_nodes, it, gn) {
 		r_list_delete_data (gn->in_nodes, n);
 		r_list_delete_data (gn->all_neighbours, n);
+		vec_delete (gn->in, &gn->n_in, n);
 		t->n_edges--;
 	}
 
-	r_list_delete_data (t->nodes, n);
+	t->index[n->idx] = NULL;
+	r_list_delete (t->nodes, n->iter);
 	t->n_nodes--;
 }
 
@@ -159,6 +191,8 @@ R_API void r_graph_add_edge (RGraph *t, RGraphNode *from, RGraphNode *to) {
 	r_list_append(from->all_neighbours, to);
 	r_list_append(to->in_nodes, from);
 	r_list_append(to->all_neighbours, from);
+	vec_append (&from->out, &from->n_out, &from->out_size, to);
+	vec_append (&to->in, &to->n_in, &to->in_size, from);
 	t->n_edges++;
 }
 
@@ -168,6 +202,8 @@ R_API void r_graph_del_edge (RGraph *t, RGraphNode *from, RGraphNode *to) {
 	r_list_delete_data (from->all_neighbours, to);
 	r_list_delete_data (to->in_nodes, from);
 	r_list_delete_data (to->all_neighbours, from);
+	vec_delete (from->out, &from->n_out, to);
+	vec_delete (to->in, &to->n_in, from);
 	t->n_edges--;
 }
 
@@ -177,8 +213,13 @@ R_API const RList *r_graph_get_neighbours (const RGraph *g, const RGraphNode *n)
 }
 
 R_API RGraphNode *r_graph_nth_neighbour (const RGraph *g, const RGraphNode *n, int nth) {
-	if (!n) return NULL;
-	return (RGraphNode *)r_list_get_n (n->out_nodes, nth);
+	if (!n || nth < 0 || nth >= n->n_out) return NULL;
+	return n->out[nth];
+}
+
+R_API RGraphNode *r_graph_nth_innode (const RGraph *g, const RGraphNode *n, int nth) {
+	if (!n || nth < 0 || nth >= n->n_in) return NULL;
+	return n->in[nth];
 }
 
 R_API const RList *r_graph_innodes (const RGraph *g, const RGraphNode *n) {
@@ -197,8 +238,12 @@ R_API const RList *r_graph_get_nodes (const RGraph *g) {
 }
 
 R_API int r_graph_adjacent (const RGraph *g, const RGraphNode *from, const RGraphNode *to) {
+	int i;
 	if (!g || !from) return R_FALSE;
-	return r_list_contains (from->out_nodes, to) ? R_TRUE : R_FALSE;
+	for (i = 0; i < from->n_out; i++)
+		if (from->out[i] == to)
+			return R_TRUE;
+	return R_FALSE;
 }
 
 R_API void r_graph_dfs_node (RGraph *g, RGraphNode *n, RGraphVisitor *vis) {
@@ -212,12 +257,11 @@ R_API void r_graph_dfs_node (RGraph *g, RGraphNode *n, RGraphVisitor *vis) {
 
 R_API void r_graph_dfs (RGraph *g, RGraphVisitor *vis) {
 	RGraphNode *n;
-	RListIter *it;
-	int *color;
+	int i, *color;
 
 	if (!g || !vis) return;
 	color = R_NEWS0 (int, g->last_index);
-	r_list_foreach (g->nodes, it, n) {
+	r_graph_foreach_node (g, i, n) {
 		 if (color[n->idx] == WHITE_COLOR)
 			 dfs_node (g, n, vis, color);
 	}
@@ -30,18 +30,14 @@ R_API void r_mem_copyloop(ut8 *dest, const ut8 *orig, int dsize, int osize) {
 }
 
 R_API int r_mem_cmp_mask(const ut8 *dest, const ut8 *orig, const ut8 *mask, int len) {
-	int i, ret = -1;
-	ut8 *mdest, *morig;
-	mdest = malloc (len);
-	morig = malloc (len);
+	int i;
 	for (i=0; i<len; i++) {
-		mdest[i] = dest[i]&mask[i];
-		morig[i] = orig[i]&mask[i];
+		ut8 a = dest[i]&mask[i];
+		ut8 b = orig[i]&mask[i];
+		if (a != b)
+			return (int)a - (int)b;
 	}
-	ret = memcmp (mdest, morig, len);
-	free (mdest);
-	free (morig);
-	return ret;
+	return 0;
 }
 
 R_API void r_mem_copybits(ut8 *dst, const ut8 *src, int bits) {
@@ -77,6 +77,19 @@ R_API int r_sys_fork() {
 #endif
 }
 
+/* number of online cpus, 1 when it cannot be known */
+R_API int r_sys_cpus(void) {
+	long n = 1;
+#if __WINDOWS__ && !defined(__CYGWIN__)
+	SYSTEM_INFO si;
+	GetSystemInfo (&si);
+	n = si.dwNumberOfProcessors;
+#elif __UNIX__ && defined(_SC_NPROCESSORS_ONLN)
+	n = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+	return (n < 1)? 1: (int)n;
+}
+
 /* TODO: import stuff fron bininfo/p/bininfo_addr2line */
 /* TODO: check endianness issues here */
 R_API ut64 r_sys_now(void) {
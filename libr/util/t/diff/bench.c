@@ -0,0 +1,108 @@
+/* edit distance benchmark: full matrix vs r_diff_buffers_distance[_max] */
+
+#include <r_diff.h>
+
+static ut32 matrix_distance(const ut8 *a, ut32 la, const ut8 *b, ut32 lb) {
+	ut32 i, j, d, *m = malloc ((la+1) * (lb+1) * sizeof (ut32));
+#define M(x,y) m[(x)*(lb+1)+(y)]
+	for (i=0; i<=la; i++)
+		M(i, 0) = i;
+	for (j=0; j<=lb; j++)
+		M(0, j) = j;
+	for (i=1; i<=la; i++) {
+		for (j=1; j<=lb; j++) {
+			d = R_MIN (M(i-1, j) + 1, M(i, j-1) + 1);
+			M(i, j) = R_MIN (d, M(i-1, j-1) + (a[i-1] != b[j-1]));
+		}
+	}
+	d = M(la, lb);
+#undef M
+	free (m);
+	return d;
+}
+
+/* code-like pair: a slice of the file and a copy with a few edits */
+static ut32 mkpair(const ut8 *file, int fsz, ut8 *a, ut8 *b, ut32 max) {
+	ut32 i, la = 16 + rand () % (max - 16);
+	ut32 lb = 0, off = rand () % (fsz - la);
+	memcpy (a, file + off, la);
+	for (i=0; i<la && lb < max; i++) {
+		switch (rand () % 32) {
+		case 0: break;
+		case 1: b[lb++] = rand (); break;
+		case 2: b[lb++] = rand (); if (lb < max) b[lb++] = a[i]; break;
+		default: b[lb++] = a[i]; break;
+		}
+	}
+	if (!lb)
+		b[lb++] = 0;
+	return (la << 16) | lb;
+}
+
+int main(int argc, char **argv) {
+	const char *path = argc>1? argv[1]: "/bin/ls";
+	int i, fsz, npairs = argc>2? atoi (argv[2]): 200;
+	ut32 max = 4096, d, dm, la, lb, *lens;
+	ut8 *file = (ut8*)r_file_slurp (path, &fsz);
+	ut8 *a, *b;
+	ut64 t0, t1, t2, t3;
+	double sim, th = 0.7;
+	int fail = 0, above = 0;
+
+	if (!file || fsz < (int)max * 2) {
+		eprintf ("Cannot use %s\n", path);
+		return 1;
+	}
+	srand (1337);
+	a = malloc ((size_t)npairs * max);
+	b = malloc ((size_t)npairs * max);
+	lens = malloc (npairs * sizeof (ut32));
+	for (i=0; i<npairs; i++) {
+		/* every other pair is unrelated code */
+		lens[i] = mkpair (file, fsz, a + i*max, b + i*max, max);
+		if (i&1) {
+			lb = lens[i] & 0xffff;
+			memcpy (b + i*max, file + rand () % (fsz - lb), lb);
+		}
+	}
+	t0 = r_sys_now ();
+	for (i=0; i<npairs; i++)
+		matrix_distance (a+i*max, lens[i]>>16, b+i*max, lens[i]&0xffff);
+	t1 = r_sys_now ();
+	for (i=0; i<npairs; i++)
+		r_diff_buffers_distance (NULL, a+i*max, lens[i]>>16, b+i*max, lens[i]&0xffff, &d, NULL);
+	t2 = r_sys_now ();
+	for (i=0; i<npairs; i++) {
+		la = lens[i]>>16;
+		lb = lens[i]&0xffff;
+		r_diff_buffers_distance_max (NULL, a+i*max, la, b+i*max, lb,
+			(ut32)((1-th) * R_MAX (la, lb)), &d, &sim);
+	}
+	t3 = r_sys_now ();
+	for (i=0; i<npairs; i++) {
+		la = lens[i]>>16;
+		lb = lens[i]&0xffff;
+		dm = matrix_distance (a+i*max, la, b+i*max, lb);
+		r_diff_buffers_distance (NULL, a+i*max, la, b+i*max, lb, &d, NULL);
+		if (d != dm)
+			fail++;
+		r_diff_buffers_distance_max (NULL, a+i*max, la, b+i*max, lb,
+			(ut32)((1-th) * R_MAX (la, lb)), &d, &sim);
+		if (sim > th) {
+			above++;
+			if (d != dm)
+				fail++;
+		} else if (d > dm && d != (ut32)((1-th) * R_MAX (la, lb)) + 1)
+			fail++;
+	}
+	printf ("%d pairs from %s, %d above %.2f\n", npairs, path, above, th);
+	printf ("matrix:  %.1f us/pair\n", (double)(t1-t0)/npairs);
+	printf ("bitvec:  %.1f us/pair\n", (double)(t2-t1)/npairs);
+	printf ("bounded: %.1f us/pair\n", (double)(t3-t2)/npairs);
+	printf ("%s\n", fail? "[-] results differ": "[+] same results");
+	free (lens);
+	free (a);
+	free (b);
+	free (file);
+	return fail? 1: 0;
+}
@@ -0,0 +1,73 @@
+/* chunked diff: rebuild b from a plus the reported ops on a big buffer
+ * with inserted, removed, moved and patched regions */
+
+#include <r_diff.h>
+
+typedef struct {
+	const ut8 *a;
+	ut8 *out;
+	ut64 pa, pb, len;
+	int ops, bad;
+} Patch;
+
+static int cb(RDiff *d, void *user, RDiffOp *op) {
+	Patch *p = user;
+	if (op->a_off < p->pa || op->b_off - p->pb != op->a_off - p->pa) {
+		p->bad++;
+		return 1;
+	}
+	memcpy (p->out + p->pb, p->a + p->pa, op->a_off - p->pa);
+	memcpy (p->out + op->b_off, op->b_buf, op->b_len);
+	p->pa = op->a_off + op->a_len;
+	p->pb = op->b_off + op->b_len;
+	p->ops++;
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	ut64 i, la = (argc>1? atoi (argv[1]): 64) << 20, lb = 0;
+	ut8 *a = malloc (la), *b = malloc (la + 4096);
+	Patch p = { 0 };
+	RDiff *d;
+	ut64 t0, t1;
+	int n;
+
+	if (!a || !b)
+		return 1;
+	srand (1337);
+	/* random data with zero padding every 64k */
+	for (i = 0; i < la; i++)
+		a[i] = (i % 65536 < 4096)? 0: rand () >> 7;
+	/* insert 3 bytes, drop 100, move 64k forward and patch 4 bytes */
+	memcpy (b, a, la / 8);
+	lb = la / 8;
+	memcpy (b + lb, "\x90\x90\x90", 3);
+	lb += 3;
+	memcpy (b + lb, a + la / 8, la / 4 - la / 8);
+	lb += la / 4 - la / 8;
+	memcpy (b + lb, a + la / 4 + 100 + 65536, la / 2 - la / 4 - 100 - 65536);
+	lb += la / 2 - la / 4 - 100 - 65536;
+	memcpy (b + lb, a + la / 4 + 100, 65536);
+	lb += 65536;
+	memcpy (b + lb, a + la / 2, la - la / 2);
+	lb += la - la / 2;
+	memcpy (b + la - la / 8, "\xcc\xcc\xcc\xcc", 4);
+
+	p.a = a;
+	p.out = malloc (lb);
+	d = r_diff_new (0, 0);
+	r_diff_set_callback (d, cb, &p);
+	t0 = r_sys_now ();
+	n = r_diff_buffers_chunks (d, a, la, b, lb);
+	t1 = r_sys_now ();
+	memcpy (p.out + p.pb, a + p.pa, la - p.pa);
+	printf ("%"PFMT64d" MB: %d anchors, %d ops in %.1f ms\n", la >> 20, n,
+		p.ops, (double)(t1 - t0) / 1000);
+	n = !p.bad && p.pb + la - p.pa == lb && !memcmp (p.out, b, lb);
+	printf ("%s\n", n? "[+] b rebuilt": "[-] b differs");
+	r_diff_free (d);
+	free (p.out);
+	free (a);
+	free (b);
+	return n? 0: 1;
+}
@@ -0,0 +1,52 @@
+/* RGraph benchmark: lookups, DFS and adjacency on a 100k nodes graph.
+ * the layout of the visual graph is timed by core/t/graph_bench */
+
+#include <r_util.h>
+
+static int n_finished = 0;
+
+static void finish_cb(RGraphNode *n, RGraphVisitor *vis) {
+	n_finished++;
+}
+
+int main(int argc, char **argv) {
+	int i, j, nn = argc > 1? atoi (argv[1]): 100000;
+	RGraph *g = r_graph_new ();
+	RGraphVisitor vis = { 0 };
+	RGraphNode *n;
+	ut64 t0, t1, t2, t3;
+	ut64 sum = 0;
+
+	srand (1337);
+	for (i = 0; i < nn; i++)
+		r_graph_add_node (g, NULL);
+	/* a CFG-like dag: fallthrough plus a forward jump every other node */
+	for (i = 0; i < nn - 1; i++) {
+		r_graph_add_edge (g, r_graph_get_node (g, i), r_graph_get_node (g, i + 1));
+		if (i & 1) {
+			j = R_MIN (i + 2 + rand () % 64, nn - 1);
+			r_graph_add_edge (g, r_graph_get_node (g, i), r_graph_get_node (g, j));
+		}
+	}
+
+	t0 = r_sys_now ();
+	for (i = 0; i < nn * 10; i++) {
+		n = r_graph_get_node (g, rand () % nn);
+		sum += n->n_out;
+	}
+	t1 = r_sys_now ();
+	vis.finish_node = finish_cb;
+	r_graph_dfs (g, &vis);
+	t2 = r_sys_now ();
+	for (i = 0; i < nn; i++)
+		sum += r_graph_adjacent (g, r_graph_get_node (g, i), r_graph_get_node (g, (i + 1) % nn));
+	t3 = r_sys_now ();
+
+	printf ("%d nodes, %d edges (%"PFMT64d")\n", g->n_nodes,
+		g->n_edges, sum);
+	printf ("get_node:  %.3f ms (%d lookups)\n", (double)(t1 - t0) / 1000, nn * 10);
+	printf ("dfs:       %.3f ms\n", (double)(t2 - t1) / 1000);
+	printf ("adjacent:  %.3f ms\n", (double)(t3 - t2) / 1000);
+	r_graph_free (g);
+	return n_finished == nn? 0: 1;
+}
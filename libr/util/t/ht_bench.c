@@ -0,0 +1,53 @@
+/* RHashTable and RHashTable64 with n address-like keys */
+
+#include <r_util.h>
+
+static int bench(int n, int use64) {
+	RHashTable *ht = use64? NULL: r_hashtable_new ();
+	RHashTable64 *ht64 = use64? r_hashtable64_new (): NULL;
+	ut64 base = use64? 0x7fff00000000ULL: 0x8048000, k, t0, t1, t2, t3, t4;
+	ut32 x = 2463534242U;
+	int i, found = 0, fail = 0;
+	void *v;
+
+#define INS(k,v) (use64? r_hashtable64_insert (ht64, k, v): r_hashtable_insert (ht, (ut32)(k), v))
+#define GET(k) (use64? r_hashtable64_lookup (ht64, k): r_hashtable_lookup (ht, (ut32)(k)))
+#define DEL(k) (use64? r_hashtable64_remove (ht64, k): r_hashtable_remove (ht, (ut32)(k)))
+	t0 = r_sys_now ();
+	for (i = 0; i < n; i++)
+		INS (base + i * 16ULL, (void *)(size_t)(i + 1));
+	t1 = r_sys_now ();
+	for (i = 0; i < n; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		k = x % n;
+		v = GET (base + k * 16);
+		found += v && (size_t)v == k + 1;
+	}
+	fail += found != n;
+	t2 = r_sys_now ();
+	for (i = 0, found = 0; i < n; i++)
+		found += !!GET (base + i * 16ULL + 8);
+	fail += found != 0;
+	t3 = r_sys_now ();
+	for (i = 0; i < n; i += 2)
+		DEL (base + i * 16ULL);
+	for (i = 0, found = 0; i < n; i++)
+		found += !!GET (base + i * 16ULL);
+	fail += found != n / 2;
+	t4 = r_sys_now ();
+	printf ("%-6s insert %7.3f  hit %7.3f  miss %7.3f  remove %7.3f (ms)\n",
+		use64? "ht64": "ht", (t1 - t0) / 1000.0, (t2 - t1) / 1000.0,
+		(t3 - t2) / 1000.0, (t4 - t3) / 1000.0);
+	r_hashtable_free (ht);
+	r_hashtable64_free (ht64);
+	return fail;
+}
+
+int main(int argc, char **argv) {
+	int n = argc > 1? atoi (argv[1]): 1000000;
+	int fail = bench (n, 0) + bench (n, 1);
+	printf ("%d keys %s\n", n, fail? "[-] failed": "[+] ok");
+	return fail? 1: 0;
+}
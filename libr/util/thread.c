@@ -45,7 +45,11 @@ R_API struct r_th_t *r_th_new(R_TH_FUNCTION(fun), void *user, int delay) {
 		th->breaked = R_FALSE;
 		th->ready = R_FALSE;
 #if HAVE_PTHREAD
-		pthread_create(&th->tid, NULL, _r_th_launcher, th);
+		if (pthread_create (&th->tid, NULL, _r_th_launcher, th)) {
+			r_th_lock_free (th->lock);
+			free (th);
+			return NULL;
+		}
 #elif __WIN32__ || __WINDOWS__ && !defined(__CYGWIN__)
 		th->tid = CreateThread(NULL, 0, _r_th_launcher, th, 0, &th->tid);
 #endif
@@ -61,6 +65,9 @@ R_API int r_th_kill(struct r_th_t *th, int force) {
 	th->breaked = R_TRUE;
 	r_th_break(th);
 	r_th_wait(th);
+	/* the thread is gone once it has been joined */
+	if (th->joined)
+		return 0;
 #if HAVE_PTHREAD
 #ifdef __ANDROID__
 	pthread_kill (th->tid, 9);
@@ -94,8 +101,9 @@ R_API int r_th_wait(struct r_th_t *th) {
 	int ret = R_FALSE;
 	void *thret;
 #if HAVE_PTHREAD
-	if (th) {
+	if (th && !th->joined) {
 		ret = pthread_join (th->tid, &thret);
+		th->joined = !ret;
 		th->running = R_FALSE;
 	}
 #endif
@@ -106,7 +114,10 @@ R_API int r_th_wait_async(struct r_th_t *th) {
 	return th->running;
 }
 
+/* joins the thread */
 R_API void *r_th_free(struct r_th_t *th) {
+	if (!th)
+		return NULL;
 	r_th_kill (th, R_TRUE);
 	r_th_lock_free (th->lock);
 	free (th);
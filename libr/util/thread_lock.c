@@ -69,3 +69,71 @@ R_API void *r_th_lock_free(RThreadLock *thl) {
 	}
 	return NULL;
 }
+
+/* writers are preferred, busy readers would starve them otherwise */
+R_API RThreadRWLock *r_th_rwlock_new() {
+	RThreadRWLock *thl = R_NEW (RThreadRWLock);
+	if (thl) {
+		thl->writer = 0;
+#if HAVE_PTHREAD
+#if __GLIBC__
+		pthread_rwlockattr_t attr;
+		pthread_rwlockattr_init (&attr);
+		pthread_rwlockattr_setkind_np (&attr,
+			PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+		pthread_rwlock_init (&thl->lock, &attr);
+		pthread_rwlockattr_destroy (&attr);
+#else
+		pthread_rwlock_init (&thl->lock, NULL);
+#endif
+#elif __WIN32__ || __WINDOWS__ && !defined(__CYGWIN__)
+		InitializeSRWLock (&thl->lock);
+#endif
+	}
+	return thl;
+}
+
+R_API void r_th_rwlock_read(RThreadRWLock *thl) {
+#if HAVE_PTHREAD
+	pthread_rwlock_rdlock (&thl->lock);
+#elif __WIN32__ || __WINDOWS__ && !defined(__CYGWIN__)
+	AcquireSRWLockShared (&thl->lock);
+#endif
+}
+
+R_API void r_th_rwlock_write(RThreadRWLock *thl) {
+#if HAVE_PTHREAD
+	pthread_rwlock_wrlock (&thl->lock);
+#elif __WIN32__ || __WINDOWS__ && !defined(__CYGWIN__)
+	AcquireSRWLockExclusive (&thl->lock);
+#endif
+	thl->writer = 1;
+}
+
+/* the writer flag is only touched by the exclusive owner */
+R_API void r_th_rwlock_unlock(RThreadRWLock *thl) {
+	if (thl->writer) {
+		thl->writer = 0;
+#if HAVE_PTHREAD
+		pthread_rwlock_unlock (&thl->lock);
+#elif __WIN32__ || __WINDOWS__ && !defined(__CYGWIN__)
+		ReleaseSRWLockExclusive (&thl->lock);
+#endif
+		return;
+	}
+#if HAVE_PTHREAD
+	pthread_rwlock_unlock (&thl->lock);
+#elif __WIN32__ || __WINDOWS__ && !defined(__CYGWIN__)
+	ReleaseSRWLockShared (&thl->lock);
+#endif
+}
+
+R_API void *r_th_rwlock_free(RThreadRWLock *thl) {
+	if (thl) {
+#if HAVE_PTHREAD
+		pthread_rwlock_destroy (&thl->lock);
+#endif
+		free (thl);
+	}
+	return NULL;
+}
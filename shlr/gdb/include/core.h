@@ -20,6 +20,7 @@
 #define CMD_WRITEREG	"P"
 #define CMD_WRITEMEM	"M"
 #define CMD_READMEM		"m"
+#define CMD_READMEM_BIN	"x"
 
 #define CMD_BP				"Z0"
 #define CMD_RBP				"z0"
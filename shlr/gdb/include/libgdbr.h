@@ -19,6 +19,10 @@
 #define MSG_NOT_SUPPORTED -1
 #define MSG_ERROR_1 -2
 
+#define GDBR_MAX_PACKET_SIZE 0x10000
+#define GDBR_PAGE_SIZE 0x400
+#define GDBR_CACHE_PAGES 256
+
 /*! 
  * Structure that saves a gdb message
  */
@@ -28,6 +32,23 @@ typedef struct libgdbr_message_t {
 	uint8_t chk;	/*! Cheksum of the current message read from the packet */
 } libgdbr_message_t;
 
+/*!
+ * Features reported by the stub in its qSupported reply
+ */
+typedef struct libgdbr_stub_features_t {
+	ssize_t pkt_sz; /*! PacketSize, the maximum packet the stub accepts */
+	int binary_upload; /*! binary memory reads with the 'x' packet */
+} libgdbr_stub_features_t;
+
+/*!
+ * Page of target memory kept until the next stop event or write
+ */
+typedef struct libgdbr_page_t {
+	ut64 addr;
+	int valid;
+	uint8_t buf[GDBR_PAGE_SIZE];
+} libgdbr_page_t;
+
 /*! 
  * Core "object" that saves
  * the instance of the lib
@@ -48,8 +69,14 @@ typedef struct libgdbr_t {
 	ssize_t data_len;
 	ssize_t data_max;
 	uint8_t architecture;
+	int big_endian; /*! byte order of the target registers */
 	registers_t* registers;
 	int last_code;
+	libgdbr_stub_features_t stub_features;
+	libgdbr_page_t* cache; /*! direct mapped memory cache, see gdbr_read_memory_at */
+	char* regs; /*! copy of the last 'g' reply */
+	ssize_t regs_len;
+	int regs_valid;
 } libgdbr_t;
 
 /*!
@@ -104,6 +131,22 @@ int gdbr_write_register(libgdbr_t* g, int index, char* value, int len);
 int gdbr_write_registers(libgdbr_t* g, char* registers);
 int gdbr_read_memory(libgdbr_t* g, ut64 address, ut64 len);
 int gdbr_write_memory(libgdbr_t* g, ut64 address, const uint8_t* data, ut64 len);
+
+/*!
+ * \brief Function reads memory through the page cache
+ * Missing pages are requested in as few packets as the negotiated
+ * PacketSize allows, using binary 'x' transfers when supported
+ * \param buf destination buffer, unreadable bytes are set to 0xff
+ * \returns the amount of bytes read up to the first unreadable page,
+ * or -1 when the first one cannot be read
+ */
+int gdbr_read_memory_at(libgdbr_t* g, ut64 address, uint8_t* buf, int len);
+
+/*!
+ * \brief drops the cached memory pages and registers
+ * Must be called whenever the target may have changed (stop events, writes)
+ */
+void gdbr_invalidate_cache(libgdbr_t* g);
 int gdbr_send_command(libgdbr_t* g, char* command);
 int test_command(libgdbr_t* g, const char* command);
 
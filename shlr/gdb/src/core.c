@@ -4,6 +4,10 @@
 #include "core.h"
 #include "packet.h"
 #include "messages.h"
+#if __UNIX__
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
 
 extern char hex2char(char* hex);
 
@@ -318,6 +322,13 @@ int gdbr_init(libgdbr_t* g) {
 		return -1;
 	}
 	g->data_max = 4096;
+	g->cache = calloc (GDBR_CACHE_PAGES, sizeof (libgdbr_page_t));
+	if (!g->cache) {
+		free (g->send_buff);
+		free (g->read_buff);
+		free (g->data);
+		return -1;
+	}
 	return 0;
 }
 
@@ -354,6 +365,11 @@ int gdbr_cleanup(libgdbr_t* g) {
 	g->send_len = 0;
 	free (g->read_buff);
 	g->read_len = 0;
+	free (g->cache);
+	g->cache = NULL;
+	free (g->regs);
+	g->regs = NULL;
+	g->regs_valid = 0;
 	return 0;
 }
 
@@ -367,11 +383,19 @@ int gdbr_connect(libgdbr_t* g, const char* host, int port) {
 	ret = r_socket_connect_tcp (g->sock, host, tmp, 200);
 	if (!ret) return -1;
 	g->connected = 1;
+#if __UNIX__
+	{
+		// request/reply of small packets, do not wait to coalesce them
+		int on = 1;
+		setsockopt (g->sock->fd, IPPROTO_TCP, TCP_NODELAY, (void*)&on, sizeof (on));
+	}
+#endif
 	// TODO add config possibility here
 	ret = send_command(g, message);
 	if (ret < 0)
 		return ret;
 	read_packet(g);
+	parse_packet(g, 0);
 	return handle_connect(g);
 }
 
@@ -385,13 +409,29 @@ int gdbr_disconnect(libgdbr_t* g) {
 int gdbr_read_registers(libgdbr_t* g) {
 	int ret = -1;
 	if (!g) return -1;
+	// registers can only change on stop events or when we write them
+	if (g->regs_valid && g->regs_len <= g->data_max) {
+		memcpy (g->data, g->regs, g->regs_len);
+		g->data_len = g->regs_len;
+		return 0;
+	}
 	ret = send_command (g, CMD_READREGS);
 	if (ret < 0)
 		return ret;
 
 	if (read_packet (g) > 0) {
 		parse_packet (g, 0);
-		return handle_g (g);
+		ret = handle_g (g);
+		if (g->data_len > 0) {
+			char *regs = realloc (g->regs, g->data_len);
+			if (regs) {
+				memcpy (regs, g->data, g->data_len);
+				g->regs = regs;
+				g->regs_len = g->data_len;
+				g->regs_valid = 1;
+			}
+		}
+		return ret;
 	}
 	return -1;
 }
@@ -401,7 +441,7 @@ int gdbr_read_memory(libgdbr_t* g, ut64 address, ut64 len) {
 	int ret;
 	if (!g) return -1;
 	ret = snprintf (command, sizeof (command),
-		"%s%016"PFMT64x",%"PFMT64d, CMD_READMEM, address, len);
+		"%s%016"PFMT64x",%"PFMT64x, CMD_READMEM, address, len);
 	if (ret < 0)
 		return ret;
 	ret = send_command(g, command);
@@ -415,6 +455,188 @@ int gdbr_read_memory(libgdbr_t* g, ut64 address, ut64 len) {
 	return -1;
 }
 
+/**
+ * Decodes the binary reply of an 'x' packet straight from the read buffer.
+ * The data is prefixed with 'b', and '#', '$', '}' and '*' are escaped
+ * with '}' followed by the byte xored with 0x20; an unescaped '*' is the
+ * usual run-length encoding of the previous byte
+ */
+static int unpack_binary(libgdbr_t* g, uint8_t* dst, int len) {
+	const char *p = g->read_buff;
+	const char *end = g->read_buff + g->read_len;
+	uint8_t ch, last = 0;
+	int n = 0, run;
+	while (p < end && *p != '$') p++;
+	if (++p >= end || *p++ != 'b')
+		return -1;
+	while (p < end && *p != '#' && n < len) {
+		ch = (uint8_t)*p++;
+		if (ch == '}') {
+			if (p >= end) break;
+			ch = ((uint8_t)*p++) ^ 0x20;
+		} else if (ch == '*') {
+			if (p >= end) break;
+			run = (uint8_t)*p++ - 29;
+			while (run-- > 0 && n < len)
+				dst[n++] = last;
+			continue;
+		}
+		dst[n++] = last = ch;
+	}
+	return n;
+}
+
+/* biggest amount of bytes a single read reply can carry */
+static int max_transfer(libgdbr_t* g) {
+	ssize_t sz = g->read_max;
+	if (g->stub_features.pkt_sz > 0 && g->stub_features.pkt_sz < sz)
+		sz = g->stub_features.pkt_sz;
+	// both hex and escaped binary replies can take two bytes per byte
+	return (int)R_MAX ((sz - 32) / 2, 16);
+}
+
+static int read_chunk(libgdbr_t* g, ut64 address, uint8_t* buf, int len) {
+	char command[64];
+	int ret;
+	if (g->stub_features.binary_upload) {
+		snprintf (command, sizeof (command), "%s%"PFMT64x",%x",
+			CMD_READMEM_BIN, address, len);
+		if (send_command (g, command) < 0 || read_packet (g) <= 0)
+			return -1;
+		ret = unpack_binary (g, buf, len);
+		g->read_len = 0;
+		send_ack (g);
+		return ret;
+	}
+	if (gdbr_read_memory (g, address, len) < 0)
+		return -1;
+	ret = R_MIN (g->data_len, len);
+	memcpy (buf, g->data, ret);
+	return ret;
+}
+
+static libgdbr_page_t *cache_page(libgdbr_t* g, ut64 addr) {
+	return &g->cache[(addr / GDBR_PAGE_SIZE) % GDBR_CACHE_PAGES];
+}
+
+static int cache_has(libgdbr_t* g, ut64 addr) {
+	libgdbr_page_t *page = cache_page (g, addr);
+	return page->valid && page->addr == addr;
+}
+
+/* fetches count pages starting at the page aligned address addr */
+static void cache_fill(libgdbr_t* g, ut64 addr, int count) {
+	int i, n, got = 0, total = count * GDBR_PAGE_SIZE;
+	int max = max_transfer (g);
+	uint8_t *tmp = malloc (total);
+	if (!tmp) return;
+	while (got < total) {
+		n = read_chunk (g, addr + got, tmp + got, R_MIN (max, total - got));
+		if (n <= 0) break;
+		got += n;
+	}
+	for (i = 0; (i + 1) * GDBR_PAGE_SIZE <= got; i++) {
+		libgdbr_page_t *page = cache_page (g, addr + i * GDBR_PAGE_SIZE);
+		page->addr = addr + i * GDBR_PAGE_SIZE;
+		page->valid = 1;
+		memcpy (page->buf, tmp + i * GDBR_PAGE_SIZE, GDBR_PAGE_SIZE);
+	}
+	free (tmp);
+}
+
+int gdbr_read_memory_at(libgdbr_t* g, ut64 address, uint8_t* buf, int len) {
+	ut64 addr, first, last;
+	int run, max_run, delta, n;
+	if (!g || !buf || len < 1) return -1;
+	memset (buf, 0xff, len);
+	if (!g->cache) {
+		return read_chunk (g, address, buf, R_MIN (len, max_transfer (g)));
+	}
+	first = address - (address % GDBR_PAGE_SIZE);
+	last = address + len - 1;
+	last -= last % GDBR_PAGE_SIZE;
+	max_run = R_MAX (max_transfer (g) / GDBR_PAGE_SIZE, 1);
+	for (addr = first; addr <= last && addr >= first; addr += GDBR_PAGE_SIZE) {
+		libgdbr_page_t *page;
+		if (!cache_has (g, addr)) {
+			// request all the consecutive missing pages at once
+			for (run = 1; run < max_run; run++) {
+				ut64 next = addr + run * GDBR_PAGE_SIZE;
+				if (next > last || next < addr || cache_has (g, next))
+					break;
+			}
+			cache_fill (g, addr, run);
+			if (!cache_has (g, addr)) {
+				// stop at the first unreadable page
+				int got = (addr > address)? (int)(addr - address): 0;
+				return got? got: -1;
+			}
+		}
+		page = cache_page (g, addr);
+		delta = (addr < address)? (int)(address - addr): 0;
+		n = R_MIN (GDBR_PAGE_SIZE - delta, len - (int)(addr + delta - address));
+		memcpy (buf + (addr + delta - address), page->buf + delta, n);
+	}
+	return len;
+}
+
+void gdbr_invalidate_cache(libgdbr_t* g) {
+	int i;
+	if (!g) return;
+	g->regs_valid = 0;
+	if (!g->cache) return;
+	for (i = 0; i < GDBR_CACHE_PAGES; i++)
+		g->cache[i].valid = 0;
+}
+
+static void invalidate_range(libgdbr_t* g, ut64 address, ut64 len) {
+	ut64 addr = address - (address % GDBR_PAGE_SIZE);
+	if (!g->cache) return;
+	for (; addr < address + len; addr += GDBR_PAGE_SIZE) {
+		libgdbr_page_t *page = cache_page (g, addr);
+		if (page->addr == addr)
+			page->valid = 0;
+	}
+}
+
+static ut64 reg_value(libgdbr_t* g, const char** names) {
+	const ut8 *p;
+	ut64 val = 0;
+	int i, j, k, size;
+	for (i = 0; g->registers[i].size > 0; i++) {
+		for (j = 0; names[j]; j++) {
+			if (strcmp (g->registers[i].name, names[j]))
+				continue;
+			size = R_MIN (g->registers[i].size, sizeof (ut64));
+			if (g->registers[i].offset + size > g->data_len)
+				return 0;
+			/* the stub sends the registers in target byte order */
+			p = (const ut8*)g->data + g->registers[i].offset;
+			for (k = 0; k < size; k++)
+				val |= (ut64)p[g->big_endian? size - 1 - k: k] << (k * 8);
+			return val;
+		}
+	}
+	return 0;
+}
+
+/* reads the registers and the memory around pc and sp after a stop,
+ * which is what the debugger is going to ask for right after */
+static void prefetch_stop(libgdbr_t* g) {
+	static const char *pcs[] = { "rip", "eip", "pc", NULL };
+	static const char *sps[] = { "rsp", "esp", "sp", NULL };
+	uint8_t tmp[GDBR_PAGE_SIZE * 2];
+	ut64 pc, sp;
+	if (!g->registers || gdbr_read_registers (g) < 0)
+		return;
+	pc = reg_value (g, pcs);
+	sp = reg_value (g, sps);
+	if (pc) gdbr_read_memory_at (g, pc, tmp, sizeof (tmp));
+	if (sp > GDBR_PAGE_SIZE) gdbr_read_memory_at (g, sp - GDBR_PAGE_SIZE, tmp, sizeof (tmp));
+	// leave the registers in g->data as the callers expect
+	gdbr_read_registers (g);
+}
+
 int gdbr_write_memory(libgdbr_t* g, ut64 address, const uint8_t* data, ut64 len) {
 	char command[255] = {};
 	int ret = 0;
@@ -422,13 +644,14 @@ int gdbr_write_memory(libgdbr_t* g, ut64 address, const uint8_t* data, ut64 len)
 	char* tmp;
 	if (!g || !data) return -1;
 	command_len = snprintf(command, 255,
-		"%s%016"PFMT64x",%"PFMT64d":",
+		"%s%016"PFMT64x",%"PFMT64x":",
 		CMD_WRITEMEM, address, len);
 	tmp = calloc (command_len + (len * 2), sizeof(ut8));
 	if (!tmp)
 		return -1;
 	memcpy (tmp, command, command_len);
 	pack_hex ((char*)data, len, (tmp + command_len));
+	invalidate_range (g, address, len);
 	ret = send_command (g, tmp);
 	free (tmp);
 	if (ret < 0)
@@ -458,6 +681,8 @@ int gdbr_send_command(libgdbr_t* g, char* command) {
 	if (!cmd) return -1;
 	strcpy (cmd, CMD_QRCMD);
 	pack_hex (command, strlen (command), (cmd + strlen (CMD_QRCMD)));
+	// monitor commands can change anything in the target
+	gdbr_invalidate_cache (g);
 	ret = send_command (g, cmd);
 	free (cmd);
 	if (ret < 0) return ret;
@@ -473,6 +698,7 @@ int gdbr_write_bin_registers(libgdbr_t* g){
 	uint64_t buffer_size;
 	char* command;
 	if (!g) return -1;
+	g->regs_valid = 0;
 	buffer_size = g->data_len * 2 + 8;
 	command = calloc (buffer_size, sizeof (char));
 	if (!command) return -1;
@@ -492,6 +718,7 @@ int gdbr_write_register(libgdbr_t* g, int index, char* value, int len) {
 	int ret;
 	char command[255] = {};
 	if (!g) return -1;
+	g->regs_valid = 0;
 	ret = snprintf (command, 255, "%s%d=", CMD_WRITEREG, index);
 	memcpy (command + ret, value, len);
 	pack_hex (value, len, (command + ret));
@@ -587,6 +814,7 @@ int gdbr_write_registers(libgdbr_t* g, char* registers) {
 
 	free (buff);
 
+	g->regs_valid = 0;
 	buffer_size = g->data_len * 2 + 8;
 	command = calloc(buffer_size, sizeof(char));
 	if (!command)
@@ -623,11 +851,16 @@ int send_vcont(libgdbr_t* g, const char* command, int thread_id) {
 		ret = snprintf (tmp, 255, "%s;%s:%x", CMD_C, command, thread_id);
 	}
 	if (ret < 0) return ret;
+	gdbr_invalidate_cache (g);
 	ret = send_command (g, tmp);
 	if (ret < 0) return ret;
 	if (read_packet (g) > 0) { 
 		parse_packet (g, 0);
-		return handle_cont (g);
+		ret = handle_cont (g);
+		// 'S' and 'T' are stop replies, the target is still alive
+		if (g->data_len > 0 && (g->data[0] == 'S' || g->data[0] == 'T'))
+			prefetch_stop (g);
+		return ret;
 	}
 	return 0;
 }
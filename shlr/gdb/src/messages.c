@@ -33,8 +33,15 @@ int handle_P(libgdbr_t* g) {
 }
 
 int handle_m(libgdbr_t* g) {
-	int len = strlen (g->data);
-	g->data_len = strlen (g->data) / 2;
+	int len = g->data_len;
+	// error replies look like "Exx", an odd amount of hex digits
+	if (len == 3 && g->data[0] == 'E') {
+		g->data_len = 0;
+		g->last_code = MSG_ERROR_1;
+		return send_ack (g);
+	}
+	g->data_len = len / 2;
+	g->last_code = MSG_OK;
 	unpack_hex (g->data, len, g->data);
 	return send_ack (g);
 }
@@ -46,7 +53,27 @@ int handle_cmd(libgdbr_t* g) {
 }
 
 int handle_connect(libgdbr_t* g) {
-	// TODO handle the message correct and set all infos like packetsize, thread stuff and features
+	// TODO handle thread stuff and the rest of the features
+	char *p = strstr (g->data, "PacketSize=");
+	if (p) {
+		ssize_t pkt_sz = strtoul (p + strlen ("PacketSize="), NULL, 16);
+		if (pkt_sz > GDBR_MAX_PACKET_SIZE)
+			pkt_sz = GDBR_MAX_PACKET_SIZE;
+		// replies can be as big as the packets we are allowed to send
+		if (pkt_sz + 64 > g->read_max) {
+			char *read_buff = realloc (g->read_buff, pkt_sz + 64);
+			char *data = read_buff? realloc (g->data, pkt_sz + 64): NULL;
+			if (read_buff) {
+				g->read_buff = read_buff;
+			}
+			if (data) {
+				g->data = data;
+				g->read_max = g->data_max = pkt_sz + 64;
+			}
+		}
+		g->stub_features.pkt_sz = R_MIN (pkt_sz, g->read_max - 64);
+	}
+	g->stub_features.binary_upload = strstr (g->data, "binary-upload+") != NULL;
 	return send_ack (g);
 }
 
@@ -91,6 +91,8 @@ int parse_packet(libgdbr_t* g, int data_offset) {
 		target_pos += po_size + runlength;
 	}
 	g->data_len = target_pos; // setting the resulting length
+	if (target_pos < g->data_max)
+		g->data[target_pos] = '\0';
 	g->read_len = 0; // reset the read_buf len
 	return 0;
 }
@@ -103,16 +105,34 @@ int send_packet(libgdbr_t* g) {
 	return r_socket_write (g->sock, g->send_buff, g->send_len);
 }
 
+/**
+ * Checks if the buffer already holds a whole $<data>#<checksum> packet.
+ * '#' cannot appear unescaped inside the data, even in binary replies
+ */
+static int packet_complete(const char* buf, int len) {
+	int i = 0;
+	while (i < len && buf[i] != '$') i++;
+	while (i < len && buf[i] != '#') i++;
+	return (i + 2 < len);
+}
+
 int read_packet(libgdbr_t* g) {
-	int po_size = 0;
+	int ret, po_size = 0;
 	if (!g) {
 		fprintf (stderr, "Initialize libgdbr_t first\n");
 		return -1;
 	}
-	while (r_socket_ready (g->sock, 0, 250 * 1000) > 0) {
-		po_size += r_socket_read (g->sock, (
+	// stop as soon as the reply is complete instead of waiting
+	// for the socket to be idle, which costs 250ms per packet
+	while (po_size < g->read_max && r_socket_ready (g->sock, 0, 250 * 1000) > 0) {
+		ret = r_socket_read (g->sock, (
 			(ut8*)g->read_buff + po_size),
 			(g->read_max - po_size));
+		if (ret <= 0)
+			break;
+		po_size += ret;
+		if (packet_complete (g->read_buff, po_size))
+			break;
 	}
 	g->read_len = po_size;
 	return po_size;
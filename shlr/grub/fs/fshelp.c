@@ -257,7 +257,7 @@ grub_fshelp_find_file (const char *path, grub_fshelp_node_t rootnode,
 
   return 0;
 }
-unsigned long long grub_hack_lastoff = 0;
+R_TH_LOCAL unsigned long long grub_hack_lastoff = 0;
 
 /* Read LEN bytes from the file NODE on disk DISK into the buffer BUF,
    beginning with the block POS.  READ_HOOK should be set before
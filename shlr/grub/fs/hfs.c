@@ -177,9 +177,9 @@ grub_hfs_block (struct grub_hfs_data *data, grub_hfs_datarecord_t dat,
   struct grub_hfs_extent_key key;
 
   int tree = 0;
-  static int cache_file = 0;
-  static int cache_pos = 0;
-  static grub_hfs_datarecord_t cache_dr;
+  static R_TH_LOCAL int cache_file = 0;
+  static R_TH_LOCAL int cache_pos = 0;
+  static R_TH_LOCAL grub_hfs_datarecord_t cache_dr;
 
   grub_memcpy (dr, dat, sizeof (dr));
 
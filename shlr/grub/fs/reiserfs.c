@@ -51,7 +51,9 @@
 #define REISERFS_MAX_LABEL_LENGTH 16
 #define REISERFS_LABEL_OFFSET 0x64
 
+#ifndef S_IFLNK
 #define S_IFLNK 0xA000
+#endif
 
 static grub_dl_t my_mod;
 
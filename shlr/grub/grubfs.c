@@ -7,28 +7,19 @@
 #include <string.h>
 
 
-static RIOBind *bio = NULL;
-static ut64 delta = 0;
-
 static void* empty (int sz) {
 	void *p = malloc (sz);
 	if (p) memset (p, '\0', sz);
 	return p;
 }
 
+/* disk->data is the RFSRoot, so every mount reads its own device */
 static grub_err_t read_foo (struct grub_disk *disk, grub_disk_addr_t sector, grub_size_t size, char *buf) {
 	if (disk != NULL) {
 		const int blocksize = 512; // unhardcode 512
-		int ret;
-		RIOBind *iob = disk->data;
-		if (bio) iob = bio;
-		//printf ("io %p\n", file->root->iob.io);
-		ret = iob->read_at (iob->io, delta+(blocksize*sector),
-			(ut8*)buf, size*blocksize);
-		if (ret == -1)
+		RFSRoot *root = disk->data;
+		if (r_fs_root_read (root, blocksize*sector, (ut8*)buf, size*blocksize) == -1)
 			return 1;
-		//printf ("DISK PTR = %p\n", disk->data);
-		//printf ("\nBUF: %x %x %x %x\n", buf[0], buf[1], buf[2], buf[3]);
 	} else eprintf ("oops. no disk\n");
 	return 0; // 0 is ok
 }
@@ -65,8 +56,3 @@ void grubfs_free (GrubFS *gf) {
 		free (gf);
 	}
 }
-
-void grubfs_bind_io (RIOBind *iob, ut64 _delta) {
-	bio = iob;
-	delta = _delta;
-}
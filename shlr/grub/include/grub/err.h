@@ -21,6 +21,7 @@
 #define GRUB_ERR_HEADER	1
 
 #include <grub/symbol.h>
+#include <grub/types.h>
 
 typedef enum
   {
@@ -59,8 +60,8 @@ typedef enum
   }
 grub_err_t;
 
-extern grub_err_t grub_errno;
-extern char grub_errmsg[];
+extern R_TH_LOCAL grub_err_t grub_errno;
+extern R_TH_LOCAL char grub_errmsg[];
 
 grub_err_t grub_error (grub_err_t n, const char *fmt, ...);
 void grub_fatal (const char *fmt, ...);
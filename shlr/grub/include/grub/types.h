@@ -40,6 +40,9 @@
 # endif
 #endif /* ! GRUB_UTIL */
 
+/* R_TH_LOCAL: state kept per thread, r_fs reads several files in parallel */
+#include <r_types.h>
+
 #if GRUB_CPU_SIZEOF_VOID_P != 4 && GRUB_CPU_SIZEOF_VOID_P != 8
 # error "This architecture is not supported because sizeof(void *) != 4 and sizeof(void *) != 8"
 #endif
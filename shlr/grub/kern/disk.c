@@ -444,8 +444,10 @@ grub_disk_read (grub_disk_t disk, grub_disk_addr_t sector,
       if (len > size)
 	len = size;
 
-      /* Fetch the cache.  */
-      data = grub_disk_cache_fetch (disk->dev->id, disk->id, start_sector);
+      /* Fetch the cache. r_fs disks have no size, their blocks are
+	 cached by the RFSRoot instead of this process wide table.  */
+      data = disk->total_sectors
+	? grub_disk_cache_fetch (disk->dev->id, disk->id, start_sector) : 0;
       if (data)
 	{
 	  /* Just copy it!  */
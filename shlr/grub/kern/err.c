@@ -36,17 +36,17 @@ GRUB_EXPORT(grub_err_printf);
 #define GRUB_MAX_ERRMSG		256
 #define GRUB_ERROR_STACK_SIZE	10
 
-grub_err_t grub_errno;
-char grub_errmsg[GRUB_MAX_ERRMSG];
+R_TH_LOCAL grub_err_t grub_errno;
+R_TH_LOCAL char grub_errmsg[GRUB_MAX_ERRMSG];
 
-static struct
+static R_TH_LOCAL struct
 {
   grub_err_t no;
   char errmsg[GRUB_MAX_ERRMSG];
 } grub_error_stack_items[GRUB_ERROR_STACK_SIZE];
 
-static int grub_error_stack_pos;
-static int grub_error_stack_assert;
+static R_TH_LOCAL int grub_error_stack_pos;
+static R_TH_LOCAL int grub_error_stack_assert;
 
 grub_err_t
 grub_error (grub_err_t n, const char *fmt, ...)
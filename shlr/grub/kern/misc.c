@@ -21,6 +21,7 @@
 #include <grub/err.h>
 #include <grub/mm.h>
 #include <stdarg.h>
+#include <string.h>
 #include <grub/term.h>
 #include <grub/env.h>
 #include <grub/i18n.h>
@@ -83,22 +84,8 @@ const char* (*grub_gettext) (const char *s) = grub_gettext_dummy;
 void *
 grub_memmove (void *dest, const void *src, grub_size_t n)
 {
-  char *d = (char *) dest;
-  const char *s = (const char *) src;
-
-  if (d < s)
-    while (n--)
-      *d++ = *s++;
-  else
-    {
-      d += n;
-      s += n;
-
-      while (n--)
-	*--d = *--s;
-    }
-
-  return dest;
+  /* every block read by the filesystems is copied with it */
+  return memmove (dest, src, n);
 }
 
 char *
@@ -1,6 +1,7 @@
 /* sdb - LGPLv3 - Copyright 2011-2015 - pancake */
 
 #include "sdb.h"
+#include <ctype.h>
 
 #define PUSH_PREPENDS 1
 // TODO: missing num_{inc/dec} functions
@@ -47,9 +48,243 @@ static inline int int_cmp(const void *a, const void *b) {
 	return (int)(*va  - *vb);
 } 
 
+static int num_cmp(const void *a, const void *b) {
+	const ut64 va = *(const ut64 *)a;
+	const ut64 vb = *(const ut64 *)b;
+	return (va > vb) - (va < vb);
+}
+
+/* first index holding a value >= v */
+static int nums_lower(const ut64 *a, int len, ut64 v) {
+	int lo = 0, hi = len, mid;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (a[mid] < v)
+			lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+static int nums_grow(ut64 **a, int *size, int need) {
+	ut64 *p;
+	int n;
+	if (need <= *size)
+		return 1;
+	for (n = *size? *size: 8; n < need; n *= 2);
+	p = realloc (*a, n * sizeof (ut64));
+	if (!p) return 0;
+	*a = p;
+	*size = n;
+	return 1;
+}
+
+static int nums_count(const ut64 *a, int len, ut64 v) {
+	int i = nums_lower (a, len, v), j = i;
+	while (j < len && a[j] == v)
+		j++;
+	return j - i;
+}
+
+/* insert v in the sorted run a, which is kept short */
+static int nums_put(ut64 **a, int *len, int *size, ut64 v) {
+	int i;
+	if (!nums_grow (a, size, *len + 1))
+		return 0;
+	i = nums_lower (*a, *len, v);
+	memmove (*a + i + 1, *a + i, (*len - i) * sizeof (ut64));
+	(*a)[i] = v;
+	(*len)++;
+	return 1;
+}
+
+/* drop the pending removals and fold the recent insertions
+ * into the main vector, both in place */
+static int nums_merge(SdbNums *n) {
+	int i, j, k;
+	if (n->dlen) {
+		for (i = j = k = 0; i < n->len; i++) {
+			while (j < n->dlen && n->d[j] < n->a[i])
+				j++;
+			if (j < n->dlen && n->d[j] == n->a[i])
+				j++;
+			else n->a[k++] = n->a[i];
+		}
+		n->len = k;
+		n->dlen = 0;
+	}
+	if (!n->tlen)
+		return 1;
+	if (!nums_grow (&n->a, &n->size, n->len + n->tlen))
+		return 0;
+	i = n->len - 1;
+	j = n->tlen - 1;
+	for (k = n->len + n->tlen - 1; j >= 0; k--) {
+		if (i >= 0 && n->a[i] > n->t[j])
+			n->a[k] = n->a[i--];
+		else n->a[k] = n->t[j--];
+	}
+	n->len += n->tlen;
+	n->tlen = 0;
+	return 1;
+}
+
+/* the side runs are merged once they outgrow sqrt(len) */
+static int nums_balance(SdbNums *n, int runlen) {
+	if (runlen >= 64 && (ut64)runlen * runlen > (ut64)n->len)
+		return nums_merge (n);
+	return 1;
+}
+
+static int nums_size(SdbNums *n) {
+	return n->len + n->tlen - n->dlen;
+}
+
+static int nums_has(SdbNums *n, ut64 v) {
+	if (nums_count (n->t, n->tlen, v))
+		return 1;
+	if (!n->dlen) {
+		int i = nums_lower (n->a, n->len, v);
+		return i < n->len && n->a[i] == v;
+	}
+	return nums_count (n->a, n->len, v) > nums_count (n->d, n->dlen, v);
+}
+
+static int nums_insert(SdbNums *n, ut64 v) {
+	/* ascending insertions, the common case, are appended */
+	if (!n->len || v >= n->a[n->len - 1]) {
+		if (!nums_grow (&n->a, &n->size, n->len + 1))
+			return 0;
+		n->a[n->len++] = v;
+		return 1;
+	}
+	if (!nums_put (&n->t, &n->tlen, &n->tsize, v))
+		return 0;
+	return nums_balance (n, n->tlen);
+}
+
+static int nums_remove(SdbNums *n, ut64 v) {
+	int i = nums_lower (n->t, n->tlen, v);
+	if (i < n->tlen && n->t[i] == v) {
+		memmove (n->t + i, n->t + i + 1, (n->tlen - i - 1) * sizeof (ut64));
+		n->tlen--;
+		return 1;
+	}
+	if (n->len && n->a[n->len - 1] == v && !nums_count (n->d, n->dlen, v)) {
+		n->len--;
+		return 1;
+	}
+	if (nums_count (n->a, n->len, v) <= nums_count (n->d, n->dlen, v))
+		return 0;
+	if (!nums_put (&n->d, &n->dlen, &n->dsize, v))
+		return 0;
+	nums_balance (n, n->dlen);
+	return 1;
+}
+
+/* "0", "0x1f" or "31", as written by sdb_itoa */
+static int nums_item(const char *p, const char **end, ut64 *v) {
+	const char *q = p;
+	if (p[0] == '0' && p[1] == 'x') {
+		for (q = p + 2; isxdigit ((ut8)*q); q++);
+		if (q == p + 2) return 0;
+	} else if (*p >= '1' && *p <= '9') {
+		for (q = p + 1; *q >= '0' && *q <= '9'; q++);
+	} else if (*p == '0') {
+		q = p + 1;
+	} else return 0;
+	if (*q && *q != SDB_RS)
+		return 0;
+	*v = strtoull (p, NULL, 0);
+	*end = q;
+	return 1;
+}
+
+/* parse a comma separated value, NULL unless every item is a number */
+SDB_API SdbNums *sdb_nums_new(const char *str) {
+	SdbNums *n = calloc (1, sizeof (SdbNums));
+	const char *p = str;
+	ut64 v;
+	if (!n) return NULL;
+	n->stale = 1;
+	if (!p || !*p)
+		return n;
+	for (;;) {
+		if (!nums_item (p, &p, &v) || !nums_grow (&n->a, &n->size, n->len + 1)) {
+			sdb_nums_free (n);
+			return NULL;
+		}
+		n->a[n->len++] = v;
+		if (!*p) break;
+		p++;
+	}
+	qsort (n->a, n->len, sizeof (ut64), num_cmp);
+	return n;
+}
+
+SDB_API void sdb_nums_free(SdbNums *n) {
+	if (n) {
+		free (n->a);
+		free (n->t);
+		free (n->d);
+		free (n);
+	}
+}
+
+/* readers sharing a database may race to rebuild the same string,
+ * only one of them does it while the others wait for the result */
+#if defined(__ATOMIC_ACQUIRE)
+static int nums_busy = 0;
+#define nums_stale(n) __atomic_load_n (&(n)->stale, __ATOMIC_ACQUIRE)
+#define nums_fresh(n) __atomic_store_n (&(n)->stale, 0, __ATOMIC_RELEASE)
+#define nums_lock() while (__atomic_exchange_n (&nums_busy, 1, __ATOMIC_ACQUIRE))
+#define nums_unlock() __atomic_store_n (&nums_busy, 0, __ATOMIC_RELEASE)
+#else
+#define nums_stale(n) ((n)->stale)
+#define nums_fresh(n) ((n)->stale = 0)
+#define nums_lock()
+#define nums_unlock()
+#endif
+
+/* the string form of kv, rebuilt from its numeric array if needed */
+SDB_API const char *sdb_kv_value(SdbKv *kv) {
+	SdbNums *n = kv->nums;
+	char *str, *p, buf[64];
+	int i, len;
+	if (!n || !nums_stale (n))
+		return kv->value;
+	nums_lock ();
+	if (!n->stale || !nums_merge (n) || !(str = malloc ((size_t)n->len * 20 + 1))) {
+		nums_unlock ();
+		return kv->value;
+	}
+	p = str;
+	for (i = 0; i < n->len; i++) {
+		const char *v = sdb_itoa (n->a[i], buf, SDB_NUM_BASE);
+		if (i) *p++ = SDB_RS;
+		len = strlen (v);
+		memcpy (p, v, len);
+		p += len;
+	}
+	*p = 0;
+	sdb_kv_set_value (kv, str, (int)(p - str) + 1);
+	nums_fresh (n);
+	nums_unlock ();
+	return kv->value;
+}
+
 SDB_API ut64 sdb_array_get_num(Sdb *s, const char *key, int idx, ut32 *cas) {
 	const char *str, *n, *p;
+	SdbKv *kv = s? ht_lookup (s->ht, sdb_hash (key), key): NULL;
 	int i;
+	if (kv && kv->nums && !kv->expire) {
+		if (cas) *cas = kv->cas;
+		/* merges the pending runs without writing outside the rebuild lock */
+		sdb_kv_value (kv);
+		if (idx < 0 || idx >= kv->nums->len)
+			return 0LL;
+		return kv->nums->a[idx];
+	}
 	p = str = sdb_const_get (s, key, cas);
 	if (!str || !*str)
 		return 0LL;
@@ -158,6 +393,14 @@ SDB_API int sdb_array_set_num(Sdb *s, const char *key, int idx, ut64 val, ut32 c
 
 SDB_API int sdb_array_add_num(Sdb *s, const char *key, ut64 val, ut32 cas) {
 	char valstr10[64], valstr16[64];
+	SdbKv *kv = sdb_kv_nums (s, key, 1);
+	if (kv) {
+		if ((cas && cas != kv->cas) || nums_has (kv->nums, val))
+			return 0;
+		if (!nums_insert (kv->nums, val))
+			return 0;
+		return sdb_kv_nums_changed (s, kv);
+	}
 	char *v10 = sdb_itoa (val, valstr10, 10);
 	char *v16 = sdb_itoa (val, valstr16, 16);
 	// TODO: optimize
@@ -226,8 +469,15 @@ SDB_API int sdb_array_add_sorted(Sdb *s, const char *key, const char *val, ut32
 SDB_API int sdb_array_add_sorted_num(Sdb *s, const char *key, ut64 val, ut32 cas) {
 	int i;
 	char valstr[64];
-	const char *str = sdb_const_get (s, key, 0);
-	const char *n = str;
+	SdbKv *kv = sdb_kv_nums (s, key, 1);
+	const char *str, *n;
+	if (kv) {
+		if ((cas && cas != kv->cas) || !nums_insert (kv->nums, val))
+			return 0;
+		sdb_kv_nums_changed (s, kv);
+		return 0;
+	}
+	n = str = sdb_const_get (s, key, 0);
 	if (!str || !*str)
 		return sdb_set (s, key, sdb_itoa (val, valstr, SDB_NUM_BASE), cas);
 	for (i=0; n != NULL; i++) {
@@ -289,9 +539,17 @@ SDB_API int sdb_array_set(Sdb *s, const char *key, int idx, const char *val, ut3
 }
 
 SDB_API int sdb_array_remove_num(Sdb *s, const char *key, ut64 val, ut32 cas) {
-	const char *n, *p, *str = sdb_const_get (s, key, 0);
+	const char *n, *p, *str;
+	SdbKv *kv = sdb_kv_nums (s, key, 0);
 	int idx = 0;
 	ut64 num;
+	if (kv) {
+		if ((cas && cas != kv->cas) || !nums_remove (kv->nums, val))
+			return 0;
+		sdb_kv_nums_changed (s, kv);
+		return 1;
+	}
+	str = sdb_const_get (s, key, 0);
 	if (!str) return 0;
 	for (p=str; ; idx++) {
 		num = sdb_atoi (p);
@@ -372,7 +630,13 @@ SDB_API int sdb_array_delete(Sdb *s, const char *key, int idx, ut32 cas) {
 // XXX Doesnt works if numbers are stored in different base
 SDB_API int sdb_array_contains_num(Sdb *s, const char *key, ut64 num, ut32 *cas) {
 	char val[64];
-	char *nval = sdb_itoa (num, val, SDB_NUM_BASE);
+	char *nval;
+	SdbKv *kv = s? ht_lookup (s->ht, sdb_hash (key), key): NULL;
+	if (kv && kv->nums && !kv->expire) {
+		if (cas) *cas = kv->cas;
+		return nums_has (kv->nums, num);
+	}
+	nval = sdb_itoa (num, val, SDB_NUM_BASE);
 	return sdb_array_contains (s, key, nval, cas);
 }
 
@@ -396,11 +660,17 @@ SDB_API int sdb_array_contains(Sdb *s, const char *key, const char *val, ut32 *c
 }
 
 SDB_API int sdb_array_size(Sdb *s, const char *key) {
+	SdbKv *kv = s? ht_lookup (s->ht, sdb_hash (key), key): NULL;
+	if (kv && kv->nums && !kv->expire)
+		return nums_size (kv->nums);
 	return sdb_alen (sdb_const_get (s, key, 0));
 }
 
 // NOTE: ignore empty buckets
 SDB_API int sdb_array_length(Sdb *s, const char *key) {
+	SdbKv *kv = s? ht_lookup (s->ht, sdb_hash (key), key): NULL;
+	if (kv && kv->nums && !kv->expire)
+		return nums_size (kv->nums);
 	return sdb_alen_ignore_empty (sdb_const_get (s, key, 0));
 }
 
@@ -510,6 +780,10 @@ SDB_API void sdb_array_sort_num(Sdb *s, const char *key, ut32 cas) {
 	char *ret, *nstr, *str;
 	int lstr, i;
 	ut64 *nums;
+	SdbKv *kv = s? ht_lookup (s->ht, sdb_hash (key), key): NULL;
+	/* numeric arrays are always sorted */
+	if (kv && kv->nums)
+		return;
 	str = sdb_get_len (s, key, &lstr, 0);
 	if (!str) return;
 	if (!*str) {
@@ -9,14 +9,37 @@
 #include <sys/mman.h>
 #endif
 
-/* XXX: this code must be rewritten . too slow */
+static inline void unpack_kvlen(const ut8 *buf, ut32 *klen, ut32 *vlen) {
+	*klen = (ut32)buf[0];
+	*vlen = (ut32)(buf[1] | ((ut32)buf[2]<<8) | ((ut32)buf[3]<<16));
+}
+
 int cdb_getkvlen(int fd, ut32 *klen, ut32 *vlen) {
 	ut8 buf[4] = {0};
 	*klen = *vlen = 0;
 	if (fd == -1 || read (fd, buf, sizeof (buf)) != sizeof (buf))
 		return 0;
-	*klen = (ut32)buf[0];
-	*vlen = (ut32)(buf[1] | ((ut32)buf[2]<<8) | ((ut32)buf[3]<<16));
+	unpack_kvlen (buf, klen, vlen);
+	return 1;
+}
+
+/* walk the records of the mapped file without copying them. *pos starts
+ * at 2048, the records end where the first hash table begins */
+int cdb_nextkv(struct cdb *c, ut32 *pos, const char **key, ut32 *klen, const char **val, ut32 *vlen) {
+	ut32 end;
+	if (!c->map || c->size < 2048 + KVLSZ)
+		return 0;
+	ut32_unpack (c->map, &end);
+	if (end > c->size)
+		end = c->size;
+	if (*pos < 2048 || *pos + KVLSZ > end)
+		return 0;
+	unpack_kvlen ((const ut8 *)c->map + *pos, klen, vlen);
+	if (*klen < 1 || *vlen < 1 || *pos + KVLSZ + *klen + *vlen > end)
+		return 0;
+	*key = c->map + *pos + KVLSZ;
+	*val = *key + *klen;
+	*pos += KVLSZ + *klen + *vlen;
 	return 1;
 }
 
@@ -36,7 +59,7 @@ void cdb_findstart(struct cdb *c) {
 
 int cdb_init(struct cdb *c, int fd) {
 	struct stat st;
-	c->map = NULL;
+	cdb_free (c);
 	c->fd = fd;
 	cdb_findstart (c);
 	if (fd != -1 && !fstat (fd, &st) && st.st_size>4 && st.st_size != (off_t)UT64_MAX) {
@@ -81,6 +104,11 @@ int cdb_read(struct cdb *c, char *buf, ut32 len, ut32 pos) {
 static int match(struct cdb *c, const char *key, ut32 len, ut32 pos) {
 	char buf[32];
 	const size_t szb = sizeof buf;
+	if (c->map) {
+		if (pos > c->size || c->size - pos < len)
+			return -1;
+		return !memcmp (c->map + pos, key, len);
+	}
 	while (len > 0) {
 		int n = (szb>len)? len: szb;
 		if (!cdb_read (c, buf, n, pos))
@@ -125,13 +153,10 @@ int cdb_findnext(struct cdb *c, ut32 u, const char *key, ut32 len) {
 			c->kpos = c->hpos;
 		ut32_unpack (buf, &u);
 		if (u == c->khash) {
-			if (!seek_set (c->fd, pos)) {
-
-				return -1;
-			}
-			if (!cdb_getkvlen (c->fd, &u, &c->dlen)) {
+			if (!cdb_read (c, buf, KVLSZ, pos)) {
 				return -1;
 			}
+			unpack_kvlen ((const ut8 *)buf, &u, &c->dlen);
 			if (u == 0) {
 				return -1;
 			}
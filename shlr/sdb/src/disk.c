@@ -109,7 +109,6 @@ SDB_API int sdb_disk_finish (Sdb* s) {
 		if (ret && rr<0) {
 			ret = 0;
 		}
-		cdb_init (&s->db, s->fd);
 	}
 	return ret;
 }
@@ -2,6 +2,7 @@
 #include "types.h"
 
 typedef void (*HtKvFreeFunc)(void *);
+typedef const char *(*HtKeyFunc)(void *);
 
 /** ht **/
 typedef struct ht_entry_t {
@@ -10,22 +11,20 @@ typedef struct ht_entry_t {
 	void *data;
 } SdbHashEntry;
 
+/* open addressing with robin hood linear probing over a power of two
+ * table. the list keeps the data in insertion order for iteration */
 typedef struct ht_t {
 	SdbList *list;
 	SdbHashEntry *table;
+	HtKeyFunc key;
 	ut32 size;
-	ut32 rehash;
 	ut32 max_entries;
-	ut32 size_index;
 	ut32 entries;
-	ut32 deleted_entries;
 } SdbHash;
 
-SdbHash* ht_new(SdbListFree f);
+SdbHash* ht_new(SdbListFree f, HtKeyFunc key);
 void ht_free(SdbHash *ht);
-//void ht_set(SdbHash *ht, ut32 hash, void *data);
-SdbHashEntry* ht_search(SdbHash *ht, ut32 hash);
-void *ht_lookup(SdbHash *ht, ut32 hash);
-void ht_set(SdbHash *ht, ut32 hash, void *data);
+SdbHashEntry* ht_search(SdbHash *ht, ut32 hash, const char *key);
+void *ht_lookup(SdbHash *ht, ut32 hash, const char *key);
 int ht_insert(SdbHash *ht, ut32 hash, void *data, SdbListIter *iter);
 void ht_delete_entry(SdbHash *ht, SdbHashEntry *entry);
@@ -14,6 +14,10 @@ static inline int nextcas() {
 	return cas++;
 }
 
+static const char *sdb_kv_key (SdbKv *kv) {
+	return kv->key;
+}
+
 static SdbHook global_hook = NULL;
 static void* global_user = NULL;
 
@@ -65,6 +69,7 @@ SDB_API Sdb* sdb_new (const char *path, const char *name, int lock) {
 	} else {
 		s->last = sdb_now ();
 		s->fd = -1;
+		cdb_init (&s->db, s->fd);
 	}
 	s->journal = -1;
 	s->fdump = -1;
@@ -74,13 +79,12 @@ SDB_API Sdb* sdb_new (const char *path, const char *name, int lock) {
 		goto fail;
 	s->ns->free = NULL;
 	if (!s->ns) goto fail;
-	s->ht = ht_new ((SdbListFree)sdb_kv_free);
+	s->ht = ht_new ((SdbListFree)sdb_kv_free, (HtKeyFunc)sdb_kv_key);
 	s->lock = lock;
 	// s->ht->list->free = (SdbListFree)sdb_kv_free;
 	// if open fails ignore
 	if (global_hook)
 		sdb_hook (s, global_hook, global_user);
-	cdb_init (&s->db, s->fd);
 	return s;
 fail:
 	if (s->fd != -1) {
@@ -123,6 +127,7 @@ static void sdb_fini(Sdb* s, int donull) {
 	}
 	free (s->ndump);
 	free (s->dir);
+	free (s->tmpkv.key);
 	free (s->tmpkv.value);
 	s->tmpkv.value_len = 0;
 	if (donull)
@@ -146,6 +151,7 @@ SDB_API int sdb_free (Sdb* s) {
 SDB_API const char *sdb_const_get_len (Sdb* s, const char *key, int *vlen, ut32 *cas) {
 	ut32 hash, pos, len, keylen;
 	ut64 now = 0LL;
+	struct cdb db;
 	SdbKv *kv;
 	if (cas) *cas = 0;
 	if (vlen) *vlen = 0;
@@ -154,9 +160,9 @@ SDB_API const char *sdb_const_get_len (Sdb* s, const char *key, int *vlen, ut32
 	keylen = strlen (key)+1;
 	hash = sdb_hash (key);
 	/* search in memory */
-	kv = (SdbKv*)ht_lookup (s->ht, hash);
+	kv = (SdbKv*)ht_lookup (s->ht, hash, key);
 	if (kv) {
-		if (*kv->value) {
+		if (*sdb_kv_value (kv)) {
 			if (kv->expire) {
 				if (!now) now = sdb_now ();
 				if (now > kv->expire) {
@@ -173,14 +179,15 @@ SDB_API const char *sdb_const_get_len (Sdb* s, const char *key, int *vlen, ut32
 	/* search in disk */
 	if (s->fd == -1)
 		return NULL;
-	(void)cdb_findstart (&s->db);
-	if (cdb_findnext (&s->db, hash, key, keylen) <1)
+	db = s->db;
+	cdb_findstart (&db);
+	if (cdb_findnext (&db, hash, key, keylen) <1)
 		return NULL;
-	len = cdb_datalen (&s->db);
+	len = cdb_datalen (&db);
 	if (len == 0)
 		return NULL;
 	if (vlen) *vlen = len;
-	pos = cdb_datapos (&s->db);
+	pos = cdb_datapos (&db);
 	return s->db.map+pos;
 }
 
@@ -193,6 +200,7 @@ SDB_API const char *sdb_const_get (Sdb* s, const char *key, ut32 *cas) {
 SDB_API char *sdb_get_len (Sdb* s, const char *key, int *vlen, ut32 *cas) {
 	ut32 hash, pos, len, keylen;
 	ut64 now = 0LL;
+	struct cdb db;
 	SdbKv *kv;
 	char *buf;
 
@@ -203,9 +211,9 @@ SDB_API char *sdb_get_len (Sdb* s, const char *key, int *vlen, ut32 *cas) {
 	hash = sdb_hash (key);
 
 	/* search in memory */
-	kv = (SdbKv*)ht_lookup (s->ht, hash);
+	kv = (SdbKv*)ht_lookup (s->ht, hash, key);
 	if (kv) {
-		if (!*kv->value)
+		if (!*sdb_kv_value (kv))
 			return NULL;
 		if (kv->expire) {
 			if (!now) now = sdb_now ();
@@ -222,17 +230,18 @@ SDB_API char *sdb_get_len (Sdb* s, const char *key, int *vlen, ut32 *cas) {
 	/* search in disk */
 	if (s->fd == -1)
 		return NULL;
-	(void)cdb_findstart (&s->db);
-	if (!cdb_findnext (&s->db, hash, key, keylen))
+	db = s->db;
+	cdb_findstart (&db);
+	if (!cdb_findnext (&db, hash, key, keylen))
 		return NULL;
-	if ((len = cdb_datalen (&s->db)) >= SDB_MAX_VALUE)
+	if ((len = cdb_datalen (&db)) >= SDB_MAX_VALUE)
 		return NULL;
 	if (vlen)
 		*vlen = len;
 	if (!(buf = malloc (len+1))) // XXX too many mallocs
 		return NULL;
-	pos = cdb_datapos (&s->db);
-	cdb_read (&s->db, buf, len, pos);
+	pos = cdb_datapos (&db);
+	cdb_read (&db, buf, len, pos);
 	buf[len] = 0;
 	return buf;
 }
@@ -249,10 +258,9 @@ SDB_API int sdb_unset (Sdb* s, const char *key, ut32 cas) {
 SDB_API int sdb_remove(Sdb *s, const char *key, ut32 cas) {
 	SdbHashEntry *e;
 	ut32 hash = sdb_hash (key);
-	e = ht_search (s->ht, hash);
+	e = ht_search (s->ht, hash, key);
 	if (e) {
 		ht_delete_entry (s->ht, e);
-		ls_delete (s->ht->list, e->iter);
 		return 1;
 	}
 	return 0;
@@ -300,18 +308,20 @@ SDB_API int sdb_add (Sdb* s, const char *key, const char *val, ut32 cas) {
 }
 
 SDB_API int sdb_exists (Sdb* s, const char *key) {
+	struct cdb db;
 	char ch;
 	SdbKv *kv;
 	int klen = strlen (key)+1;
 	ut32 pos, hash = sdb_hash (key);
-	kv = (SdbKv*)ht_lookup (s->ht, hash);
-	if (kv) return (*kv->value)? 1: 0;
+	kv = (SdbKv*)ht_lookup (s->ht, hash, key);
+	if (kv) return (*sdb_kv_value (kv))? 1: 0;
 	if (s->fd == -1)
 		return 0;
-	(void)cdb_findstart (&s->db);
-	if (cdb_findnext (&s->db, hash, key, klen)) {
-		pos = cdb_datapos (&s->db);
-		cdb_read (&s->db, &ch, 1, pos);
+	db = s->db;
+	cdb_findstart (&db);
+	if (cdb_findnext (&db, hash, key, klen)) {
+		pos = cdb_datapos (&db);
+		cdb_read (&db, &ch, 1, pos);
 		return ch != 0;
 	}
 	return 0;
@@ -342,9 +352,7 @@ SDB_API int sdb_open (Sdb *s, const char *file) {
 		}
 		s->last = st.st_mtime;
 	}
-	if (s->fd != -1) {
-		cdb_init (&s->db, s->fd);
-	}
+	cdb_init (&s->db, s->fd);
 	return s->fd;
 }
 
@@ -368,13 +376,13 @@ SDB_API void sdb_reset (Sdb* s) {
 	/* empty memory hashtable */
 	if (s->ht)
 		ht_free (s->ht);
-	s->ht = ht_new ((SdbListFree)sdb_kv_free);
+	s->ht = ht_new ((SdbListFree)sdb_kv_free, (HtKeyFunc)sdb_kv_key);
 }
 
-// TODO: too many allocs here. use slices
+/* the kv, its key and short values share a single allocation */
 SDB_API SdbKv* sdb_kv_new (const char *k, const char *v) {
 	SdbKv *kv;
-	int vl;
+	int kl, vl, il;
 	if (!sdb_check_key (k))
 		return NULL;
 	if (v) {
@@ -384,23 +392,94 @@ SDB_API SdbKv* sdb_kv_new (const char *k, const char *v) {
 	} else {
 		vl = 0;
 	}
-	kv = R_NEW (SdbKv);
-	strncpy (kv->key, k, sizeof (kv->key)-1);
+	kl = strlen (k)+1;
+	if (kl > SDB_KSZ)
+		kl = SDB_KSZ;
+	il = (vl <= SDB_KV_INLINE)? vl: 0;
+	kv = malloc (sizeof (SdbKv) + il + kl);
+	if (!kv)
+		return NULL;
+	kv->key = (char *)(kv + 1) + il;
+	memcpy (kv->key, k, kl - 1);
+	kv->key[kl - 1] = 0;
 	kv->value_len = vl;
-	if (vl) {
+	if (il) {
+		kv->value = (char *)(kv + 1);
+		memcpy (kv->value, v, vl);
+	} else if (vl) {
 		kv->value = malloc (vl);
+		if (!kv->value) {
+			free (kv);
+			return NULL;
+		}
 		memcpy (kv->value, v, vl);
 	} else kv->value = NULL;
 	kv->cas = nextcas ();
 	kv->expire = 0LL;
+	kv->nums = NULL;
 	return kv;
 }
 
+/* replace the value of kv with v, which is owned by kv from now on */
+SDB_API void sdb_kv_set_value (SdbKv *kv, char *v, int vl) {
+	if (kv->value != (char *)(kv + 1))
+		free (kv->value);
+	kv->value = v;
+	kv->value_len = vl;
+}
+
 SDB_API void sdb_kv_free (SdbKv *kv) {
-	free (kv->value);
+	sdb_nums_free (kv->nums);
+	if (kv->value != (char *)(kv + 1))
+		free (kv->value);
 	free (kv);
 }
 
+/* in-memory kv of key holding a numeric array. the current value is
+ * converted when all its items are numbers, otherwise returns NULL */
+SDB_API SdbKv *sdb_kv_nums (Sdb *s, const char *key, int create) {
+	const char *str;
+	SdbNums *nums;
+	SdbKv *kv;
+	ut32 hash;
+	if (!s || !key)
+		return NULL;
+	hash = sdb_hash (key);
+	kv = (SdbKv*)ht_lookup (s->ht, hash, key);
+	if (kv && kv->nums && (!kv->expire || sdb_now () <= kv->expire))
+		return kv;
+	str = sdb_const_get (s, key, NULL);
+	if (!str && !create)
+		return NULL;
+	if (!(nums = sdb_nums_new (str)))
+		return NULL;
+	kv = (SdbKv*)ht_lookup (s->ht, hash, key);
+	if (!kv) {
+		kv = sdb_kv_new (key, "");
+		if (!kv) {
+			sdb_nums_free (nums);
+			return NULL;
+		}
+		ht_insert (s->ht, hash, kv, NULL);
+	}
+	sdb_nums_free (kv->nums);
+	kv->nums = nums;
+	return kv;
+}
+
+/* account a change made through kv->nums */
+SDB_API ut32 sdb_kv_nums_changed (Sdb *s, SdbKv *kv) {
+	const char *v = NULL;
+	kv->nums->stale = 1;
+	kv->cas = nextcas ();
+	if (s->journal != -1 || s->hooks)
+		v = sdb_kv_value (kv);
+	if (s->journal != -1)
+		sdb_journal_log (s, kv->key, v);
+	sdb_hook_call (s, kv->key, v);
+	return kv->cas;
+}
+
 static int sdb_set_internal (Sdb* s, const char *key, char *val, int owned, ut32 cas) {
 	ut32 hash, klen;
 	SdbHashEntry *e;
@@ -420,21 +499,22 @@ static int sdb_set_internal (Sdb* s, const char *key, char *val, int owned, ut32
 	vlen = strlen (val)+1;
 	hash = sdb_hash (key);
 	cdb_findstart (&s->db);
-	e = ht_search (s->ht, hash);
+	e = ht_search (s->ht, hash, key);
 	if (e) {
 		if (cdb_findnext (&s->db, hash, key, klen)) {
 			kv = e->data;
 			if (cas && kv->cas != cas)
 				return 0;
 			kv->cas = cas = nextcas ();
+			if (kv->nums) {
+				sdb_nums_free (kv->nums);
+				kv->nums = NULL;
+			}
 			if (owned) {
-				kv->value_len = vlen;
-				free (kv->value);
-				kv->value = val; // owned
+				sdb_kv_set_value (kv, val, vlen);
 			} else {
 				if (vlen>kv->value_len) {
-					free (kv->value);
-					kv->value = strdup (val);
+					sdb_kv_set_value (kv, strdup (val), vlen);
 				} else {
 					memcpy (kv->value, val, vlen);
 				}
@@ -473,39 +553,82 @@ SDB_API int sdb_set (Sdb* s, const char *key, const char *val, ut32 cas) {
 	return sdb_set_internal (s, key, (char*)val, 0, cas);
 }
 
+static int dump_next(Sdb *s, ut32 *pos, const char **key, const char **value, int *vlen) {
+	const char *k, *v;
+	ut32 klen, vl;
+	if (s->fd == -1)
+		return 0;
+	while (cdb_nextkv (&s->db, pos, &k, &klen, &v, &vl)) {
+		/* sdb always writes them zero terminated */
+		if (k[klen-1] || v[vl-1])
+			continue;
+		if (key) *key = k;
+		if (value) *value = v;
+		if (vlen) *vlen = vl;
+		return 1;
+	}
+	return 0;
+}
+
+/* dump_next() for databases that could not be mapped: reads the next
+ * record from the file at s->pos. the copies left in *kbuf and *vbuf
+ * are released by the next call */
+static int dump_next_read(Sdb *s, const char **key, const char **value, int *vlen, char **kbuf, char **vbuf) {
+	for (;;) {
+		free (*kbuf);
+		free (*vbuf);
+		*kbuf = *vbuf = NULL;
+		if (!sdb_dump_dupnext (s, kbuf, vbuf, vlen))
+			return 0;
+		if (*kbuf && *vbuf)
+			break;
+	}
+	*key = *kbuf;
+	*value = *vbuf;
+	return 1;
+}
+
+/* walks the database with its own cursor, so concurrent readers can
+ * share it as long as the callbacks do not modify it. when the file is
+ * not mapped the records are read through s->fd instead */
 SDB_API int sdb_foreach (Sdb* s, SdbForeachCallback cb, void *user) {
 	SdbListIter *iter;
-	char *k, *v;
+	const char *k, *v;
+	char *kbuf = NULL, *vbuf = NULL;
+	ut32 pos = 2048;
 	SdbKv *kv;
+	int mapped;
 	if (!s) return 0;
-	sdb_dump_begin (s);
-	while (sdb_dump_dupnext (s, &k, &v, NULL)) {
+	mapped = s->db.map != NULL;
+	if (!mapped)
+		sdb_dump_begin (s);
+	while (mapped? dump_next (s, &pos, &k, &v, NULL)
+			: dump_next_read (s, &k, &v, NULL, &kbuf, &vbuf)) {
 		ut32 hash = sdb_hash (k);
-		SdbHashEntry *hte = ht_search (s->ht, hash);
+		SdbHashEntry *hte = ht_search (s->ht, hash, k);
 		if (hte) {
-			free (k);
-			free (v);
 			kv = (SdbKv*)hte->data;
-			if (!*kv->value) {
+			if (!*sdb_kv_value (kv)) {
 				// deleted = 1;
 				continue;
 			}
 			if (!cb (user, kv->key, kv->value))
-				return 0;
-		} else {
-			int ret = cb (user, k, v);
-			free (k);
-			free (v);
-			if (!ret) return 0;
+				goto stop;
+		} else if (!cb (user, k, v)) {
+			goto stop;
 		}
 	}
 	ls_foreach (s->ht->list, iter, kv) {
-		if (!kv->value || !*kv->value)
+		if (!kv->value || !*sdb_kv_value (kv))
 			continue;
 		if (!cb (user, kv->key, kv->value))
 			return 0;
 	}
 	return 1;
+stop:
+	free (kbuf);
+	free (vbuf);
+	return 0;
 }
 
 // TODO: reuse sdb_foreach DEPRECATE WTF NOT READING THE CDB?
@@ -515,7 +638,7 @@ SDB_API void sdb_list (Sdb* s) {
 	if (!s || !s->ht)
 		return;
 	ls_foreach (s->ht->list, iter, kv) {
-		if (!kv->value || !*kv->value)
+		if (!kv->value || !*sdb_kv_value (kv))
 			continue;
 		printf ("%s=%s\n", kv->key, kv->value);
 	}
@@ -523,39 +646,36 @@ SDB_API void sdb_list (Sdb* s) {
 
 SDB_API int sdb_sync (Sdb* s) {
 	SdbListIter it, *iter;
-	char *k, *v;
+	const char *k, *v;
+	char *kbuf = NULL, *vbuf = NULL;
 	SdbKv *kv;
+	int vl, mapped;
 
 	if (!s || !sdb_disk_create (s)) {
 		return 0;
 	}
-// TODO: use sdb_foreach here
+	mapped = s->db.map != NULL;
 	sdb_dump_begin (s);
-	/* iterate over all keys in disk database */
-	while (sdb_dump_dupnext (s, &k, &v, NULL)) {
+	/* stream the disk database into the new one, replacing the keys
+	 * changed in memory. the old file stays open until the rename */
+	while (mapped? sdb_dump_next_const (s, &k, &v, &vl)
+			: dump_next_read (s, &k, &v, &vl, &kbuf, &vbuf)) {
 		ut32 hash = sdb_hash (k);
 		/* find that key in the memory storage */
-		SdbHashEntry *hte = ht_search (s->ht, hash);
+		SdbHashEntry *hte = ht_search (s->ht, hash, k);
 		if (hte) {
 			kv = (SdbKv*)hte->data;
-			if (kv && *kv->value) {
-				/* asume k = kv->key */
+			if (kv && *sdb_kv_value (kv)) {
 				sdb_disk_insert (s, k, kv->value);
 			}
-			// XXX: This fails if key is dupped
-			//else printf ("remove (%s)\n", kv->key);
-			ls_delete (s->ht->list, hte->iter);
-			hte->iter = NULL;
 			ht_delete_entry (s->ht, hte);
-		} else if (v && *v) {
-			sdb_disk_insert (s, k, v);
+		} else if (vl > 1) {
+			cdb_make_add (&s->m, k, strlen (k)+1, v, vl);
 		}
-		free (k);
-		free (v);
 	}
 	/* append new keyvalues */
 	ls_foreach (s->ht->list, iter, kv) {
-		if (*kv->value && kv->expire == 0LL) {
+		if (*sdb_kv_value (kv) && kv->expire == 0LL) {
 			if (sdb_disk_insert (s, kv->key, kv->value)) {
 				it.n = iter->n;
 				//sdb_unset (s, kv->key, 0);
@@ -570,7 +690,7 @@ SDB_API int sdb_sync (Sdb* s) {
 	return 1;
 }
 
-// TODO: optimize: do not use syscalls here. we can just do mmap and pointer arithmetics
+/* only used when the database could not be mapped */
 static int getbytes(Sdb *s, char *b, int len) {
 	if (read (s->fd, b, len) != len)
 		return -1;
@@ -579,9 +699,18 @@ static int getbytes(Sdb *s, char *b, int len) {
 }
 
 SDB_API void sdb_dump_begin (Sdb* s) {
-	if (s->fd != -1)
-		seek_set (s->fd, (s->pos=2048));
-	else s->pos = 0;
+	if (s->fd != -1) {
+		s->pos = 2048;
+		if (!s->db.map)
+			seek_set (s->fd, s->pos);
+	} else s->pos = 0;
+}
+
+/* next key and value of the disk database, pointing to its mapping, so
+ * they are only valid until the database is reopened. vlen counts the
+ * zero terminator */
+SDB_API int sdb_dump_next_const (Sdb* s, const char **key, const char **value, int *vlen) {
+	return dump_next (s, &s->pos, key, value, vlen);
 }
 
 SDB_API SdbKv *sdb_dump_next (Sdb* s) {
@@ -591,9 +720,8 @@ SDB_API SdbKv *sdb_dump_next (Sdb* s) {
 	if (!sdb_dump_dupnext (s, &k, &v, &vl))
 		return NULL;
 	vl--;
-	strncpy (s->tmpkv.key, k, SDB_KSZ-1);
-	s->tmpkv.key[SDB_KSZ-1] = '\0';
-	free (k);
+	free (s->tmpkv.key);
+	s->tmpkv.key = k;
 	free (s->tmpkv.value);
 	s->tmpkv.value = v;
 	s->tmpkv.value_len = vl;
@@ -609,6 +737,32 @@ SDB_API int sdb_dump_dupnext (Sdb* s, char **key, char **value, int *_vlen) {
 		*_vlen = 0;
 	if (s->fd==-1)
 		return 0;
+	if (s->db.map) {
+		const char *k, *v;
+		int vl;
+		if (!sdb_dump_next_const (s, &k, &v, &vl))
+			return 0;
+		klen = strlen (k)+1;
+		vlen = vl;
+		if (_vlen)
+			*_vlen = vlen;
+		if (key && klen>=SDB_MIN_KEY && klen<SDB_MAX_KEY) {
+			if (!(*key = malloc (klen)))
+				return 0;
+			memcpy (*key, k, klen);
+		}
+		if (value && vlen>=SDB_MIN_VALUE && vlen<SDB_MAX_VALUE) {
+			if (!(*value = malloc (vlen))) {
+				if (key) {
+					free (*key);
+					*key = NULL;
+				}
+				return 0;
+			}
+			memcpy (*value, v, vlen);
+		}
+		return 1;
+	}
 	if (!cdb_getkvlen (s->fd, &klen, &vlen))
 		return 0;
 	if (klen<1 || vlen<1)
@@ -672,9 +826,9 @@ SDB_API int sdb_expire_set(Sdb* s, const char *key, ut64 expire, ut32 cas) {
 		return 1;
 	}
 	hash = sdb_hash (key);
-	kv = (SdbKv*)ht_lookup (s->ht, hash);
+	kv = (SdbKv*)ht_lookup (s->ht, hash, key);
 	if (kv) {
-		if (*kv->value) {
+		if (*sdb_kv_value (kv)) {
 			if (!cas || cas == kv->cas) {
 				kv->expire = parse_expire (expire);
 				return 1;
@@ -702,8 +856,8 @@ SDB_API int sdb_expire_set(Sdb* s, const char *key, ut64 expire, ut32 cas) {
 SDB_API ut64 sdb_expire_get(Sdb* s, const char *key, ut32 *cas) {
 	SdbKv *kv;
 	ut32 hash = sdb_hash (key);
-	kv = (SdbKv*)ht_lookup (s->ht, hash);
-	if (kv && *kv->value) {
+	kv = (SdbKv*)ht_lookup (s->ht, hash, key);
+	if (kv && *sdb_kv_value (kv)) {
 		if (cas) *cas = kv->cas;
 		return kv->expire;
 	}
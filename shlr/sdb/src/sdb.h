@@ -56,14 +56,39 @@ extern char *strdup (const char *);
 // This size implies trailing zero terminator, this is 254 chars + 0
 #define SDB_KSZ 0xff
 
+/* numeric array value: a sorted vector plus two short sorted runs with
+ * the recent out of order insertions and the pending removals, merged
+ * when they outgrow sqrt(len).
+ * the comma separated form in kv->value is only rebuilt when read */
+typedef struct sdb_nums_t {
+	ut64 *a;
+	int len;
+	int size;
+	ut64 *t;
+	int tlen;
+	int tsize;
+	ut64 *d;
+	int dlen;
+	int dsize;
+	int stale;
+} SdbNums;
+
+// Values up to this size, terminator included, are stored in the kv
+#define SDB_KV_INLINE 32
+
 typedef struct sdb_kv {
-	char key[SDB_KSZ];
+	char *key;
 	char *value;
 	int value_len;
 	ut64 expire;
 	ut32 cas;
+	SdbNums *nums;
 } SdbKv;
 
+/* An Sdb is not locked internally. Any number of threads may read it
+ * (get, exists, foreach, array queries) while nothing writes to it, as
+ * long as its disk database is mapped and no read hits an expired key,
+ * because those are removed on lookup. Writers need exclusive access. */
 typedef struct sdb_t {
 	char *dir; // path+name
 	char *path;
@@ -133,6 +158,9 @@ int  sdb_add (Sdb* s, const char *key, const char *val, ut32 cas);
 void sdb_list(Sdb*);
 int  sdb_sync (Sdb*);
 void sdb_kv_free (SdbKv *kv);
+void sdb_kv_set_value (SdbKv *kv, char *v, int vl);
+SDB_API SdbKv *sdb_kv_nums (Sdb *s, const char *key, int create);
+SDB_API ut32 sdb_kv_nums_changed (Sdb *s, SdbKv *kv);
 
 /* num.c */
 int  sdb_num_exists (Sdb*, const char *key);
@@ -159,6 +187,7 @@ int sdb_disk_unlink (Sdb* s);
 void sdb_dump_begin (Sdb* s);
 SdbKv *sdb_dump_next (Sdb* s);
 int sdb_dump_dupnext (Sdb* s, char **key, char **value, int *_vlen);
+int sdb_dump_next_const (Sdb* s, const char **key, const char **value, int *vlen);
 
 /* journaling */
 int sdb_journal_close(Sdb *s);
@@ -239,6 +268,10 @@ int sdb_array_add_sorted (Sdb *s, const char *key, const char *val, ut32 cas);
 int sdb_array_add_sorted_num (Sdb *s, const char *key, ut64 val, ut32 cas);
 int sdb_array_remove (Sdb *s, const char *key, const char *val, ut32 cas);
 int sdb_array_remove_num (Sdb* s, const char *key, ut64 val, ut32 cas);
+// numeric arrays
+SDB_API SdbNums *sdb_nums_new (const char *str);
+SDB_API void sdb_nums_free (SdbNums *n);
+SDB_API const char *sdb_kv_value (SdbKv *kv);
 // helpers
 char *sdb_anext(char *str, char **next);
 const char *sdb_const_anext(const char *str, const char **next);
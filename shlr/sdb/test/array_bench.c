@@ -0,0 +1,76 @@
+/* sdb numeric arrays: insertion and lookup of 1M elements */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "sdb.h"
+
+static double now() {
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static ut64 rnd(ut64 *x) {
+	*x ^= *x << 13;
+	*x ^= *x >> 7;
+	*x ^= *x << 17;
+	return *x;
+}
+
+/* n insertions in key, random or ascending, returns the elapsed time */
+static double fill(Sdb *s, const char *key, int n, int random) {
+	ut64 x = 88172645463325252ULL;
+	double t = now ();
+	int i;
+	for (i = 0; i < n; i++)
+		sdb_array_add_num (s, key, random? rnd (&x) % (n * 4ULL): i, 0);
+	return now () - t;
+}
+
+int main(int argc, char **argv) {
+	int i, n = argc > 1? atoi (argv[1]): 1000000;
+	int fail = 0, slow = n / 50, found = 0;
+	Sdb *s = sdb_new0 ();
+	ut64 x = 88172645463325252ULL, prev = 0, v;
+	double t;
+
+	printf ("seq add:    %.3fs (%d)\n", fill (s, "seq", n, 0), n);
+	t = fill (s, "rnd", n, 1);
+	printf ("rand add:   %.3fs (%d)\n", t, sdb_array_size (s, "rnd"));
+	x = 1337;
+	t = now ();
+	for (i = 0; i < n; i++)
+		found += sdb_array_contains_num (s, "rnd", rnd (&x) % (n * 4ULL), NULL);
+	printf ("contains:   %.3fs (%d hits)\n", now () - t, found);
+	t = now ();
+	for (i = 0; i < n; i += 2)
+		sdb_array_remove_num (s, "seq", i, 0);
+	printf ("remove:     %.3fs\n", now () - t);
+	if (sdb_array_size (s, "seq") != n / 2 || sdb_array_contains_num (s, "seq", 2, NULL)
+			|| !sdb_array_contains_num (s, "seq", 3, NULL))
+		fail++;
+	t = now ();
+	i = strlen (sdb_const_get (s, "rnd", NULL));
+	printf ("serialize:  %.3fs (%d bytes)\n", now () - t, i);
+	/* the string view is sorted and parses back to the same set */
+	for (i = 0; i < sdb_array_size (s, "rnd"); i++) {
+		v = sdb_array_get_num (s, "rnd", i, NULL);
+		if (i && v <= prev)
+			fail++;
+		prev = v;
+	}
+	sdb_set (s, "copy", sdb_const_get (s, "rnd", NULL), 0);
+	if (sdb_array_size (s, "copy") != sdb_array_size (s, "rnd")
+			|| !sdb_array_contains_num (s, "copy", prev, NULL))
+		fail++;
+	/* non numeric values take the string path */
+	sdb_set (s, "str", "foo", 0);
+	printf ("string add: %.3fs (%d)\n", fill (s, "str", slow, 1), slow);
+	printf ("nums add:   %.3fs (%d)\n", fill (s, "nums", slow, 1), slow);
+	if (!sdb_array_contains (s, "str", "foo", NULL))
+		fail++;
+	sdb_free (s);
+	printf ("%s\n", fail? "[-] failed": "[+] ok");
+	return fail? 1: 0;
+}
@@ -0,0 +1,76 @@
+/* sdb in-memory table: insert, lookup, update, remove and iterate n keys */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "sdb.h"
+
+static double now() {
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static int count_cb(void *user, const char *k, const char *v) {
+	(*(int *)user)++;
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	int i, n = argc > 1? atoi (argv[1]): 1000000;
+	int fail = 0, found = 0, count = 0;
+	Sdb *s = sdb_new0 ();
+	struct rusage ru;
+	char k[64], v[64];
+	const char *r;
+	double t;
+
+	t = now ();
+	for (i = 0; i < n; i++) {
+		sprintf (k, "fcn.%08x.name", i * 16);
+		sprintf (v, "0x%x", i);
+		sdb_set (s, k, v, 0);
+	}
+	printf ("insert:  %.3fs (%d keys)\n", now () - t, n);
+	t = now ();
+	for (i = 0; i < n; i++) {
+		sprintf (k, "fcn.%08x.name", (int)((i * 2654435761U) % n) * 16);
+		if ((r = sdb_const_get (s, k, NULL)))
+			found++;
+	}
+	printf ("hit:     %.3fs (%d found)\n", now () - t, found);
+	fail += found != n;
+	t = now ();
+	for (i = 0, found = 0; i < n; i++) {
+		sprintf (k, "fcn.%08x.size", i * 16);
+		if (sdb_const_get (s, k, NULL))
+			found++;
+	}
+	printf ("miss:    %.3fs\n", now () - t);
+	fail += found != 0;
+	t = now ();
+	for (i = 0; i < n; i++) {
+		sprintf (k, "fcn.%08x.name", i * 16);
+		sdb_set (s, k, (i & 1)? "updated": "", 0);
+	}
+	printf ("update:  %.3fs\n", now () - t);
+	t = now ();
+	for (i = 0; i < n; i += 2) {
+		sprintf (k, "fcn.%08x.name", i * 16);
+		sdb_remove (s, k, 0);
+	}
+	printf ("remove:  %.3fs\n", now () - t);
+	t = now ();
+	sdb_foreach (s, count_cb, &count);
+	printf ("foreach: %.3fs (%d keys)\n", now () - t, count);
+	fail += count != n / 2;
+	sprintf (k, "fcn.%08x.name", 16);
+	r = sdb_const_get (s, k, NULL);
+	fail += !r || strcmp (r, "updated");
+	getrusage (RUSAGE_SELF, &ru);
+	printf ("maxrss:  %ld MB\n", ru.ru_maxrss / 1024);
+	sdb_free (s);
+	printf ("%s\n", fail? "[-] failed": "[+] ok");
+	return fail? 1: 0;
+}
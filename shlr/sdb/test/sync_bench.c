@@ -0,0 +1,71 @@
+/* sdb_sync and sdb_foreach over a disk database of n keys */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "sdb.h"
+
+#define DB "sync_bench.sdb"
+
+static double now() {
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static int count_cb(void *user, const char *k, const char *v) {
+	(*(int *)user)++;
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	int i, n = argc > 1? atoi (argv[1]): 1000000;
+	int fail = 0, count = 0;
+	char k[64], v[64];
+	const char *r;
+	double t;
+	Sdb *s;
+
+	unlink (DB);
+	s = sdb_new (NULL, DB, 0);
+	for (i = 0; i < n; i++) {
+		sprintf (k, "blocks.%08x.size", i * 16);
+		sprintf (v, "0x%x", i);
+		sdb_set (s, k, v, 0);
+	}
+	t = now ();
+	sdb_sync (s);
+	printf ("sync new:   %.3fs (%d keys)\n", now () - t, n);
+	sdb_free (s);
+
+	s = sdb_new (NULL, DB, 0);
+	t = now ();
+	sdb_foreach (s, count_cb, &count);
+	printf ("foreach:    %.3fs (%d keys)\n", now () - t, count);
+	fail += count != n;
+	/* rewrite a tenth of the keys and drop another tenth */
+	for (i = 0; i < n; i += 10) {
+		sprintf (k, "blocks.%08x.size", i * 16);
+		sdb_set (s, k, "changed", 0);
+		sprintf (k, "blocks.%08x.size", (i + 1) * 16);
+		sdb_unset (s, k, 0);
+	}
+	t = now ();
+	sdb_sync (s);
+	printf ("sync delta: %.3fs\n", now () - t);
+	sdb_free (s);
+
+	s = sdb_new (NULL, DB, 0);
+	count = 0;
+	sdb_foreach (s, count_cb, &count);
+	fail += count != n - (n + 9) / 10;
+	r = sdb_const_get (s, "blocks.00000000.size", NULL);
+	fail += !r || strcmp (r, "changed");
+	r = sdb_const_get (s, "blocks.00000020.size", NULL);
+	fail += !r || strcmp (r, "0x2");
+	fail += sdb_exists (s, "blocks.00000010.size");
+	sdb_free (s);
+	unlink (DB);
+	printf ("%s\n", fail? "[-] failed": "[+] ok");
+	return fail? 1: 0;
+}